@@ -0,0 +1,8 @@
+// @Volatile: keep in sync with CameraBlock.
+layout (std140) uniform Camera {
+    mat4 world_to_view; // view
+    mat4 view_to_clip; // projection
+    mat4 clip_to_view; // inverse projection
+    mat4 view_to_world; // inverse view
+    vec3 view_pos;
+};
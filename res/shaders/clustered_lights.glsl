@@ -0,0 +1,45 @@
+#include "lights.glsl"
+
+// @Note: the cluster grid dimensions are injected by the application (see light_clusters.h).
+#ifndef LIGHT_CLUSTERS_X
+#define LIGHT_CLUSTERS_X 16
+#define LIGHT_CLUSTERS_Y 9
+#define LIGHT_CLUSTERS_Z 24
+#endif
+
+uniform samplerBuffer cluster_lights; // three texels per light
+uniform usamplerBuffer cluster_grid; // an (offset, count) pair into cluster_indices per cluster
+uniform usamplerBuffer cluster_indices;
+
+uniform vec2 cluster_depth_scale_bias; // slice = log(view depth) * scale + bias
+uniform vec2 cluster_tile_size; // in pixels
+
+// @Volatile: keep in sync with ClusterLight.
+Light fetch_light(int index) {
+    vec4 position_radius = texelFetch(cluster_lights, 3 * index + 0);
+    vec4 color_constant = texelFetch(cluster_lights, 3 * index + 1);
+    vec4 linear_quadratic = texelFetch(cluster_lights, 3 * index + 2);
+
+    return Light(
+        position_radius.xyz,
+        position_radius.w,
+        color_constant.rgb,
+        color_constant.a,
+        linear_quadratic.x,
+        linear_quadratic.y,
+        linear_quadratic.z);
+}
+
+// Returns the (offset, count) range of light indices of the cluster that the fragment is in.
+uvec2 fetch_cluster(vec2 frag_coord, float view_depth) {
+    ivec2 tile = clamp(
+        ivec2(frag_coord / cluster_tile_size), ivec2(0), ivec2(LIGHT_CLUSTERS_X, LIGHT_CLUSTERS_Y) - 1);
+    int slice = clamp(
+        int(floor(log(max(view_depth, 1e-6)) * cluster_depth_scale_bias.x + cluster_depth_scale_bias.y)), 0, LIGHT_CLUSTERS_Z - 1);
+
+    return texelFetch(cluster_grid, (slice * LIGHT_CLUSTERS_Y + tile.y) * LIGHT_CLUSTERS_X + tile.x).rg;
+}
+
+int fetch_cluster_light_index(uint i) {
+    return int(texelFetch(cluster_indices, int(i)).r);
+}
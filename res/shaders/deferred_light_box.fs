@@ -2,7 +2,7 @@
 
 out vec4 fragColor;
 
-uniform vec3 light_color;
+flat in vec3 light_color;
 
 void main() {
     fragColor = vec4(light_color, 1.0);
@@ -4,10 +4,19 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
-uniform mat4 local_to_world; // model
-uniform mat4 world_to_view; // view
-uniform mat4 view_to_clip; // projection
+flat out vec3 light_color;
+
+// @Note: there is one instance per light, which are scaled down to this size.
+uniform float light_scale;
+
+#include "clustered_lights.glsl"
+
+#include "camera.glsl"
 
 void main() {
-    gl_Position = vec4(aPos, 1.0) * local_to_world * world_to_view * view_to_clip;
+    Light light = fetch_light(gl_InstanceID);
+    vec3 pos_world = aPos * light_scale + light.position;
+    light_color = light.color;
+
+    gl_Position = vec4(pos_world, 1.0) * world_to_view * view_to_clip;
 }
@@ -0,0 +1,22 @@
+#version 330 core
+
+out vec4 fragColor;
+
+flat in int light_index;
+
+// @Note: GBUFFER_COMPACT, POINT_SHADOWS and POINT_SHADOWS_MAX are injected by the application
+// (see get_light_volume_pass).
+#include "gbuffer.glsl"
+#include "clustered_lights.glsl"
+#include "point_shadows.glsl"
+
+// @Note: the result is added to the ambient term (written by the lighting pass) with blending.
+void main() {
+    GBufferSample g = read_gbuffer(ivec2(gl_FragCoord.xy));
+
+    vec3 view_dir = normalize(view_pos - g.position);
+    Light light = fetch_light(light_index);
+
+    float shadow = light_shadow(light, g.position, g.normal);
+    fragColor = vec4(shadow * shade_light(light, g.position, g.normal, view_dir, g.albedo, g.specular), 1.0);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+flat out int light_index;
+
+// @Note: there is one instance per light, whose (unit) sphere is scaled by its radius.
+#include "clustered_lights.glsl"
+
+#include "camera.glsl"
+
+void main() {
+    Light light = fetch_light(gl_InstanceID);
+    vec3 pos_world = aPos * light.radius + light.position;
+    light_index = gl_InstanceID;
+
+    gl_Position = vec4(pos_world, 1.0) * world_to_view * view_to_clip;
+}
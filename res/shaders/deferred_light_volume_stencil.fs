@@ -0,0 +1,6 @@
+#version 330 core
+
+// @Note: the stencil pass only counts the light volumes that each pixel is inside of (with
+// separate stencil ops for front and back faces), so there's nothing to shade.
+void main() {
+}
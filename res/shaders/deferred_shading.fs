@@ -2,72 +2,176 @@
 
 out vec4 fragColor;
 
-struct Light {
-    vec3 position;
-    vec3 color;
-
-    // Light attenuation factors.
-    float constant;
-    float linear;
-    float quadratic;
-
-    // Light volume effect radius.
-    float radius;
-};
+// @Note: LIGHT_COUNT, LIGHTING_PATH, GBUFFER_COMPACT, SSAO, SHADOWS, SHADOW_CASCADES,
+// POINT_SHADOWS, POINT_SHADOWS_MAX and DRAW_MODE are injected by the application (see
+// ShaderDefine), where the Lights block is only used by the unclustered path.
+#include "gbuffer.glsl"
+#include "clustered_lights.glsl"
+#include "point_shadows.glsl"
+
+// @Volatile: keep in sync with the LIGHTING_ enum in main.inl.
+#define LIGHTING_UNCLUSTERED 0
+#define LIGHTING_CLUSTERED   1
+#define LIGHTING_VOLUMES     2 // @Note: only ambient, as each light is drawn as its own volume
+
+#ifndef LIGHTING_PATH
+#define LIGHTING_PATH LIGHTING_CLUSTERED
+#endif
+
+#define DRAW_LIGHTING 0
+#define DRAW_POSITION 1
+#define DRAW_NORMAL   2
+#define DRAW_ALBEDO   3
+#define DRAW_SPECULAR 4
+#define DRAW_OCCLUSION 6 // @Note: DRAW_LIGHT_VOLUMES (5) is shaded as DRAW_LIGHTING
+
+#ifndef DRAW_MODE
+#define DRAW_MODE DRAW_LIGHTING
+#endif
+
+#ifndef SSAO
+#define SSAO 0
+#endif
+
+#if SSAO
+uniform sampler2D ssao; // RG: occlusion, view depth (at half resolution, see ssao.fs)
+
+// @Note: how fast the weights fall off with the relative difference of depths.
+#define SSAO_DEPTH_SHARPNESS 32.0
+
+// @Note: a joint bilateral upsample, where the four half resolution texels around the pixel are
+// weighted by their bilinear weights and by how close their view depth is to the pixel's, so
+// that edges stay sharp (a texel covers the 2x2 pixels whose top left one it was computed at).
+float upsample_ssao(vec2 frag_coord, float view_depth) {
+    ivec2 size = textureSize(ssao, 0);
+    vec2 coord = (frag_coord - 0.5) * 0.5;
+    ivec2 base = ivec2(floor(coord));
+    vec2 f = coord - vec2(base);
+
+    float result = 0.0;
+    float weights = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        vec2 tap = texelFetch(ssao, clamp(base + offset, ivec2(0), size - 1), 0).rg;
+
+        vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+        float depth_difference = abs(tap.g - view_depth) / max(view_depth, 1e-4);
+        float range = exp(-SSAO_DEPTH_SHARPNESS * depth_difference);
+
+        // @Note: the epsilon falls back to bilinear where no texel is on the same surface.
+        float weight = bilinear.x * bilinear.y * (range + 1e-4);
+        result += tap.r * weight;
+        weights += weight;
+    }
+    return result / weights;
+}
+#endif
+
+// @Note: a directional light (shaded by every lighting path, as it covers every pixel).
+uniform vec3 sun_direction; // the direction that its light travels in (normalized)
+uniform vec3 sun_color; // black if it's disabled
+
+#ifndef SHADOWS
+#define SHADOWS 0
+#endif
+
+#if SHADOWS
+#ifndef SHADOW_CASCADES
+#define SHADOW_CASCADES 4
+#endif
+
+uniform sampler2DArrayShadow shadow_cascades; // @Note: a layer per cascade (see ShadowCascades)
+uniform mat4 shadow_world_to_light[SHADOW_CASCADES];
+uniform float shadow_split_depths[SHADOW_CASCADES]; // where each cascade's slice ends
+uniform float shadow_texel_sizes[SHADOW_CASCADES]; // in world units
+
+// @Note: the position is pushed along the normal by a texel of its cascade (which hides most of
+// the acne that the slope-scaled offset of the depth pass doesn't), and four compared fetches
+// (each of them a bilinear 2x2 PCF in hardware) filter it over a 3x3 texel footprint.
+float sample_sun_shadow(vec3 frag_pos, vec3 normal, float view_depth) {
+    if (view_depth > shadow_split_depths[SHADOW_CASCADES - 1]) {
+        return 1.0; // past the last cascade, i.e. farther than shadows are drawn
+    }
 
-in vec2 texcoord;
+    int cascade = 0;
+    for (int i = 0; i < SHADOW_CASCADES - 1; ++i) {
+        if (view_depth > shadow_split_depths[i]) { cascade = i + 1; }
+    }
 
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
-uniform sampler2D gAlbedoSpec;
+    vec3 offset_pos = frag_pos + normal * shadow_texel_sizes[cascade] * 1.5;
+    vec3 coords = (vec4(offset_pos, 1.0) * shadow_world_to_light[cascade]).xyz * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(shadow_cascades, 0).xy);
 
-#define LIGHT_COUNT 32
-uniform Light lights[LIGHT_COUNT];
+    float lit = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        vec2 offset = (vec2(i & 1, i >> 1) - 0.5) * texel;
+        lit += texture(shadow_cascades, vec4(coords.xy + offset, float(cascade), coords.z));
+    }
+    return 0.25 * lit;
+}
+#endif
 
-uniform vec3 view_pos;
+vec3 shade_sun(vec3 normal, vec3 view_dir, vec3 diffuse, float specular) {
+    vec3 light_dir = -sun_direction;
+    vec3 light_diffuse = max(dot(normal, light_dir), 0.0) * diffuse * sun_color;
 
-uniform int draw_mode;
-#define DRAW_POSITION 1
-#define DRAW_NORMAL   2
-#define DRAW_ALBEDO   3
-#define DRAW_SPECULAR 4
+    vec3 halfway_dir = normalize(light_dir + view_dir);
+    float spec = pow(max(dot(normal, halfway_dir), 0.0), 16.0);
+    return light_diffuse + sun_color * spec * specular;
+}
 
 void main() {
-    vec3 frag_pos = texture(gPosition, texcoord).rgb;
-    vec3 normal = texture(gNormal, texcoord).rgb;
-    vec3 diffuse = texture(gAlbedoSpec, texcoord).rgb;
-    float specular = texture(gAlbedoSpec, texcoord).a;
+    GBufferSample g = read_gbuffer(ivec2(gl_FragCoord.xy));
+    vec3 frag_pos = g.position;
+    vec3 normal = g.normal;
+    vec3 diffuse = g.albedo;
+    float specular = g.specular;
+    float view_depth = -(vec4(frag_pos, 1.0) * world_to_view).z;
+
+#if SSAO
+    float occlusion = upsample_ssao(gl_FragCoord.xy, view_depth);
+#else
+    float occlusion = 1.0;
+#endif
 
     // Debug the intermediate g-buffer textures.
-    if (0 < draw_mode && draw_mode < 5) {
-        if (draw_mode == DRAW_POSITION) fragColor = vec4(frag_pos,       1.0);
-        if (draw_mode == DRAW_NORMAL)   fragColor = vec4(normal,         1.0);
-        if (draw_mode == DRAW_ALBEDO)   fragColor = vec4(diffuse,        1.0);
-        if (draw_mode == DRAW_SPECULAR) fragColor = vec4(vec3(specular), 1.0);
-        return;
-    }
-
-    vec3 ambient = diffuse * 0.1;
+#if DRAW_MODE == DRAW_POSITION
+    fragColor = vec4(frag_pos, 1.0);
+#elif DRAW_MODE == DRAW_NORMAL
+    fragColor = vec4(normal, 1.0);
+#elif DRAW_MODE == DRAW_ALBEDO
+    fragColor = vec4(diffuse, 1.0);
+#elif DRAW_MODE == DRAW_SPECULAR
+    fragColor = vec4(vec3(specular), 1.0);
+#elif DRAW_MODE == DRAW_OCCLUSION
+    fragColor = vec4(vec3(occlusion), 1.0);
+#else
+    vec3 ambient = diffuse * 0.1 * occlusion;
     vec3 lighting = ambient;
     vec3 view_dir = normalize(view_pos - frag_pos);
 
+#if SHADOWS
+    float sun_shadow = sample_sun_shadow(frag_pos, normal, view_depth);
+#else
+    float sun_shadow = 1.0;
+#endif
+    lighting += sun_shadow * shade_sun(normal, view_dir, diffuse, specular);
+
+#if LIGHTING_PATH == LIGHTING_CLUSTERED
+    // Only loop over the lights whose volumes overlap the fragment's cluster.
+    uvec2 cluster = fetch_cluster(gl_FragCoord.xy, view_depth);
+    for (uint i = 0u; i < cluster.y; ++i) {
+        Light light = fetch_light(fetch_cluster_light_index(cluster.x + i));
+        float shadow = light_shadow(light, frag_pos, normal);
+        lighting += shadow * shade_light(light, frag_pos, normal, view_dir, diffuse, specular);
+    }
+#elif LIGHTING_PATH == LIGHTING_UNCLUSTERED
     for (int i = 0; i < LIGHT_COUNT; ++i) {
-        float dist = length(lights[i].position - frag_pos);
-        if (dist < lights[i].radius) {
-            vec3 light_dir = normalize(lights[i].position - frag_pos);
-            vec3 diffuse = max(dot(normal, light_dir), 0.0) * diffuse * lights[i].color;
-
-            vec3 halfway_dir = normalize(light_dir + view_dir);
-            float spec = pow(max(dot(normal, halfway_dir), 0.0), 16.0);
-            vec3 specular = lights[i].color * spec * specular;
-
-            float attenuation = 1.0 / (lights[i].constant + lights[i].linear * dist + lights[i].quadratic * dist * dist);
-
-            lighting += attenuation * (diffuse + specular);
-        } else {
-            // Do nothing, as the fragment is outside of the light's volume.
-        }
+        float shadow = light_shadow(lights[i], frag_pos, normal);
+        lighting += shadow * shade_light(lights[i], frag_pos, normal, view_dir, diffuse, specular);
     }
+#endif
 
     fragColor = vec4(lighting, 1.0);
+#endif
 }
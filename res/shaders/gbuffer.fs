@@ -1,22 +1,47 @@
 #version 330 core
 
+// @Note: GBUFFER_COMPACT is injected by the application (see gbuffer.glsl for both layouts).
+#ifndef GBUFFER_COMPACT
+#define GBUFFER_COMPACT 0
+#endif
+
+#if GBUFFER_COMPACT
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+#else
 layout (location = 0) out vec3 gPosition;
 layout (location = 1) out vec3 gNormal;
 layout (location = 2) out vec4 gAlbedoSpec;
+#endif
+
+#include "material.glsl"
+#include "octahedral.glsl"
 
 in VS_OUT {
     vec3 frag_pos;
     vec3 normal;
+    vec3 tangent;
     vec2 texcoord;
 } fs_in;
 
-uniform sampler2D texture_diffuse;
-uniform sampler2D texture_specular;
+vec3 compute_normal(float has_normal_map) {
+    vec3 normal = normalize(fs_in.normal);
+    // @Note: has_normal_map is constant per material, so this branch is coherent.
+    if (has_normal_map < 0.5) { return normal; }
+
+    return apply_normal_map(normal, fs_in.tangent, texture(texture_normal, fs_in.texcoord).rg);
+}
 
 void main() {
+    vec4 material = texture(texture_packed, fs_in.texcoord);
+
+#if GBUFFER_COMPACT
+    gNormal = encode_octahedral(compute_normal(material.a)) * 0.5 + 0.5; // @Note: to RG16 UNORM
+#else
     gPosition = fs_in.frag_pos;
-    gNormal = normalize(fs_in.normal);
+    gNormal = compute_normal(material.a);
+#endif
     // @Note: we pack both albedo and specular intensity into a single texture.
     gAlbedoSpec.rgb = texture(texture_diffuse, fs_in.texcoord).rgb;
-    gAlbedoSpec.a = texture(texture_specular, fs_in.texcoord).r;
+    gAlbedoSpec.a = material.r;
 }
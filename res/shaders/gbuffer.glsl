@@ -0,0 +1,48 @@
+#include "camera.glsl"
+#include "octahedral.glsl"
+
+// @Note: GBUFFER_COMPACT is injected by the application (see the GBUFFER_ enum in main.inl).
+#ifndef GBUFFER_COMPACT
+#define GBUFFER_COMPACT 0
+#endif
+
+// @Note: the classic layout stores world space positions (RGBA16F) and normals (RGBA16F),
+// while the compact one reconstructs positions from depth and stores octahedral normals (RG16).
+// Both pack albedo and specular intensity into a single RGBA8 texture.
+uniform sampler2D gPosition; // classic layout only
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gDepth; // compact layout only
+
+struct GBufferSample {
+    vec3 position; // in world space
+    vec3 normal;
+    vec3 albedo;
+    float specular;
+};
+
+vec3 read_gbuffer_position(ivec2 pixel) {
+#if GBUFFER_COMPACT
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(textureSize(gDepth, 0));
+
+    vec4 pos_view = vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0) * clip_to_view;
+    return (vec4(pos_view.xyz / pos_view.w, 1.0) * view_to_world).xyz;
+#else
+    return texelFetch(gPosition, pixel, 0).rgb;
+#endif
+}
+
+vec3 read_gbuffer_normal(ivec2 pixel) {
+#if GBUFFER_COMPACT
+    return decode_octahedral(texelFetch(gNormal, pixel, 0).rg * 2.0 - 1.0);
+#else
+    return texelFetch(gNormal, pixel, 0).rgb;
+#endif
+}
+
+GBufferSample read_gbuffer(ivec2 pixel) {
+    vec4 albedo_spec = texelFetch(gAlbedoSpec, pixel, 0);
+    return GBufferSample(
+        read_gbuffer_position(pixel), read_gbuffer_normal(pixel), albedo_spec.rgb, albedo_spec.a);
+}
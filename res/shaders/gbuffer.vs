@@ -3,26 +3,26 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec3 aTangent;
+layout (location = 4) in mat4 aInstanceLocalToWorld; // model (@Volatile: see mesh.h)
 
 out VS_OUT {
     vec3 frag_pos;
     vec3 normal;
+    vec3 tangent;
     vec2 texcoord;
 } vs_out;
 
-uniform mat4 local_to_world; // model
-uniform mat4 world_to_view; // view
-uniform mat4 view_to_clip; // projection
-
-uniform sampler2D texture_diffuse;
-uniform sampler2D texture_specular;
+#include "camera.glsl"
 
 void main() {
+    mat4 local_to_world = aInstanceLocalToWorld;
     vec4 pos_world = vec4(aPos, 1.0) * local_to_world;
     mat3 normal_matrix = transpose(inverse(mat3(local_to_world)));
 
     vs_out.frag_pos = vec3(pos_world);
     vs_out.normal = normalize(aNormal * normal_matrix);
+    vs_out.tangent = aTangent * mat3(local_to_world);
     vs_out.texcoord = aTexCoord;
 
     gl_Position = pos_world * world_to_view * view_to_clip;
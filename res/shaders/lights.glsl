@@ -0,0 +1,43 @@
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 32
+#endif
+
+// @Note: members are ordered so that each vec3 is followed by a float, as in std140
+// vec3s take up 16 bytes (which would otherwise be wasted as padding).
+struct Light {
+    vec3 position;
+    float radius; // light volume effect radius
+
+    vec3 color;
+
+    // Light attenuation factors.
+    float constant;
+    float linear;
+    float quadratic;
+
+    float shadow; // the slot of its point shadow (see point_shadows.glsl), or negative
+};
+
+// @Volatile: keep in sync with LightBlock.
+layout (std140) uniform Lights {
+    Light lights[LIGHT_COUNT];
+};
+
+// @Note: shared by every lighting path (i.e. the fullscreen loops and the light volumes).
+vec3 shade_light(Light light, vec3 frag_pos, vec3 normal, vec3 view_dir, vec3 diffuse, float specular) {
+    float dist = length(light.position - frag_pos);
+    if (dist >= light.radius) {
+        return vec3(0.0); // the fragment is outside of the light's volume
+    }
+
+    vec3 light_dir = normalize(light.position - frag_pos);
+    vec3 light_diffuse = max(dot(normal, light_dir), 0.0) * diffuse * light.color;
+
+    vec3 halfway_dir = normalize(light_dir + view_dir);
+    float spec = pow(max(dot(normal, halfway_dir), 0.0), 16.0);
+    vec3 light_specular = light.color * spec * specular;
+
+    float attenuation = 1.0 / (light.constant + light.linear * dist + light.quadratic * dist * dist);
+
+    return attenuation * (light_diffuse + light_specular);
+}
@@ -0,0 +1,19 @@
+// @Note: the material textures of the mesh being drawn (see bind_mesh_textures), which are
+// sampled by both the geometry pass and the visibility buffer's resolve pass.
+uniform sampler2D texture_diffuse;
+uniform sampler2D texture_packed; // R = specular, G = ambient, B = height, A = has normal map
+uniform sampler2D texture_normal; // @Note: RG only, as Z is reconstructed
+
+// @Note: normal_rg is what was sampled from texture_normal (for meshes that have one).
+vec3 apply_normal_map(vec3 normal, vec3 tangent, vec2 normal_rg) {
+    vec3 n;
+    n.xy = normal_rg * 2.0 - 1.0;
+    n.z = sqrt(max(1.0 - dot(n.xy, n.xy), 0.0));
+
+    // Fall back to the vertex normal on meshes without tangents.
+    if (dot(tangent, tangent) == 0.0) { return normal; }
+
+    tangent = normalize(tangent - dot(tangent, normal) * normal);
+    vec3 bitangent = cross(normal, tangent);
+    return normalize(mat3(tangent, bitangent, normal) * n);
+}
@@ -0,0 +1,6 @@
+#version 330 core
+
+// @Note: the bounds are only drawn to count whether any of their samples pass the depth test
+// (with color and depth writes disabled), so there's nothing to shade.
+void main() {
+}
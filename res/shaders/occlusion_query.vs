@@ -0,0 +1,15 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+// @Note: the unit cube (from -1 to 1) is stretched to these bounds, which are in world space.
+uniform vec3 bounds_min;
+uniform vec3 bounds_max;
+
+#include "camera.glsl"
+
+void main() {
+    vec3 pos_world = mix(bounds_min, bounds_max, aPos * 0.5 + 0.5);
+
+    gl_Position = vec4(pos_world, 1.0) * world_to_view * view_to_clip;
+}
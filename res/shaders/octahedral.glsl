@@ -0,0 +1,18 @@
+// @Note: maps unit vectors onto the faces of an octahedron, unfolded into the [-1, 1] square,
+// so that normals can be stored in two (16-bit) channels with an even precision everywhere.
+// Reference: https://jcgt.org/published/0003/02/01/ (A Survey of Efficient Representations)
+
+vec2 sign_not_zero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encode_octahedral(vec3 n) {
+    vec2 p = n.xy * (1.0 / (abs(n.x) + abs(n.y) + abs(n.z)));
+    return (n.z <= 0.0) ? ((1.0 - abs(p.yx)) * sign_not_zero(p)) : p;
+}
+
+vec3 decode_octahedral(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) { n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy); }
+    return normalize(n);
+}
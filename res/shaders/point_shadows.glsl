@@ -0,0 +1,79 @@
+#include "lights.glsl"
+
+// @Note: POINT_SHADOWS and POINT_SHADOWS_MAX are injected by the application, and lights whose
+// `shadow` is a slot (rather than negative) sample their faces in the atlas (see PointShadows).
+#ifndef POINT_SHADOWS
+#define POINT_SHADOWS 0
+#endif
+
+#if POINT_SHADOWS
+#ifndef POINT_SHADOWS_MAX
+#define POINT_SHADOWS_MAX 16
+#endif
+
+#define POINT_SHADOW_FACES 6
+#define POINT_SHADOW_NEAR 0.05 // @Volatile: keep in sync with point_shadows.h
+
+uniform sampler2DShadow point_shadow_atlas;
+uniform vec4 point_shadow_spheres[POINT_SHADOWS_MAX]; // position and radius, as rendered
+uniform vec4 point_shadow_tiles[POINT_SHADOWS_MAX * POINT_SHADOW_FACES]; // offset, size, texels
+
+// @Volatile: keep in sync with face_forwards and face_ups in point_shadows.c.
+const vec3 point_shadow_forwards[POINT_SHADOW_FACES] = vec3[POINT_SHADOW_FACES](
+    vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
+const vec3 point_shadow_ups[POINT_SHADOW_FACES] = vec3[POINT_SHADOW_FACES](
+    vec3(0, -1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, -1, 0), vec3(0, -1, 0));
+
+// @Note: the fragment is projected onto the face of its major axis, the same way that
+// mat4_lookat and mat4_perspective would (with a 90 degree field of view, which the tile's
+// rectangle maps to, inside of its border). As for the sun, the position is pushed along the
+// normal by about a texel and a half, and four compared fetches filter it.
+float sample_point_shadow(int slot, vec3 frag_pos, vec3 normal) {
+    vec4 sphere = point_shadow_spheres[slot];
+    if (sphere.w <= 0.0) {
+        return 1.0; // @Note: the slot was just freed
+    }
+
+    vec3 to_frag = frag_pos - sphere.xyz;
+    vec3 distances = abs(to_frag);
+    float texels = point_shadow_tiles[slot * POINT_SHADOW_FACES].w;
+    to_frag += normal * (3.0 * max(distances.x, max(distances.y, distances.z)) / texels);
+
+    distances = abs(to_frag);
+    int face = (distances.x >= distances.y && distances.x >= distances.z) ? (to_frag.x > 0.0 ? 0 : 1)
+             : (distances.y >= distances.z) ? (to_frag.y > 0.0 ? 2 : 3)
+             : (to_frag.z > 0.0 ? 4 : 5);
+
+    vec3 forward = point_shadow_forwards[face];
+    vec3 x_axis = normalize(cross(point_shadow_ups[face], -forward));
+    vec3 y_axis = cross(-forward, x_axis);
+    float depth = dot(to_frag, forward);
+    vec2 ndc = vec2(dot(to_frag, x_axis), dot(to_frag, y_axis)) / depth;
+
+    float near = POINT_SHADOW_NEAR;
+    float far = sphere.w;
+    float ndc_depth = (far + near) / (far - near) - 2.0 * far * near / ((far - near) * depth);
+    float reference = min(ndc_depth * 0.5 + 0.5, 1.0);
+
+    vec4 tile = point_shadow_tiles[slot * POINT_SHADOW_FACES + face];
+    vec2 uv = tile.xy + (ndc * 0.5 + 0.5) * tile.z;
+    vec2 texel = 1.0 / vec2(textureSize(point_shadow_atlas, 0));
+
+    float lit = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        vec2 offset = (vec2(i & 1, i >> 1) - 0.5) * texel;
+        lit += texture(point_shadow_atlas, vec3(uv + offset, reference));
+    }
+    return 0.25 * lit;
+}
+#endif
+
+// @Note: how much of the light reaches the fragment (all of it, unless it's shadowed).
+float light_shadow(Light light, vec3 frag_pos, vec3 normal) {
+#if POINT_SHADOWS
+    if (light.shadow >= 0.0 && distance(light.position, frag_pos) < light.radius) {
+        return sample_point_shadow(int(light.shadow), frag_pos, normal);
+    }
+#endif
+    return 1.0;
+}
@@ -0,0 +1,10 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 4) in mat4 aInstanceLocalToWorld; // model (@Volatile: see mesh.h)
+
+uniform mat4 world_to_light; // the cascade's orthographic view-projection (see ShadowCascade)
+
+void main() {
+    gl_Position = vec4(aPos, 1.0) * aInstanceLocalToWorld * world_to_light;
+}
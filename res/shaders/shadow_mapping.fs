@@ -15,7 +15,9 @@ uniform sampler2D shadow_map; // ranges [0.0, 1.0]
 uniform vec3 light_pos;
 uniform vec3 view_pos;
 
+#ifndef PCF
 #define PCF 1 // percentage-closer filtering
+#endif
 
 float shadowing(vec4 frag_pos_light_space) {
     // @Note: when we output a clip-space vertex position to gl_Position in the vertex shader,
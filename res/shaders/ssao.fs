@@ -1,52 +1,64 @@
 #version 330 core
 
-out float fragColor;
+// @Note: the ambient occlusion, and the view depth that it was computed at (which the blur and
+// the upsample weigh their taps by, see ssao_blur.fs and deferred_shading.fs).
+layout (location = 0) out vec2 fragColor;
 
-in vec2 texcoord;
+// @Note: SSAO_SAMPLES_MAX (the size of the kernel) and GBUFFER_COMPACT are injected by the
+// application, and the g-buffer is read in either layout.
+#include "gbuffer.glsl"
 
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
-uniform sampler2D texNoise;
+#ifndef SSAO_SAMPLES_MAX
+#define SSAO_SAMPLES_MAX 64
+#endif
 
-uniform mat4 view_to_clip; // projection
+uniform sampler2D ssao_noise; // 4x4 random rotations around the normal (tiled)
 
-uniform vec2 noise_scale;
+uniform vec3 ssao_kernel[SSAO_SAMPLES_MAX]; // in the tangent space hemisphere, of unit radius
+uniform int ssao_samples; // how many of the kernel's samples are taken
+uniform float ssao_radius; // 0.5
+uniform float ssao_bias; // 0.025
 
-uniform float radius; // 0.5
-uniform float bias; // 0.025
-
-uniform vec3 samples[64];
-int samples_count = 64;
+vec3 read_view_position(ivec2 pixel) {
+    return (vec4(read_gbuffer_position(pixel), 1.0) * world_to_view).xyz;
+}
 
 void main() {
-    vec3 frag_pos = texture(gPosition, texcoord).xyz;
-    vec3 normal = texture(gNormal, texcoord).xyz;
-    vec3 random = texture(texNoise, texcoord * noise_scale).xyz;
+    // @Note: this runs at half resolution, where each texel takes the top left pixel of the
+    // 2x2 block of the g-buffer that it covers (rather than averaging across edges).
+    ivec2 size = textureSize(gAlbedoSpec, 0);
+    ivec2 pixel = min(ivec2(gl_FragCoord.xy) * 2, size - 1);
+
+    vec3 frag_pos = read_view_position(pixel);
+    vec3 normal = normalize(read_gbuffer_normal(pixel) * mat3(world_to_view));
+    vec3 random = texelFetch(ssao_noise, ivec2(gl_FragCoord.xy) & 3, 0).xyz;
 
     vec3 tangent = normalize(random - normal * dot(random, normal));
     vec3 bitangent = cross(normal, tangent);
     mat3 tbn_matrix = mat3(tangent, bitangent, normal);
 
     float occlusion = 0.0;
-    for (int i = 0; i < samples_count; ++i) {
+    for (int i = 0; i < ssao_samples; ++i) {
+        // @Note: the samples are pulled towards the center (where occlusion matters the most),
+        // by how far along the samples that are taken they are.
+        float t = float(i + 1) / float(ssao_samples);
+        float scale = mix(0.1, 1.0, t * t) * ssao_radius;
+
         // Sample position, transforming it from tangent to view-space.
-        vec3 samples_pos = tbn_matrix * samples[i];
-        samples_pos = frag_pos + samples_pos * radius;
-
-        // Project it from view-space to screen-space.
-        vec4 offset = vec4(samples_pos, 1.0);
-        offset = offset * view_to_clip;
-        offset.xyz /= offset.w; // perspective divide (NDC)
-        offset.xyz = offset.xyz * 0.5 + 0.5; // [-1, 1] -> [0, 1]
-
-        float sample_depth = texture(gPosition, offset.xy).z;
-        // float range_check = min(1.0, radius / abs(frag_pos.z - sample_depth));
-        float range_check = smoothstep(0.0, 1.0, radius / abs(frag_pos.z - sample_depth));
-        occlusion += ((sample_depth >= sample_pos.z + bias) ? 1.0 : 0.0) * range_check;
+        vec3 sample_pos = frag_pos + tbn_matrix * ssao_kernel[i] * scale;
+
+        // Project it from view-space to the pixel of the g-buffer that it lands on.
+        vec4 offset = vec4(sample_pos, 1.0) * view_to_clip;
+        vec2 uv = offset.xy / offset.w * 0.5 + 0.5;
+        ivec2 sample_pixel = clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1);
+
+        float sample_depth = read_view_position(sample_pixel).z;
+        float range_check = smoothstep(0.0, 1.0, ssao_radius / abs(frag_pos.z - sample_depth));
+        occlusion += ((sample_depth >= sample_pos.z + ssao_bias) ? 1.0 : 0.0) * range_check;
     }
 
     // Normalize the occlusion factor and save it subtracted from 1.0, so that
     // we can use the output directly to scale the ambient lighting component.
-    occlusion = occlusion / samples_count;
-    fragColor = 1.0 - occlusion;
+    occlusion = occlusion / float(max(ssao_samples, 1));
+    fragColor = vec2(1.0 - occlusion, -frag_pos.z);
 }
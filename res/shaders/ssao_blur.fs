@@ -1,21 +1,36 @@
 #version 330 core
 
-out float fragColor;
+// @Note: one direction of a separable bilateral blur of the (half resolution) ambient occlusion,
+// where each tap is weighted by its distance and by how close its view depth is to the center's,
+// so that occlusion doesn't bleed across the edges of objects.
+layout (location = 0) out vec2 fragColor;
 
-in vec2 texcoord;
+uniform sampler2D ssao_input; // RG: occlusion, view depth (see ssao.fs)
+uniform vec2 blur_direction; // (1, 0) or (0, 1)
 
-uniform sampler2D ssaoInput;
+#define BLUR_RADIUS 4
+#define BLUR_SIGMA (0.5 * float(BLUR_RADIUS))
+
+// @Note: how fast the weights fall off with the relative difference of depths.
+#define DEPTH_SHARPNESS 32.0
 
 void main() {
-    vec2 texel_size = 1.0 / vec2(textureSize(ssaoInput, 0));
+    ivec2 size = textureSize(ssao_input, 0);
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec2 center = texelFetch(ssao_input, pixel, 0).rg;
 
     float result = 0.0;
-    for (int x = -2; x < 2; ++x) {
-        for (int y = -2; y < 2; ++y) {
-            vec2 offset = vec2(float(x), float(y)) * texel_size;
-            result += texture(ssaoInput, texcoord + offset).r;
-        }
+    float weights = 0.0;
+    for (int i = -BLUR_RADIUS; i <= BLUR_RADIUS; ++i) {
+        ivec2 tap_pixel = clamp(pixel + ivec2(blur_direction) * i, ivec2(0), size - 1);
+        vec2 tap = texelFetch(ssao_input, tap_pixel, 0).rg;
+
+        float spatial = exp(-float(i * i) / (2.0 * BLUR_SIGMA * BLUR_SIGMA));
+        float range = exp(-DEPTH_SHARPNESS * abs(tap.g - center.g) / max(center.g, 1e-4));
+        result += tap.r * spatial * range;
+        weights += spatial * range;
     }
 
-    fragColor = result / (4.0 * 4.0);
+    // @Note: the center tap always has a weight of one, so this never divides by zero.
+    fragColor = vec2(result / weights, center.g);
 }
@@ -0,0 +1,13 @@
+#version 330 core
+
+layout (location = 0) out uint visibility_id;
+
+flat in uint instance;
+
+#include "visibility.glsl"
+
+// @Note: gl_PrimitiveID restarts from zero on every instance, so it's the triangle's index
+// within its mesh (whose own index is written to the stencil buffer, see visibility_buffer.h).
+void main() {
+    visibility_id = pack_visibility_id(uint(gl_PrimitiveID), instance);
+}
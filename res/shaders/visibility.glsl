@@ -0,0 +1,43 @@
+// @Note: VISIBILITY_INSTANCE_BITS is injected by the application (see visibility_buffer.h).
+#ifndef VISIBILITY_INSTANCE_BITS
+#define VISIBILITY_INSTANCE_BITS 8
+#endif
+
+uint pack_visibility_id(uint triangle, uint instance) {
+    return (triangle << VISIBILITY_INSTANCE_BITS) | instance;
+}
+
+uint unpack_visibility_triangle(uint id) { return id >> VISIBILITY_INSTANCE_BITS; }
+uint unpack_visibility_instance(uint id) { return id & ((1u << VISIBILITY_INSTANCE_BITS) - 1u); }
+
+// @Note: see VisibilityGeometry.
+uniform samplerBuffer visibility_vertices;
+uniform usamplerBuffer visibility_indices;
+uniform samplerBuffer visibility_instances;
+
+struct VisibilityVertex {
+    vec3 position;
+    vec3 normal;
+    vec3 tangent;
+    vec2 texcoord;
+};
+
+// @Volatile: keep in sync with VisibilityVertex (in visibility_buffer.h).
+VisibilityVertex fetch_visibility_vertex(int index) {
+    vec4 a = texelFetch(visibility_vertices, 3 * index + 0);
+    vec4 b = texelFetch(visibility_vertices, 3 * index + 1);
+    vec4 c = texelFetch(visibility_vertices, 3 * index + 2);
+    return VisibilityVertex(a.xyz, b.xyz, c.xyz, vec2(a.w, b.w));
+}
+
+int fetch_visibility_index(int index) { return int(texelFetch(visibility_indices, index).r); }
+
+// @Note: built like the aInstanceLocalToWorld attribute (i.e. with rows as columns), so that
+// it's also applied as `v * local_to_world`.
+mat4 fetch_visibility_instance(int instance) {
+    return mat4(
+        texelFetch(visibility_instances, 4 * instance + 0),
+        texelFetch(visibility_instances, 4 * instance + 1),
+        texelFetch(visibility_instances, 4 * instance + 2),
+        texelFetch(visibility_instances, 4 * instance + 3));
+}
@@ -0,0 +1,13 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 4) in mat4 aInstanceLocalToWorld; // model (@Volatile: see mesh.h)
+
+flat out uint instance;
+
+#include "camera.glsl"
+
+void main() {
+    instance = uint(gl_InstanceID);
+    gl_Position = vec4(aPos, 1.0) * aInstanceLocalToWorld * world_to_view * view_to_clip;
+}
@@ -0,0 +1,95 @@
+#version 330 core
+
+// @Note: GBUFFER_COMPACT is injected by the application (see gbuffer.glsl for both layouts).
+#ifndef GBUFFER_COMPACT
+#define GBUFFER_COMPACT 0
+#endif
+
+// @Volatile: keep in sync with the outputs of gbuffer.fs.
+#if GBUFFER_COMPACT
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+#else
+layout (location = 0) out vec3 gPosition;
+layout (location = 1) out vec3 gNormal;
+layout (location = 2) out vec4 gAlbedoSpec;
+#endif
+
+#include "camera.glsl"
+#include "material.glsl"
+#include "octahedral.glsl"
+#include "visibility.glsl"
+
+uniform usampler2D visibility_ids;
+uniform int visibility_first_index; // @Note: of the mesh being resolved, into the indices
+uniform int visibility_first_instance; // @Note: of the mesh's draw, into the instances
+
+// @Note: direction (in world space) of the ray from the camera through a point on the screen.
+vec3 compute_view_ray(vec2 frag_coord, vec2 screen_size) {
+    vec2 ndc = frag_coord / screen_size * 2.0 - 1.0;
+    vec4 pos_view = vec4(ndc, 1.0, 1.0) * clip_to_view;
+    vec3 pos_world = (vec4(pos_view.xyz / pos_view.w, 1.0) * view_to_world).xyz;
+    return pos_world - view_pos;
+}
+
+// @Note: barycentric coordinates of where the ray hits the triangle's plane (which are
+// perspective correct, as they're computed in world space), and may be outside of it.
+vec3 intersect_triangle(vec3 dir, vec3 p0, vec3 p1, vec3 p2) {
+    vec3 e1 = p1 - p0;
+    vec3 e2 = p2 - p0;
+    vec3 p = cross(dir, e2);
+    vec3 t = view_pos - p0;
+    vec3 q = cross(t, e1);
+    vec2 uv = vec2(dot(t, p), dot(dir, q)) / dot(e1, p);
+    return vec3(1.0 - uv.x - uv.y, uv);
+}
+
+void main() {
+    uint id = texelFetch(visibility_ids, ivec2(gl_FragCoord.xy), 0).r;
+    int triangle = int(unpack_visibility_triangle(id));
+    int instance = visibility_first_instance + int(unpack_visibility_instance(id));
+    mat4 local_to_world = fetch_visibility_instance(instance);
+
+    int first = visibility_first_index + 3 * triangle;
+    VisibilityVertex v0 = fetch_visibility_vertex(fetch_visibility_index(first + 0));
+    VisibilityVertex v1 = fetch_visibility_vertex(fetch_visibility_index(first + 1));
+    VisibilityVertex v2 = fetch_visibility_vertex(fetch_visibility_index(first + 2));
+
+    vec3 p0 = (vec4(v0.position, 1.0) * local_to_world).xyz;
+    vec3 p1 = (vec4(v1.position, 1.0) * local_to_world).xyz;
+    vec3 p2 = (vec4(v2.position, 1.0) * local_to_world).xyz;
+
+    // @Note: the hardware derivatives would be meaningless here (as neighboring pixels may
+    // belong to other triangles), so texture gradients come from the barycentric coordinates
+    // of the next pixels' rays, on the plane of this pixel's triangle.
+    vec2 screen_size = vec2(textureSize(visibility_ids, 0));
+    vec3 w = intersect_triangle(compute_view_ray(gl_FragCoord.xy, screen_size), p0, p1, p2);
+    vec3 w_dx = intersect_triangle(
+        compute_view_ray(gl_FragCoord.xy + vec2(1.0, 0.0), screen_size), p0, p1, p2);
+    vec3 w_dy = intersect_triangle(
+        compute_view_ray(gl_FragCoord.xy + vec2(0.0, 1.0), screen_size), p0, p1, p2);
+
+    mat3x2 texcoords = mat3x2(v0.texcoord, v1.texcoord, v2.texcoord);
+    vec2 texcoord = texcoords * w;
+    vec2 texcoord_dx = texcoords * (w_dx - w);
+    vec2 texcoord_dy = texcoords * (w_dy - w);
+
+    mat3 normal_matrix = transpose(inverse(mat3(local_to_world)));
+    vec3 normal = normalize((mat3(v0.normal, v1.normal, v2.normal) * w) * normal_matrix);
+    vec3 tangent = (mat3(v0.tangent, v1.tangent, v2.tangent) * w) * mat3(local_to_world);
+
+    vec4 material = textureGrad(texture_packed, texcoord, texcoord_dx, texcoord_dy);
+    if (material.a >= 0.5) {
+        vec2 normal_rg = textureGrad(texture_normal, texcoord, texcoord_dx, texcoord_dy).rg;
+        normal = apply_normal_map(normal, tangent, normal_rg);
+    }
+
+#if GBUFFER_COMPACT
+    gNormal = encode_octahedral(normal) * 0.5 + 0.5; // @Note: to RG16 UNORM
+#else
+    gPosition = mat3(p0, p1, p2) * w;
+    gNormal = normal;
+#endif
+    gAlbedoSpec.rgb = textureGrad(texture_diffuse, texcoord, texcoord_dx, texcoord_dy).rgb;
+    gAlbedoSpec.a = material.r;
+}
@@ -0,0 +1,281 @@
+#include "culling.h"
+
+#include "maths.h"
+#include "mesh.h"
+#include "model.h"
+#include "occlusion.h"
+#include "simd.h"
+
+//
+// Bounding boxes.
+//
+
+Aabb empty_aabb(void) {
+    return (Aabb) { { +FLT_MAX, +FLT_MAX, +FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+}
+
+Aabb aabb_union(Aabb const a, Aabb const b) {
+    return (Aabb) { vec3_min(a.min, b.min), vec3_max(a.max, b.max) };
+}
+
+Aabb aabb_with_point(Aabb const aabb, vec3 const point) {
+    return (Aabb) { vec3_min(aabb.min, point), vec3_max(aabb.max, point) };
+}
+
+bool aabb_contains_point(Aabb const aabb, vec3 const point) {
+    return aabb.min.x <= point.x && point.x <= aabb.max.x && aabb.min.y <= point.y
+           && point.y <= aabb.max.y && aabb.min.z <= point.z && point.z <= aabb.max.z;
+}
+
+// Reference: Graphics Gems, "Transforming Axis-Aligned Bounding Boxes" (James Arvo, 1990)
+Aabb aabb_transform(Aabb const aabb, mat4 const local_to_world) {
+    if (aabb.max.x < aabb.min.x) { return aabb; } // @Note: keep empty boxes empty
+
+    f32 const center[3] = {
+        0.5f * (aabb.min.x + aabb.max.x),
+        0.5f * (aabb.min.y + aabb.max.y),
+        0.5f * (aabb.min.z + aabb.max.z),
+    };
+    f32 const extent[3] = {
+        0.5f * (aabb.max.x - aabb.min.x),
+        0.5f * (aabb.max.y - aabb.min.y),
+        0.5f * (aabb.max.z - aabb.min.z),
+    };
+
+    f32 new_center[3], new_extent[3];
+    for (int i = 0; i < 3; ++i) {
+        new_center[i] = local_to_world.m[i][3];
+        new_extent[i] = 0;
+        for (int j = 0; j < 3; ++j) {
+            new_center[i] += local_to_world.m[i][j] * center[j];
+            new_extent[i] += fabsf(local_to_world.m[i][j]) * extent[j];
+        }
+    }
+
+    vec3 const world_center = { new_center[0], new_center[1], new_center[2] };
+    vec3 const world_extent = { new_extent[0], new_extent[1], new_extent[2] };
+    return (Aabb) { vec3_sub(world_center, world_extent), vec3_add(world_center, world_extent) };
+}
+
+//
+// Frustum culling.
+//
+
+// Reference: "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+// (Gil Gribb and Klaus Hartmann, 2001)
+Frustum compute_frustum(mat4 const world_to_clip) {
+    mat4 const m = world_to_clip;
+
+    Frustum frustum;
+    for (int i = 0; i < 3; ++i) {
+        for (int side = 0; side < 2; ++side) {
+            f32 const sign = side == 0 ? 1.0f : -1.0f; // @Note: i.e. -w <= clip[i] <= w
+            frustum.planes[2 * i + side] = (vec4) {
+                m.m[3][0] + sign * m.m[i][0],
+                m.m[3][1] + sign * m.m[i][1],
+                m.m[3][2] + sign * m.m[i][2],
+                m.m[3][3] + sign * m.m[i][3],
+            };
+        }
+    }
+
+    for (int i = 0; i < 6; ++i) {
+        vec4 const plane = frustum.planes[i];
+        f32 const length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0) { frustum.planes[i] = vec4_scl(plane, 1 / length); }
+    }
+
+    return frustum;
+}
+
+usize cull_aabbs(Frustum const *frustum, Aabb const aabbs[], bool visible[], usize count) {
+    // @Note: splat each plane's normal (and its absolute value) and distance once, as every
+    // batch is tested against the same planes. A box is outside of a plane if even its corner
+    // that is the furthest along the normal, i.e. its center plus its extents projected onto
+    // the absolute normal, is behind it.
+    f32x4 normal_x[6], normal_y[6], normal_z[6], abs_x[6], abs_y[6], abs_z[6], distance[6];
+    for (int i = 0; i < 6; ++i) {
+        vec4 const plane = frustum->planes[i];
+        normal_x[i] = f32x4_set1(plane.x);
+        normal_y[i] = f32x4_set1(plane.y);
+        normal_z[i] = f32x4_set1(plane.z);
+        abs_x[i] = f32x4_set1(fabsf(plane.x));
+        abs_y[i] = f32x4_set1(fabsf(plane.y));
+        abs_z[i] = f32x4_set1(fabsf(plane.z));
+        distance[i] = f32x4_set1(plane.w);
+    }
+
+    f32x4 const zero = f32x4_set1(0.0f);
+    f32x4 const half = f32x4_set1(0.5f);
+
+    usize visible_len = 0;
+    for (usize i = 0; i < count; i += 4) {
+        // Transpose (up to) four boxes, padding the last batch with copies of the last box.
+        f32 min_x[4], min_y[4], min_z[4], max_x[4], max_y[4], max_z[4];
+        for (usize j = 0; j < 4; ++j) {
+            Aabb const aabb = aabbs[MIN(i + j, count - 1)];
+            min_x[j] = aabb.min.x;
+            min_y[j] = aabb.min.y;
+            min_z[j] = aabb.min.z;
+            max_x[j] = aabb.max.x;
+            max_y[j] = aabb.max.y;
+            max_z[j] = aabb.max.z;
+        }
+
+        f32x4 const lo_x = f32x4_load(min_x), hi_x = f32x4_load(max_x);
+        f32x4 const lo_y = f32x4_load(min_y), hi_y = f32x4_load(max_y);
+        f32x4 const lo_z = f32x4_load(min_z), hi_z = f32x4_load(max_z);
+
+        f32x4 const center_x = f32x4_mul(f32x4_add(lo_x, hi_x), half);
+        f32x4 const center_y = f32x4_mul(f32x4_add(lo_y, hi_y), half);
+        f32x4 const center_z = f32x4_mul(f32x4_add(lo_z, hi_z), half);
+        f32x4 const extent_x = f32x4_mul(f32x4_sub(hi_x, lo_x), half);
+        f32x4 const extent_y = f32x4_mul(f32x4_sub(hi_y, lo_y), half);
+        f32x4 const extent_z = f32x4_mul(f32x4_sub(hi_z, lo_z), half);
+
+        f32x4 outside = zero;
+        for (int p = 0; p < 6; ++p) {
+            f32x4 dist = f32x4_madd(normal_x[p], center_x, distance[p]);
+            dist = f32x4_madd(normal_y[p], center_y, dist);
+            dist = f32x4_madd(normal_z[p], center_z, dist);
+            dist = f32x4_madd(abs_x[p], extent_x, dist);
+            dist = f32x4_madd(abs_y[p], extent_y, dist);
+            dist = f32x4_madd(abs_z[p], extent_z, dist);
+            outside = f32x4_or(outside, f32x4_lt(dist, zero));
+        }
+
+        int const outside_mask = f32x4_movemask(outside);
+        for (usize j = 0; j < 4 && i + j < count; ++j) {
+            visible[i + j] = !(outside_mask & (1 << j));
+            visible_len += visible[i + j] ? 1 : 0;
+        }
+    }
+
+    return visible_len;
+}
+
+//
+// Model instance culling.
+//
+
+// @Note: returns false if the buffers can't grow (keeping whichever ones could, as they are).
+static bool reserve_culled_model(CulledModel *culled, usize meshes_len, usize capacity) {
+    if (meshes_len + 1 > culled->meshes_capacity) {
+        usize *first_instances =
+            realloc(culled->first_instances, (meshes_len + 1) * sizeof(usize));
+        if (!first_instances) { return false; }
+        culled->first_instances = first_instances;
+        culled->meshes_capacity = meshes_len + 1;
+    }
+
+    if (capacity > culled->capacity) {
+        mat4 *local_to_worlds = realloc(culled->local_to_worlds, capacity * sizeof(mat4));
+        if (local_to_worlds) { culled->local_to_worlds = local_to_worlds; }
+        mat4 *objects = realloc(culled->objects, capacity * sizeof(mat4));
+        if (objects) { culled->objects = objects; }
+        Aabb *bounds = realloc(culled->bounds, capacity * sizeof(Aabb));
+        if (bounds) { culled->bounds = bounds; }
+        bool *visible = realloc(culled->visible, capacity * sizeof(bool));
+        if (visible) { culled->visible = visible; }
+
+        if (!local_to_worlds || !objects || !bounds || !visible) { return false; }
+        culled->capacity = capacity;
+    }
+
+    return true;
+}
+
+// @Note: clears the visibility of the boxes that are occluded, and returns how many were.
+static usize cull_occluded_aabbs(
+    OcclusionBuffer const *occlusion, Aabb const aabbs[], bool visible[], usize count) {
+    usize occluded_len = 0;
+    for (usize i = 0; i < count; ++i) {
+        if (visible[i] && is_aabb_occluded(occlusion, aabbs[i])) {
+            visible[i] = false;
+            occluded_len += 1;
+        }
+    }
+    return occluded_len;
+}
+
+void cull_model_instances(
+    CulledModel *culled,
+    Model const *model,
+    Frustum const *frustum,
+    OcclusionBuffer const *occlusion,
+    mat4 const local_to_worlds[],
+    usize count,
+    Err *err) {
+    if (*err) { return; }
+
+    usize const meshes_len = model->meshes_len;
+    usize const capacity = MAX(count * MAX(meshes_len, 1), 1);
+    if (!reserve_culled_model(culled, meshes_len, capacity)) {
+        *err = Err_Realloc;
+        return;
+    }
+
+    // Cull whole objects first (by the bounds of the whole model).
+    for (usize i = 0; i < count; ++i) {
+        culled->bounds[i] = aabb_transform(model->bounds, local_to_worlds[i]);
+    }
+    cull_aabbs(frustum, culled->bounds, culled->visible, count);
+
+    usize objects_occluded = 0;
+    if (occlusion) {
+        objects_occluded = cull_occluded_aabbs(occlusion, culled->bounds, culled->visible, count);
+    }
+
+    usize objects_len = 0;
+    for (usize i = 0; i < count; ++i) {
+        if (culled->visible[i]) { culled->objects[objects_len++] = local_to_worlds[i]; }
+    }
+
+    // Then cull each mesh of the visible objects (with their bounds stored object by object).
+    for (usize i = 0; i < objects_len; ++i) {
+        for (usize j = 0; j < meshes_len; ++j) {
+            culled->bounds[i * meshes_len + j] =
+                aabb_transform(model->meshes[j].bounds, culled->objects[i]);
+        }
+    }
+    usize const meshes_tested = objects_len * meshes_len;
+    cull_aabbs(frustum, culled->bounds, culled->visible, meshes_tested);
+
+    usize meshes_occluded = 0;
+    if (occlusion) {
+        meshes_occluded =
+            cull_occluded_aabbs(occlusion, culled->bounds, culled->visible, meshes_tested);
+    }
+
+    // Finally, gather the visible instances of each mesh.
+    usize instances_len = 0;
+    for (usize j = 0; j < meshes_len; ++j) {
+        culled->first_instances[j] = instances_len;
+        for (usize i = 0; i < objects_len; ++i) {
+            if (culled->visible[i * meshes_len + j]) {
+                culled->local_to_worlds[instances_len++] = culled->objects[i];
+            }
+        }
+    }
+    culled->first_instances[meshes_len] = instances_len;
+
+    culled->instances_len = instances_len;
+    culled->meshes_len = meshes_len;
+    culled->stats = (CullingStats) {
+        .objects_tested = count,
+        .objects_visible = objects_len,
+        .objects_occluded = objects_occluded,
+        .meshes_tested = meshes_tested,
+        .meshes_visible = instances_len,
+        .meshes_occluded = meshes_occluded,
+    };
+}
+
+void dealloc_culled_model(CulledModel *culled) {
+    free(culled->visible);
+    free(culled->bounds);
+    free(culled->objects);
+    free(culled->first_instances);
+    free(culled->local_to_worlds);
+    *culled = (CulledModel) { 0 };
+}
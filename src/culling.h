@@ -0,0 +1,75 @@
+#pragma once
+
+#include "prelude.h"
+
+#include "maths_types.h"
+
+// Forward declarations.
+typedef struct Model Model;
+typedef struct OcclusionBuffer OcclusionBuffer;
+
+typedef struct Aabb {
+    vec3 min;
+    vec3 max; // @Note: empty boxes have max < min (see empty_aabb)
+} Aabb;
+
+Aabb empty_aabb(void);
+Aabb aabb_union(Aabb const a, Aabb const b);
+Aabb aabb_with_point(Aabb const aabb, vec3 const point);
+bool aabb_contains_point(Aabb const aabb, vec3 const point);
+Aabb aabb_transform(Aabb const aabb, mat4 const local_to_world); // @Note: bounds the result
+
+// @Note: planes are (normal, distance) pairs, with normals pointing inwards, i.e. points p
+// inside of the frustum have dot(normal, p) + distance >= 0 for every plane.
+typedef struct Frustum {
+    vec4 planes[6]; // left, right, bottom, top, near, far
+} Frustum;
+
+// @Note: expects the matrix to map to GL clip space (with -w <= z <= w), e.g. view_to_clip
+// multiplied by world_to_view, whose planes are then in world space.
+Frustum compute_frustum(mat4 const world_to_clip);
+
+// @Note: tests the boxes four at a time (see simd.h), setting whether each one is (at least
+// partially) inside of the frustum, and returns how many are. It's conservative, so a large
+// box that is outside of the frustum, but not entirely behind any one plane, is kept.
+usize cull_aabbs(Frustum const *frustum, Aabb const aabbs[], bool visible[], usize count);
+
+typedef struct CullingStats {
+    usize objects_tested;
+    usize objects_visible;
+    usize objects_occluded; // @Note: inside of the frustum, but not visible
+    usize meshes_tested; // @Note: of the visible objects
+    usize meshes_visible;
+    usize meshes_occluded;
+} CullingStats;
+
+// @Note: the instances of each of a model's meshes that are inside of the frustum, stored mesh
+// after mesh, so that every mesh can be drawn with its own range of them (first_instances[i]
+// up to first_instances[i + 1]), see draw_model_instanced_ranges.
+typedef struct CulledModel {
+    mat4 *local_to_worlds; // @Ownership
+    usize *first_instances; // @Ownership (meshes_len + 1 of them)
+    usize instances_len;
+    usize meshes_len;
+
+    CullingStats stats; // @Note: of the last call to cull_model_instances
+
+    // @Note: scratch memory, with room for every instance of every mesh (as local_to_worlds).
+    mat4 *objects; // @Ownership (the local_to_worlds of the visible objects)
+    Aabb *bounds; // @Ownership
+    bool *visible; // @Ownership
+    usize capacity;
+    usize meshes_capacity;
+} CulledModel;
+
+// @Note: if an occlusion buffer is given (i.e. it isn't NULL), objects and meshes that are
+// inside of the frustum are also tested against it, see rasterize_occluders.
+void cull_model_instances(
+    CulledModel *culled,
+    Model const *model,
+    Frustum const *frustum,
+    OcclusionBuffer const *occlusion,
+    mat4 const local_to_worlds[],
+    usize count,
+    Err *err);
+void dealloc_culled_model(CulledModel *culled);
@@ -1,7 +1,18 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // mkdir
+#endif
+
 #include "file.h"
 
+#include <errno.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 usize file_size_in_bytes(FILE *fp) {
     fpos_t fpos;
     fgetpos(fp, &fpos);
@@ -68,6 +79,24 @@ char *alloc_data_from_filepath(char const *path, Err *err) {
     return data;
 }
 
+bool write_data_to_filepath(char const *path, void const *data, usize size) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) { return false; }
+
+    usize const written = fwrite(data, 1, size, fp);
+    bool const is_closed = fclose(fp) == 0;
+    return written == size && is_closed;
+}
+
+bool make_directory(char const *path) {
+#ifdef _WIN32
+    int const result = _mkdir(path);
+#else
+    int const result = mkdir(path, 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
 char *alloc_str_copy(char const *str, Err *err) {
     if (*err || !str) { return NULL; }
     usize const len = strlen(str);
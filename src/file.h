@@ -12,12 +12,21 @@
 #define SLASH_CHAR '/'
 #endif
 
+// @Note: directory for generated data (e.g. mipmaps) that is cached between runs.
+#ifndef GLOW_CACHE_
+#define GLOW_CACHE_ ""
+#endif
+
 usize file_size_in_bytes(FILE *fp);
 
 char *alloc_human_readable_size_str(usize size_in_bytes, Err *err);
 
 char *alloc_data_from_filepath(char const *path, Err *err);
 
+bool write_data_to_filepath(char const *path, void const *data, usize size);
+
+bool make_directory(char const *path); // @Note: true if it exists afterwards
+
 char *alloc_str_copy(char const *str, Err *err);
 
 void replace_back_with_forward_slashes_inplace(char *path);
@@ -0,0 +1,170 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // stat, read
+#endif
+
+#include "file_watcher.h"
+
+#include "console.h"
+#include "dynarray.h"
+#include "file.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#define GLOW_USE_INOTIFY 1
+#else
+#define GLOW_USE_INOTIFY 0
+#endif
+
+typedef struct WatchedFile {
+    char *path; // @Ownership
+    time_t modified_time; // @Note: only used when polling
+} WatchedFile;
+
+struct FileWatcher {
+    WatchedFile *files; // @Ownership (dynarray)
+#if GLOW_USE_INOTIFY
+    int fd;
+    int *watch_descriptors; // @Ownership (dynarray)
+    char **watch_directories; // @Ownership (dynarray, parallel to watch_descriptors)
+#endif
+};
+
+static time_t get_modified_time(char const *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_mtime : 0;
+}
+
+FileWatcher *alloc_file_watcher(Err *err) {
+    if (*err) { return NULL; }
+
+    FileWatcher *watcher = calloc(1, sizeof(FileWatcher));
+    if (!watcher) {
+        *err = Err_Calloc;
+        return NULL;
+    }
+
+#if GLOW_USE_INOTIFY
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd == -1) {
+        GLOW_WARNING("inotify_init1() failed, falling back to polling for file changes");
+    }
+#endif
+
+    return watcher;
+}
+
+void dealloc_file_watcher(FileWatcher *watcher) {
+    if (!watcher) { return; }
+
+    for (usize i = 0; i < arrlen(watcher->files); ++i) { free(watcher->files[i].path); }
+    arrfree(watcher->files);
+
+#if GLOW_USE_INOTIFY
+    for (usize i = 0; i < arrlen(watcher->watch_directories); ++i) {
+        free(watcher->watch_directories[i]);
+    }
+    arrfree(watcher->watch_directories);
+    arrfree(watcher->watch_descriptors);
+    if (watcher->fd != -1) { close(watcher->fd); }
+#endif
+
+    free(watcher);
+}
+
+#if GLOW_USE_INOTIFY
+static void watch_directory_of_file(FileWatcher *watcher, char const *path) {
+    Err err = Err_None;
+    char *directory = alloc_str_copy(path, &err);
+    if (err) { return; }
+    terminate_at_last_path_component_inplace(directory);
+
+    for (usize i = 0; i < arrlen(watcher->watch_directories); ++i) {
+        if (!strcmp(watcher->watch_directories[i], directory)) {
+            free(directory);
+            return;
+        }
+    }
+
+    int const wd =
+        inotify_add_watch(watcher->fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd == -1) {
+        GLOW_WARNING("failed to watch directory: `%s`", directory);
+        free(directory);
+        return;
+    }
+
+    arrpush(watcher->watch_descriptors, wd);
+    arrpush(watcher->watch_directories, directory);
+}
+#endif
+
+void watch_file(FileWatcher *watcher, char const *path) {
+    for (usize i = 0; i < arrlen(watcher->files); ++i) {
+        if (!strcmp(watcher->files[i].path, path)) { return; }
+    }
+
+    Err err = Err_None;
+    WatchedFile const file = { alloc_str_copy(path, &err), get_modified_time(path) };
+    if (err) { return; }
+    arrpush(watcher->files, file);
+
+#if GLOW_USE_INOTIFY
+    if (watcher->fd != -1) { watch_directory_of_file(watcher, path); }
+#endif
+}
+
+static void
+report_file_changed(FileWatcher *watcher, char const *path, FileChangedFn fn, void *data) {
+    for (usize i = 0; i < arrlen(watcher->files); ++i) {
+        if (!strcmp(watcher->files[i].path, path)) {
+            fn(watcher->files[i].path, data);
+            return;
+        }
+    }
+}
+
+void poll_file_watcher(FileWatcher *watcher, FileChangedFn fn, void *data) {
+#if GLOW_USE_INOTIFY
+    if (watcher->fd != -1) {
+        // @Note: events are variable-sized, as they end with the (null-terminated) file name.
+        union {
+            struct inotify_event event; // @Note: only here to align the buffer
+            char bytes[4096];
+        } buffer;
+        char path[1024];
+
+        LOOP {
+            ssize_t const len = read(watcher->fd, buffer.bytes, sizeof(buffer.bytes));
+            if (len <= 0) { break; } // @Note: EAGAIN (i.e. no more events), or an error
+
+            for (char const *p = buffer.bytes; p < buffer.bytes + len;) {
+                struct inotify_event const *event = (struct inotify_event const *) p;
+                p += sizeof(struct inotify_event) + event->len;
+                if (event->len == 0) { continue; }
+
+                for (usize i = 0; i < arrlen(watcher->watch_descriptors); ++i) {
+                    if (watcher->watch_descriptors[i] != event->wd) { continue; }
+                    char const *directory = watcher->watch_directories[i];
+                    snprintf(path, sizeof(path), "%s%s", directory, event->name);
+                    report_file_changed(watcher, path, fn, data);
+                    break;
+                }
+            }
+        }
+        return;
+    }
+#endif
+
+    for (usize i = 0; i < arrlen(watcher->files); ++i) {
+        time_t const modified_time = get_modified_time(watcher->files[i].path);
+        if (modified_time != watcher->files[i].modified_time) {
+            watcher->files[i].modified_time = modified_time;
+            fn(watcher->files[i].path, data);
+        }
+    }
+}
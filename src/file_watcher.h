@@ -0,0 +1,18 @@
+#pragma once
+
+#include "prelude.h"
+
+// @Note: reports changes to a set of files, using inotify on Linux (where the directories of
+// the files are watched, since many editors save by replacing them) and by polling the files'
+// modification times everywhere else.
+typedef struct FileWatcher FileWatcher;
+
+typedef void (*FileChangedFn)(char const *path, void *data);
+
+FileWatcher *alloc_file_watcher(Err *err);
+void dealloc_file_watcher(FileWatcher *watcher);
+
+void watch_file(FileWatcher *watcher, char const *path); // @Note: ignores repeated paths
+
+// @Note: doesn't block, calling fn once for each watched file that changed since the last poll.
+void poll_file_watcher(FileWatcher *watcher, FileChangedFn fn, void *data);
@@ -1,5 +1,7 @@
 #include "fullscreen_quad.h"
 
+#include "opengl.h"
+
 #include <glad/glad.h>
 
 static f32 const QUAD_VERTICES_NDC[] = {
@@ -11,8 +13,8 @@ FullscreenQuad create_fullscreen_quad(void) {
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
 
-    glBindVertexArray(vao);
-    DEFER (glBindVertexArray(0)) {
+    bind_gl_vertex_array(vao);
+    DEFER (bind_gl_vertex_array(0)) {
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(
             GL_ARRAY_BUFFER, sizeof(QUAD_VERTICES_NDC), QUAD_VERTICES_NDC, GL_STATIC_DRAW);
@@ -32,12 +34,11 @@ FullscreenQuad create_fullscreen_quad(void) {
 }
 
 void destroy_fullscreen_quad(FullscreenQuad *quad) {
+    forget_gl_vertex_array(quad->vao);
     glDeleteVertexArrays(1, &quad->vao);
 }
 
 void draw_fullscreen_quad(FullscreenQuad const *quad) {
-    DEFER (glBindVertexArray(0)) {
-        glBindVertexArray(quad->vao);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    }
+    bind_gl_vertex_array(quad->vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
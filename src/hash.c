@@ -0,0 +1,50 @@
+#include "hash.h"
+
+#include <string.h>
+
+// Reference: https://github.com/wangyi-fudan/wyhash (simplified mixing, not the full spec)
+static u64 const HASH_PRIME_0 = 0xa0761d6478bd642full;
+static u64 const HASH_PRIME_1 = 0xe7037ed1a0b428dbull;
+static u64 const HASH_PRIME_2 = 0x8ebc6af09c88c6e3ull;
+
+static inline u64 hash_mix(u64 a, u64 b) {
+    // @Note: 64x64 -> 128 bit multiply, folded back into 64 bits.
+    u64 const a_lo = a & 0xffffffffull, a_hi = a >> 32;
+    u64 const b_lo = b & 0xffffffffull, b_hi = b >> 32;
+    u64 const lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+    u64 const lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    u64 const cross = (lo_lo >> 32) + (hi_lo & 0xffffffffull) + lo_hi;
+    u64 const hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    u64 const lo = (cross << 32) | (lo_lo & 0xffffffffull);
+    return hi ^ lo;
+}
+
+static inline u64 read_u64(u8 const *p) {
+    u64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+u64 hash_bytes(void const *data, usize len, u64 seed) {
+    u8 const *p = data;
+    u64 h = seed ^ HASH_PRIME_0;
+
+    usize i = 0;
+    for (; i + 16 <= len; i += 16) {
+        h = hash_mix(read_u64(p + i) ^ HASH_PRIME_1, read_u64(p + i + 8) ^ h);
+    }
+
+    u64 tail[2] = { 0, 0 };
+    memcpy(tail, p + i, len - i);
+    h = hash_mix(tail[0] ^ HASH_PRIME_1, tail[1] ^ h);
+
+    return hash_mix(h ^ HASH_PRIME_2, (u64) len ^ HASH_PRIME_1);
+}
+
+u64 hash_str(char const *str, u64 seed) {
+    return hash_bytes(str, strlen(str), seed);
+}
+
+u64 hash_combine(u64 a, u64 b) {
+    return hash_mix(a ^ HASH_PRIME_0, b ^ HASH_PRIME_2);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "prelude.h"
+
+// @Note: non-cryptographic 64-bit hashes, used for cache keys and hash tables.
+
+u64 hash_bytes(void const *data, usize len, u64 seed);
+u64 hash_str(char const *str, u64 seed);
+u64 hash_combine(u64 a, u64 b);
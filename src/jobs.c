@@ -0,0 +1,347 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // pthreads and sysconf
+#endif
+
+#include "jobs.h"
+
+#include "console.h"
+#include "maths.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <process.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define JOBS_MAX_THREADS 64
+
+//
+// Platform wrappers.
+//
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Cond;
+typedef HANDLE Thread;
+
+/* clang-format off */
+static void mutex_init(Mutex *m) { InitializeCriticalSection(m); }
+static void mutex_deinit(Mutex *m) { DeleteCriticalSection(m); }
+static void mutex_lock(Mutex *m) { EnterCriticalSection(m); }
+static bool mutex_trylock(Mutex *m) { return TryEnterCriticalSection(m) != 0; }
+static void mutex_unlock(Mutex *m) { LeaveCriticalSection(m); }
+static void cond_init(Cond *c) { InitializeConditionVariable(c); }
+static void cond_deinit(Cond *c) { UNUSED(c); }
+static void cond_wait(Cond *c, Mutex *m) { SleepConditionVariableCS(c, m, INFINITE); }
+static void cond_broadcast(Cond *c) { WakeAllConditionVariable(c); }
+/* clang-format on */
+
+static int count_cores(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int) info.dwNumberOfProcessors;
+}
+#else
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Cond;
+typedef pthread_t Thread;
+
+/* clang-format off */
+static void mutex_init(Mutex *m) { pthread_mutex_init(m, NULL); }
+static void mutex_deinit(Mutex *m) { pthread_mutex_destroy(m); }
+static void mutex_lock(Mutex *m) { pthread_mutex_lock(m); }
+static bool mutex_trylock(Mutex *m) { return pthread_mutex_trylock(m) == 0; }
+static void mutex_unlock(Mutex *m) { pthread_mutex_unlock(m); }
+static void cond_init(Cond *c) { pthread_cond_init(c, NULL); }
+static void cond_deinit(Cond *c) { pthread_cond_destroy(c); }
+static void cond_wait(Cond *c, Mutex *m) { pthread_cond_wait(c, m); }
+static void cond_broadcast(Cond *c) { pthread_cond_broadcast(c); }
+/* clang-format on */
+
+static int count_cores(void) {
+    long const count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int) count : 1;
+}
+#endif
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+#ifdef _MSC_VER
+static i64 atomic_fetch_add_i64(i64 volatile *p, i64 value) {
+    return InterlockedExchangeAdd64((LONG64 volatile *) p, value);
+}
+#else
+static i64 atomic_fetch_add_i64(i64 volatile *p, i64 value) {
+    return __atomic_fetch_add(p, value, __ATOMIC_ACQ_REL);
+}
+#endif
+
+//
+// Job pool.
+//
+
+typedef struct JobBatch {
+    JobFn fn;
+    void *data;
+    usize count;
+} JobBatch;
+
+static struct {
+    bool is_initialized;
+    bool should_quit;
+    int workers_len;
+    Thread workers[JOBS_MAX_THREADS];
+
+    Mutex submit_lock; // held while a batch is in flight
+    Mutex lock; // protects everything below
+    Cond wake_cond;
+    Cond finished_cond;
+
+    u64 generation;
+    JobBatch batch;
+    int active_workers;
+
+    i64 volatile next_index;
+    i64 volatile done_count;
+} jobs;
+
+// @Note: set while the thread runs a job, so that run_jobs() called from inside of one runs
+// serially (rather than relying on the submit lock not being recursive, which it is on Win32).
+static THREAD_LOCAL bool is_inside_job;
+
+static void work_on_batch(JobBatch const batch) {
+    is_inside_job = true;
+
+    i64 processed = 0;
+    LOOP {
+        i64 const index = atomic_fetch_add_i64(&jobs.next_index, 1);
+        if (index >= (i64) batch.count) { break; }
+        batch.fn(batch.data, (usize) index);
+        processed += 1;
+    }
+    if (processed > 0) { atomic_fetch_add_i64(&jobs.done_count, processed); }
+
+    is_inside_job = false;
+}
+
+static void worker_loop(void) {
+    u64 seen_generation = 0;
+
+    mutex_lock(&jobs.lock);
+    LOOP {
+        while (!jobs.should_quit && jobs.generation == seen_generation) {
+            cond_wait(&jobs.wake_cond, &jobs.lock);
+        }
+        if (jobs.should_quit) { break; }
+
+        seen_generation = jobs.generation;
+        JobBatch const batch = jobs.batch;
+        jobs.active_workers += 1;
+        mutex_unlock(&jobs.lock);
+
+        work_on_batch(batch);
+
+        mutex_lock(&jobs.lock);
+        jobs.active_workers -= 1;
+        cond_broadcast(&jobs.finished_cond);
+    }
+    mutex_unlock(&jobs.lock);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall worker_main(void *arg) {
+    UNUSED(arg);
+    worker_loop();
+    return 0;
+}
+#else
+static void *worker_main(void *arg) {
+    UNUSED(arg);
+    worker_loop();
+    return NULL;
+}
+#endif
+
+void init_jobs(int thread_count) {
+    assert(!jobs.is_initialized);
+
+    int const workers_len =
+        CLAMP(thread_count > 0 ? thread_count - 1 : count_cores() - 1, 0, JOBS_MAX_THREADS);
+
+    mutex_init(&jobs.submit_lock);
+    mutex_init(&jobs.lock);
+    cond_init(&jobs.wake_cond);
+    cond_init(&jobs.finished_cond);
+
+    jobs.should_quit = false;
+    jobs.workers_len = 0;
+    for (int i = 0; i < workers_len; ++i) {
+#ifdef _WIN32
+        uintptr_t const handle = _beginthreadex(NULL, 0, worker_main, NULL, 0, NULL);
+        if (handle == 0) { break; }
+        jobs.workers[jobs.workers_len++] = (HANDLE) handle;
+#else
+        if (pthread_create(&jobs.workers[jobs.workers_len], NULL, worker_main, NULL) != 0) {
+            break;
+        }
+        jobs.workers_len += 1;
+#endif
+    }
+
+    if (jobs.workers_len < workers_len) {
+        GLOW_WARNING("only started %d of %d job threads", jobs.workers_len, workers_len);
+    }
+
+    jobs.is_initialized = true;
+    GLOW_LOG("Started %d job threads", jobs.workers_len);
+}
+
+void deinit_jobs(void) {
+    if (!jobs.is_initialized) { return; }
+
+    mutex_lock(&jobs.lock);
+    jobs.should_quit = true;
+    cond_broadcast(&jobs.wake_cond);
+    mutex_unlock(&jobs.lock);
+
+    for (int i = 0; i < jobs.workers_len; ++i) {
+#ifdef _WIN32
+        WaitForSingleObject(jobs.workers[i], INFINITE);
+        CloseHandle(jobs.workers[i]);
+#else
+        pthread_join(jobs.workers[i], NULL);
+#endif
+    }
+
+    cond_deinit(&jobs.finished_cond);
+    cond_deinit(&jobs.wake_cond);
+    mutex_deinit(&jobs.lock);
+    mutex_deinit(&jobs.submit_lock);
+
+    jobs.workers_len = 0;
+    jobs.is_initialized = false;
+}
+
+int get_jobs_thread_count(void) {
+    return jobs.is_initialized ? jobs.workers_len + 1 : 1;
+}
+
+void run_jobs(JobFn fn, void *data, usize count) {
+    // @Note: the submit lock is only tried once we know that this isn't a nested call, as the
+    // thread that runs the outer batch already holds it.
+    bool const is_serial =
+        !jobs.is_initialized || jobs.workers_len == 0 || count <= 1 || is_inside_job
+        || !mutex_trylock(&jobs.submit_lock);
+
+    if (is_serial) {
+        for (usize i = 0; i < count; ++i) { fn(data, i); }
+        return;
+    }
+
+    mutex_lock(&jobs.lock);
+    {
+        // @Note: wait for workers that are still holding on to the previous batch,
+        // so that none of them can grab an index of this one with its old JobFn.
+        while (jobs.active_workers > 0) { cond_wait(&jobs.finished_cond, &jobs.lock); }
+
+        jobs.batch = (JobBatch) { fn, data, count };
+        jobs.next_index = 0;
+        jobs.done_count = 0;
+        jobs.generation += 1;
+        cond_broadcast(&jobs.wake_cond);
+    }
+    mutex_unlock(&jobs.lock);
+
+    work_on_batch((JobBatch) { fn, data, count });
+
+    mutex_lock(&jobs.lock);
+    while (atomic_fetch_add_i64(&jobs.done_count, 0) < (i64) count || jobs.active_workers > 0) {
+        cond_wait(&jobs.finished_cond, &jobs.lock);
+    }
+    mutex_unlock(&jobs.lock);
+
+    mutex_unlock(&jobs.submit_lock);
+}
+
+//
+// Background jobs.
+//
+
+struct BackgroundJob {
+    JobFn fn;
+    void *data;
+    Thread thread;
+    bool has_thread;
+    i64 volatile is_done;
+};
+
+static void run_background_job(BackgroundJob *job) {
+    is_inside_job = true;
+    job->fn(job->data, 0);
+    is_inside_job = false;
+
+    atomic_fetch_add_i64(&job->is_done, 1);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall background_job_main(void *arg) {
+    run_background_job(arg);
+    return 0;
+}
+#else
+static void *background_job_main(void *arg) {
+    run_background_job(arg);
+    return NULL;
+}
+#endif
+
+BackgroundJob *start_background_job(JobFn fn, void *data) {
+    BackgroundJob *job = calloc(1, sizeof(BackgroundJob));
+    if (!job) {
+        fn(data, 0);
+        return NULL;
+    }
+
+    job->fn = fn;
+    job->data = data;
+#ifdef _WIN32
+    uintptr_t const handle = _beginthreadex(NULL, 0, background_job_main, job, 0, NULL);
+    job->has_thread = handle != 0;
+    if (job->has_thread) { job->thread = (HANDLE) handle; }
+#else
+    job->has_thread = pthread_create(&job->thread, NULL, background_job_main, job) == 0;
+#endif
+
+    if (!job->has_thread) {
+        GLOW_WARNING("failed to start a background job thread, running it right away");
+        run_background_job(job);
+    }
+
+    return job;
+}
+
+bool is_background_job_done(BackgroundJob *job) {
+    return !job || atomic_fetch_add_i64(&job->is_done, 0) > 0;
+}
+
+void wait_for_background_job(BackgroundJob *job) {
+    if (!job) { return; }
+
+    if (job->has_thread) {
+#ifdef _WIN32
+        WaitForSingleObject(job->thread, INFINITE);
+        CloseHandle(job->thread);
+#else
+        pthread_join(job->thread, NULL);
+#endif
+    }
+
+    free(job);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "prelude.h"
+
+// @Note: a minimal job system, with a fixed pool of worker threads that run
+// parallel-for style batches. The calling thread also works on its own batch,
+// and run_jobs() only returns after every index in it has been processed.
+
+typedef void (*JobFn)(void *data, usize index);
+
+// @Note: a thread_count of 0 uses one worker less than the number of cores, while
+// calling run_jobs() without ever initializing the pool runs every job serially.
+void init_jobs(int thread_count);
+void deinit_jobs(void);
+
+int get_jobs_thread_count(void); // includes the calling thread
+
+// @Note: nested calls from inside of a job, and calls made while another thread's batch is
+// in flight, simply run their jobs serially on the calling thread.
+void run_jobs(JobFn fn, void *data, usize count);
+
+// @Note: runs fn(data, 0) on a thread of its own (outside of the pool), for work that the
+// calling thread shouldn't wait on. The job is run right away (on the calling thread) if the
+// thread can't be started, in which case null may be returned (which is always done).
+typedef struct BackgroundJob BackgroundJob;
+BackgroundJob *start_background_job(JobFn fn, void *data);
+bool is_background_job_done(BackgroundJob *job);
+void wait_for_background_job(BackgroundJob *job); // @Note: also frees it
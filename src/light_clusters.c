@@ -0,0 +1,294 @@
+#include "light_clusters.h"
+
+#include "jobs.h"
+#include "maths.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <glad/glad.h>
+
+// @Note: the number of lights whose bounds are computed by each job.
+#define LIGHT_BOUNDS_PER_JOB 256
+
+// @Note: inclusive ranges of the clusters that a light's volume overlaps (empty if x0 > x1).
+typedef struct LightBounds {
+    u8 x0, x1;
+    u8 y0, y1;
+    u8 z0, z1;
+} LightBounds;
+
+STATIC_ASSERT(LIGHT_CLUSTERS_X <= 256 && LIGHT_CLUSTERS_Y <= 256 && LIGHT_CLUSTERS_Z <= 256);
+STATIC_ASSERT(sizeof(ClusterLight) == 3 * 4 * sizeof(f32));
+
+typedef struct SliceIndices {
+    u32 *data; // @Ownership
+    usize len;
+    usize capacity;
+    Err err;
+} SliceIndices;
+
+struct LightBinning {
+    ClusterLight *lights;
+    usize lights_capacity;
+
+    LightBounds *bounds;
+    usize bounds_capacity;
+    SliceIndices slices[LIGHT_CLUSTERS_Z];
+
+    u32 grid[LIGHT_CLUSTERS_LEN][2]; // @Note: offsets are relative to their slice until merged
+
+    u32 *indices;
+    usize indices_capacity;
+
+    // @Note: inputs of the jobs running in assign_lights_to_clusters.
+    LightClusterView view;
+    vec2 depth_scale_bias;
+    usize lights_len;
+};
+
+// @Note: returns the (possibly moved) data, which is left untouched if it can't grow.
+static void *reserve(void *data, usize *capacity, usize len, usize elem_size, Err *err) {
+    if (len <= *capacity) { return data; }
+
+    usize const new_capacity = MAX(2 * *capacity, len);
+    void *new_data = realloc(data, new_capacity * elem_size);
+    if (!new_data) {
+        *err = Err_Realloc;
+        return data;
+    }
+
+    *capacity = new_capacity;
+    return new_data;
+}
+
+LightClusters create_light_clusters(Err *err) {
+    if (*err) { return (LightClusters) { 0 }; }
+
+    LightBinning *binning = calloc(1, sizeof(LightBinning));
+    if (!binning) {
+        *err = Err_Calloc;
+        return (LightClusters) { 0 };
+    }
+
+    return (LightClusters) {
+        .lights = create_texture_buffer(GL_RGBA32F),
+        .grid = create_texture_buffer(GL_RG32UI),
+        .indices = create_texture_buffer(GL_R32UI),
+        .binning = binning,
+    };
+}
+
+void destroy_light_clusters(LightClusters *clusters) {
+    LightBinning *binning = clusters->binning;
+    if (binning) {
+        for (usize z = 0; z < LIGHT_CLUSTERS_Z; ++z) { free(binning->slices[z].data); }
+        free(binning->indices);
+        free(binning->bounds);
+        free(binning->lights);
+        free(binning);
+        clusters->binning = NULL;
+    }
+
+    destroy_texture_buffer(&clusters->indices);
+    destroy_texture_buffer(&clusters->grid);
+    destroy_texture_buffer(&clusters->lights);
+}
+
+void update_cluster_lights(
+    LightClusters *clusters, ClusterLight const lights[], usize count, Err *err) {
+    if (*err) { return; }
+
+    LightBinning *binning = clusters->binning;
+
+    binning->lights = reserve(
+        binning->lights, &binning->lights_capacity, count, sizeof(ClusterLight), err);
+    binning->bounds = reserve(
+        binning->bounds, &binning->bounds_capacity, count, sizeof(LightBounds), err);
+    if (*err) { return; }
+
+    if (count > 0) { memcpy(binning->lights, lights, count * sizeof(ClusterLight)); }
+    clusters->lights_len = count;
+
+    update_texture_buffer(&clusters->lights, lights, count * sizeof(ClusterLight));
+}
+
+//
+// Light binning.
+//
+
+static int get_slice_of_depth(f32 depth, vec2 const depth_scale_bias) {
+    int const slice = (int) floorf(logf(depth) * depth_scale_bias.x + depth_scale_bias.y);
+    return CLAMP(slice, 0, LIGHT_CLUSTERS_Z - 1);
+}
+
+static int get_tile_of_ndc(f32 ndc, int tiles_len) {
+    int const tile = (int) floorf((0.5f * ndc + 0.5f) * tiles_len);
+    return CLAMP(tile, 0, tiles_len - 1);
+}
+
+static LightBounds compute_light_bounds(
+    ClusterLight const *light, LightClusterView const *view, vec2 const depth_scale_bias) {
+    LightBounds const empty = { 1, 0, 1, 0, 1, 0 };
+
+    vec4 const center = mat4_mul_vec4(view->world_to_view, vec4_from_vec3(light->position, 1));
+    f32 const depth = -center.z;
+    f32 const radius = light->radius;
+
+    if (!(radius > 0) || depth + radius < view->near || depth - radius > view->far) {
+        return empty;
+    }
+
+    vec2 ndc_min = { -1, -1 };
+    vec2 ndc_max = { +1, +1 };
+
+    // @Note: project the corners of the light's view space bounding box (which bounds the
+    // sphere's projection), unless it crosses the near plane, in which case it could be anywhere.
+    if (depth - radius > view->near) {
+        f32 const p00 = view->view_to_clip.m[0][0];
+        f32 const p11 = view->view_to_clip.m[1][1];
+
+        ndc_min = (vec2) { +INFINITY, +INFINITY };
+        ndc_max = (vec2) { -INFINITY, -INFINITY };
+        for (int corner = 0; corner < 8; ++corner) {
+            f32 const x = center.x + ((corner & 1) ? radius : -radius);
+            f32 const y = center.y + ((corner & 2) ? radius : -radius);
+            f32 const w = depth + ((corner & 4) ? radius : -radius);
+            vec2 const ndc = { p00 * x / w, p11 * y / w };
+            ndc_min = (vec2) { MIN(ndc_min.x, ndc.x), MIN(ndc_min.y, ndc.y) };
+            ndc_max = (vec2) { MAX(ndc_max.x, ndc.x), MAX(ndc_max.y, ndc.y) };
+        }
+
+        if (ndc_max.x < -1 || ndc_min.x > 1 || ndc_max.y < -1 || ndc_min.y > 1) {
+            return empty;
+        }
+    }
+
+    return (LightBounds) {
+        .x0 = (u8) get_tile_of_ndc(ndc_min.x, LIGHT_CLUSTERS_X),
+        .x1 = (u8) get_tile_of_ndc(ndc_max.x, LIGHT_CLUSTERS_X),
+        .y0 = (u8) get_tile_of_ndc(ndc_min.y, LIGHT_CLUSTERS_Y),
+        .y1 = (u8) get_tile_of_ndc(ndc_max.y, LIGHT_CLUSTERS_Y),
+        .z0 = (u8) get_slice_of_depth(MAX(depth - radius, view->near), depth_scale_bias),
+        .z1 = (u8) get_slice_of_depth(MIN(depth + radius, view->far), depth_scale_bias),
+    };
+}
+
+static void bound_lights_job(void *data, usize index) {
+    LightBinning *binning = data;
+
+    usize const begin = index * LIGHT_BOUNDS_PER_JOB;
+    usize const end = MIN(begin + LIGHT_BOUNDS_PER_JOB, binning->lights_len);
+    for (usize i = begin; i < end; ++i) {
+        binning->bounds[i] =
+            compute_light_bounds(&binning->lights[i], &binning->view, binning->depth_scale_bias);
+    }
+}
+
+// @Note: each slice is binned in two passes over the lights that overlap it (counting them per
+// cluster, and then writing their indices), so that its index list can be sized exactly.
+static void bin_slice_job(void *data, usize z) {
+    LightBinning *binning = data;
+    SliceIndices *slice = &binning->slices[z];
+    u32(*grid)[2] = &binning->grid[z * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y];
+
+    memset(grid, 0, LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * sizeof(*grid));
+    slice->len = 0;
+    slice->err = Err_None;
+
+    for (usize i = 0; i < binning->lights_len; ++i) {
+        LightBounds const b = binning->bounds[i];
+        if (b.x0 > b.x1 || z < b.z0 || z > b.z1) { continue; }
+        for (int y = b.y0; y <= b.y1; ++y) {
+            for (int x = b.x0; x <= b.x1; ++x) { grid[y * LIGHT_CLUSTERS_X + x][1] += 1; }
+        }
+    }
+
+    u32 offset = 0;
+    for (usize c = 0; c < LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y; ++c) {
+        grid[c][0] = offset;
+        offset += grid[c][1];
+        grid[c][1] = 0; // @Note: reused as the write cursor below
+    }
+
+    slice->data = reserve(slice->data, &slice->capacity, offset, sizeof(u32), &slice->err);
+    if (slice->err) { return; } // @Note: the slice is left with no lights
+
+    for (usize i = 0; i < binning->lights_len; ++i) {
+        LightBounds const b = binning->bounds[i];
+        if (b.x0 > b.x1 || z < b.z0 || z > b.z1) { continue; }
+        for (int y = b.y0; y <= b.y1; ++y) {
+            for (int x = b.x0; x <= b.x1; ++x) {
+                u32 *cluster = grid[y * LIGHT_CLUSTERS_X + x];
+                slice->data[cluster[0] + cluster[1]++] = (u32) i;
+            }
+        }
+    }
+    slice->len = offset;
+}
+
+void assign_lights_to_clusters(LightClusters *clusters, LightClusterView const view, Err *err) {
+    if (*err) { return; }
+
+    assert(view.near > 0 && view.far > view.near);
+    f32 const log_far_over_near = logf(view.far / view.near);
+
+    LightBinning *binning = clusters->binning;
+    binning->view = view;
+    binning->depth_scale_bias = (vec2) {
+        LIGHT_CLUSTERS_Z / log_far_over_near,
+        -LIGHT_CLUSTERS_Z * logf(view.near) / log_far_over_near,
+    };
+    binning->lights_len = clusters->lights_len;
+
+    usize const bounds_jobs_len =
+        (binning->lights_len + LIGHT_BOUNDS_PER_JOB - 1) / LIGHT_BOUNDS_PER_JOB;
+    run_jobs(bound_lights_job, binning, bounds_jobs_len);
+    run_jobs(bin_slice_job, binning, LIGHT_CLUSTERS_Z);
+
+    // Merge the slices' index lists, making their grid offsets absolute.
+    // @Note: a slice that failed is left with empty clusters, so the others are still uploaded
+    // and the error is only reported once the grid is consistent.
+    Err slices_err = Err_None;
+    usize indices_len = 0;
+    for (usize z = 0; z < LIGHT_CLUSTERS_Z; ++z) {
+        SliceIndices const *slice = &binning->slices[z];
+        if (slice->err && !slices_err) { slices_err = slice->err; }
+
+        u32(*grid)[2] = &binning->grid[z * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y];
+        for (usize c = 0; c < LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y; ++c) {
+            grid[c][0] += (u32) indices_len;
+        }
+        indices_len += slice->len;
+    }
+
+    binning->indices = reserve(
+        binning->indices, &binning->indices_capacity, indices_len, sizeof(u32), err);
+    if (*err) {
+        // @Note: without the merged list, upload an empty grid rather than keep last frame's.
+        memset(binning->grid, 0, sizeof(binning->grid));
+        indices_len = 0;
+    } else {
+        for (usize z = 0, offset = 0; z < LIGHT_CLUSTERS_Z; ++z) {
+            SliceIndices const *slice = &binning->slices[z];
+            if (slice->len > 0) {
+                memcpy(binning->indices + offset, slice->data, slice->len * sizeof(u32));
+            }
+            offset += slice->len;
+        }
+    }
+
+    usize visible_lights_len = 0;
+    for (usize i = 0; i < binning->lights_len; ++i) {
+        visible_lights_len += binning->bounds[i].x0 <= binning->bounds[i].x1 ? 1 : 0;
+    }
+
+    clusters->depth_scale_bias = binning->depth_scale_bias;
+    clusters->visible_lights_len = visible_lights_len;
+    clusters->indices_len = indices_len;
+
+    update_texture_buffer(&clusters->grid, binning->grid, sizeof(binning->grid));
+    update_texture_buffer(&clusters->indices, binning->indices, indices_len * sizeof(u32));
+
+    if (!*err) { *err = slices_err; }
+}
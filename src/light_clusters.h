@@ -0,0 +1,65 @@
+#pragma once
+
+#include "prelude.h"
+
+#include "maths_types.h"
+#include "texture_buffer.h"
+
+// @Note: the view frustum is split into screen tiles and (exponentially spaced) depth slices,
+// and every light is binned into the clusters that its volume overlaps. Shaders then only loop
+// over the lights of the fragment's cluster, so the lighting cost follows the local density of
+// lights rather than how many there are in total (see clustered_lights.glsl).
+
+// @Volatile: injected into shaders that read the clusters (see get_lighting_pass).
+#define LIGHT_CLUSTERS_X 16
+#define LIGHT_CLUSTERS_Y 9
+#define LIGHT_CLUSTERS_Z 24
+#define LIGHT_CLUSTERS_LEN (LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z)
+
+// @Volatile: keep in sync with fetch_light() in clustered_lights.glsl, which reads each light
+// from the `lights` buffer as three RGBA32F texels.
+typedef struct ClusterLight {
+    vec3 position; // in world space
+    f32 radius;
+    vec3 color;
+    f32 constant;
+    f32 linear;
+    f32 quadratic;
+    f32 shadow; // @Note: the slot of its point shadow (see get_point_shadow_slot), or -1
+    f32 _padding;
+} ClusterLight;
+
+typedef struct LightClusterView {
+    mat4 world_to_view;
+    mat4 view_to_clip; // @Note: expects a symmetric perspective projection
+    f32 near;
+    f32 far;
+} LightClusterView;
+
+typedef struct LightBinning LightBinning; // @Note: scratch memory, opaque
+
+typedef struct LightClusters {
+    TextureBuffer lights; // RGBA32F, three texels per light
+    TextureBuffer grid; // RG32UI, an (offset, count) pair into indices per cluster
+    TextureBuffer indices; // R32UI, light indices grouped by cluster
+
+    vec2 depth_scale_bias; // @Note: slice = log(view depth) * scale + bias
+
+    // Stats of the last assignment.
+    usize visible_lights_len;
+    usize indices_len;
+
+    usize lights_len;
+    LightBinning *binning; // @Ownership (along with a copy of the lights)
+} LightClusters;
+
+LightClusters create_light_clusters(Err *err);
+void destroy_light_clusters(LightClusters *clusters);
+
+// @Note: uploads the lights, which are kept around so that they can be binned again every frame
+// (i.e. call it whenever a light changes, and assign_lights_to_clusters whenever the view does).
+void update_cluster_lights(
+    LightClusters *clusters, ClusterLight const lights[], usize count, Err *err);
+
+// @Note: bins the lights on the job system (one job per depth slice), then uploads the grid.
+void assign_lights_to_clusters(LightClusters *clusters, LightClusterView const view, Err *err);
@@ -1,19 +1,32 @@
 #include "main.inl"
 
 static inline void setup_shaders(void);
+static void setup_geometry_pass(Shader const shader);
+static void setup_lighting_pass(Shader const shader);
+static void setup_light_volume_pass(Shader const shader);
+static void setup_visibility_resolve_pass(Shader const shader);
+static void setup_ssao_pass(Shader const shader);
 static inline void process_input(GLFWwindow *window, f32 delta_time);
 static void set_window_callbacks(GLFWwindow *window);
 
-static inline Resources create_resources(Err *err, int width, int height);
+static inline Resources create_resources(Err *err, int width, int height, usize lights_len);
 static inline void destroy_resources(Resources *r, int width, int height);
 static inline void begin_frame(GLFWwindow *window, int width, int height);
-static inline void draw_frame(Resources const *r, int width, int height);
+static inline void draw_frame(Resources *r, int width, int height);
 static inline void end_frame(GLFWwindow *window, int width, int height);
 
 int main(int argc, char *argv[]) {
     Err err = Err_None;
 
     Options const options = parse_args(argc, argv);
+    init_jobs(options.jobs);
+
+    // @Note: occlusion culling runs entirely on the CPU, so it's benchmarked without a window.
+    if (options.bench_occlusion > 0) {
+        bench_occlusion(options.bench_occlusion, &err);
+        goto main_exit_jobs;
+    }
+
     WindowSettings const window_settings = {
         1280, 720, set_window_callbacks, options.msaa, options.vsync, options.fullscreen,
     };
@@ -34,11 +47,12 @@ int main(int argc, char *argv[]) {
     camera = new_camera_at((vec3) { 0, 0, 5 });
     camera.aspect = (f32) w / (f32) h;
 
-    Resources r = create_resources(&err, w, h);
+    usize const lights_len = options.lights > 0 ? (usize) options.lights : LIGHT_COUNT;
+    Resources r = create_resources(&err, w, h, lights_len);
     if (err) { goto main_exit; }
 
     setup_shaders();
-    glEnable(GL_DEPTH_TEST);
+    set_gl_capability(GL_DEPTH_TEST, true);
     glfwSetInputMode(
         window, GLFW_CURSOR, mouse_is_in_ui ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
     glfwSetWindowUserPointer(window, (void *) &r);
@@ -60,6 +74,9 @@ main_exit:
 main_exit_opengl:
     deinit_opengl(window);
 
+main_exit_jobs:
+    deinit_jobs();
+
     switch (err) {
         case Err_None: break;
         case Err_Unkown: GLOW_ERROR("unkown error"); break;
@@ -68,10 +85,12 @@ main_exit_opengl:
         case Err_Glad_Init: GLOW_ERROR("failed to initialize glad"); break;
         case Err_Shader_Compile: GLOW_ERROR("failed to compile shader"); break;
         case Err_Shader_Link: GLOW_ERROR("failed to link shader program"); break;
+        case Err_Shader_Include: GLOW_ERROR("failed to resolve shader #include"); break;
         case Err_Stbi_Load: GLOW_ERROR("stbi_load() failed"); break;
         case Err_Assimp_Import: GLOW_ERROR("aiImportFile() failed"); break;
         case Err_Assimp_Get_Texture: GLOW_ERROR("aiGetMaterialTexture() failed"); break;
         case Err_Model_Load_Stored_Texture: GLOW_ERROR("failed to load from TextureStore"); break;
+        case Err_Occlusion_Check: GLOW_ERROR("occlusion culling gave a wrong result"); break;
         case Err_Fopen: GLOW_ERROR("fopen() failed"); break;
         case Err_Malloc: GLOW_ERROR("malloc() failed"); break;
         case Err_Calloc: GLOW_ERROR("calloc() failed"); break;
@@ -86,25 +105,217 @@ main_exit_opengl:
 // Resources setup and cleanup.
 //
 
-static inline Resources create_resources(Err *err, int width, int height) {
-    Resources r = { 0 };
+// @Note: creates the shaders of every pass in one batch (see new_shaders_from_sources),
+// and registers them to be hot reloaded (so the passes must outlive their registration).
+static void new_shaders_for_passes(PathsToShader *const passes[], usize count, Err *err) {
+    if (*err) { return; }
+
+    ShaderFilepaths *paths = calloc(count, sizeof(ShaderFilepaths));
+    Shader **shaders = calloc(count, sizeof(Shader *));
+    if (!paths || !shaders) {
+        *err = Err_Calloc;
+    } else {
+        for (usize i = 0; i < count; ++i) {
+            paths[i] = passes[i]->paths;
+            shaders[i] = &passes[i]->shader;
+        }
+        new_registered_shaders_from_filepaths(paths, shaders, count, err);
+    }
+
+    free(shaders);
+    free(paths);
+}
+
+// @Note: the g-buffer debug views (and each lighting path) are compiled as separate variants
+// of the lighting pass, while LIGHT_COUNT and the cluster grid dimensions are injected so that
+// the shader always matches LightBlock and the LightClusters layout. With `ssao`, the ambient
+// term is scaled by the (upsampled) output of the SSAO passes, with `shadows` the sun is
+// shadowed by its cascades, and with `point_shadows` the lights that have shadows sample them.
+static Shader const *get_lighting_pass(
+    int draw_mode,
+    int lighting_path,
+    int gbuffer_layout,
+    bool ssao,
+    bool shadows,
+    bool point_shadows,
+    Err *err) {
+    ShaderDefine const defines[] = {
+        { "GBUFFER_COMPACT", gbuffer_layout == GBUFFER_COMPACT },
+        { "SSAO", ssao },
+        { "SHADOWS", shadows },
+        { "SHADOW_CASCADES", SHADOW_CASCADES },
+        { "POINT_SHADOWS", point_shadows },
+        { "POINT_SHADOWS_MAX", POINT_SHADOWS_MAX },
+        { "LIGHT_COUNT", LIGHT_COUNT },
+        { "LIGHT_CLUSTERS_X", LIGHT_CLUSTERS_X },
+        { "LIGHT_CLUSTERS_Y", LIGHT_CLUSTERS_Y },
+        { "LIGHT_CLUSTERS_Z", LIGHT_CLUSTERS_Z },
+        { "LIGHTING_PATH", lighting_path },
+        { "DRAW_MODE", draw_mode },
+    };
+    return get_shader_permutation(lighting_pass, defines, ARRAY_LEN(defines), err);
+}
+
+// @Note: the g-buffer layout changes what the geometry pass writes, and how it's read back.
+static Shader const *get_geometry_pass(int gbuffer_layout, Err *err) {
+    ShaderDefine const defines[] = { { "GBUFFER_COMPACT", gbuffer_layout == GBUFFER_COMPACT } };
+    return get_shader_permutation(geometry_pass, defines, ARRAY_LEN(defines), err);
+}
+
+static Shader const *get_light_volume_pass(int gbuffer_layout, bool point_shadows, Err *err) {
+    ShaderDefine const defines[] = {
+        { "GBUFFER_COMPACT", gbuffer_layout == GBUFFER_COMPACT },
+        { "POINT_SHADOWS", point_shadows },
+        { "POINT_SHADOWS_MAX", POINT_SHADOWS_MAX },
+    };
+    return get_shader_permutation(light_volume, defines, ARRAY_LEN(defines), err);
+}
+
+static Shader const *get_visibility_resolve_pass(int gbuffer_layout, Err *err) {
+    ShaderDefine const defines[] = {
+        { "GBUFFER_COMPACT", gbuffer_layout == GBUFFER_COMPACT },
+        { "VISIBILITY_INSTANCE_BITS", VISIBILITY_INSTANCE_BITS },
+    };
+    return get_shader_permutation(visibility_resolve, defines, ARRAY_LEN(defines), err);
+}
+
+static Shader const *get_ssao_pass(int gbuffer_layout, Err *err) {
+    ShaderDefine const defines[] = {
+        { "GBUFFER_COMPACT", gbuffer_layout == GBUFFER_COMPACT },
+        { "SSAO_SAMPLES_MAX", SSAO_SAMPLES_MAX },
+    };
+    return get_shader_permutation(ssao_pass, defines, ARRAY_LEN(defines), err);
+}
+
+// @Note: the layout is picked by gbuffer_layout, and every texture (including depth, which the
+// compact layout reconstructs positions from) is sampled with texelFetch().
+static GBufferTargets declare_gbuffer(RenderGraph *graph, int gbuffer_layout, int geometry_path) {
+    GBufferTargets gbuffer = { 0 };
+
+    if (gbuffer_layout == GBUFFER_COMPACT) {
+        // Octahedral normal (RG16) + albedo color and specular intensity (RGBA8) buffers.
+        gbuffer.normal =
+            declare_render_texture(graph, (RenderTextureDesc) { "gNormal", GL_RG16 });
+    } else {
+        // Position (RGBA16F) + normal (RGBA16F) + albedo color and specular intensity (RGBA8).
+        gbuffer.position =
+            declare_render_texture(graph, (RenderTextureDesc) { "gPosition", GL_RGBA16F });
+        gbuffer.normal =
+            declare_render_texture(graph, (RenderTextureDesc) { "gNormal", GL_RGBA16F });
+    }
+    gbuffer.albedo_spec =
+        declare_render_texture(graph, (RenderTextureDesc) { "gAlbedoSpec", GL_RGBA8 });
+
+    // Depth (and stencil) buffer, where the stencil is used by light volumes.
+    gbuffer.depth =
+        declare_render_texture(graph, (RenderTextureDesc) { "gDepth", GL_DEPTH24_STENCIL8 });
+
+    if (geometry_path == GEOMETRY_VISIBILITY) {
+        // Visibility ids (R32UI), see VISIBILITY_INSTANCE_BITS.
+        gbuffer.visibility_ids =
+            declare_render_texture(graph, (RenderTextureDesc) { "visibility_ids", GL_R32UI });
+    }
+
+    return gbuffer;
+}
+
+// @Note: fills a pass' reads or writes in order, skipping resources that weren't declared.
+static void
+list_render_resources(RenderResource list[], RenderResource const resources[], usize len) {
+    usize list_len = 0;
+    for (usize i = 0; i < len; ++i) {
+        if (resources[i] != 0) { list[list_len++] = resources[i]; }
+    }
+}
 
-    geometry_pass.paths.vertex = GLOW_SHADERS_ "gbuffer.vs";
-    geometry_pass.paths.fragment = GLOW_SHADERS_ "gbuffer.fs";
+// @Note: binds the g-buffer to the units that set_gbuffer_samplers assigns (in either layout).
+static void bind_gbuffer_textures(RenderGraph const *graph, GBufferTargets const *gbuffer) {
+    uint const position = get_render_texture(graph, gbuffer->position); // @Note: or zero
+    uint const normal = get_render_texture(graph, gbuffer->normal);
+    uint const albedo_spec = get_render_texture(graph, gbuffer->albedo_spec);
+    uint const depth = get_render_texture(graph, gbuffer->depth);
+
+    bind_gl_texture(GL_TEXTURE0 + GPOSITION_UNIT, GL_TEXTURE_2D, position);
+    bind_gl_texture(GL_TEXTURE0 + GNORMAL_UNIT, GL_TEXTURE_2D, normal);
+    bind_gl_texture(GL_TEXTURE0 + GALBEDO_SPEC_UNIT, GL_TEXTURE_2D, albedo_spec);
+    bind_gl_texture(GL_TEXTURE0 + GDEPTH_UNIT, GL_TEXTURE_2D, depth);
+}
+
+// @Note: binds a texture to the unit that its sampler was assigned when linked (if it's active).
+static void
+bind_sampler_texture(Shader const shader, char const *name, uint target, uint texture) {
+    uint const texture_unit = get_shader_sampler_unit(shader, name);
+    if (texture_unit != 0) { bind_gl_texture(texture_unit, target, texture); }
+}
 
-    lighting_pass.paths.vertex = GLOW_SHADERS_ "deferred_shading.vs";
-    lighting_pass.paths.fragment = GLOW_SHADERS_ "deferred_shading.fs";
+static void set_gbuffer_samplers(Shader const shader) {
+    set_shader_sampler2D(shader, "gPosition", GL_TEXTURE0 + GPOSITION_UNIT);
+    set_shader_sampler2D(shader, "gNormal", GL_TEXTURE0 + GNORMAL_UNIT);
+    set_shader_sampler2D(shader, "gAlbedoSpec", GL_TEXTURE0 + GALBEDO_SPEC_UNIT);
+    set_shader_sampler2D(shader, "gDepth", GL_TEXTURE0 + GDEPTH_UNIT);
+}
+
+static inline Resources create_resources(Err *err, int width, int height, usize lights_len) {
+    UNUSED(width);
+    UNUSED(height);
+
+    Resources r = { 0 };
+
+    r.gbuffer_layout = GBUFFER_COMPACT;
 
     light_box.paths.vertex = GLOW_SHADERS_ "deferred_light_box.vs";
     light_box.paths.fragment = GLOW_SHADERS_ "deferred_light_box.fs";
 
-    // @Volatile: use the same shaders as in `process_input`.
-    geometry_pass.shader = new_shader_from_filepath(geometry_pass.paths, err);
-    lighting_pass.shader = new_shader_from_filepath(lighting_pass.paths, err);
-    light_box.shader = new_shader_from_filepath(light_box.paths, err);
+    light_volume_stencil.paths.vertex = GLOW_SHADERS_ "deferred_light_volume.vs";
+    light_volume_stencil.paths.fragment = GLOW_SHADERS_ "deferred_light_volume_stencil.fs";
+
+    visibility_pass.paths.vertex = GLOW_SHADERS_ "visibility.vs";
+    visibility_pass.paths.fragment = GLOW_SHADERS_ "visibility.fs";
+
+    occlusion_query.paths.vertex = GLOW_SHADERS_ "occlusion_query.vs";
+    occlusion_query.paths.fragment = GLOW_SHADERS_ "occlusion_query.fs";
+
+    ssao_blur.paths.vertex = GLOW_SHADERS_ "deferred_shading.vs";
+    ssao_blur.paths.fragment = GLOW_SHADERS_ "ssao_blur.fs";
+
+    shadow_depth.paths.vertex = GLOW_SHADERS_ "shadow_depth.vs";
+    shadow_depth.paths.fragment = GLOW_SHADERS_ "shadow_mapping_depth.fs";
+
+    PathsToShader *const passes[] = {
+        &light_box,       &light_volume_stencil, &visibility_pass,
+        &occlusion_query, &ssao_blur,            &shadow_depth,
+    };
+    new_shaders_for_passes(passes, ARRAY_LEN(passes), err);
+
+    ShaderFilepaths const geometry_pass_paths = {
+        GLOW_SHADERS_ "gbuffer.vs", GLOW_SHADERS_ "gbuffer.fs", NULL
+    };
+    ShaderFilepaths const lighting_pass_paths = {
+        GLOW_SHADERS_ "deferred_shading.vs", GLOW_SHADERS_ "deferred_shading.fs", NULL
+    };
+    ShaderFilepaths const light_volume_paths = {
+        GLOW_SHADERS_ "deferred_light_volume.vs", GLOW_SHADERS_ "deferred_light_volume.fs", NULL
+    };
+    ShaderFilepaths const visibility_resolve_paths = {
+        GLOW_SHADERS_ "deferred_shading.vs", GLOW_SHADERS_ "visibility_resolve.fs", NULL
+    };
+    ShaderFilepaths const ssao_pass_paths = {
+        GLOW_SHADERS_ "deferred_shading.vs", GLOW_SHADERS_ "ssao.fs", NULL
+    };
+    geometry_pass = alloc_shader_permutations(geometry_pass_paths, setup_geometry_pass, err);
+    lighting_pass = alloc_shader_permutations(lighting_pass_paths, setup_lighting_pass, err);
+    light_volume = alloc_shader_permutations(light_volume_paths, setup_light_volume_pass, err);
+    visibility_resolve = alloc_shader_permutations(
+        visibility_resolve_paths, setup_visibility_resolve_pass, err);
+    ssao_pass = alloc_shader_permutations(ssao_pass_paths, setup_ssao_pass, err);
+
+    // @Note: fail early on errors.
+    get_geometry_pass(r.gbuffer_layout, err);
+    get_lighting_pass(DRAW_LIGHTING, LIGHTING_CLUSTERED, r.gbuffer_layout, true, true, true, err);
 
     stbi_set_flip_vertically_on_load(choose_model[BACKPACK].flip_on_load);
     backpack = alloc_model_from_filepath(choose_model[BACKPACK].path, err);
+    r.visibility_geometry = create_visibility_geometry(&backpack, err);
 
 #if 0
     skybox.paths.vertex = GLOW_SHADERS_ "simple_skybox.vs";
@@ -145,6 +356,30 @@ static inline Resources create_resources(Err *err, int width, int height) {
     // Exit early if there were any errors during setup.
     if (*err != Err_None) { return r; }
 
+    ShaderCacheStats const shader_cache_stats = get_shader_cache_stats();
+    GLOW_LOG(
+        "Shader program cache: `%zu` hits, `%zu` misses",
+        shader_cache_stats.hits,
+        shader_cache_stats.misses);
+
+    r.render_graph = create_render_graph(err);
+    if (*err != Err_None) { return r; }
+
+    // @Note: only ever has the g-buffer's depth (and stencil) attached (to copy it from).
+    glGenFramebuffers(1, &r.depth_blit_framebuffer);
+    bind_gl_framebuffer(GL_FRAMEBUFFER, r.depth_blit_framebuffer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    bind_gl_framebuffer(GL_FRAMEBUFFER, 0);
+
+    r.camera_block = create_uniform_buffer(CAMERA_BLOCK_BINDING, sizeof(CameraBlock));
+    r.light_block = create_uniform_buffer(LIGHTS_BLOCK_BINDING, sizeof(LightBlock));
+    r.light_clusters = create_light_clusters(err);
+    r.occlusion = alloc_occlusion_buffer(err);
+    r.shadow_cascades = create_shadow_cascades();
+    r.point_shadows = create_point_shadows();
+    glGenQueries(OBJECT_COUNT, r.object_queries);
+
     //
     // Scene's objects and lights (object_positions, light_positions, light_colors).
     //
@@ -160,11 +395,23 @@ static inline Resources create_resources(Err *err, int width, int height) {
     r.object_positions[7] = (vec3) { +0, -0.5, +3 };
     r.object_positions[8] = (vec3) { +3, -0.5, +3 };
 
-    for (usize i = 0; i < LIGHT_COUNT; ++i) {
+    r.lights_len = lights_len;
+    r.light_positions = calloc(lights_len, sizeof(vec3));
+    r.light_colors = calloc(lights_len, sizeof(vec3));
+    r.light_radii = calloc(lights_len, sizeof(f32));
+    if (!r.light_positions || !r.light_colors || !r.light_radii) {
+        *err = Err_Calloc;
+        return r;
+    }
+
+    // @Note: lights are spread over a volume that grows with their count, so that their density
+    // (and thus the cost of clustered lighting per pixel) stays the same as for LIGHT_COUNT.
+    f32 const spread = 6.0f * cbrtf((f32) lights_len / LIGHT_COUNT);
+    for (usize i = 0; i < lights_len; ++i) {
         r.light_positions[i] = (vec3) {
-            ((rand() % 100) / 100.0) * 6.0 - 3.0,
-            ((rand() % 100) / 100.0) * 6.0 - 4.0,
-            ((rand() % 100) / 100.0) * 6.0 - 3.0,
+            ((rand() % 100) / 100.0) * spread - 0.5f * spread,
+            ((rand() % 100) / 100.0) * spread - 0.5f * spread - 1.0,
+            ((rand() % 100) / 100.0) * spread - 0.5f * spread,
         };
         r.light_colors[i] = (vec3) {
             ((rand() % 100) / 200.0) + 0.5,
@@ -172,53 +419,50 @@ static inline Resources create_resources(Err *err, int width, int height) {
             ((rand() % 100) / 200.0) + 0.5,
         };
     }
+    light_block_is_dirty = true;
 
     //
-    // Configure the g-buffer (gbuffer, gtex_position, gtex_normal, gtex_albedo_spec,
-    // grbo_depth).
+    // Ambient occlusion (ssao_kernel, tex_noise).
     //
 
-    glGenFramebuffers(1, &r.gbuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, r.gbuffer);
-    DEFER (glBindFramebuffer(GL_FRAMEBUFFER, 0)) {
-        /* clang-format off */
-
-        #define COLOR_BUFFER(                                                                               \
-                gl_handle, gl_internal_format, gl_format, gl_type, gl_color_attachment, gl_texture_wrap)    \
-            glGenTextures(1, &gl_handle);                                                                   \
-            glBindTexture(GL_TEXTURE_2D, gl_handle);                                                        \
-            glTexImage2D(GL_TEXTURE_2D, 0, gl_internal_format, width, height, 0, gl_format, gl_type, NULL); \
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);                              \
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);                              \
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, gl_texture_wrap);                             \
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, gl_texture_wrap);                             \
-            glFramebufferTexture2D(GL_FRAMEBUFFER, gl_color_attachment, GL_TEXTURE_2D, gl_handle, 0);
-
-        // Position color buffer.
-        COLOR_BUFFER(r.gtex_position, GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT0, GL_CLAMP_TO_EDGE);
-
-        // Normal color buffer.
-        COLOR_BUFFER(r.gtex_normal, GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT1, GL_REPEAT);
-
-        // Albedo color + specular intensity color buffer.
-        COLOR_BUFFER(r.gtex_albedo_spec, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT2, GL_REPEAT);
-
-        // Specify which color attachments will be used for rendering.
-        glDrawBuffers(3, (uint[3]) { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 });
-
-        // Depth buffer renderbuffer.
-        glGenRenderbuffers(1, &r.grbo_depth);
-        glBindRenderbuffer(GL_RENDERBUFFER, r.grbo_depth);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, r.grbo_depth);
-
-        check_bound_framebuffer_is_complete();
-
-        #undef GBUFFER_COLOR_BUFFER
+    // @Note: the kernel's samples are spread over the hemisphere around +Z at random distances
+    // (which ssao.fs scales down towards the center), while the noise rotates them around it.
+    // They're generated after the lights, so that these keep the positions they always had.
+    for (usize i = 0; i < SSAO_SAMPLES_MAX; ++i) {
+        vec3 const direction = {
+            ((rand() % 1000) / 500.0f) - 1.0f,
+            ((rand() % 1000) / 500.0f) - 1.0f,
+            ((rand() % 1000) + 1) / 1000.0f, // @Note: never zero, so it can be normalized
+        };
+        f32 const distance = ((rand() % 1000) + 1) / 1000.0f;
+        ssao_kernel[i] = vec3_scl(vec3_normalize(direction), distance);
+    }
 
-        /* clang-format on */
+    vec3 noise[SSAO_NOISE_SIZE * SSAO_NOISE_SIZE];
+    for (usize i = 0; i < ARRAY_LEN(noise); ++i) {
+        noise[i] = (vec3) {
+            ((rand() % 1000) / 500.0f) - 1.0f,
+            ((rand() % 1000) / 500.0f) - 1.0f,
+            0.0f,
+        };
     }
 
+    // @Note: only ever read with texelFetch() (wrapping the coordinates by hand).
+    glGenTextures(1, &r.tex_noise);
+    bind_gl_texture(GL_TEXTURE0, GL_TEXTURE_2D, r.tex_noise);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_RGB16F,
+        SSAO_NOISE_SIZE,
+        SSAO_NOISE_SIZE,
+        0,
+        GL_RGB,
+        GL_FLOAT,
+        noise);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
 #if 0
     //
     // Skybox vertices (vao_skybox).
@@ -392,11 +636,23 @@ static inline void destroy_resources(Resources *r, int width, int height) {
     UNUSED(width);
     UNUSED(height);
 
-    glDeleteRenderbuffers(1, &r->grbo_depth);
-    glDeleteTextures(1, &r->gtex_albedo_spec);
-    glDeleteTextures(1, &r->gtex_normal);
-    glDeleteTextures(1, &r->gtex_position);
-    glDeleteFramebuffers(1, &r->gbuffer);
+    destroy_point_shadows(&r->point_shadows);
+    destroy_shadow_cascades(&r->shadow_cascades);
+
+    forget_gl_texture(r->tex_noise);
+    glDeleteTextures(1, &r->tex_noise);
+
+    forget_gl_framebuffer(r->depth_blit_framebuffer);
+    glDeleteFramebuffers(1, &r->depth_blit_framebuffer);
+    destroy_render_graph(&r->render_graph);
+
+    destroy_light_clusters(&r->light_clusters);
+    destroy_uniform_buffer(&r->light_block);
+    destroy_uniform_buffer(&r->camera_block);
+
+    free(r->light_radii);
+    free(r->light_colors);
+    free(r->light_positions);
 
 #if 0
     glDeleteFramebuffers(1, &r->fbo_depth_map);
@@ -405,30 +661,145 @@ static inline void destroy_resources(Resources *r, int width, int height) {
     glDeleteVertexArrays(1, &r->vao_cube);
     glDeleteVertexArrays(1, &r->vao_plane);
     glDeleteVertexArrays(1, &r->vao_skybox);
-    glDeleteFramebuffers(1, &r->gbuffer);
 
     glDeleteTextures(1, &wood_texture.id);
     glDeleteTextures(1, &skybox_texture.id);
 #endif
 
+    glDeleteQueries(OBJECT_COUNT, r->object_queries);
+    dealloc_render_queue(&r->render_queue);
+    dealloc_occlusion_buffer(&r->occlusion);
+    dealloc_culled_model(&r->culled_backpack);
+    destroy_visibility_geometry(&r->visibility_geometry);
     dealloc_model(&backpack);
+    destroy_mesh_instance_buffer();
 
 #if 0
-    glDeleteProgram(shadow_mapping.shader.program_id);
-    glDeleteProgram(debug_quad.shader.program_id);
-    glDeleteProgram(test_scene.shader.program_id);
-    glDeleteProgram(skybox.shader.program_id);
+    destroy_shader(&shadow_mapping.shader);
+    destroy_shader(&debug_quad.shader);
+    destroy_shader(&test_scene.shader);
+    destroy_shader(&skybox.shader);
 #endif
 
-    glDeleteProgram(light_box.shader.program_id);
-    glDeleteProgram(lighting_pass.shader.program_id);
-    glDeleteProgram(geometry_pass.shader.program_id);
+    unregister_shader(&shadow_depth.shader);
+    unregister_shader(&ssao_blur.shader);
+    unregister_shader(&occlusion_query.shader);
+    unregister_shader(&visibility_pass.shader);
+    unregister_shader(&light_volume_stencil.shader);
+    unregister_shader(&light_box.shader);
+
+    dealloc_shader_permutations(ssao_pass);
+    dealloc_shader_permutations(visibility_resolve);
+    dealloc_shader_permutations(light_volume);
+    dealloc_shader_permutations(lighting_pass);
+    dealloc_shader_permutations(geometry_pass);
+    ssao_pass = NULL;
+    visibility_resolve = NULL;
+    light_volume = NULL;
+    lighting_pass = NULL;
+    geometry_pass = NULL;
+
+    destroy_shader(&shadow_depth.shader);
+    destroy_shader(&ssao_blur.shader);
+    destroy_shader(&occlusion_query.shader);
+    destroy_shader(&visibility_pass.shader);
+    destroy_shader(&light_volume_stencil.shader);
+    destroy_shader(&light_box.shader);
 }
 
 //
 // Frame rendering pre- and post-processing.
 //
 
+// @Note: the stats of the previous frame, printed on demand (see process_input) rather than
+// shown in the window's title, which only has room for the frame times.
+static void log_frame_stats(Resources const *r, GlStateStats const gl_stats) {
+    usize const calls = gl_stats.programs.calls + gl_stats.vertex_arrays.calls
+                        + gl_stats.framebuffers.calls + gl_stats.textures.calls
+                        + gl_stats.capabilities.calls;
+    usize const filtered = gl_stats.programs.filtered + gl_stats.vertex_arrays.filtered
+                           + gl_stats.framebuffers.filtered + gl_stats.textures.filtered
+                           + gl_stats.capabilities.filtered;
+
+    CullingStats const culling = r->culled_backpack.stats;
+    OcclusionQueryStats const queries = r->occlusion_query_stats;
+
+    RenderQueueStats const queue = r->render_queue.stats;
+
+    // @Note: either path fills the g-buffer, so the passes that didn't run count as zero.
+    RenderGraph const *graph = &r->render_graph;
+    RenderGraphStats const graph_stats = graph->stats;
+    char const *const gbuffer_passes[] = { "geometry", "visibility", "visibility_resolve" };
+    f64 gbuffer_ms = 0.0;
+    for (usize i = 0; i < ARRAY_LEN(gbuffer_passes); ++i) {
+        RenderPassStats const *pass = get_render_pass_stats(graph, gbuffer_passes[i]);
+        if (pass) { gbuffer_ms += pass->gpu_ms; }
+    }
+    char const *const ssao_passes[] = { "ssao", "ssao_blur_x", "ssao_blur_y" };
+    f64 ssao_ms = 0.0;
+    for (usize i = 0; i < ARRAY_LEN(ssao_passes); ++i) {
+        RenderPassStats const *pass = get_render_pass_stats(graph, ssao_passes[i]);
+        if (pass) { ssao_ms += pass->gpu_ms; }
+    }
+    RenderPassStats const *lighting = get_render_pass_stats(graph, "lighting");
+    RenderPassStats const *shadows = get_render_pass_stats(graph, "shadow_cascades");
+    ShadowCascadeStats const cascades = r->shadow_cascades.stats;
+    RenderPassStats const *point_shadows = get_render_pass_stats(graph, "point_shadows");
+    PointShadowStats const points = r->point_shadows.stats;
+    f64 const atlas_texels = (f64) POINT_SHADOW_ATLAS_SIZE * POINT_SHADOW_ATLAS_SIZE;
+
+    GLOW_LOG(
+        "Gpu: %.2f ms gbuffer, %.2f ms ssao, %.2f ms lighting",
+        gbuffer_ms,
+        ssao_ms,
+        lighting ? lighting->gpu_ms : 0.0);
+    GLOW_LOG(
+        "Shadows: %.2f ms, %zu cascades rendered, %zu cached",
+        shadows ? shadows->gpu_ms : 0.0,
+        cascades.cascades_rendered,
+        cascades.cascades_cached);
+    GLOW_LOG(
+        "Point shadows: %.2f ms, %zu lights, %zu faces rendered, %zu pending, "
+        "%.0f%% of the atlas (%zu lights out of room)",
+        point_shadows ? point_shadows->gpu_ms : 0.0,
+        points.lights_shadowed,
+        points.faces_rendered,
+        points.faces_pending,
+        100.0 * (f64) points.texels_used / atlas_texels,
+        points.lights_out_of_tiles);
+    GLOW_LOG(
+        "Visible: %zu of %zu objects, %zu of %zu meshes "
+        "(occluded: %zu objects, %zu meshes, %.2f ms)",
+        culling.objects_visible,
+        culling.objects_tested,
+        culling.meshes_visible,
+        culling.meshes_tested,
+        culling.objects_occluded,
+        culling.meshes_occluded,
+        r->occlusion.stats.rasterize_ms);
+    GLOW_LOG(
+        "Queries: %zu, ~%zu of %zu draws culled",
+        queries.queries,
+        queries.draws_culled,
+        queries.draws);
+    GLOW_LOG(
+        "Queue: %zu packets in %zu draws, %zu shader and %zu material changes",
+        queue.packets,
+        queue.draws,
+        queue.shader_changes,
+        queue.material_changes);
+    GLOW_LOG(
+        "Graph: %zu of %zu passes, %zu of %zu targets, %.1f of %.1f MiB, %.3f ms",
+        graph_stats.passes - graph_stats.passes_culled,
+        graph_stats.passes,
+        graph_stats.textures_allocated,
+        graph_stats.textures,
+        (f64) graph_stats.bytes / (1024.0 * 1024.0),
+        (f64) graph_stats.bytes_unaliased / (1024.0 * 1024.0),
+        graph_stats.overhead_ms);
+    GLOW_LOG("Gl state: %zu of %zu calls filtered", filtered, calls);
+}
+
 static inline void begin_frame(GLFWwindow *window, int width, int height) {
     UNUSED(width);
     UNUSED(height);
@@ -437,6 +808,13 @@ static inline void begin_frame(GLFWwindow *window, int width, int height) {
     update_frame_counter(&frame_counter, clock.time);
     process_input(window, clock.time_increment);
 
+    // @Note: shaders whose files changed (or that were marked dirty) are swapped in here.
+    if (update_shader_registry() > 0) { setup_shaders(); }
+
+    // @Note: these are the counts of the previous frame, as they're reset for this one.
+    GlStateStats const gl_stats = get_gl_state_stats();
+    reset_gl_state_stats();
+
     if (frame_counter.last_update_time == clock.time) {
         char title[64]; // 64 seems large enough..
         snprintf(
@@ -448,6 +826,8 @@ static inline void begin_frame(GLFWwindow *window, int width, int height) {
         glfwSetWindowTitle(window, title);
     }
 
+    if (should_log_stats) { log_frame_stats(glfwGetWindowUserPointer(window), gl_stats); }
+
     if (is_ui_enabled) { begin_imgui_frame(); }
 }
 
@@ -506,8 +886,8 @@ static inline void render_quad(void) {
         uint vbo;
         glGenBuffers(1, &vbo);
         DEFER (glDeleteBuffers(1, &vbo)) {
-            glBindVertexArray(vao_quad);
-            DEFER (glBindVertexArray(0)) {
+            bind_gl_vertex_array(vao_quad);
+            DEFER (bind_gl_vertex_array(0)) {
                 f32 const quad_vertices_ndc[] = { -1, 1, 0, 0, 1, -1, -1, 0, 0, 0, 1, 1, 0, 1, 1, 1, -1, 0, 1, 0 };
                 glBindBuffer(GL_ARRAY_BUFFER, vbo);
                 glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices_ndc), quad_vertices_ndc, GL_STATIC_DRAW);
@@ -522,13 +902,11 @@ static inline void render_quad(void) {
     }
     /* clang-format on */
 
-    DEFER (glBindVertexArray(0)) {
-        glBindVertexArray(vao_quad);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    }
+    bind_gl_vertex_array(vao_quad);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
 
-static inline void render_cube(void) {
+static inline void render_cube(usize instances_len) {
     static uint vao_cube = 0;
 
     /* clang-format off */
@@ -538,8 +916,8 @@ static inline void render_cube(void) {
         uint vbo;
         glGenBuffers(1, &vbo);
         DEFER (glDeleteBuffers(1, &vbo)) {
-            glBindVertexArray(vao_cube);
-            DEFER (glBindVertexArray(0)) {
+            bind_gl_vertex_array(vao_cube);
+            DEFER (bind_gl_vertex_array(0)) {
                 static f32 const cube_vertices_ndc[] = { -1, -1, -1, 0, 0, -1, 0, 0, 1, 1, -1, 0, 0, -1, 1, 1, 1, -1, -1, 0, 0, -1, 1, 0, 1, 1, -1, 0, 0, -1, 1, 1, -1, -1, -1, 0, 0, -1, 0, 0, -1, 1, -1, 0, 0, -1, 0, 1, -1, -1, 1, 0, 0, 1, 0, 0, 1, -1, 1, 0, 0, 1, 1, 0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 1, 1, 1, -1, 1, 1, 0, 0, 1, 0, 1, -1, -1, 1, 0, 0, 1, 0, 0, -1, 1, 1, -1, 0, 0, 1, 0, -1, 1, -1, -1, 0, 0, 1, 1, -1, -1, -1, -1, 0, 0, 0, 1, -1, -1, -1, -1, 0, 0, 0, 1, -1, -1, 1, -1, 0, 0, 0, 0, -1, 1, 1, -1, 0, 0, 1, 0, 1, 1, 1, 1, 0, 0, 1, 0, 1, -1, -1, 1, 0, 0, 0, 1, 1, 1, -1, 1, 0, 0, 1, 1, 1, -1, -1, 1, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0, 1, 0, 1, -1, 1, 1, 0, 0, 0, 0, -1, -1, -1, 0, -1, 0, 0, 1, 1, -1, -1, 0, -1, 0, 1, 1, 1, -1, 1, 0, -1, 0, 1, 0, 1, -1, 1, 0, -1, 0, 1, 0, -1, -1, 1, 0, -1, 0, 0, 0, -1, -1, -1, 0, -1, 0, 0, 1, -1, 1, -1, 0, 1, 0, 0, 1, 1, 1, 1, 0, 1, 0, 1, 0, 1, 1, -1, 0, 1, 0, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0, -1, 1, -1, 0, 1, 0, 0, 1, -1, 1, 1, 0, 1, 0, 0, 0 };
                 glBindBuffer(GL_ARRAY_BUFFER, vbo);
                 glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices_ndc), cube_vertices_ndc, GL_STATIC_DRAW);
@@ -556,50 +934,800 @@ static inline void render_cube(void) {
     }
     /* clang-format on */
 
-    DEFER (glBindVertexArray(0)) {
-        glBindVertexArray(vao_cube);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+    bind_gl_vertex_array(vao_cube);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (int) instances_len);
+}
+
+#define SPHERE_RINGS 8
+#define SPHERE_SEGMENTS 16
+
+// @Note: draws a (low poly) unit sphere that is slightly scaled up so that its faces enclose
+// the actual sphere, as it's used as a light volume proxy (so it mustn't cut off any pixels).
+static inline void render_sphere(usize instances_len) {
+    static uint vao_sphere = 0;
+
+    usize const indices_len = SPHERE_RINGS * SPHERE_SEGMENTS * 6;
+
+    if (vao_sphere == 0) {
+        glGenVertexArrays(1, &vao_sphere); // @Leak
+
+        f32 const pi = 3.14159265358979f;
+        f32 const scale = 1 / (cosf(pi / SPHERE_SEGMENTS) * cosf(pi / (2 * SPHERE_RINGS)));
+
+        vec3 vertices[(SPHERE_RINGS + 1) * (SPHERE_SEGMENTS + 1)];
+        for (usize i = 0; i <= SPHERE_RINGS; ++i) {
+            f32 const theta = pi * i / SPHERE_RINGS;
+            for (usize j = 0; j <= SPHERE_SEGMENTS; ++j) {
+                f32 const phi = 2 * pi * j / SPHERE_SEGMENTS;
+                vertices[i * (SPHERE_SEGMENTS + 1) + j] = (vec3) {
+                    scale * sinf(theta) * cosf(phi),
+                    scale * cosf(theta),
+                    scale * sinf(theta) * sinf(phi),
+                };
+            }
+        }
+
+        // @Note: counter-clockwise when seen from the outside (i.e. front faces are outside).
+        u16 indices[SPHERE_RINGS * SPHERE_SEGMENTS * 6];
+        for (usize i = 0, k = 0; i < SPHERE_RINGS; ++i) {
+            for (usize j = 0; j < SPHERE_SEGMENTS; ++j) {
+                u16 const a = (u16) (i * (SPHERE_SEGMENTS + 1) + j);
+                u16 const b = (u16) (a + SPHERE_SEGMENTS + 1);
+                u16 const c = (u16) (b + 1);
+                u16 const d = (u16) (a + 1);
+                indices[k++] = a, indices[k++] = d, indices[k++] = c;
+                indices[k++] = a, indices[k++] = c, indices[k++] = b;
+            }
+        }
+
+        uint buffers[2];
+        glGenBuffers(2, buffers);
+        DEFER (glDeleteBuffers(2, buffers)) {
+            bind_gl_vertex_array(vao_sphere);
+            DEFER (bind_gl_vertex_array(0)) {
+                glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+                glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+                glEnableVertexAttribArray(0); // position
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *) 0);
+            }
+        }
+    }
+
+    bind_gl_vertex_array(vao_sphere);
+    glDrawElementsInstanced(
+        GL_TRIANGLES, (int) indices_len, GL_UNSIGNED_SHORT, NULL, (int) instances_len);
+}
+
+// @Note: for the variants of the lighting passes that sample the point shadows.
+static void bind_point_shadows(Shader const shader, PointShadows const *shadows) {
+    vec4 spheres[POINT_SHADOWS_MAX];
+    vec4 tiles[POINT_SHADOWS_MAX * POINT_SHADOW_FACES];
+    get_point_shadow_uniforms(shadows, spheres, tiles);
+
+    bind_gl_texture(GL_TEXTURE0 + POINT_SHADOW_ATLAS_UNIT, GL_TEXTURE_2D, shadows->texture);
+    set_shader_vec4_array(shader, "point_shadow_spheres", spheres, ARRAY_LEN(spheres));
+    set_shader_vec4_array(shader, "point_shadow_tiles", tiles, ARRAY_LEN(tiles));
+}
+
+// @Note: adds every light's contribution to the bound framebuffer, whose depth (and zeroed
+// stencil) must be the g-buffer's. First, a stencil pass counts the volumes that each pixel's
+// surface is inside of (back faces behind it increment, front faces behind it decrement), and
+// then only pixels inside of some volume are shaded, by the back faces of the volumes covering
+// them (so it also works with the camera inside of a volume). Thus, sky pixels and pixels out
+// of every light's range are never shaded.
+static void render_light_volumes(
+    Resources const *r,
+    RenderGraph const *graph,
+    GBufferTargets const *gbuffer,
+    bool point_shadows) {
+    LightClusters const *clusters = &r->light_clusters;
+    if (clusters->lights_len == 0) { return; }
+
+    // @Note: variants that fail to compile are logged once (and can still be hot reloaded).
+    Err light_volume_err = Err_None;
+    Shader const *light_volume_shader =
+        get_light_volume_pass(r->gbuffer_layout, point_shadows, &light_volume_err);
+    if (!light_volume_shader) { return; }
+
+    set_gl_capability(GL_STENCIL_TEST, true);
+    set_gl_capability(GL_CULL_FACE, false);
+    glDepthMask(GL_FALSE);
+
+    // Stencil pass.
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glStencilFunc(GL_ALWAYS, 0, 0xff);
+    glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+    glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+
+    use_shader(light_volume_stencil.shader);
+    bind_gl_texture(
+        GL_TEXTURE0 + CLUSTER_LIGHTS_UNIT, GL_TEXTURE_BUFFER, clusters->lights.texture);
+    render_sphere(clusters->lights_len);
+
+    // Lighting pass.
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glStencilFunc(GL_NOTEQUAL, 0, 0xff);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+    set_gl_capability(GL_DEPTH_TEST, false);
+    set_gl_capability(GL_CULL_FACE, true);
+    glCullFace(GL_FRONT);
+    set_gl_capability(GL_BLEND, true);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    use_shader(*light_volume_shader);
+    bind_gbuffer_textures(graph, gbuffer);
+    if (point_shadows) { bind_point_shadows(*light_volume_shader, &r->point_shadows); }
+    bind_gl_texture(
+        GL_TEXTURE0 + CLUSTER_LIGHTS_UNIT, GL_TEXTURE_BUFFER, clusters->lights.texture);
+    render_sphere(clusters->lights_len);
+
+    set_gl_capability(GL_BLEND, false);
+    glCullFace(GL_BACK);
+    set_gl_capability(GL_CULL_FACE, false);
+    set_gl_capability(GL_DEPTH_TEST, true);
+    set_gl_capability(GL_STENCIL_TEST, false);
+    glDepthMask(GL_TRUE);
+}
+
+// @Note: the visibility ids only hold the index of an instance within its draw, so each mesh's
+// instances are drawn in chunks of at most VISIBILITY_INSTANCES_MAX, and every chunk gets its own
+// stencil value (which is how the resolve pass tells them apart).
+typedef struct VisibilityDraw {
+    usize mesh;
+    usize first_instance;
+    usize instances_len;
+} VisibilityDraw;
+
+// @Note: returns how many draws there are, where those past VISIBILITY_MESHES_MAX are dropped.
+static usize get_visibility_draws(
+    FramePasses const *frame, VisibilityDraw draws[VISIBILITY_MESHES_MAX]) {
+    static bool were_draws_dropped = false;
+
+    CulledModel const *culled = frame->culled;
+    usize const meshes_len =
+        culled ? MIN(frame->r->visibility_geometry.meshes_len, culled->meshes_len) : 0;
+
+    usize draws_len = 0;
+    usize instances_dropped = 0;
+    for (usize i = 0; i < meshes_len; ++i) {
+        usize const end = culled->first_instances[i + 1];
+        for (usize first = culled->first_instances[i]; first < end;
+             first += VISIBILITY_INSTANCES_MAX) {
+            usize const instances_len = MIN(end - first, VISIBILITY_INSTANCES_MAX);
+            if (draws_len == VISIBILITY_MESHES_MAX) {
+                instances_dropped += instances_len;
+                continue;
+            }
+            draws[draws_len++] = (VisibilityDraw) { i, first, instances_len };
+        }
+    }
+
+    // @Note: only warn when it starts happening, rather than every frame.
+    if (instances_dropped > 0 && !were_draws_dropped) {
+        GLOW_WARNING(
+            "only `%d` visibility draws fit in the stencil, so `%zu` instances aren't drawn",
+            VISIBILITY_MESHES_MAX,
+            instances_dropped);
+    }
+    were_draws_dropped = instances_dropped > 0;
+
+    return draws_len;
+}
+
+// @Note: the visibility path fills the g-buffer in two passes. The first one only writes
+// visibility ids and depth (plus the index of each pixel's draw to stencil), and then a
+// fullscreen pass per draw (whose pixels are picked by the stencil test) fetches their triangles
+// and materials, writing the same g-buffer attributes that the geometry pass would, so lighting
+// is left as it is.
+static void execute_visibility_pass(RenderGraph const *graph, void *data) {
+    UNUSED(graph);
+    FramePasses const *frame = data;
+    CulledModel const *culled = frame->culled;
+
+    VisibilityDraw draws[VISIBILITY_MESHES_MAX];
+    usize const draws_len = get_visibility_draws(frame, draws);
+
+    set_gl_capability(GL_STENCIL_TEST, true);
+
+    // @Note: the ids aren't cleared, as empty pixels are the ones left with a zero stencil.
+    glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+    use_shader(visibility_pass.shader);
+    for (usize i = 0; i < draws_len; ++i) {
+        VisibilityDraw const draw = draws[i];
+        glStencilFunc(GL_ALWAYS, (int) i + 1, 0xff);
+        upload_mesh_instances(&culled->local_to_worlds[draw.first_instance], draw.instances_len);
+        draw_mesh_instanced_direct(&backpack.meshes[draw.mesh], draw.instances_len);
+    }
+
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    set_gl_capability(GL_STENCIL_TEST, false);
+}
+
+static void execute_visibility_resolve_pass(RenderGraph const *graph, void *data) {
+    FramePasses const *frame = data;
+    CulledModel const *culled = frame->culled;
+    VisibilityGeometry *geometry = &frame->r->visibility_geometry;
+
+    Err resolve_err = Err_None;
+    Shader const *resolve_shader =
+        get_visibility_resolve_pass(frame->r->gbuffer_layout, &resolve_err);
+
+    set_gl_capability(GL_STENCIL_TEST, true);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (resolve_shader && culled) {
+        Shader const shader = *resolve_shader;
+        VisibilityDraw draws[VISIBILITY_MESHES_MAX];
+        usize const draws_len = get_visibility_draws(frame, draws);
+        uint const ids = get_render_texture(graph, frame->gbuffer.visibility_ids);
+        set_gl_capability(GL_DEPTH_TEST, false);
+
+        use_shader(shader);
+        update_visibility_instances(geometry, culled->local_to_worlds, culled->instances_len);
+        bind_sampler_texture(shader, "visibility_ids", GL_TEXTURE_2D, ids);
+        bind_sampler_texture(
+            shader, "visibility_vertices", GL_TEXTURE_BUFFER, geometry->vertices.texture);
+        bind_sampler_texture(
+            shader, "visibility_indices", GL_TEXTURE_BUFFER, geometry->indices.texture);
+        bind_sampler_texture(
+            shader, "visibility_instances", GL_TEXTURE_BUFFER, geometry->instances.texture);
+
+        for (usize i = 0; i < draws_len; ++i) {
+            VisibilityDraw const draw = draws[i];
+            glStencilFunc(GL_EQUAL, (int) i + 1, 0xff);
+            bind_mesh_textures(&backpack.meshes[draw.mesh]);
+            set_shader_int(
+                shader, "visibility_first_index", (int) geometry->first_indices[draw.mesh]);
+            set_shader_int(shader, "visibility_first_instance", (int) draw.first_instance);
+            render_quad();
+        }
+
+        set_gl_capability(GL_DEPTH_TEST, true);
+    }
+
+    // @Note: the light volumes expect the stencil to be zeroed (see render_light_volumes).
+    glClear(GL_STENCIL_BUFFER_BIT);
+    set_gl_capability(GL_STENCIL_TEST, false);
+}
+
+// @Note: queues every instance of each mesh that survived culling, so that they're sorted by
+// material and front to back (and merged back into instanced draws) by submit_render_queue.
+static void push_culled_model_draws(
+    RenderQueue *queue,
+    Shader const *shader,
+    CulledModel const *culled,
+    mat4 const world_to_view,
+    Err *err) {
+    for (usize j = 0; j < culled->meshes_len; ++j) {
+        for (usize i = culled->first_instances[j]; i < culled->first_instances[j + 1]; ++i) {
+            push_mesh_draw(
+                queue,
+                RENDER_PASS_GEOMETRY,
+                &backpack.meshes[j],
+                shader,
+                culled->local_to_worlds[i],
+                world_to_view,
+                err);
+        }
+    }
+}
+
+// @Note: each object inside of the frustum is drawn (as a whole) only if any sample of its
+// bounds passed the depth test on the last frame, which is decided by the GPU with conditional
+// rendering, so the CPU never waits on a query. Then its bounds are tested against this frame's
+// depth to decide on the next one (so objects show up one frame late when they're uncovered).
+static void draw_objects_with_occlusion_queries(
+    Resources *r,
+    Shader const *shader,
+    Frustum const *frustum,
+    mat4 const local_to_worlds[OBJECT_COUNT]) {
+    Aabb bounds[OBJECT_COUNT];
+    bool visible[OBJECT_COUNT];
+    for (usize i = 0; i < OBJECT_COUNT; ++i) {
+        bounds[i] = aabb_transform(backpack.bounds, local_to_worlds[i]);
+    }
+    cull_aabbs(frustum, bounds, visible, OBJECT_COUNT);
+
+    // @Note: objects whose bounds the camera is in are always drawn (and aren't queried), as
+    // their faces could all be clipped by the near plane.
+    bool is_queryable[OBJECT_COUNT];
+    for (usize i = 0; i < OBJECT_COUNT; ++i) {
+        is_queryable[i] = visible[i] && !aabb_contains_point(bounds[i], camera.position);
+    }
+
+    OcclusionQueryStats stats = { 0 };
+
+    use_shader(*shader);
+    for (usize i = 0; i < OBJECT_COUNT; ++i) {
+        if (!visible[i]) { continue; }
+
+        bool const is_conditional = is_queryable[i] && r->object_is_queried[i];
+        if (is_conditional) {
+            int is_available = 0;
+            glGetQueryObjectiv(r->object_queries[i], GL_QUERY_RESULT_AVAILABLE, &is_available);
+            if (is_available) {
+                uint any_samples_passed = 1;
+                glGetQueryObjectuiv(r->object_queries[i], GL_QUERY_RESULT, &any_samples_passed);
+                if (!any_samples_passed) { stats.draws_culled += backpack.draws.batches_len; }
+            }
+
+            // @Note: draws anyway if the result isn't ready yet (instead of stalling the GPU).
+            glBeginConditionalRender(r->object_queries[i], GL_QUERY_NO_WAIT);
+        }
+
+        draw_model_instanced(&backpack, shader, &local_to_worlds[i], 1);
+        stats.draws += backpack.draws.batches_len;
+
+        if (is_conditional) { glEndConditionalRender(); }
+    }
+
+    // Test the bounds against the depth buffer, without writing to it (nor to any color).
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    use_shader(occlusion_query.shader);
+    for (usize i = 0; i < OBJECT_COUNT; ++i) {
+        r->object_is_queried[i] = is_queryable[i];
+        if (!is_queryable[i]) { continue; }
+
+        set_shader_vec3(occlusion_query.shader, "bounds_min", bounds[i].min);
+        set_shader_vec3(occlusion_query.shader, "bounds_max", bounds[i].max);
+
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, r->object_queries[i]);
+        render_cube(1);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        stats.queries += 1;
+    }
+
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    r->occlusion_query_stats = stats;
+}
+
+// @Note: the objects inside of the frustum are added as occluders nearest first, mesh by mesh
+// (skipping the small ones), until either one of the OCCLUDER limits is reached.
+static void rasterize_scene_occluders(
+    Resources *r,
+    mat4 const world_to_clip,
+    Frustum const *frustum,
+    mat4 const local_to_worlds[OBJECT_COUNT],
+    Err *err) {
+    Aabb bounds[OBJECT_COUNT];
+    bool visible[OBJECT_COUNT];
+    for (usize i = 0; i < OBJECT_COUNT; ++i) {
+        bounds[i] = aabb_transform(backpack.bounds, local_to_worlds[i]);
+    }
+    cull_aabbs(frustum, bounds, visible, OBJECT_COUNT);
+
+    // Sort the visible objects by their distance to the camera (with an insertion sort).
+    usize order[OBJECT_COUNT];
+    f32 distances[OBJECT_COUNT];
+    usize order_len = 0;
+    for (usize i = 0; i < OBJECT_COUNT; ++i) {
+        if (!visible[i]) { continue; }
+
+        vec3 const center = vec3_scl(vec3_add(bounds[i].min, bounds[i].max), 0.5f);
+        f32 const distance = vec3_length(vec3_sub(center, camera.position));
+
+        usize j = order_len++;
+        for (; j > 0 && distances[j - 1] > distance; --j) {
+            order[j] = order[j - 1];
+            distances[j] = distances[j - 1];
+        }
+        order[j] = i;
+        distances[j] = distance;
+    }
+
+    vec3 const model_extent = vec3_sub(backpack.bounds.max, backpack.bounds.min);
+    f32 const min_size = OCCLUDER_MIN_SIZE * vec3_length(model_extent);
+
+    OccluderMesh occluders[OCCLUDERS_MAX];
+    usize occluders_len = 0;
+    usize triangles_len = 0;
+    for (usize k = 0; k < order_len; ++k) {
+        for (usize j = 0; j < backpack.meshes_len; ++j) {
+            Mesh const *mesh = &backpack.meshes[j];
+            vec3 const extent = vec3_sub(mesh->bounds.max, mesh->bounds.min);
+            if (!(vec3_length(extent) >= min_size)) { continue; } // @Note: also skips empty ones
+
+            usize const mesh_triangles_len = mesh->indices_len / 3;
+            if (occluders_len == OCCLUDERS_MAX
+                || triangles_len + mesh_triangles_len > OCCLUDER_TRIANGLES_MAX) {
+                continue;
+            }
+
+            occluders[occluders_len++] = (OccluderMesh) {
+                .positions = &mesh->vertices[0].position,
+                .stride = sizeof(Vertex),
+                .indices = mesh->indices,
+                .indices_len = mesh->indices_len,
+                .local_to_world = local_to_worlds[order[k]],
+            };
+            triangles_len += mesh_triangles_len;
+        }
+    }
+
+    rasterize_occluders(&r->occlusion, world_to_clip, occluders, occluders_len, err);
+}
+
+//
+// Render graph passes (see draw_frame).
+//
+
+static void execute_geometry_pass(RenderGraph const *graph, void *data) {
+    UNUSED(graph);
+    FramePasses const *frame = data;
+    Resources *r = frame->r;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    if (frame->geometry_shader && frame->occlusion_queries) {
+        draw_objects_with_occlusion_queries(
+            r, frame->geometry_shader, frame->frustum, frame->local_to_worlds);
+    } else if (frame->geometry_shader && frame->culled) {
+        Err queue_err = Err_None;
+        push_culled_model_draws(
+            &r->render_queue,
+            frame->geometry_shader,
+            frame->culled,
+            frame->world_to_view,
+            &queue_err);
+        if (queue_err) { GLOW_WARNING("failed to queue the geometry pass' draws"); }
+
+        submit_render_queue(&r->render_queue); // @Note: whatever was queued
+    }
+}
+
+// @Note: computes the ambient occlusion of every other pixel of the g-buffer in each direction,
+// i.e. of a quarter of them, with `ssao_samples` samples each (see ssao.fs).
+static void execute_ssao_pass(RenderGraph const *graph, void *data) {
+    FramePasses const *frame = data;
+
+    if (!frame->ssao_shader) {
+        // @Note: nothing is occluded (and the zero depths leave the upsample bilinear).
+        glClearColor(1.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        return;
+    }
+
+    Shader const shader = *frame->ssao_shader;
+    set_gl_capability(GL_DEPTH_TEST, false);
+
+    use_shader(shader);
+    bind_gbuffer_textures(graph, &frame->gbuffer);
+    bind_gl_texture(GL_TEXTURE0 + SSAO_NOISE_UNIT, GL_TEXTURE_2D, frame->r->tex_noise);
+    set_shader_int(shader, "ssao_samples", frame->ssao_samples);
+    set_shader_float(shader, "ssao_radius", frame->ssao_radius);
+    set_shader_float(shader, "ssao_bias", frame->ssao_bias);
+    render_quad();
+
+    set_gl_capability(GL_DEPTH_TEST, true);
+}
+
+// @Note: the blur is split into a horizontal and a vertical pass (9 taps each, instead of 81),
+// which isn't exactly the same as a 2D bilateral blur, but close enough for occlusion.
+static void blur_ssao(RenderGraph const *graph, RenderResource input, vec2 const direction) {
+    set_gl_capability(GL_DEPTH_TEST, false);
+
+    use_shader(ssao_blur.shader);
+    bind_gl_texture(GL_TEXTURE0 + SSAO_UNIT, GL_TEXTURE_2D, get_render_texture(graph, input));
+    set_shader_vec2(ssao_blur.shader, "blur_direction", direction);
+    render_quad();
+
+    set_gl_capability(GL_DEPTH_TEST, true);
+}
+
+static void execute_ssao_blur_x_pass(RenderGraph const *graph, void *data) {
+    FramePasses const *frame = data;
+    blur_ssao(graph, frame->ssao_raw, (vec2) { 1, 0 });
+}
+
+static void execute_ssao_blur_y_pass(RenderGraph const *graph, void *data) {
+    FramePasses const *frame = data;
+    blur_ssao(graph, frame->ssao_blur_x, (vec2) { 0, 1 });
+}
+
+// @Note: renders the cascades that update_shadow_cascades decided need it, with the objects
+// whose bounds overlap each one. Every object is static, so the cached cascades are drawn with
+// the same casters as the others (which would be the only ones that dynamic objects are drawn
+// into).
+static void execute_shadow_cascades_pass(RenderGraph const *graph, void *data) {
+    UNUSED(graph);
+    FramePasses const *frame = data;
+    ShadowCascades const *shadows = &frame->r->shadow_cascades;
+    Shader const shader = shadow_depth.shader;
+
+    Aabb bounds[OBJECT_COUNT];
+    for (usize i = 0; i < OBJECT_COUNT; ++i) {
+        bounds[i] = aabb_transform(backpack.bounds, frame->local_to_worlds[i]);
+    }
+
+    // @Note: the slope-scaled offset keeps surfaces at grazing angles from shadowing themselves.
+    set_gl_capability(GL_POLYGON_OFFSET_FILL, true);
+    glPolygonOffset(1.5f, 2.0f);
+
+    use_shader(shader);
+    for (usize c = 0; c < SHADOW_CASCADES; ++c) {
+        ShadowCascade const *cascade = &shadows->cascades[c];
+        if (!cascade->needs_update) { continue; }
+
+        bool visible[OBJECT_COUNT];
+        cull_aabbs(&cascade->frustum, bounds, visible, OBJECT_COUNT);
+
+        mat4 casters[OBJECT_COUNT];
+        usize casters_len = 0;
+        for (usize i = 0; i < OBJECT_COUNT; ++i) {
+            if (visible[i]) { casters[casters_len++] = frame->local_to_worlds[i]; }
+        }
+
+        begin_shadow_cascade(shadows, c);
+        if (casters_len == 0) { continue; }
+
+        set_shader_mat4(shader, "world_to_light", cascade->world_to_light);
+        upload_mesh_instances(casters, casters_len);
+        for (usize j = 0; j < backpack.meshes_len; ++j) {
+            draw_mesh_instanced_direct(&backpack.meshes[j], casters_len);
+        }
     }
+
+    set_gl_capability(GL_POLYGON_OFFSET_FILL, false);
 }
 
-static inline void draw_frame(Resources const *r, int width, int height) {
-    mat4 const projection = compute_camera_projection_matrix(&camera);
-    mat4 const view = compute_camera_view_matrix(&camera);
+// @Note: renders the faces that update_point_shadows scheduled this frame, each one with the
+// objects whose bounds overlap it (which, unlike the cascades' casters, may move).
+static void execute_point_shadows_pass(RenderGraph const *graph, void *data) {
+    UNUSED(graph);
+    FramePasses const *frame = data;
+    PointShadows const *shadows = &frame->r->point_shadows;
+    Shader const shader = shadow_depth.shader;
+
+    Aabb bounds[OBJECT_COUNT];
+    for (usize i = 0; i < OBJECT_COUNT; ++i) {
+        bounds[i] = aabb_transform(backpack.bounds, frame->local_to_worlds[i]);
+    }
+
+    set_gl_capability(GL_POLYGON_OFFSET_FILL, true);
+    set_gl_capability(GL_SCISSOR_TEST, true);
+    glPolygonOffset(1.5f, 2.0f);
+
+    use_shader(shader);
+    for (usize s = 0; s < POINT_SHADOWS_MAX; ++s) {
+        PointShadow const *shadow = &shadows->shadows[s];
+        for (usize f = 0; f < POINT_SHADOW_FACES; ++f) {
+            if (!(shadow->update_faces & (1 << f))) { continue; }
+
+            Frustum const frustum = compute_frustum(shadow->world_to_faces[f]);
+            bool visible[OBJECT_COUNT];
+            cull_aabbs(&frustum, bounds, visible, OBJECT_COUNT);
+
+            mat4 casters[OBJECT_COUNT];
+            usize casters_len = 0;
+            for (usize i = 0; i < OBJECT_COUNT; ++i) {
+                if (visible[i]) { casters[casters_len++] = frame->local_to_worlds[i]; }
+            }
+
+            begin_point_shadow_face(shadows, s, f);
+            if (casters_len == 0) { continue; }
+
+            set_shader_mat4(shader, "world_to_light", shadow->world_to_faces[f]);
+            upload_mesh_instances(casters, casters_len);
+            for (usize j = 0; j < backpack.meshes_len; ++j) {
+                draw_mesh_instanced_direct(&backpack.meshes[j], casters_len);
+            }
+        }
+    }
+
+    set_gl_capability(GL_SCISSOR_TEST, false);
+    set_gl_capability(GL_POLYGON_OFFSET_FILL, false);
+}
+
+static void execute_lighting_pass(RenderGraph const *graph, void *data) {
+    FramePasses const *frame = data;
+    Resources const *r = frame->r;
+
+    // @Note: copy the depth (and stencil) values from the g-buffer into the default
+    // framebuffer, this way the light volumes are depth tested against the scene, and
+    // the light boxes don't end up getting rendered on top of everything else.
+    uint const depth = get_render_texture(graph, frame->gbuffer.depth);
+    bind_gl_framebuffer(GL_READ_FRAMEBUFFER, r->depth_blit_framebuffer);
+    DEFER (bind_gl_framebuffer(GL_READ_FRAMEBUFFER, 0)) {
+        glFramebufferTexture2D(
+            GL_READ_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+        glBlitFramebuffer(
+            0,
+            0,
+            graph->width,
+            graph->height,
+            0,
+            0,
+            graph->width,
+            graph->height,
+            GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT,
+            GL_NEAREST);
+    }
+
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (frame->lighting_shader) {
+        set_gl_capability(GL_DEPTH_TEST, false); // @Note: so the quad isn't hidden by the scene
+        use_shader(*frame->lighting_shader);
+        bind_gbuffer_textures(graph, &frame->gbuffer);
+
+        // @Note: zero if SSAO is disabled (in which case the variant doesn't sample it).
+        uint const ssao = get_render_texture(graph, frame->ssao);
+        bind_gl_texture(GL_TEXTURE0 + SSAO_UNIT, GL_TEXTURE_2D, ssao);
+
+        Shader const shader = *frame->lighting_shader;
+        set_shader_vec3(shader, "sun_direction", frame->sun_direction);
+        set_shader_vec3(shader, "sun_color", frame->sun_color);
+
+        if (frame->shadows) {
+            ShadowCascades const *shadows = &r->shadow_cascades;
+            mat4 world_to_lights[SHADOW_CASCADES];
+            f32 split_depths[SHADOW_CASCADES];
+            f32 texel_sizes[SHADOW_CASCADES];
+            for (usize i = 0; i < SHADOW_CASCADES; ++i) {
+                world_to_lights[i] = shadows->cascades[i].world_to_light;
+                split_depths[i] = shadows->cascades[i].split_depth;
+                texel_sizes[i] = shadows->cascades[i].texel_size;
+            }
+
+            bind_gl_texture(
+                GL_TEXTURE0 + SHADOW_CASCADES_UNIT, GL_TEXTURE_2D_ARRAY, shadows->texture);
+            set_shader_mat4_array(
+                shader, "shadow_world_to_light", world_to_lights, SHADOW_CASCADES);
+            set_shader_float_array(shader, "shadow_split_depths", split_depths, SHADOW_CASCADES);
+            set_shader_float_array(shader, "shadow_texel_sizes", texel_sizes, SHADOW_CASCADES);
+        }
+
+        if (frame->point_shadows) { bind_point_shadows(shader, &r->point_shadows); }
+
+        if (frame->lighting_path == LIGHTING_CLUSTERED) {
+            LightClusters const *clusters = &r->light_clusters;
+            bind_gl_texture(
+                GL_TEXTURE0 + CLUSTER_LIGHTS_UNIT, GL_TEXTURE_BUFFER, clusters->lights.texture);
+            bind_gl_texture(
+                GL_TEXTURE0 + CLUSTER_GRID_UNIT, GL_TEXTURE_BUFFER, clusters->grid.texture);
+            bind_gl_texture(
+                GL_TEXTURE0 + CLUSTER_INDICES_UNIT, GL_TEXTURE_BUFFER, clusters->indices.texture);
+
+            vec2 const tile_size = {
+                (f32) graph->width / LIGHT_CLUSTERS_X,
+                (f32) graph->height / LIGHT_CLUSTERS_Y,
+            };
+            set_shader_vec2(shader, "cluster_depth_scale_bias", clusters->depth_scale_bias);
+            set_shader_vec2(shader, "cluster_tile_size", tile_size);
+        }
+
+        render_quad();
+        set_gl_capability(GL_DEPTH_TEST, true);
+    }
+
+    if (frame->lighting_path == LIGHTING_VOLUMES && frame->draw_mode == DRAW_LIGHTING) {
+        render_light_volumes(r, graph, &frame->gbuffer, frame->point_shadows);
+    }
+}
+
+// @Note: the cubes' positions and colors are read from the clustered lights (by instance).
+static void execute_light_boxes_pass(RenderGraph const *graph, void *data) {
+    UNUSED(graph);
+    FramePasses const *frame = data;
+
+    use_shader(light_box.shader);
+    bind_gl_texture(
+        GL_TEXTURE0 + CLUSTER_LIGHTS_UNIT,
+        GL_TEXTURE_BUFFER,
+        frame->r->light_clusters.lights.texture);
+    render_cube(frame->r->light_clusters.lights_len);
+}
+
+static inline void draw_frame(Resources *r, int width, int height) {
+    static int gbuffer_layout = GBUFFER_COMPACT;
+    static int geometry_path = GEOMETRY_GBUFFER;
+    imgui_slider_int("gbuffer_layout", &gbuffer_layout, 0, 1);
+    imgui_slider_int("geometry_path", &geometry_path, 0, 1);
+    r->gbuffer_layout = gbuffer_layout; // @Note: the graph adapts to them (see declare_gbuffer)
+    r->geometry_path = geometry_path;
+
+    mat4 const world_to_view = compute_camera_view_matrix(&camera);
+    mat4 const view_to_clip = compute_camera_projection_matrix(&camera);
+    CameraBlock const camera_block = {
+        .world_to_view = world_to_view,
+        .view_to_clip = view_to_clip,
+        .clip_to_view = mat4_inverse(view_to_clip),
+        .view_to_world = mat4_inverse(world_to_view),
+        .view_pos = camera.position,
+    };
+    update_uniform_buffer(&r->camera_block, &camera_block, sizeof(camera_block));
 
     // @Note: clear to black to avoid leaking into the g-buffer.
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     //
-    // Geometry pass (render all geometric and color data to the g-buffer).
+    // Culling (of the objects that the geometry pass draws).
     //
 
-    DEFER (glBindFramebuffer(GL_FRAMEBUFFER, 0)) {
-        glBindFramebuffer(GL_FRAMEBUFFER, r->gbuffer);
+    mat4 local_to_worlds[OBJECT_COUNT];
+    for (usize i = 0; i < OBJECT_COUNT; ++i) {
+        local_to_worlds[i] =
+            mat4_mul(mat4_translate(r->object_positions[i]), mat4_scale(vec3_of(0.5f)));
+    }
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        use_shader(geometry_pass.shader);
-        {
-            set_shader_mat4(geometry_pass.shader, "world_to_view", view);
-            set_shader_mat4(geometry_pass.shader, "view_to_clip", projection);
+    // @Note: bobs the center object up and down, so that the shadows that it's in are updated
+    // (the cascades treat every object as static, so they're all rendered again).
+    static int moving_object = 0;
+    imgui_slider_int("moving_object", &moving_object, 0, 1);
+    if (moving_object) {
+        vec3 const offset = { 0.0f, 0.25f * sinf((f32) clock.time), 0.0f };
+        local_to_worlds[4] = mat4_mul(mat4_translate(offset), local_to_worlds[4]);
+        ++r->static_geometry_version;
+    }
 
-            for (usize i = 0; i < OBJECT_COUNT; ++i) {
-                set_shader_mat4(
-                    geometry_pass.shader,
-                    "local_to_world",
-                    mat4_mul(mat4_translate(r->object_positions[i]), mat4_scale(vec3_of(0.5f))));
+    // @Note: objects outside of the view frustum are skipped, and so are the meshes outside of
+    // it of the remaining ones (so if culling fails, which it only does if it runs out of
+    // memory, nothing is drawn this frame). Those hidden behind the nearest objects are too,
+    // unless occlusion culling is disabled (or fails, in which case only it is skipped).
+    mat4 const world_to_clip = mat4_mul(view_to_clip, world_to_view);
+    Frustum const frustum = compute_frustum(world_to_clip);
+    CulledModel *culled = &r->culled_backpack;
+
+    static int occlusion_culling = 1;
+    imgui_slider_int("occlusion_culling", &occlusion_culling, 0, 1);
+
+    // @Note: GPU occlusion queries replace the culled draws of the geometry pass (whose objects
+    // are then drawn one by one), and are only supported by GEOMETRY_GBUFFER.
+    static int occlusion_queries = 0;
+    imgui_slider_int("occlusion_queries", &occlusion_queries, 0, 1);
+    if (!occlusion_queries || r->geometry_path != GEOMETRY_GBUFFER) {
+        memset(r->object_is_queried, 0, sizeof(r->object_is_queried));
+        r->occlusion_query_stats = (OcclusionQueryStats) { 0 };
+    }
 
-                draw_model_with_shader(&backpack, &geometry_pass.shader);
-            }
+    OcclusionBuffer const *occlusion = NULL;
+    if (occlusion_culling) {
+        Err occlusion_err = Err_None;
+        rasterize_scene_occluders(r, world_to_clip, &frustum, local_to_worlds, &occlusion_err);
+        if (occlusion_err) {
+            GLOW_WARNING("failed to rasterize the occluders");
+        } else {
+            occlusion = &r->occlusion;
         }
+    } else {
+        r->occlusion.stats = (OcclusionStats) { 0 };
     }
 
+    Err culling_err = Err_None;
+    cull_model_instances(
+        culled,
+        &backpack,
+        &frustum,
+        occlusion,
+        local_to_worlds,
+        ARRAY_LEN(local_to_worlds),
+        &culling_err);
+    if (culling_err) { GLOW_WARNING("failed to cull the model's instances"); }
+
+    Err geometry_pass_err = Err_None;
+    Shader const *geometry_shader = get_geometry_pass(r->gbuffer_layout, &geometry_pass_err);
+
     //
-    // Deferred lighting pass (use g-buffer to calculate scene's lighting).
+    // Lights (that the deferred lighting pass shades the g-buffer with).
     //
 
     static int draw_mode = DRAW_LIGHTING;
-    imgui_slider_int("draw_mode", &draw_mode, 0, 5);
+    imgui_slider_int("draw_mode", &draw_mode, 0, 6);
+
+    // @Note: the unclustered path only shades the first LIGHT_COUNT lights (see LightBlock).
+    static int lighting_path = LIGHTING_CLUSTERED;
+    imgui_slider_int("lighting_path", &lighting_path, 0, 2);
 
     static int dark_threshold = 5;
     imgui_slider_int("dark_threshold", &dark_threshold, 1, 255);
@@ -611,85 +1739,299 @@ static inline void draw_frame(Resources const *r, int width, int height) {
     imgui_slider_float("linear", &linear, 0.0f, 10.0f);
     imgui_slider_float("quadratic", &quadratic, 0.0f, 10.0f);
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    use_shader(lighting_pass.shader);
-    {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, r->gtex_position);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, r->gtex_normal);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, r->gtex_albedo_spec);
-
-        char uniform_string[32]; // 32 seems large enough..
-        for (usize i = 0; i < LIGHT_COUNT; ++i) {
+    LightBlockParameters const parameters = { dark_threshold, constant, linear, quadratic };
+    bool const are_parameters_changed =
+        memcmp(&parameters, &light_block_parameters, sizeof(parameters)) != 0;
+    if (light_block_is_dirty || are_parameters_changed) {
+        for (usize i = 0; i < r->lights_len; ++i) {
             vec3 const color = r->light_colors[i];
 
-            snprintf(uniform_string, 32, "lights[%zu].position", i);
-            set_shader_vec3(lighting_pass.shader, uniform_string, r->light_positions[i]);
-
-            snprintf(uniform_string, 32, "lights[%zu].color", i);
-            set_shader_vec3(lighting_pass.shader, uniform_string, color);
-
             // Threshold = I_max / (Kc + Kl * d + Kq * d*d)
             // Kq * d*d + Kl * d + Kc - (I_max / Threshold) = 0
             f32 const max_intensity = MAX3(color.x, color.y, color.z);
             f32 const a = quadratic;
             f32 const b = linear;
             f32 const c = constant - (max_intensity * (256.0f / dark_threshold));
-            f32 const effect_radius =
-                (a == 0.0f) ? -c / b : (-b + sqrtf(b * b - 4 * a * c)) / (2 * a);
+            r->light_radii[i] = (a == 0.0f) ? -c / b : (-b + sqrtf(b * b - 4 * a * c)) / (2 * a);
+        }
+    }
 
-            snprintf(uniform_string, 32, "lights[%zu].radius", i);
-            set_shader_float(lighting_pass.shader, uniform_string, effect_radius);
+    // @Note: the lights that cover the most of the screen are shadowed, and their faces are
+    // rendered again (within the budget) as the objects inside of them move, see PointShadows.
+    static int point_shadows = 8;
+    static int point_shadow_budget = 12; // @Note: in faces per frame
+    imgui_slider_int("point_shadows", &point_shadows, 0, POINT_SHADOWS_MAX);
+    imgui_slider_int("point_shadow_budget", &point_shadow_budget, 1, 6 * POINT_SHADOWS_MAX);
 
-            snprintf(uniform_string, 32, "lights[%zu].constant", i);
-            set_shader_float(lighting_pass.shader, uniform_string, constant);
+    bool const uses_point_shadows =
+        point_shadows > 0 && (draw_mode == DRAW_LIGHTING || draw_mode == DRAW_LIGHT_VOLUMES);
+    {
+        Aabb casters[OBJECT_COUNT];
+        for (usize i = 0; i < OBJECT_COUNT; ++i) {
+            casters[i] = aabb_transform(backpack.bounds, local_to_worlds[i]);
+        }
 
-            snprintf(uniform_string, 32, "lights[%zu].linear", i);
-            set_shader_float(lighting_pass.shader, uniform_string, linear);
+        PointShadowView const view = {
+            .world_to_clip = world_to_clip,
+            .position = camera.position,
+            .fovy = RADIANS_FROM_DEGREES(camera.fovy),
+            .height = (f32) height,
+        };
+        update_point_shadows(
+            &r->point_shadows,
+            view,
+            r->light_positions,
+            r->light_radii,
+            r->lights_len,
+            casters,
+            OBJECT_COUNT,
+            uses_point_shadows ? (usize) point_shadows : 0,
+            (usize) point_shadow_budget);
+    }
 
-            snprintf(uniform_string, 32, "lights[%zu].quadratic", i);
-            set_shader_float(lighting_pass.shader, uniform_string, quadratic);
+    // @Note: the lights are written again when a light starts or stops being shadowed, too.
+    if (light_block_is_dirty || are_parameters_changed || r->point_shadows.lights_changed) {
+        Err lights_err = Err_None;
+        LightBlock light_block = { 0 };
+        ClusterLight *cluster_lights = calloc(r->lights_len, sizeof(ClusterLight));
+        if (!cluster_lights && r->lights_len > 0) { lights_err = Err_Calloc; }
+
+        for (usize i = 0; i < r->lights_len && !lights_err; ++i) {
+            f32 const shadow = (f32) get_point_shadow_slot(&r->point_shadows, i);
+            cluster_lights[i] = (ClusterLight) {
+                .position = r->light_positions[i],
+                .radius = r->light_radii[i],
+                .color = r->light_colors[i],
+                .constant = constant,
+                .linear = linear,
+                .quadratic = quadratic,
+                .shadow = shadow,
+            };
+
+            if (i < LIGHT_COUNT) {
+                light_block.lights[i].position = r->light_positions[i];
+                light_block.lights[i].radius = r->light_radii[i];
+                light_block.lights[i].color = r->light_colors[i];
+                light_block.lights[i].constant = constant;
+                light_block.lights[i].linear = linear;
+                light_block.lights[i].quadratic = quadratic;
+                light_block.lights[i].shadow = shadow;
+            }
         }
+        update_uniform_buffer(&r->light_block, &light_block, sizeof(light_block));
+        update_cluster_lights(&r->light_clusters, cluster_lights, r->lights_len, &lights_err);
+        free(cluster_lights);
 
-        set_shader_vec3(lighting_pass.shader, "view_pos", camera.position);
+        if (lights_err) { GLOW_WARNING("failed to update the clustered lights"); }
 
-        set_shader_int(lighting_pass.shader, "draw_mode", draw_mode); // @@
+        light_block_is_dirty = false;
+        light_block_parameters = parameters;
+    }
 
-        render_quad();
+    // @Note: lights are binned again every frame, as the clusters move along with the camera.
+    if (lighting_path == LIGHTING_CLUSTERED) {
+        LightClusterView const view = {
+            camera_block.world_to_view, camera_block.view_to_clip, camera.near, camera.far
+        };
+
+        Err clusters_err = Err_None;
+        assign_lights_to_clusters(&r->light_clusters, view, &clusters_err);
+        if (clusters_err) { GLOW_WARNING("failed to assign lights to clusters"); }
     }
 
     //
-    // Forward rendering pass (to render all light cubes).
+    // Ambient occlusion (at half resolution, see execute_ssao_pass).
     //
 
-    DEFER (glBindFramebuffer(GL_FRAMEBUFFER, 0)) {
-        // @Note: copy the depth values from the g-buffer into the default framebuffer,
-        // this way the lights don't end up getting rendered on top of everything else.
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, r->gbuffer);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-        glBlitFramebuffer(
-            0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-    }
+    static int ssao = 1;
+    static int ssao_samples = 16;
+    static float ssao_radius = 0.5f;
+    static float ssao_bias = 0.025f;
+    imgui_slider_int("ssao", &ssao, 0, 1);
+    imgui_slider_int("ssao_samples", &ssao_samples, 1, SSAO_SAMPLES_MAX);
+    imgui_slider_float("ssao_radius", &ssao_radius, 0.05f, 2.0f);
+    imgui_slider_float("ssao_bias", &ssao_bias, 0.0f, 0.1f);
 
-    use_shader(light_box.shader);
-    {
-        set_shader_mat4(light_box.shader, "world_to_view", view);
-        set_shader_mat4(light_box.shader, "view_to_clip", projection);
+    // @Note: the g-buffer debug views don't have an ambient term.
+    bool const uses_ssao =
+        ssao && (draw_mode == DRAW_LIGHTING || draw_mode >= DRAW_LIGHT_VOLUMES);
 
-        for (usize i = 0; i < LIGHT_COUNT; ++i) {
-            set_shader_mat4(
-                light_box.shader,
-                "local_to_world",
-                mat4_mul(mat4_translate(r->light_positions[i]), mat4_scale(vec3_of(0.125f))));
+    Err ssao_pass_err = Err_None;
+    Shader const *ssao_shader =
+        uses_ssao ? get_ssao_pass(r->gbuffer_layout, &ssao_pass_err) : NULL;
 
-            set_shader_vec3(light_box.shader, "light_color", r->light_colors[i]);
+    //
+    // Sun (a directional light, whose shadows are cascaded, see ShadowCascades).
+    //
+
+    static float sun_azimuth = 45.0f;
+    static float sun_elevation = 50.0f;
+    static float sun_intensity = 0.4f;
+    imgui_slider_float("sun_azimuth", &sun_azimuth, 0.0f, 360.0f);
+    imgui_slider_float("sun_elevation", &sun_elevation, 5.0f, 90.0f);
+    imgui_slider_float("sun_intensity", &sun_intensity, 0.0f, 2.0f);
+
+    static int shadows = 1;
+    static float shadow_distance = 20.0f;
+    static float shadow_split_lambda = 0.75f;
+    imgui_slider_int("shadows", &shadows, 0, 1);
+    imgui_slider_float("shadow_distance", &shadow_distance, 2.0f, 100.0f);
+    imgui_slider_float("shadow_split_lambda", &shadow_split_lambda, 0.0f, 1.0f);
+
+    f32 const azimuth = RADIANS_FROM_DEGREES(sun_azimuth);
+    f32 const elevation = RADIANS_FROM_DEGREES(sun_elevation);
+    vec3 const sun_direction = {
+        -cosf(elevation) * cosf(azimuth),
+        -sinf(elevation),
+        -cosf(elevation) * sinf(azimuth),
+    };
 
-            render_cube();
+    bool const uses_shadows = shadows && sun_intensity > 0.0f
+                              && (draw_mode == DRAW_LIGHTING || draw_mode == DRAW_LIGHT_VOLUMES);
+    if (uses_shadows) {
+        Aabb scene_bounds = empty_aabb();
+        for (usize i = 0; i < OBJECT_COUNT; ++i) {
+            scene_bounds =
+                aabb_union(scene_bounds, aabb_transform(backpack.bounds, local_to_worlds[i]));
         }
+
+        ShadowCascadeView const view = {
+            .world_to_view = world_to_view,
+            .fovy = RADIANS_FROM_DEGREES(camera.fovy),
+            .aspect = camera.aspect,
+            .near = camera.near,
+            .far = MIN(shadow_distance, camera.far),
+            .split_lambda = shadow_split_lambda,
+        };
+        update_shadow_cascades(
+            &r->shadow_cascades, view, sun_direction, scene_bounds, r->static_geometry_version);
+    } else {
+        r->shadow_cascades.stats = (ShadowCascadeStats) { 0 };
+    }
+
+    // @Note: variants that fail to compile are logged once (and can still be hot reloaded).
+    Err lighting_pass_err = Err_None;
+    Shader const *lighting_shader = get_lighting_pass(
+        draw_mode,
+        lighting_path,
+        r->gbuffer_layout,
+        uses_ssao,
+        uses_shadows,
+        uses_point_shadows,
+        &lighting_pass_err);
+
+    //
+    // Render graph (declare the frame's passes and the textures that they read and write).
+    //
+
+    RenderGraph *graph = &r->render_graph;
+    begin_render_graph(graph, width, height);
+
+    FramePasses frame = {
+        .r = r,
+        .gbuffer = declare_gbuffer(graph, r->gbuffer_layout, r->geometry_path),
+        .culled = culling_err ? NULL : culled,
+        .frustum = &frustum,
+        .local_to_worlds = local_to_worlds,
+        .world_to_view = world_to_view,
+        .geometry_shader = geometry_shader,
+        .occlusion_queries = occlusion_queries,
+        .ssao_shader = ssao_shader,
+        .ssao_samples = ssao_samples,
+        .ssao_radius = ssao_radius,
+        .ssao_bias = ssao_bias,
+        .sun_direction = sun_direction,
+        .sun_color = vec3_of(sun_intensity),
+        .shadows = uses_shadows,
+        .point_shadows = uses_point_shadows,
+        .lighting_shader = lighting_shader,
+        .lighting_path = lighting_path,
+        .draw_mode = draw_mode,
+    };
+    GBufferTargets const *gbuffer = &frame.gbuffer;
+    RenderResource const gbuffer_targets[] = {
+        gbuffer->position, gbuffer->normal, gbuffer->albedo_spec, gbuffer->depth
+    };
+
+    clear_render_queue(&r->render_queue);
+
+    // Geometry pass (render all geometric and color data to the g-buffer).
+    if (r->geometry_path == GEOMETRY_VISIBILITY) {
+        RenderPassDesc visibility = { "visibility", execute_visibility_pass, &frame };
+        visibility.writes[0] = gbuffer->visibility_ids;
+        visibility.writes[1] = gbuffer->depth;
+        add_render_pass(graph, visibility);
+
+        RenderPassDesc resolve = {
+            "visibility_resolve", execute_visibility_resolve_pass, &frame
+        };
+        resolve.reads[0] = gbuffer->visibility_ids;
+        resolve.reads[1] = gbuffer->depth; // @Note: its stencil picks the pixels of each mesh
+        list_render_resources(resolve.writes, gbuffer_targets, ARRAY_LEN(gbuffer_targets));
+        add_render_pass(graph, resolve);
+    } else {
+        RenderPassDesc geometry = { "geometry", execute_geometry_pass, &frame };
+        list_render_resources(geometry.writes, gbuffer_targets, ARRAY_LEN(gbuffer_targets));
+        add_render_pass(graph, geometry);
+    }
+
+    // Shadow pass (renders into the cascades, which aren't transient, as some are cached).
+    if (uses_shadows) {
+        RenderPassDesc shadow_cascades = {
+            "shadow_cascades", execute_shadow_cascades_pass, &frame
+        };
+        shadow_cascades.has_side_effects = true;
+        add_render_pass(graph, shadow_cascades);
+    }
+
+    // Point shadow pass (renders the faces that were scheduled into the atlas, which persists).
+    if (uses_point_shadows) {
+        RenderPassDesc point_shadows_pass = {
+            "point_shadows", execute_point_shadows_pass, &frame
+        };
+        point_shadows_pass.has_side_effects = true;
+        add_render_pass(graph, point_shadows_pass);
     }
 
+    // SSAO passes (occlusion and view depth at half resolution, then blurred along each axis),
+    // which are culled by the graph unless the lighting pass reads their output.
+    RenderTextureDesc const ssao_desc = { "ssao", GL_RG16F, 0.5f };
+    frame.ssao_raw = declare_render_texture(graph, ssao_desc);
+    frame.ssao_blur_x = declare_render_texture(graph, ssao_desc);
+    frame.ssao = declare_render_texture(graph, ssao_desc); // @Note: aliases ssao_raw
+
+    RenderPassDesc ssao_pass = { "ssao", execute_ssao_pass, &frame };
+    list_render_resources(ssao_pass.reads, gbuffer_targets, ARRAY_LEN(gbuffer_targets));
+    ssao_pass.writes[0] = frame.ssao_raw;
+    add_render_pass(graph, ssao_pass);
+
+    RenderPassDesc ssao_blur_x = { "ssao_blur_x", execute_ssao_blur_x_pass, &frame };
+    ssao_blur_x.reads[0] = frame.ssao_raw;
+    ssao_blur_x.writes[0] = frame.ssao_blur_x;
+    add_render_pass(graph, ssao_blur_x);
+
+    RenderPassDesc ssao_blur_y = { "ssao_blur_y", execute_ssao_blur_y_pass, &frame };
+    ssao_blur_y.reads[0] = frame.ssao_blur_x;
+    ssao_blur_y.writes[0] = frame.ssao;
+    add_render_pass(graph, ssao_blur_y);
+
+    // Deferred lighting pass (use g-buffer to calculate scene's lighting).
+    RenderResource const lighting_inputs[] = {
+        gbuffer->position, gbuffer->normal, gbuffer->albedo_spec, gbuffer->depth,
+        uses_ssao ? frame.ssao : 0,
+    };
+    RenderPassDesc lighting = { "lighting", execute_lighting_pass, &frame };
+    list_render_resources(lighting.reads, lighting_inputs, ARRAY_LEN(lighting_inputs));
+    lighting.writes[0] = RENDER_GRAPH_BACKBUFFER;
+    add_render_pass(graph, lighting);
+
+    // Forward rendering pass (to render all light cubes).
+    RenderPassDesc light_boxes = { "light_boxes", execute_light_boxes_pass, &frame };
+    light_boxes.writes[0] = RENDER_GRAPH_BACKBUFFER;
+    add_render_pass(graph, light_boxes);
+
+    execute_render_graph(graph);
+
 #if !1
     // Use an orthographic projection matrix to model a directional light source
     // (i.e. all its rays are parallel), so there is no perspective deform.
@@ -742,8 +2084,8 @@ static inline void draw_frame(Resources const *r, int width, int height) {
     // Render the scene, but now using the generated depth/shadow map.
     use_shader(test_scene.shader);
     {
-        set_shader_mat4(test_scene.shader, "world_to_view", view);
-        set_shader_mat4(test_scene.shader, "view_to_clip", projection);
+        set_shader_mat4(test_scene.shader, "world_to_view", camera_block.world_to_view);
+        set_shader_mat4(test_scene.shader, "view_to_clip", camera_block.view_to_clip);
 
         set_shader_vec3(test_scene.shader, "view_pos", camera.position);
         set_shader_vec3(test_scene.shader, "light_pos", r->light_position);
@@ -761,12 +2103,12 @@ static inline void draw_frame(Resources const *r, int width, int height) {
     glDepthFunc(GL_LEQUAL);
     use_shader(skybox.shader);
     {
-        mat4 view_without_translation = view;
+        mat4 view_without_translation = camera_block.world_to_view;
         view_without_translation.m[0][3] = 0.0f;
         view_without_translation.m[1][3] = 0.0f;
         view_without_translation.m[2][3] = 0.0f;
         set_shader_mat4(skybox.shader, "world_to_view", view_without_translation);
-        set_shader_mat4(skybox.shader, "view_to_clip", projection);
+        set_shader_mat4(skybox.shader, "view_to_clip", camera_block.view_to_clip);
 
         glBindVertexArray(r->vao_skybox);
         DEFER (glBindVertexArray(0)) {
@@ -783,10 +2125,22 @@ static inline void draw_frame(Resources const *r, int width, int height) {
 //
 
 static inline void setup_shaders(void) {
-    use_shader(lighting_pass.shader);
-    set_shader_sampler2D(lighting_pass.shader, "gPosition", GL_TEXTURE0);
-    set_shader_sampler2D(lighting_pass.shader, "gNormal", GL_TEXTURE1);
-    set_shader_sampler2D(lighting_pass.shader, "gAlbedoSpec", GL_TEXTURE2);
+    bind_shader_uniform_block(light_box.shader, "Camera", CAMERA_BLOCK_BINDING);
+
+    use_shader(light_box.shader);
+    set_shader_float(light_box.shader, "light_scale", 0.125f);
+    set_shader_sampler2D(light_box.shader, "cluster_lights", GL_TEXTURE0 + CLUSTER_LIGHTS_UNIT);
+
+    bind_shader_uniform_block(light_volume_stencil.shader, "Camera", CAMERA_BLOCK_BINDING);
+    bind_shader_uniform_block(visibility_pass.shader, "Camera", CAMERA_BLOCK_BINDING);
+    bind_shader_uniform_block(occlusion_query.shader, "Camera", CAMERA_BLOCK_BINDING);
+
+    use_shader(light_volume_stencil.shader);
+    set_shader_sampler2D(
+        light_volume_stencil.shader, "cluster_lights", GL_TEXTURE0 + CLUSTER_LIGHTS_UNIT);
+
+    use_shader(ssao_blur.shader);
+    set_shader_sampler2D(ssao_blur.shader, "ssao_input", GL_TEXTURE0 + SSAO_UNIT);
 
 #if 0
     use_shader(test_scene.shader);
@@ -801,6 +2155,53 @@ static inline void setup_shaders(void) {
 #endif
 }
 
+// @Note: the setup_*_pass functions are called for each variant of their pass (see the
+// get_*_pass functions), and after every reload of one, as they aren't covered by setup_shaders.
+static void setup_geometry_pass(Shader const shader) {
+    bind_shader_uniform_block(shader, "Camera", CAMERA_BLOCK_BINDING);
+}
+
+static void setup_lighting_pass(Shader const shader) {
+    bind_shader_uniform_block(shader, "Camera", CAMERA_BLOCK_BINDING);
+    bind_shader_uniform_block(shader, "Lights", LIGHTS_BLOCK_BINDING);
+
+    use_shader(shader);
+    set_gbuffer_samplers(shader);
+
+    // @Note: see LightClusters (these are only used by the clustered variants).
+    set_shader_sampler2D(shader, "cluster_lights", GL_TEXTURE0 + CLUSTER_LIGHTS_UNIT);
+    set_shader_sampler2D(shader, "cluster_grid", GL_TEXTURE0 + CLUSTER_GRID_UNIT);
+    set_shader_sampler2D(shader, "cluster_indices", GL_TEXTURE0 + CLUSTER_INDICES_UNIT);
+
+    set_shader_sampler2D(shader, "ssao", GL_TEXTURE0 + SSAO_UNIT); // @Note: SSAO variants only
+    set_shader_sampler2D(shader, "shadow_cascades", GL_TEXTURE0 + SHADOW_CASCADES_UNIT);
+    set_shader_sampler2D(shader, "point_shadow_atlas", GL_TEXTURE0 + POINT_SHADOW_ATLAS_UNIT);
+}
+
+static void setup_light_volume_pass(Shader const shader) {
+    bind_shader_uniform_block(shader, "Camera", CAMERA_BLOCK_BINDING);
+
+    use_shader(shader);
+    set_gbuffer_samplers(shader);
+    set_shader_sampler2D(shader, "cluster_lights", GL_TEXTURE0 + CLUSTER_LIGHTS_UNIT);
+    set_shader_sampler2D(shader, "point_shadow_atlas", GL_TEXTURE0 + POINT_SHADOW_ATLAS_UNIT);
+}
+
+static void setup_ssao_pass(Shader const shader) {
+    bind_shader_uniform_block(shader, "Camera", CAMERA_BLOCK_BINDING);
+
+    use_shader(shader);
+    set_gbuffer_samplers(shader);
+    set_shader_sampler2D(shader, "ssao_noise", GL_TEXTURE0 + SSAO_NOISE_UNIT);
+    set_shader_vec3_array(shader, "ssao_kernel", ssao_kernel, SSAO_SAMPLES_MAX);
+}
+
+// @Note: its samplers keep the units they were assigned when linked (as the material ones are
+// fixed, see bind_mesh_textures), and are bound by name in render_visibility_buffer.
+static void setup_visibility_resolve_pass(Shader const shader) {
+    bind_shader_uniform_block(shader, "Camera", CAMERA_BLOCK_BINDING);
+}
+
 //
 // Input processing.
 //
@@ -833,18 +2234,8 @@ static inline void process_input(GLFWwindow *window, f32 delta_time) {
     if (IS_PRESSED(TAB) && !was_tab_pressed) {
         GLOW_LOG("Hot swapping shaders");
 
-        // @Volatile: use the same shaders as in `create_resources`.
-        try_reload_shader_from_filepath(&geometry_pass.shader, geometry_pass.paths);
-        try_reload_shader_from_filepath(&lighting_pass.shader, lighting_pass.paths);
-        try_reload_shader_from_filepath(&light_box.shader, light_box.paths);
-#if 0
-        try_reload_shader_from_filepath(&skybox.shader, skybox.paths);
-        try_reload_shader_from_filepath(&test_scene.shader, test_scene.paths);
-        try_reload_shader_from_filepath(&debug_quad.shader, debug_quad.paths);
-        try_reload_shader_from_filepath(&shadow_mapping.shader, shadow_mapping.paths);
-#endif
-
-        setup_shaders();
+        // @Note: they're reloaded (and set up again) by the next update_shader_registry().
+        mark_all_shaders_dirty();
     }
 
     // Get or release GUI control of the mouse.
@@ -862,6 +2253,9 @@ static inline void process_input(GLFWwindow *window, f32 delta_time) {
         }
     }
 
+    // Print the stats of the last frame.
+    should_log_stats = IS_PRESSED(P) && !was_p_pressed;
+
     // @Temporary: used to see the shadow map depth texure.
     show_debug_quad = IS_PRESSED(LEFT_SHIFT) || IS_PRESSED(RIGHT_SHIFT);
 
@@ -870,6 +2264,7 @@ static inline void process_input(GLFWwindow *window, f32 delta_time) {
     was_lmb_pressed = IS_PRESSED_MOUSE(LEFT);
     was_tab_pressed = IS_PRESSED(TAB);
     was_space_pressed = IS_PRESSED(SPACE);
+    was_p_pressed = IS_PRESSED(P);
 }
 
 //
@@ -883,26 +2278,8 @@ static void framebuffer_size_callback(GLFWwindow *window, int width, int height)
     // Update the camera's aspect ratio.
     camera.aspect = (f32) width / (f32) height;
 
-    Resources *r = glfwGetWindowUserPointer(window);
-
-    // Resize buffers.
-    DEFER (glBindTexture(GL_TEXTURE_2D, 0)) {
-        /* clang-format off */
-        glBindTexture(GL_TEXTURE_2D, r->gtex_position);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-
-        glBindTexture(GL_TEXTURE_2D, r->gtex_normal);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-
-        glBindTexture(GL_TEXTURE_2D, r->gtex_albedo_spec);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-        /* clang-format on */
-    }
-
-    glBindRenderbuffer(GL_RENDERBUFFER, r->grbo_depth);
-    DEFER (glBindRenderbuffer(GL_RENDERBUFFER, 0)) {
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-    }
+    // @Note: the render graph's textures follow the size that the next frame is drawn at.
+    UNUSED(window);
 }
 static void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
     // Do nothing.
@@ -6,16 +6,26 @@
 
 #include "camera.h"
 #include "console.h"
+#include "culling.h"
 #include "file.h"
 #include "imgui_facade.h"
+#include "jobs.h"
+#include "light_clusters.h"
 #include "maths.h"
 #include "mesh.h"
 #include "model.h"
+#include "occlusion.h"
 #include "opengl.h"
 #include "options.h"
+#include "point_shadows.h"
+#include "render_graph.h"
+#include "render_queue.h"
 #include "shader.h"
+#include "shadow_cascades.h"
 #include "texture.h"
+#include "uniform_buffer.h"
 #include "vertices.h"
+#include "visibility_buffer.h"
 #include "window.h"
 
 // Standard headers.
@@ -73,7 +83,46 @@ enum {
     DRAW_NORMAL,
     DRAW_ALBEDO,
     DRAW_SPECULAR,
-    DRAW_LIGHT_VOLUMES
+    DRAW_LIGHT_VOLUMES,
+    DRAW_OCCLUSION, // @Note: the upsampled ambient occlusion (white if SSAO is disabled)
+};
+
+// @Volatile: keep in sync with the LIGHTING_ defines in deferred_shading.fs.
+enum {
+    LIGHTING_UNCLUSTERED = 0, // fullscreen loop over the Lights block
+    LIGHTING_CLUSTERED, // fullscreen loop over the lights of each pixel's cluster
+    LIGHTING_VOLUMES, // stencil tested light volumes (see render_light_volumes)
+};
+
+// @Volatile: keep in sync with GBUFFER_COMPACT in gbuffer.glsl.
+enum {
+    GBUFFER_CLASSIC = 0, // position (RGBA16F), normal (RGBA16F) and albedo + specular (RGBA8)
+    GBUFFER_COMPACT, // octahedral normal (RG16) and albedo + specular (RGBA8), depth for position
+};
+
+enum {
+    GEOMETRY_GBUFFER = 0, // the geometry pass writes every g-buffer attribute of each fragment
+    GEOMETRY_VISIBILITY, // which are only written once per pixel (see render_visibility_buffer)
+};
+
+// @Note: passes that draw through the render queue, in the order their packets are submitted.
+enum {
+    RENDER_PASS_GEOMETRY = 0,
+};
+
+// @Note: texture units of the lighting passes' inputs (see set_gbuffer_samplers).
+enum {
+    GPOSITION_UNIT = 0,
+    GNORMAL_UNIT,
+    GALBEDO_SPEC_UNIT,
+    GDEPTH_UNIT,
+    CLUSTER_LIGHTS_UNIT,
+    CLUSTER_GRID_UNIT,
+    CLUSTER_INDICES_UNIT,
+    SSAO_UNIT, // @Note: also the input of the blur passes
+    SSAO_NOISE_UNIT,
+    SHADOW_CASCADES_UNIT,
+    POINT_SHADOW_ATLAS_UNIT,
 };
 
 //
@@ -84,10 +133,12 @@ enum {
 // struct, with some Mouse and Keyboard groupings as well.
 static bool is_ui_enabled = true;
 static bool show_debug_quad = false;
+static bool should_log_stats = false;
 static bool was_rmb_pressed = false;
 static bool was_lmb_pressed = false;
 static bool was_tab_pressed = false;
 static bool was_space_pressed = false;
+static bool was_p_pressed = false;
 static bool mouse_is_in_ui = false;
 static bool mouse_is_first = true;
 static vec2 mouse_last = { 0 };
@@ -101,9 +152,17 @@ static Model backpack;
 static Texture skybox_texture;
 static Texture wood_texture;
 
-static PathsToShader geometry_pass;
-static PathsToShader lighting_pass;
+static ShaderPermutations *geometry_pass; // @Note: see get_geometry_pass
+static ShaderPermutations *lighting_pass; // @Note: see get_lighting_pass
 static PathsToShader light_box;
+static ShaderPermutations *light_volume; // @Note: see get_light_volume_pass
+static PathsToShader light_volume_stencil;
+static PathsToShader visibility_pass;
+static PathsToShader occlusion_query;
+static ShaderPermutations *visibility_resolve; // @Note: see get_visibility_resolve_pass
+static ShaderPermutations *ssao_pass; // @Note: see get_ssao_pass
+static PathsToShader ssao_blur;
+static PathsToShader shadow_depth;
 #if 0
 static PathsToShader skybox;
 static PathsToShader debug_quad;
@@ -114,24 +173,123 @@ static PathsToShader shadow_mapping;
 #define SHADOW_MAP_RESOLUTION 512
 
 #define OBJECT_COUNT 9
-#define LIGHT_COUNT 32
+#define LIGHT_COUNT 32 // @Note: the size of the Lights block (used by unclustered lighting)
+
+STATIC_ASSERT(OBJECT_COUNT <= POINT_SHADOW_CASTERS_MAX);
+
+// @Note: limits on the meshes that are rasterized as occluders (see rasterize_scene_occluders),
+// where those smaller than OCCLUDER_MIN_SIZE (relative to the size of their model) are skipped.
+#define OCCLUDERS_MAX 64
+#define OCCLUDER_TRIANGLES_MAX (1 << 16)
+#define OCCLUDER_MIN_SIZE 0.25f
+
+// @Note: the ambient occlusion is computed at half resolution, taking up to SSAO_SAMPLES_MAX
+// samples of the kernel per texel, rotated by a tiled texture of SSAO_NOISE_SIZE^2 rotations.
+#define SSAO_SAMPLES_MAX 64
+#define SSAO_NOISE_SIZE 4
+
+static vec3 ssao_kernel[SSAO_SAMPLES_MAX]; // @Note: generated by create_resources
+
+//
+// Uniform blocks (std140).
+//
+
+enum { CAMERA_BLOCK_BINDING = 0, LIGHTS_BLOCK_BINDING };
+
+// @Volatile: keep in sync with the `Camera` block in camera.glsl (where vec3s take up 16 bytes).
+typedef struct CameraBlock {
+    mat4 world_to_view;
+    mat4 view_to_clip;
+    mat4 clip_to_view; // @Note: used to reconstruct positions from depth
+    mat4 view_to_world;
+    vec3 view_pos;
+    f32 _padding;
+} CameraBlock;
+
+// @Volatile: keep in sync with the `Lights` block (and the Light struct) in lights.glsl.
+typedef struct LightBlock {
+    struct {
+        vec3 position;
+        f32 radius;
+        vec3 color;
+        f32 constant;
+        f32 linear;
+        f32 quadratic;
+        f32 shadow; // @Note: the slot of its point shadow (see get_point_shadow_slot), or -1
+        f32 _padding;
+    } lights[LIGHT_COUNT];
+} LightBlock;
+
+STATIC_ASSERT(sizeof(CameraBlock) == 4 * 64 + 16);
+STATIC_ASSERT(sizeof(LightBlock) == LIGHT_COUNT * 48);
+
+// @Note: the values that the lights were last written with (to the light block and clusters), as
+// we only rewrite them when they change (lights are static, so only when the sliders move).
+typedef struct LightBlockParameters {
+    int dark_threshold;
+    f32 constant;
+    f32 linear;
+    f32 quadratic;
+} LightBlockParameters;
+
+static bool light_block_is_dirty = true; // @Note: set whenever light positions or colors change
+static LightBlockParameters light_block_parameters = { 0 };
+
+typedef struct OcclusionQueryStats {
+    usize queries; // @Note: issued this frame
+    usize draws; // @Note: submitted this frame (one per batch of each object, see ModelDraws)
+    usize draws_culled; // @Note: estimated, from the results that were already available
+} OcclusionQueryStats;
+
+// @Note: the render graph's handles of the g-buffer's textures (declared every frame).
+typedef struct GBufferTargets {
+    RenderResource position; // @Note: only declared by GBUFFER_CLASSIC
+    RenderResource normal;
+    RenderResource albedo_spec;
+    RenderResource depth; // @Note: along with the stencil, which the light volumes use
+    RenderResource visibility_ids; // @Note: only declared by GEOMETRY_VISIBILITY
+} GBufferTargets;
 
 typedef struct Resources {
-    uint gbuffer;
-    uint gtex_position;
-    uint gtex_normal;
-    uint gtex_albedo_spec;
-    uint grbo_depth;
-
-    uint tex_noise;
-    uint fbo_ssao;
-    uint tex_ssao;
-    uint fbo_ssao_blur;
-    uint tex_ssao_blur;
+    // @Note: the g-buffer is declared to the render graph every frame, so changing these (or the
+    // size of the window) doesn't need anything to be recreated by hand.
+    int gbuffer_layout;
+    int geometry_path;
+    RenderGraph render_graph;
+    uint depth_blit_framebuffer; // @Note: to read the g-buffer's depth from when copying it
+
+    VisibilityGeometry visibility_geometry;
+    CulledModel culled_backpack; // @Note: rebuilt every frame (see cull_model_instances)
+    OcclusionBuffer occlusion; // @Note: rasterized every frame (see rasterize_scene_occluders)
+    RenderQueue render_queue; // @Note: filled and submitted every frame
+
+    // @Note: GL_ANY_SAMPLES_PASSED queries of each object's bounds, which decide whether it is
+    // drawn on the next frame (see draw_objects_with_occlusion_queries).
+    uint object_queries[OBJECT_COUNT];
+    bool object_is_queried[OBJECT_COUNT]; // @Note: whether its query was issued last frame
+    OcclusionQueryStats occlusion_query_stats;
+
+    uint tex_noise; // @Note: the SSAO rotations (its targets are declared to the render graph)
+
+    // @Note: the sun's shadows, whose far cascades are cached across frames, so they have to be
+    // told whenever the objects (all of which are static) move, by bumping the version.
+    ShadowCascades shadow_cascades;
+    u64 static_geometry_version;
+
+    // @Note: the shadows of the point lights that cover the most of the screen, which are also
+    // kept across frames (and are only rendered again as what's inside of them moves).
+    PointShadows point_shadows;
 
     vec3 object_positions[OBJECT_COUNT];
-    vec3 light_positions[LIGHT_COUNT];
-    vec3 light_colors[LIGHT_COUNT];
+
+    usize lights_len;
+    vec3 *light_positions; // @Ownership
+    vec3 *light_colors; // @Ownership
+    f32 *light_radii; // @Ownership (which depend on the attenuation, see LightBlockParameters)
+
+    UniformBuffer camera_block;
+    UniformBuffer light_block;
+    LightClusters light_clusters;
 
 #if 0
     uint vao_skybox;
@@ -145,3 +303,36 @@ typedef struct Resources {
     uint fbo_depth_map;
 #endif
 } Resources;
+
+// @Note: what the passes of the render graph are executed with, as they're declared by
+// draw_frame (which fills this in) but only run later on, by execute_render_graph.
+typedef struct FramePasses {
+    Resources *r;
+    GBufferTargets gbuffer;
+
+    CulledModel const *culled; // @Note: NULL if culling failed (so that nothing is drawn)
+    Frustum const *frustum;
+    mat4 const *local_to_worlds; // @Note: OBJECT_COUNT of them
+    mat4 world_to_view;
+    Shader const *geometry_shader; // @Note: NULL if it failed to compile
+    bool occlusion_queries;
+
+    // @Note: the (half resolution) targets of the SSAO passes, where the last one is what the
+    // lighting pass reads, unless SSAO is disabled (so that the graph culls them all).
+    RenderResource ssao_raw;
+    RenderResource ssao_blur_x;
+    RenderResource ssao;
+    Shader const *ssao_shader; // @Note: NULL if it failed to compile
+    int ssao_samples;
+    f32 ssao_radius;
+    f32 ssao_bias;
+
+    vec3 sun_direction;
+    vec3 sun_color;
+    bool shadows; // @Note: whether the lighting pass samples the shadow cascades
+    bool point_shadows; // @Note: whether the lighting passes sample the point shadows
+
+    Shader const *lighting_shader; // @Note: NULL if it failed to compile
+    int lighting_path;
+    int draw_mode;
+} FramePasses;
@@ -289,8 +289,8 @@ static f32 mat4_minor(mat4 const m, int r, int c) {
     mat3 cut_down;
     for (int i = 0; i < 3; ++i) {
         for (int j = 0; j < 3; ++j) {
-            int const row = i + (int) i >= r; // i < r ? i : i + 1;
-            int const col = j + (int) j >= c; // j < c ? j : j + 1;
+            int const row = i + (int) (i >= r); // i < r ? i : i + 1;
+            int const col = j + (int) (j >= c); // j < c ? j : j + 1;
             cut_down.m[i][j] = m.m[row][col];
         }
     }
@@ -2,13 +2,21 @@
 
 #include "console.h"
 #include "maths.h"
-#include "shader.h"
+#include "opengl.h"
 #include "texture.h"
 
-#include <stdio.h>
-
 #include <glad/glad.h>
 
+static struct {
+    uint vbo;
+    usize capacity; // @Note: in instances
+} instance_buffer;
+
+static void bind_instance_buffer(void) {
+    if (!instance_buffer.vbo) { glGenBuffers(1, &instance_buffer.vbo); }
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer.vbo);
+}
+
 uint create_mesh_vao(
     Vertex const *vertices, usize vertices_len, uint *indices, usize indices_len) {
     uint vao, vbo, ebo;
@@ -16,8 +24,8 @@ uint create_mesh_vao(
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
 
-    glBindVertexArray(vao);
-    DEFER (glBindVertexArray(0)) {
+    bind_gl_vertex_array(vao);
+    DEFER (bind_gl_vertex_array(0)) {
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(
             GL_ARRAY_BUFFER, sizeof(Vertex) * vertices_len, &vertices[0], GL_STATIC_DRAW);
@@ -29,6 +37,7 @@ uint create_mesh_vao(
         glEnableVertexAttribArray(0); // position
         glEnableVertexAttribArray(1); // normal
         glEnableVertexAttribArray(2); // texcoord
+        glEnableVertexAttribArray(3); // tangent
 
         glVertexAttribPointer(
             0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, position));
@@ -36,6 +45,19 @@ uint create_mesh_vao(
             1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, normal));
         glVertexAttribPointer(
             2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, texcoord));
+        glVertexAttribPointer(
+            3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, tangent));
+
+        // @Note: the vertex array keeps referring to the same buffer object, even as it's
+        // orphaned (or grown) by glBufferData() calls, so it's only set up once here.
+        bind_instance_buffer();
+        for (uint i = 0; i < 4; ++i) {
+            uint const location = MESH_INSTANCE_ATTRIBUTE_LOCATION + i; // local_to_world row i
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(
+                location, 4, GL_FLOAT, GL_FALSE, sizeof(mat4), (void *) (sizeof(vec4) * i));
+            glVertexAttribDivisor(location, 1);
+        }
     }
 
     glDeleteBuffers(1, &ebo);
@@ -44,10 +66,6 @@ uint create_mesh_vao(
     return vao;
 }
 
-void destroy_mesh_vao(Mesh *mesh) {
-    glDeleteVertexArrays(1, &mesh->vao);
-}
-
 void dealloc_mesh(Mesh *mesh) {
     // @Note: we are not calling glDeleteTextures.
     free(mesh->textures);
@@ -60,52 +78,68 @@ void dealloc_mesh(Mesh *mesh) {
     mesh->vertices = NULL;
 }
 
+// @Note: the vertex array is left bound, as the next draw binds its own (if it differs).
 void draw_mesh_direct(Mesh const *mesh) {
-    glBindVertexArray(mesh->vao);
-    DEFER (glBindVertexArray(0)) {
-        glDrawElements(GL_TRIANGLES, mesh->indices_len, GL_UNSIGNED_INT, 0);
-    }
+    bind_gl_vertex_array(mesh->vao);
+    glDrawElementsBaseVertex(
+        GL_TRIANGLES,
+        (int) mesh->indices_len,
+        GL_UNSIGNED_INT,
+        (void const *) (mesh->first_index * sizeof(uint)),
+        (int) mesh->base_vertex);
 }
 
-static void set_sampler_name_from_texture_material_type(
-    char *name, usize max_len, TextureMaterialType const material_type, uint count) {
-    assert(material_type != TextureMaterialType_None);
-
-    int const n = snprintf(
-        name,
-        max_len,
-        // @Volatile: keep in sync with TextureMaterialType.
-        (material_type == TextureMaterialType_Diffuse    ? "texture_diffuse"
-         : material_type == TextureMaterialType_Specular ? "texture_specular"
-         : material_type == TextureMaterialType_Ambient  ? "texture_ambient"
-         : material_type == TextureMaterialType_Normal   ? "texture_normal"
-         : material_type == TextureMaterialType_Height   ? "texture_height"
-                                                         : "texture"));
-
-    if (count > 0) { snprintf(name + n, max_len, "%d", count); }
-}
-
-void draw_mesh_with_shader(Mesh const *mesh, Shader const *shader) {
-    uint count[6] = { 0 }; // @Volatile: keep in sync with TextureMaterialType.
-    char name[24 + 1] = { 0 }; // @Note: large enough for all of sampler names.
+// @Note: the shader's material samplers already point at the fixed units of each material
+// texture (see get_material_texture_unit), which were assigned to them when it was linked.
+void bind_mesh_textures(Mesh const *mesh) {
+    uint count[7] = { 0 }; // @Volatile: keep in sync with TextureMaterialType.
 
     for (usize i = 0; i < mesh->textures_len; ++i) {
         TextureMaterialType const material_type = mesh->textures[i].material_type;
         assert(0 <= material_type && material_type < ARRAY_LEN(count));
 
-        // @Todo: store a char const *material_name in the Texture struct, and use string
-        // interning for efficiency, since they will be immutable (and not always unique).
-        set_sampler_name_from_texture_material_type(
-            &name[0], ARRAY_LEN(name), material_type, count[material_type]);
-
+        int const unit = get_material_texture_unit(material_type, count[material_type]);
         count[material_type] += 1;
+        if (unit == -1) { continue; } // @Note: no shader can sample it anyway
 
-        uint const texture_unit = GL_TEXTURE0 + (uint) i;
-        set_shader_sampler2D(*shader, name, texture_unit);
-        bind_texture_to_unit(mesh->textures[i], texture_unit);
+        bind_texture_to_unit(mesh->textures[i], GL_TEXTURE0 + (uint) unit);
     }
+}
 
+void draw_mesh_with_shader(Mesh const *mesh, Shader const *shader) {
+    UNUSED(shader);
+    bind_mesh_textures(mesh);
     draw_mesh_direct(mesh);
+}
+
+void upload_mesh_instances(mat4 const local_to_worlds[], usize count) {
+    bind_instance_buffer();
+
+    instance_buffer.capacity = MAX(instance_buffer.capacity, count);
+    glBufferData(
+        GL_ARRAY_BUFFER, instance_buffer.capacity * sizeof(mat4), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(mat4), local_to_worlds);
+}
+
+void destroy_mesh_instance_buffer(void) {
+    glDeleteBuffers(1, &instance_buffer.vbo);
+    instance_buffer.vbo = 0;
+    instance_buffer.capacity = 0;
+}
+
+void draw_mesh_instanced_direct(Mesh const *mesh, usize instances_len) {
+    bind_gl_vertex_array(mesh->vao);
+    glDrawElementsInstancedBaseVertex(
+        GL_TRIANGLES,
+        (int) mesh->indices_len,
+        GL_UNSIGNED_INT,
+        (void const *) (mesh->first_index * sizeof(uint)),
+        (int) instances_len,
+        (int) mesh->base_vertex);
+}
 
-    bind_texture_to_unit((Texture) { 0 }, GL_TEXTURE0);
+void draw_mesh_instanced(Mesh const *mesh, Shader const *shader, usize instances_len) {
+    UNUSED(shader);
+    bind_mesh_textures(mesh);
+    draw_mesh_instanced_direct(mesh, instances_len);
 }
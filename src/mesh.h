@@ -2,6 +2,7 @@
 
 #include "prelude.h"
 
+#include "culling.h"
 #include "maths_types.h"
 
 // Forward declarations.
@@ -12,10 +13,7 @@ typedef struct Vertex {
     vec3 position;
     vec3 normal;
     vec2 texcoord;
-#if 0
-    vec3 tangent;
-    vec3 bitangent; // cross(normal, tangent)
-#endif
+    vec3 tangent; // @Note: the bitangent is computed in the shader, as cross(normal, tangent)
 } Vertex;
 
 // @Speed: currently a Texture is no larger than two ints (it's an uint plus an enum),
@@ -31,14 +29,33 @@ typedef struct Mesh {
     Texture *textures; // @Ownership
     usize textures_len;
 
+    Aabb bounds; // in local space
+
+    // @Note: the vertex array is the model's, shared by all of its meshes (see ModelDraws), and
+    // the mesh's vertices and indices start at these offsets into its buffers.
     uint vao;
+    usize base_vertex;
+    usize first_index;
 } Mesh;
 
+// @Note: every mesh's vertex array also reads a per-instance local_to_world matrix (as four
+// consecutive vec4 attributes, one per row, starting at this location) from a single instance
+// buffer that is shared by all of them, and streamed into by upload_mesh_instances().
+#define MESH_INSTANCE_ATTRIBUTE_LOCATION 4
+
 uint create_mesh_vao(
     Vertex const *vertices, usize vertices_len, uint *indices, usize indices_len);
-void destroy_mesh_vao(Mesh *mesh);
 
 void dealloc_mesh(Mesh *mesh);
 
+void bind_mesh_textures(Mesh const *mesh);
+
 void draw_mesh_direct(Mesh const *mesh);
 void draw_mesh_with_shader(Mesh const *mesh, Shader const *shader);
+
+// @Note: the instance buffer is orphaned on every upload, so it's fine to upload (and draw)
+// different instances multiple times per frame, as previous draws keep their own storage.
+void upload_mesh_instances(mat4 const local_to_worlds[], usize count);
+void destroy_mesh_instance_buffer(void);
+void draw_mesh_instanced_direct(Mesh const *mesh, usize instances_len); // @Note: no textures
+void draw_mesh_instanced(Mesh const *mesh, Shader const *shader, usize instances_len);
@@ -0,0 +1,461 @@
+#include "mipmap.h"
+
+#include "color.h"
+#include "console.h"
+#include "file.h"
+#include "hash.h"
+#include "jobs.h"
+#include "maths.h"
+#include "simd.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MIPMAP_ROWS_PER_JOB 16
+#define MIPMAP_KAISER_TAPS 8
+
+//
+// Lookup tables (filled once, on the first call to alloc_mipmap_chains).
+//
+
+#define LINEAR_TO_SRGB_LUT_LEN 4096
+
+static bool luts_are_initialized = false;
+static f32 UNORM_TO_FLOAT_LUT[256];
+static f32 SRGB_TO_LINEAR_LUT[256];
+static u8 LINEAR_TO_SRGB_LUT[LINEAR_TO_SRGB_LUT_LEN];
+static f32 KAISER_WEIGHTS[MIPMAP_KAISER_TAPS];
+
+static f32 bessel_i0(f32 x) {
+    f32 sum = 1.0f;
+    f32 term = 1.0f;
+    for (int k = 1; k < 20; ++k) {
+        f32 const t = x / (2.0f * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+static f32 kaiser_windowed_sinc(f32 x, f32 alpha, f32 half_width) {
+    if (fabsf(x) >= half_width) { return 0.0f; }
+    f32 const t = x / half_width;
+    f32 const window = bessel_i0(alpha * sqrtf(1.0f - t * t)) / bessel_i0(alpha);
+    f32 const sinc = (x == 0.0f) ? 1.0f : sinf(M_PI * x) / (M_PI * x);
+    return sinc * window;
+}
+
+static void init_luts(void) {
+    if (luts_are_initialized) { return; }
+
+    for (int i = 0; i < 256; ++i) {
+        f32 const v = i / 255.0f;
+        UNORM_TO_FLOAT_LUT[i] = v;
+        SRGB_TO_LINEAR_LUT[i] = srgb_to_linear_rgb((vec3) { v, v, v }).x;
+    }
+
+    for (int i = 0; i < LINEAR_TO_SRGB_LUT_LEN; ++i) {
+        f32 const v = i / (f32) (LINEAR_TO_SRGB_LUT_LEN - 1);
+        f32 const srgb = linear_rgb_to_srgb((vec3) { v, v, v }).x;
+        LINEAR_TO_SRGB_LUT[i] = (u8) CLAMP(srgb * 255.0f + 0.5f, 0.0f, 255.0f);
+    }
+
+    // @Note: tap k is centered at (k - 3.5) source pixels from the destination pixel's
+    // center, which is half of that in destination pixels (where the filter is defined).
+    f32 sum = 0.0f;
+    for (int k = 0; k < MIPMAP_KAISER_TAPS; ++k) {
+        KAISER_WEIGHTS[k] = kaiser_windowed_sinc((k - 3.5f) / 2.0f, 4.0f, 2.0f);
+        sum += KAISER_WEIGHTS[k];
+    }
+    for (int k = 0; k < MIPMAP_KAISER_TAPS; ++k) { KAISER_WEIGHTS[k] /= sum; }
+
+    luts_are_initialized = true;
+}
+
+//
+// Pixel conversions.
+//
+
+// @Note: missing channels are set to zero, and alpha (the 4th channel) is always linear.
+static inline f32x4 load_pixel(u8 const *p, int channels, f32 const *color_lut) {
+    switch (channels) {
+        case 1: return f32x4_set(color_lut[p[0]], 0, 0, 0);
+        case 2: return f32x4_set(color_lut[p[0]], color_lut[p[1]], 0, 0);
+        case 3: return f32x4_set(color_lut[p[0]], color_lut[p[1]], color_lut[p[2]], 0);
+        default:
+            return f32x4_set(
+                color_lut[p[0]], color_lut[p[1]], color_lut[p[2]], UNORM_TO_FLOAT_LUT[p[3]]);
+    }
+}
+
+static inline void store_pixel(u8 *p, int channels, f32x4 v, bool is_srgb) {
+    v = f32x4_min(f32x4_max(v, f32x4_set1(0.0f)), f32x4_set1(1.0f));
+
+    i32 unorm[4];
+    i32x4_store(unorm, f32x4_to_i32x4(f32x4_mul(v, f32x4_set1(255.0f))));
+
+    if (is_srgb) {
+        i32 index[4];
+        i32x4_store(
+            index,
+            f32x4_to_i32x4(f32x4_mul(v, f32x4_set1((f32) (LINEAR_TO_SRGB_LUT_LEN - 1)))));
+        for (int c = 0; c < MIN(channels, 3); ++c) { p[c] = LINEAR_TO_SRGB_LUT[index[c]]; }
+        if (channels == 4) { p[3] = (u8) unorm[3]; }
+    } else {
+        for (int c = 0; c < channels; ++c) { p[c] = (u8) unorm[c]; }
+    }
+}
+
+//
+// Filter kernels (each one computes the rows [y_begin, y_end) of a level).
+//
+
+// @Note: the f32x4 lanes hold the channels of a single texel (see load_pixel), i.e. texels are
+// filtered one at a time and images with fewer than 4 channels leave lanes unused. The kernels
+// are split across rows by the jobs instead.
+
+typedef struct MipmapLevelRows {
+    u8 const *src;
+    int src_width;
+    int src_height;
+    u8 *dst;
+    int dst_width;
+    int dst_height;
+    int channels;
+    bool is_srgb;
+    int y_begin;
+    int y_end;
+} MipmapLevelRows;
+
+static void filter_rows_box(MipmapLevelRows const rows) {
+    int const channels = rows.channels;
+    f32 const *color_lut = rows.is_srgb ? SRGB_TO_LINEAR_LUT : UNORM_TO_FLOAT_LUT;
+    f32x4 const quarter = f32x4_set1(0.25f);
+
+    for (int y = rows.y_begin; y < rows.y_end; ++y) {
+        int const y0 = MIN(2 * y, rows.src_height - 1);
+        int const y1 = MIN(2 * y + 1, rows.src_height - 1);
+        u8 const *src_row0 = &rows.src[(usize) y0 * rows.src_width * channels];
+        u8 const *src_row1 = &rows.src[(usize) y1 * rows.src_width * channels];
+        u8 *dst_row = &rows.dst[(usize) y * rows.dst_width * channels];
+
+        for (int x = 0; x < rows.dst_width; ++x) {
+            int const x0 = MIN(2 * x, rows.src_width - 1) * channels;
+            int const x1 = MIN(2 * x + 1, rows.src_width - 1) * channels;
+
+            f32x4 sum = load_pixel(&src_row0[x0], channels, color_lut);
+            sum = f32x4_add(sum, load_pixel(&src_row0[x1], channels, color_lut));
+            sum = f32x4_add(sum, load_pixel(&src_row1[x0], channels, color_lut));
+            sum = f32x4_add(sum, load_pixel(&src_row1[x1], channels, color_lut));
+
+            store_pixel(&dst_row[x * channels], channels, f32x4_mul(sum, quarter), rows.is_srgb);
+        }
+    }
+}
+
+// @Note: separable, so we first filter horizontally every source row that the destination
+// rows need (into a scratch buffer of linear values), and then filter those vertically.
+static bool filter_rows_kaiser(MipmapLevelRows const rows) {
+    int const channels = rows.channels;
+    f32 const *color_lut = rows.is_srgb ? SRGB_TO_LINEAR_LUT : UNORM_TO_FLOAT_LUT;
+    int const half_taps = MIPMAP_KAISER_TAPS / 2;
+
+    int const src_y_begin = MAX(2 * rows.y_begin - (half_taps - 1), 0);
+    int const src_y_end = MIN(2 * (rows.y_end - 1) + half_taps + 1, rows.src_height);
+    int const scratch_rows = src_y_end - src_y_begin;
+
+    f32 *scratch = malloc(sizeof(f32) * 4 * rows.dst_width * scratch_rows);
+    if (!scratch) { return false; }
+
+    for (int sy = src_y_begin; sy < src_y_end; ++sy) {
+        u8 const *src_row = &rows.src[(usize) sy * rows.src_width * channels];
+        f32 *scratch_row = &scratch[(usize) (sy - src_y_begin) * rows.dst_width * 4];
+
+        for (int x = 0; x < rows.dst_width; ++x) {
+            f32x4 sum = f32x4_set1(0.0f);
+            for (int k = 0; k < MIPMAP_KAISER_TAPS; ++k) {
+                int const sx = CLAMP(2 * x - (half_taps - 1) + k, 0, rows.src_width - 1);
+                f32x4 const texel = load_pixel(&src_row[sx * channels], channels, color_lut);
+                sum = f32x4_madd(texel, f32x4_set1(KAISER_WEIGHTS[k]), sum);
+            }
+            f32x4_store(&scratch_row[x * 4], sum);
+        }
+    }
+
+    for (int y = rows.y_begin; y < rows.y_end; ++y) {
+        u8 *dst_row = &rows.dst[(usize) y * rows.dst_width * channels];
+
+        for (int x = 0; x < rows.dst_width; ++x) {
+            f32x4 sum = f32x4_set1(0.0f);
+            for (int k = 0; k < MIPMAP_KAISER_TAPS; ++k) {
+                int const sy = CLAMP(2 * y - (half_taps - 1) + k, src_y_begin, src_y_end - 1);
+                usize const texel = ((usize) (sy - src_y_begin) * rows.dst_width + x) * 4;
+                sum = f32x4_madd(f32x4_load(&scratch[texel]), f32x4_set1(KAISER_WEIGHTS[k]), sum);
+            }
+            store_pixel(&dst_row[x * channels], channels, sum, rows.is_srgb);
+        }
+    }
+
+    free(scratch);
+    return true;
+}
+
+//
+// Parallel generation.
+//
+
+typedef struct MipmapJobs {
+    MipmapLevelRows *rows; // @Ownership
+    TextureMipmapKernel *kernels; // @Ownership
+    bool *has_failed; // @Ownership @Note: per job, so that each job thread only writes its own
+    usize len;
+} MipmapJobs;
+
+static void run_mipmap_job(void *data, usize index) {
+    MipmapJobs *jobs = data;
+    if (jobs->kernels[index] == TextureMipmapKernel_Kaiser) {
+        jobs->has_failed[index] = !filter_rows_kaiser(jobs->rows[index]);
+    } else {
+        filter_rows_box(jobs->rows[index]);
+    }
+}
+
+static int count_mipmap_levels(int width, int height) {
+    int levels_len = 1;
+    while (levels_len < MIPMAP_MAX_LEVELS && ((width >> levels_len) | (height >> levels_len))) {
+        levels_len += 1;
+    }
+    return levels_len;
+}
+
+static MipmapChain alloc_empty_mipmap_chain(TextureImage const image, Err *err) {
+    if (*err) { return (MipmapChain) { 0 }; }
+
+    MipmapChain chain = {
+        .channels = image.channels,
+        .levels_len = count_mipmap_levels(image.width, image.height),
+    };
+
+    for (int level = 0; level < chain.levels_len; ++level) {
+        chain.widths[level] = MAX(image.width >> level, 1);
+        chain.heights[level] = MAX(image.height >> level, 1);
+        chain.offsets[level] = chain.size;
+        chain.size += (usize) chain.widths[level] * chain.heights[level] * chain.channels;
+    }
+
+    chain.data = malloc(chain.size);
+    if (!chain.data) {
+        *err = Err_Malloc;
+        return (MipmapChain) { 0 };
+    }
+
+    return chain;
+}
+
+//
+// Disk cache.
+//
+
+#define MIPMAP_CACHE_MAGIC 0x50494d47u // "GMIP"
+#define MIPMAP_CACHE_VERSION 1u
+
+typedef struct MipmapCacheHeader {
+    u32 magic;
+    u32 version;
+    u64 key;
+    i32 width;
+    i32 height;
+    i32 channels;
+    i32 levels_len;
+} MipmapCacheHeader;
+
+static u64 compute_mipmap_cache_key(TextureImage const image, MipmapSettings const settings) {
+    usize const size = (usize) image.width * image.height * image.channels;
+    i32 const parameters[] = {
+        image.width, image.height, image.channels, settings.kernel, settings.is_srgb,
+    };
+    return hash_combine(
+        hash_bytes(image.data, size, MIPMAP_CACHE_VERSION),
+        hash_bytes(parameters, sizeof(parameters), 0));
+}
+
+static void get_mipmap_cache_path(char *path, usize max_len, u64 key) {
+    snprintf(path, max_len, GLOW_CACHE_ "mipmaps" SLASH "%016" PRIx64 ".mip", key);
+}
+
+static bool is_mipmap_cache_enabled(MipmapSettings const settings) {
+    return settings.use_cache && GLOW_CACHE_[0] != '\0';
+}
+
+static bool try_read_mipmap_chain_from_cache(MipmapChain *chain, u64 key) {
+    char path[512];
+    get_mipmap_cache_path(path, sizeof(path), key);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) { return false; }
+
+    MipmapCacheHeader header = { 0 };
+    bool const is_valid = fread(&header, sizeof(header), 1, fp) == 1
+                          && header.magic == MIPMAP_CACHE_MAGIC
+                          && header.version == MIPMAP_CACHE_VERSION && header.key == key
+                          && header.width == chain->widths[0]
+                          && header.height == chain->heights[0]
+                          && header.channels == chain->channels
+                          && header.levels_len == chain->levels_len
+                          && fread(chain->data, 1, chain->size, fp) == chain->size;
+
+    fclose(fp);
+    return is_valid;
+}
+
+static void write_mipmap_chain_to_cache(MipmapChain const *chain, u64 key) {
+    static bool has_made_directory = false;
+    if (!has_made_directory) {
+        has_made_directory = make_directory(GLOW_CACHE_) && make_directory(GLOW_CACHE_ "mipmaps");
+    }
+
+    char path[512];
+    get_mipmap_cache_path(path, sizeof(path), key);
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        GLOW_WARNING("failed to write mipmap cache file: `%s`", path);
+        return;
+    }
+
+    MipmapCacheHeader const header = {
+        MIPMAP_CACHE_MAGIC, MIPMAP_CACHE_VERSION,  key,
+        chain->widths[0],   chain->heights[0],     chain->channels,
+        chain->levels_len,
+    };
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(chain->data, 1, chain->size, fp);
+    fclose(fp);
+}
+
+//
+// Public interface.
+//
+
+void alloc_mipmap_chains(
+    TextureImage const images[],
+    MipmapSettings const settings[],
+    MipmapChain chains[],
+    usize count,
+    Err *err) {
+    if (*err || count == 0) { return; }
+
+    init_luts();
+
+    memset(chains, 0, count * sizeof(MipmapChain));
+
+    u64 *keys = calloc(count, sizeof(u64));
+    bool *is_cached = calloc(count, sizeof(bool));
+    if (!keys || !is_cached) {
+        free(is_cached);
+        free(keys);
+        *err = Err_Calloc;
+        return;
+    }
+
+    // Allocate every chain (and copy over level 0), reading whole chains from the cache.
+    int max_levels_len = 0;
+    usize cache_hits = 0;
+    for (usize i = 0; i < count; ++i) {
+        assert(images[i].data && 1 <= images[i].channels && images[i].channels <= 4);
+
+        chains[i] = alloc_empty_mipmap_chain(images[i], err);
+        if (*err) { break; }
+
+        if (is_mipmap_cache_enabled(settings[i])) {
+            keys[i] = compute_mipmap_cache_key(images[i], settings[i]);
+            is_cached[i] = try_read_mipmap_chain_from_cache(&chains[i], keys[i]);
+            cache_hits += is_cached[i] ? 1 : 0;
+        }
+
+        if (!is_cached[i]) {
+            usize const size = (usize) images[i].width * images[i].height * images[i].channels;
+            memcpy(chains[i].data, images[i].data, size); // level 0
+            max_levels_len = MAX(max_levels_len, chains[i].levels_len);
+        }
+    }
+
+    // @Note: every level depends on the previous one, so we go level by level, splitting the
+    // rows of the current level (of every chain that still has to be generated) into jobs.
+    MipmapJobs jobs = { 0 };
+    if (*err == Err_None && max_levels_len > 1) {
+        usize jobs_capacity = 0;
+        for (usize i = 0; i < count; ++i) {
+            if (is_cached[i] || chains[i].levels_len < 2) { continue; }
+            jobs_capacity += DIV_CEIL((usize) chains[i].heights[1], MIPMAP_ROWS_PER_JOB);
+        }
+
+        jobs.rows = calloc(jobs_capacity, sizeof(MipmapLevelRows));
+        jobs.kernels = calloc(jobs_capacity, sizeof(TextureMipmapKernel));
+        jobs.has_failed = calloc(jobs_capacity, sizeof(bool));
+        if (!jobs.rows || !jobs.kernels || !jobs.has_failed) { *err = Err_Calloc; }
+    }
+
+    for (int level = 1; *err == Err_None && level < max_levels_len; ++level) {
+        jobs.len = 0;
+        for (usize i = 0; i < count; ++i) {
+            MipmapChain *chain = &chains[i];
+            if (is_cached[i] || level >= chain->levels_len) { continue; }
+
+            for (int y = 0; y < chain->heights[level]; y += MIPMAP_ROWS_PER_JOB) {
+                jobs.has_failed[jobs.len] = false;
+                jobs.kernels[jobs.len] = settings[i].kernel;
+                jobs.rows[jobs.len++] = (MipmapLevelRows) {
+                    .src = &chain->data[chain->offsets[level - 1]],
+                    .src_width = chain->widths[level - 1],
+                    .src_height = chain->heights[level - 1],
+                    .dst = &chain->data[chain->offsets[level]],
+                    .dst_width = chain->widths[level],
+                    .dst_height = chain->heights[level],
+                    .channels = chain->channels,
+                    .is_srgb = settings[i].is_srgb,
+                    .y_begin = y,
+                    .y_end = MIN(y + MIPMAP_ROWS_PER_JOB, chain->heights[level]),
+                };
+            }
+        }
+
+        run_jobs(run_mipmap_job, &jobs, jobs.len);
+        for (usize i = 0; i < jobs.len; ++i) {
+            if (jobs.has_failed[i]) { *err = Err_Malloc; }
+        }
+    }
+
+    free(jobs.has_failed);
+    free(jobs.kernels);
+    free(jobs.rows);
+
+    if (*err == Err_None) {
+        for (usize i = 0; i < count; ++i) {
+            if (!is_cached[i] && is_mipmap_cache_enabled(settings[i])) {
+                write_mipmap_chain_to_cache(&chains[i], keys[i]);
+            }
+        }
+        if (count > 1) {
+            GLOW_DEBUG("generated %zu mipmap chains (%zu from cache)", count, cache_hits);
+        }
+    } else {
+        for (usize i = 0; i < count; ++i) { dealloc_mipmap_chain(&chains[i]); }
+    }
+
+    free(is_cached);
+    free(keys);
+}
+
+MipmapChain
+alloc_mipmap_chain(TextureImage const image, MipmapSettings const settings, Err *err) {
+    MipmapChain chain = { 0 };
+    alloc_mipmap_chains(&image, &settings, &chain, 1, err);
+    return chain;
+}
+
+void dealloc_mipmap_chain(MipmapChain *chain) {
+    free(chain->data);
+    chain->data = NULL;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "prelude.h"
+
+#include "texture.h"
+
+#define MIPMAP_MAX_LEVELS 16
+
+typedef struct MipmapSettings {
+    TextureMipmapKernel kernel;
+    bool is_srgb; // @Note: if true, RGB is filtered in linear space (alpha always is)
+    bool use_cache; // @Note: read / write generated chains from / to GLOW_CACHE_
+} MipmapSettings;
+
+typedef struct MipmapChain {
+    u8 *data; // @Ownership (every level stored contiguously, starting at level 0)
+    usize size; // in bytes
+    int channels;
+    int levels_len;
+    int widths[MIPMAP_MAX_LEVELS];
+    int heights[MIPMAP_MAX_LEVELS];
+    usize offsets[MIPMAP_MAX_LEVELS]; // into data
+} MipmapChain;
+
+// @Note: expects 8-bit-per-channel images, and generates the chains of all of them at once
+// (i.e. rows of the same level are filtered in parallel, across every image that has it).
+void alloc_mipmap_chains(
+    TextureImage const images[],
+    MipmapSettings const settings[],
+    MipmapChain chains[],
+    usize count,
+    Err *err);
+MipmapChain
+alloc_mipmap_chain(TextureImage const image, MipmapSettings const settings, Err *err);
+void dealloc_mipmap_chain(MipmapChain *chain);
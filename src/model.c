@@ -2,6 +2,30 @@
 
 #include "console.h"
 #include "mesh.h"
+#include "opengl.h"
+#include "texture.h"
+
+#include <string.h>
+
+#include <glad/glad.h>
+
+// @Volatile: laid out as glMultiDrawElementsIndirect expects its commands.
+typedef struct DrawElementsIndirectCommand {
+    uint count;
+    uint instances_len;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+} DrawElementsIndirectCommand;
+
+STATIC_ASSERT(sizeof(DrawElementsIndirectCommand) == 20);
+
+struct ModelIndirectDraws {
+    uint buffer; // GL_DRAW_INDIRECT_BUFFER
+    usize instances_len; // @Note: that the commands were last written with
+    usize commands_len;
+    DrawElementsIndirectCommand commands[]; // @Note: one per draw, in the same order
+};
 
 Model alloc_model_from_filepath_using_assimp(char const *path, Err *err);
 /* Model alloc_model_from_filepath_using_cgltf(char const *path, Err *err);
@@ -11,51 +35,285 @@ Model alloc_model_from_filepath_using_fast_obj(char const *path, Err *err); */
 /* #include "model_cgltf.inl"
 #include "model_fast_obj.inl" */
 
+static bool have_same_textures(Mesh const *a, Mesh const *b) {
+    if (a->textures_len != b->textures_len) { return false; }
+    for (usize i = 0; i < a->textures_len; ++i) {
+        if (a->textures[i].id != b->textures[i].id
+            || a->textures[i].material_type != b->textures[i].material_type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// @Note: groups the draws of the meshes into batches of meshes with the same textures, where
+// each mesh joins the batch of the first one with its textures (if any).
+static void fill_model_batches(ModelDraws *draws, Model const *model, usize mesh_batches[]) {
+    for (usize i = 0; i < model->meshes_len; ++i) {
+        usize batch = draws->batches_len;
+        for (usize b = 0; b < draws->batches_len && batch == draws->batches_len; ++b) {
+            Mesh const *first = &model->meshes[draws->batches[b].mesh];
+            if (have_same_textures(first, &model->meshes[i])) { batch = b; }
+        }
+        if (batch == draws->batches_len) {
+            draws->batches[draws->batches_len++] = (ModelBatch) { .mesh = i };
+        }
+
+        mesh_batches[i] = batch;
+        draws->batches[batch].draws_len += 1;
+    }
+
+    for (usize b = 0, first_draw = 0; b < draws->batches_len; ++b) {
+        draws->batches[b].first_draw = first_draw;
+        first_draw += draws->batches[b].draws_len;
+        draws->batches[b].draws_len = 0; // @Note: counted again as the draws are filled in
+    }
+
+    for (usize i = 0; i < model->meshes_len; ++i) {
+        ModelBatch *batch = &draws->batches[mesh_batches[i]];
+        usize const draw = batch->first_draw + batch->draws_len++;
+
+        Mesh const *mesh = &model->meshes[i];
+        draws->counts[draw] = (int) mesh->indices_len;
+        draws->index_offsets[draw] = (void const *) (mesh->first_index * sizeof(uint));
+        draws->base_vertices[draw] = (int) mesh->base_vertex;
+    }
+}
+
+static ModelIndirectDraws *create_model_indirect_draws(ModelDraws const *draws, usize len) {
+    ModelIndirectDraws *indirect =
+        malloc(sizeof(ModelIndirectDraws) + len * sizeof(DrawElementsIndirectCommand));
+    if (!indirect) { return NULL; }
+
+    indirect->instances_len = 1;
+    indirect->commands_len = len;
+    for (usize i = 0; i < len; ++i) {
+        indirect->commands[i] = (DrawElementsIndirectCommand) {
+            .count = (uint) draws->counts[i],
+            .instances_len = 1,
+            .first_index = (uint) ((usize) draws->index_offsets[i] / sizeof(uint)),
+            .base_vertex = draws->base_vertices[i],
+        };
+    }
+
+    glGenBuffers(1, &indirect->buffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect->buffer);
+    glBufferData(
+        GL_DRAW_INDIRECT_BUFFER,
+        (GLsizeiptr) (len * sizeof(DrawElementsIndirectCommand)),
+        indirect->commands,
+        GL_DYNAMIC_DRAW);
+
+    return indirect;
+}
+
+// @Note: concatenates the meshes' vertices and indices into the buffers of a single vertex
+// array, which every mesh then refers to (along with its offsets into them).
+static ModelDraws create_model_draws(Model *model, Err *err) {
+    ModelDraws draws = { 0 };
+    if (*err || model->meshes_len == 0) { return draws; }
+
+    usize const meshes_len = model->meshes_len;
+    usize vertices_len = 0;
+    usize indices_len = 0;
+    for (usize i = 0; i < meshes_len; ++i) {
+        model->meshes[i].base_vertex = vertices_len;
+        model->meshes[i].first_index = indices_len;
+        vertices_len += model->meshes[i].vertices_len;
+        indices_len += model->meshes[i].indices_len;
+    }
+
+    Vertex *vertices = malloc(vertices_len * sizeof(Vertex));
+    uint *indices = malloc(indices_len * sizeof(uint));
+    usize *mesh_batches = malloc(meshes_len * sizeof(usize));
+    draws.counts = malloc(meshes_len * sizeof(int));
+    draws.index_offsets = malloc(meshes_len * sizeof(void const *));
+    draws.base_vertices = malloc(meshes_len * sizeof(int));
+    draws.batches = malloc(meshes_len * sizeof(ModelBatch));
+
+    if (!vertices || !indices || !mesh_batches || !draws.counts || !draws.index_offsets
+        || !draws.base_vertices || !draws.batches) {
+        *err = Err_Malloc;
+    }
+
+    if (!*err) {
+        for (usize i = 0; i < meshes_len; ++i) {
+            Mesh *mesh = &model->meshes[i];
+            usize const vertices_size = mesh->vertices_len * sizeof(Vertex);
+            memcpy(&vertices[mesh->base_vertex], mesh->vertices, vertices_size);
+            memcpy(&indices[mesh->first_index], mesh->indices, mesh->indices_len * sizeof(uint));
+        }
+
+        draws.vao = create_mesh_vao(vertices, vertices_len, indices, indices_len);
+        for (usize i = 0; i < meshes_len; ++i) { model->meshes[i].vao = draws.vao; }
+
+        fill_model_batches(&draws, model, mesh_batches);
+    }
+
+    free(mesh_batches);
+    free(indices);
+    free(vertices);
+
+    if (!*err && GLAD_GL_ARB_draw_indirect && GLAD_GL_ARB_multi_draw_indirect) {
+        draws.indirect = create_model_indirect_draws(&draws, meshes_len);
+        if (!draws.indirect) { *err = Err_Malloc; }
+    }
+
+    return draws;
+}
+
+static void destroy_model_draws(ModelDraws *draws) {
+    if (draws->indirect) {
+        glDeleteBuffers(1, &draws->indirect->buffer);
+        free(draws->indirect);
+    }
+    if (draws->vao) {
+        forget_gl_vertex_array(draws->vao);
+        glDeleteVertexArrays(1, &draws->vao);
+    }
+
+    free(draws->batches);
+    free(draws->base_vertices);
+    free((void *) draws->index_offsets);
+    free(draws->counts);
+    *draws = (ModelDraws) { 0 };
+}
+
 Model alloc_model_from_filepath(char const *path, Err *err) {
     if (*err) { return (Model) { 0 }; }
 
     GLOW_LOG("Loading model: `%s`", path);
 
     // @Todo: depending on the path extension, choose cgltf/fast_obj instead.
-    Model const model = alloc_model_from_filepath_using_assimp(path, err);
+    Model model = alloc_model_from_filepath_using_assimp(path, err);
+
+    model.bounds = empty_aabb();
+    for (usize i = 0; i < model.meshes_len; ++i) {
+        model.bounds = aabb_union(model.bounds, model.meshes[i].bounds);
+    }
+
+    model.draws = create_model_draws(&model, err);
 
     if (*err) {
         GLOW_WARNING("failed to load `%s` model", point_at_last_path_component(model.path));
     } else {
-        GLOW_LOG("Finished loading `%s` model", point_at_last_path_component(model.path));
+        GLOW_LOG(
+            "Finished loading `%s` model: `%zu` meshes in `%zu` batches (drawn `%s`)",
+            point_at_last_path_component(model.path),
+            model.meshes_len,
+            model.draws.batches_len,
+            model.draws.indirect ? "indirectly" : "directly");
     }
 
     return model;
 }
 
 void dealloc_model(Model *model) {
+    destroy_model_draws(&model->draws);
+
     if (model->meshes) {
-        for (usize i = 0; i < model->meshes_len; ++i) {
-            destroy_mesh_vao(&model->meshes[i]);
-            dealloc_mesh(&model->meshes[i]);
-        }
+        for (usize i = 0; i < model->meshes_len; ++i) { dealloc_mesh(&model->meshes[i]); }
         free(model->meshes);
         model->meshes = NULL;
     }
 }
 
+// @Note: the vertex array must be bound.
+static void multi_draw_model(
+    ModelDraws const *draws, usize first_draw, usize draws_len, usize instances_len) {
+    if (draws->indirect) {
+        ModelIndirectDraws *indirect = draws->indirect;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect->buffer);
+
+        // @Note: the commands are only rewritten when the number of instances changes, which
+        // (as it's usually the same for a model) keeps them on the GPU from frame to frame.
+        if (indirect->instances_len != instances_len) {
+            indirect->instances_len = instances_len;
+            for (usize i = 0; i < indirect->commands_len; ++i) {
+                indirect->commands[i].instances_len = (uint) instances_len;
+            }
+            glBufferSubData(
+                GL_DRAW_INDIRECT_BUFFER,
+                0,
+                (GLsizeiptr) (indirect->commands_len * sizeof(DrawElementsIndirectCommand)),
+                indirect->commands);
+        }
+
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES,
+            GL_UNSIGNED_INT,
+            (void const *) (first_draw * sizeof(DrawElementsIndirectCommand)),
+            (int) draws_len,
+            0);
+    } else if (instances_len == 1) {
+        glMultiDrawElementsBaseVertex(
+            GL_TRIANGLES,
+            &draws->counts[first_draw],
+            GL_UNSIGNED_INT,
+            &draws->index_offsets[first_draw],
+            (int) draws_len,
+            &draws->base_vertices[first_draw]);
+    } else {
+        for (usize i = first_draw; i < first_draw + draws_len; ++i) {
+            glDrawElementsInstancedBaseVertex(
+                GL_TRIANGLES,
+                draws->counts[i],
+                GL_UNSIGNED_INT,
+                draws->index_offsets[i],
+                (int) instances_len,
+                draws->base_vertices[i]);
+        }
+    }
+}
+
+static void draw_model_batches(Model const *model, usize instances_len) {
+    ModelDraws const *draws = &model->draws;
+    bind_gl_vertex_array(draws->vao);
+
+    for (usize b = 0; b < draws->batches_len; ++b) {
+        ModelBatch const *batch = &draws->batches[b];
+        bind_mesh_textures(&model->meshes[batch->mesh]);
+        multi_draw_model(draws, batch->first_draw, batch->draws_len, instances_len);
+    }
+}
+
 void draw_model_direct(Model const *model) {
-    for (usize i = 0; i < model->meshes_len; ++i) { draw_mesh_direct(&model->meshes[i]); }
+    if (model->meshes_len == 0) { return; }
+
+    bind_gl_vertex_array(model->draws.vao);
+    multi_draw_model(&model->draws, 0, model->meshes_len, 1);
 }
 
 void draw_model_with_shader(Model const *model, Shader const *shader) {
-    for (usize i = 0; i < model->meshes_len; ++i) {
-        draw_mesh_with_shader(&model->meshes[i], shader);
-    }
+    UNUSED(shader);
+    draw_model_batches(model, 1);
 }
 
 void draw_model_textureless_with_shader(Model const *model, Shader const *shader) {
+    UNUSED(shader);
+    draw_model_direct(model);
+}
+
+void draw_model_instanced(
+    Model const *model, Shader const *shader, mat4 const local_to_worlds[], usize count) {
+    UNUSED(shader);
+    if (count == 0) { return; }
+
+    upload_mesh_instances(local_to_worlds, count);
+    draw_model_batches(model, count);
+}
+
+void draw_model_instanced_ranges(
+    Model const *model,
+    Shader const *shader,
+    mat4 const local_to_worlds[],
+    usize const first_instances[]) {
     for (usize i = 0; i < model->meshes_len; ++i) {
-        // @Hack: ignore textures while drawing the mesh.
-        usize const textures_len = model->meshes[i].textures_len;
+        usize const count = first_instances[i + 1] - first_instances[i];
+        if (count == 0) { continue; }
 
-        model->meshes[i].textures_len = 0;
-        draw_mesh_with_shader(&model->meshes[i], shader);
-        model->meshes[i].textures_len = textures_len;
+        // @Note: GL 3.3 has no base instance, so each range is uploaded right before its draw.
+        upload_mesh_instances(&local_to_worlds[first_instances[i]], count);
+        draw_mesh_instanced(&model->meshes[i], shader, count);
     }
 }
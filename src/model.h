@@ -2,20 +2,69 @@
 
 #include "prelude.h"
 
+#include "culling.h"
+#include "maths_types.h"
+
 // Forward declarations.
 typedef struct Mesh Mesh;
 typedef struct Shader Shader;
 
+// @Note: a run of draws (one per mesh) whose meshes all have the same textures, i.e. material
+// bindings, so that they're drawn by a single multi-draw call.
+typedef struct ModelBatch {
+    usize first_draw;
+    usize draws_len;
+    usize mesh; // @Note: the first one of the batch, whose textures are bound for all of them
+} ModelBatch;
+
+typedef struct ModelIndirectDraws ModelIndirectDraws; // @Note: opaque
+
+// @Note: every mesh of a model lives in the same vertex and index buffers (read by the same
+// vertex array), so each batch is drawn with glMultiDrawElementsBaseVertex, or, when the context
+// has ARB_multi_draw_indirect (i.e. GL 4.3), with glMultiDrawElementsIndirect from a buffer of
+// draw commands that stays on the GPU.
+typedef struct ModelDraws {
+    uint vao;
+
+    // @Note: the arguments of glMultiDrawElementsBaseVertex, with the draws grouped by batch.
+    int *counts; // @Ownership
+    void const **index_offsets; // @Ownership (in bytes)
+    int *base_vertices; // @Ownership
+
+    ModelBatch *batches; // @Ownership
+    usize batches_len;
+
+    ModelIndirectDraws *indirect; // @Ownership (NULL without ARB_multi_draw_indirect)
+} ModelDraws;
+
 typedef struct Model {
     char const *path;
     Mesh *meshes; // @Ownership
     usize meshes_len;
     usize meshes_capacity;
+    Aabb bounds; // @Note: of every mesh
+    ModelDraws draws;
 } Model;
 
 Model alloc_model_from_filepath(char const *path, Err *err);
 void dealloc_model(Model *model);
 
+// @Note: a single multi-draw of every mesh (without textures), or one per batch (with them).
 void draw_model_direct(Model const *model);
 void draw_model_with_shader(Model const *model, Shader const *shader);
 void draw_model_textureless_with_shader(Model const *model, Shader const *shader);
+
+// @Note: draws each batch with instances, with the shader reading each instance's
+// local_to_world matrix from vertex attributes (see MESH_INSTANCE_ATTRIBUTE_LOCATION). GL 3.3
+// can only multi-draw single instances, so without ARB_multi_draw_indirect, drawing more than
+// one takes a draw per mesh.
+void draw_model_instanced(
+    Model const *model, Shader const *shader, mat4 const local_to_worlds[], usize count);
+
+// @Note: draws each mesh with its own range of instances, from first_instances[i] up to
+// first_instances[i + 1] (e.g. the ones that survived culling, see CulledModel).
+void draw_model_instanced_ranges(
+    Model const *model,
+    Shader const *shader,
+    mat4 const local_to_worlds[],
+    usize const first_instances[]);
@@ -12,9 +12,59 @@ typedef struct TextureStore {
     Texture *textures; // @Ownership
     usize len;
     usize capacity;
+
+    // @Note: one of each per material (indexed by mMaterialIndex), where the normal
+    // textures have an id of 0 if their material doesn't have a normal map.
+    Texture *packed_textures; // @Ownership
+    Texture *normal_textures; // @Ownership
+    usize materials_len;
+
+    // @Note: images are only uploaded (see upload_texture_store_images) after every material
+    // has been loaded, so that all of their mipmaps are generated in a single parallel batch.
+    TextureImage *images; // @Ownership (indexed as textures)
+    TextureSettings *settings; // @Ownership (indexed as textures)
+    TextureImage *packed_images; // @Ownership (indexed as packed_textures)
+    TextureImage *normal_images; // @Ownership (indexed as normal_textures)
 } TextureStore;
 
+// @Note: both packed and normal textures store data, so we don't want any swizzling.
+static TextureSettings const PACKED_TEXTURE_SETTINGS = {
+    .apply_srgb_eotf = false,
+    .generate_mipmap = true,
+    .keep_channels = true,
+};
+
+static void dealloc_texture_store_images(TextureStore *texture_store) {
+    if (texture_store->images) {
+        for (usize i = 0; i < texture_store->len; ++i) {
+            dealloc_texture_image(&texture_store->images[i]);
+        }
+        free(texture_store->images);
+        texture_store->images = NULL;
+    }
+
+    free(texture_store->settings);
+    texture_store->settings = NULL;
+
+    for (usize i = 0; i < texture_store->materials_len; ++i) {
+        if (texture_store->packed_images) {
+            dealloc_texture_image(&texture_store->packed_images[i]);
+        }
+        if (texture_store->normal_images) {
+            dealloc_texture_image(&texture_store->normal_images[i]);
+        }
+    }
+
+    free(texture_store->packed_images);
+    texture_store->packed_images = NULL;
+
+    free(texture_store->normal_images);
+    texture_store->normal_images = NULL;
+}
+
 static void dealloc_texture_store(TextureStore *texture_store) {
+    dealloc_texture_store_images(texture_store);
+
     if (texture_store->paths) {
         for (usize i = 0; i < texture_store->len; ++i) { free(texture_store->paths[i]); }
         free(texture_store->paths);
@@ -23,6 +73,12 @@ static void dealloc_texture_store(TextureStore *texture_store) {
 
     free(texture_store->textures);
     texture_store->textures = NULL;
+
+    free(texture_store->normal_textures);
+    texture_store->normal_textures = NULL;
+
+    free(texture_store->packed_textures);
+    texture_store->packed_textures = NULL;
 }
 
 static uint count_assimp_material_textures_with_types(
@@ -57,8 +113,17 @@ static TextureStore alloc_texture_store_for_assimp_texture_types(
         .textures = calloc(texture_store_capacity, sizeof(Texture)),
         .len = 0,
         .capacity = texture_store_capacity,
+        .packed_textures = calloc(ai_scene->mNumMaterials, sizeof(Texture)),
+        .normal_textures = calloc(ai_scene->mNumMaterials, sizeof(Texture)),
+        .materials_len = ai_scene->mNumMaterials,
+        .images = calloc(texture_store_capacity, sizeof(TextureImage)),
+        .settings = calloc(texture_store_capacity, sizeof(TextureSettings)),
+        .packed_images = calloc(ai_scene->mNumMaterials, sizeof(TextureImage)),
+        .normal_images = calloc(ai_scene->mNumMaterials, sizeof(TextureImage)),
     };
-    if (!texture_store.paths || !texture_store.textures) {
+    if (!texture_store.paths || !texture_store.textures || !texture_store.packed_textures
+        || !texture_store.normal_textures || !texture_store.images || !texture_store.settings
+        || !texture_store.packed_images || !texture_store.normal_images) {
         dealloc_texture_store(&texture_store);
         *err = Err_Calloc;
     }
@@ -66,6 +131,34 @@ static TextureStore alloc_texture_store_for_assimp_texture_types(
     return texture_store;
 }
 
+static char *alloc_full_path_of_assimp_material_texture_type_index(
+    Str const dir_path_str,
+    struct aiMaterial const *ai_material,
+    enum aiTextureType const ai_texture_type,
+    uint index,
+    struct aiString *path,
+    Err *err) {
+    if (*err) { return NULL; }
+
+    if (aiGetMaterialTexture(
+            ai_material, ai_texture_type, index, path, NULL, NULL, NULL, NULL, NULL, NULL)
+        != aiReturn_SUCCESS) {
+        *err = Err_Assimp_Get_Texture;
+        return NULL;
+    }
+
+    usize const full_path_len = dir_path_str.len + 1 + path->length; // + 1 for the slash
+    char *full_path = calloc(full_path_len + 1, sizeof(char));
+    if (!full_path) {
+        *err = Err_Calloc;
+        return NULL;
+    }
+
+    // @Note: we assume all texture paths are relative to dir_path_str.
+    snprintf(full_path, full_path_len + 1, "%s" SLASH "%s", dir_path_str.data, &path->data[0]);
+    return full_path;
+}
+
 static void store_texture_with_assimp_material_texture_type_index(
     TextureStore *texture_store,
     Str const dir_path_str,
@@ -97,40 +190,32 @@ static void store_texture_with_assimp_material_texture_type_index(
         GLOW_WARNING("unhandled assimp aiTextureType: `%d`", ai_texture_type);
     }
 
-    TextureSettings const texture_settings = {
-        .format = TextureFormat_Default,
-        .apply_srgb_eotf = !is_non_color_texture,
-        .highp_bitdepth = false,
-        .floating_point = false,
-        .generate_mipmap = true,
-    };
-
     //
     // Load the texture image using the full path to it.
     //
 
     struct aiString path = { 0 };
-    if (aiGetMaterialTexture(
-            ai_material, ai_texture_type, index, &path, NULL, NULL, NULL, NULL, NULL, NULL)
-        != aiReturn_SUCCESS) {
-        *err = Err_Assimp_Get_Texture;
-        return;
-    }
+    char *full_path = alloc_full_path_of_assimp_material_texture_type_index(
+        dir_path_str, ai_material, ai_texture_type, index, &path, err);
+    if (*err) { return; }
 
-    usize const full_path_len = dir_path_str.len + 1 + path.length; // + 1 for the slash
-    char *full_path = calloc(full_path_len + 1, sizeof(char));
-    if (!full_path) {
-        *err = Err_Calloc;
-        return;
-    }
+    // @Note: floating point images are already linear, so they're uploaded as half floats
+    // instead of being tonemapped to sRGB bytes (and their mipmaps come from glGenerateMipmap).
+    bool const is_floating_point = is_floating_point_image_filepath(full_path);
 
-    // @Note: we assume all texture paths are relative to dir_path_str.
-    snprintf(full_path, full_path_len + 1, "%s" SLASH "%s", dir_path_str.data, &path.data[0]);
-    Texture texture = new_texture_from_filepath(full_path, texture_settings, err);
-    texture.material_type = texture_material_type;
+    TextureSettings const texture_settings = {
+        .format = TextureFormat_Default,
+        .apply_srgb_eotf = !is_non_color_texture && !is_floating_point,
+        .highp_bitdepth = false,
+        .floating_point = is_floating_point,
+        .generate_mipmap = true,
+    };
+
+    TextureImage const image =
+        alloc_texture_image_from_filepath(full_path, texture_settings, err);
 
     //
-    // Store the loaded texture image in the texture store.
+    // Store the loaded texture image in the texture store (it's uploaded later on).
     //
 
     usize const len = texture_store->len;
@@ -138,7 +223,9 @@ static void store_texture_with_assimp_material_texture_type_index(
 
     texture_store->len += 1;
     texture_store->paths[len] = alloc_str_copy(&path.data[0], err);
-    texture_store->textures[len] = texture;
+    texture_store->textures[len] = (Texture) { .material_type = texture_material_type };
+    texture_store->images[len] = image;
+    texture_store->settings[len] = texture_settings;
 
     if (*err) {
         GLOW_WARNING("failed to load texture from path: `%s`", full_path);
@@ -149,6 +236,139 @@ static void store_texture_with_assimp_material_texture_type_index(
     free(full_path);
 }
 
+// @Note: single-channel material maps, which get packed (in this order) into the RGB
+// channels of one texture per material (see TextureMaterialType_Packed), while its alpha
+// channel flags whether or not the material also has a (two channel) normal map.
+static enum aiTextureType const PACKED_ASSIMP_TEXTURE_TYPES[3] = {
+    aiTextureType_SPECULAR,
+    aiTextureType_AMBIENT,
+    aiTextureType_HEIGHT,
+};
+
+static void store_packed_textures_with_assimp_material_index(
+    TextureStore *texture_store,
+    Str const dir_path_str,
+    struct aiMaterial const *ai_material,
+    uint material_index,
+    Err *err) {
+    if (*err) { return; }
+
+    assert(material_index < texture_store->materials_len);
+
+    // @Note: only the first texture of each packed type is used.
+    TextureImage images[ARRAY_LEN(PACKED_ASSIMP_TEXTURE_TYPES)] = { 0 };
+    TextureImage normal_image = { 0 };
+
+    for (usize i = 0; i < ARRAY_LEN(PACKED_ASSIMP_TEXTURE_TYPES); ++i) {
+        if (aiGetMaterialTextureCount(ai_material, PACKED_ASSIMP_TEXTURE_TYPES[i]) == 0) {
+            continue;
+        }
+        struct aiString path = { 0 };
+        char *full_path = alloc_full_path_of_assimp_material_texture_type_index(
+            dir_path_str, ai_material, PACKED_ASSIMP_TEXTURE_TYPES[i], 0, &path, err);
+        images[i] = alloc_texture_image_from_filepath(full_path, (TextureSettings) { 0 }, err);
+        free(full_path);
+    }
+
+    if (aiGetMaterialTextureCount(ai_material, aiTextureType_NORMALS) > 0) {
+        struct aiString path = { 0 };
+        char *full_path = alloc_full_path_of_assimp_material_texture_type_index(
+            dir_path_str, ai_material, aiTextureType_NORMALS, 0, &path, err);
+        normal_image = alloc_texture_image_from_filepath(full_path, (TextureSettings) { 0 }, err);
+        free(full_path);
+    } else if (images[2].data && images[2].channels >= 3) {
+        // @Note: .obj files' `map_Bump` is imported by assimp as aiTextureType_HEIGHT,
+        // but it's commonly used for tangent-space normal maps (e.g. in backpack.obj).
+        SWAP(TextureImage, normal_image, images[2]);
+    }
+
+    bool const has_normal_map = normal_image.data != NULL;
+
+    if (*err == Err_None) {
+        TextureChannelSource const packed_sources[4] = {
+            { &images[0], 0, 0 }, // specular
+            { &images[1], 0, 255 }, // ambient
+            { &images[2], 0, 0 }, // height
+            { NULL, 0, has_normal_map ? 255 : 0 },
+        };
+        texture_store->packed_images[material_index] =
+            alloc_texture_image_from_channels(packed_sources, 4, err);
+        texture_store->packed_textures[material_index].material_type = TextureMaterialType_Packed;
+    }
+
+    if (*err == Err_None && has_normal_map) {
+        // @Note: only store XY, as Z is reconstructed in the shader (it's unit length).
+        TextureChannelSource const normal_sources[2] = {
+            { &normal_image, 0, 128 },
+            { &normal_image, 1, 128 },
+        };
+        texture_store->normal_images[material_index] =
+            alloc_texture_image_from_channels(normal_sources, 2, err);
+        texture_store->normal_textures[material_index].material_type = TextureMaterialType_Normal;
+    }
+
+    if (*err) {
+        GLOW_WARNING("failed to pack textures for material: `%u`", material_index);
+    } else {
+        GLOW_LOG(
+            "Packed textures for material: `%u` (%s normal map)",
+            material_index,
+            has_normal_map ? "with" : "without");
+    }
+
+    dealloc_texture_image(&normal_image);
+    for (usize i = 0; i < ARRAY_LEN(images); ++i) { dealloc_texture_image(&images[i]); }
+}
+
+// @Note: creates the textures of every image in the store at once (see new_textures_from_images),
+// and then frees the images, as we don't need to keep them around after they're uploaded.
+static void upload_texture_store_images(TextureStore *texture_store, Err *err) {
+    if (*err) { return; }
+
+    usize const capacity = texture_store->len + 2 * texture_store->materials_len;
+    TextureImage *images = calloc(capacity, sizeof(TextureImage));
+    TextureSettings *settings = calloc(capacity, sizeof(TextureSettings));
+    Texture **destinations = calloc(capacity, sizeof(Texture *));
+    Texture *textures = calloc(capacity, sizeof(Texture));
+
+    if (!images || !settings || !destinations || !textures) {
+        *err = Err_Calloc;
+    } else {
+        usize len = 0;
+        for (usize i = 0; i < texture_store->len; ++i, ++len) {
+            images[len] = texture_store->images[i];
+            settings[len] = texture_store->settings[i];
+            destinations[len] = &texture_store->textures[i];
+        }
+        for (usize i = 0; i < texture_store->materials_len; ++i, ++len) {
+            images[len] = texture_store->packed_images[i];
+            settings[len] = PACKED_TEXTURE_SETTINGS;
+            destinations[len] = &texture_store->packed_textures[i];
+        }
+        for (usize i = 0; i < texture_store->materials_len; ++i) {
+            if (!texture_store->normal_images[i].data) { continue; }
+            images[len] = texture_store->normal_images[i];
+            settings[len] = PACKED_TEXTURE_SETTINGS;
+            destinations[len] = &texture_store->normal_textures[i];
+            len += 1;
+        }
+
+        new_textures_from_images(images, settings, textures, len);
+
+        for (usize i = 0; i < len; ++i) {
+            textures[i].material_type = destinations[i]->material_type;
+            *destinations[i] = textures[i];
+        }
+    }
+
+    free(textures);
+    free(destinations);
+    free(settings);
+    free(images);
+
+    dealloc_texture_store_images(texture_store);
+}
+
 static TextureStore create_texture_store_for_assimp_texture_types(
     Str const dir_path_str,
     struct aiScene const *ai_scene,
@@ -171,9 +391,12 @@ static TextureStore create_texture_store_for_assimp_texture_types(
                     &texture_store, dir_path_str, ai_material, ai_texture_type, index, err);
             }
         }
+        store_packed_textures_with_assimp_material_index(
+            &texture_store, dir_path_str, ai_material, i, err);
     }
 
     assert(texture_store.len == texture_store.capacity);
+    upload_texture_store_images(&texture_store, err);
     return texture_store;
 }
 
@@ -210,9 +433,10 @@ static Texture *load_stored_texture_with_assimp_material_texture_type_index(
 }
 
 // @Cleanup: this isn't great... maybe it could be specified as an arg when creating the model?
+// @Note: the non-color types (i.e. PACKED_ASSIMP_TEXTURE_TYPES and normals) are stored per
+// material instead, see `store_packed_textures_with_assimp_material_index`.
 static enum aiTextureType const STORED_ASSIMP_TEXTURE_TYPES[] = {
-    aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_AMBIENT,
-    aiTextureType_NORMALS, aiTextureType_HEIGHT,
+    aiTextureType_DIFFUSE,
 };
 
 static Mesh alloc_mesh_from_assimp_mesh(
@@ -227,9 +451,15 @@ static Mesh alloc_mesh_from_assimp_mesh(
     struct aiMaterial const *ai_material = ai_scene->mMaterials[ai_mesh->mMaterialIndex];
     GLOW_DEBUG("mMaterialIndex = %d", ai_mesh->mMaterialIndex);
 
-    usize const textures_capacity = count_assimp_material_textures_with_types(
+    assert(ai_mesh->mMaterialIndex < texture_store->materials_len);
+    Texture const packed_texture = texture_store->packed_textures[ai_mesh->mMaterialIndex];
+    Texture const normal_texture = texture_store->normal_textures[ai_mesh->mMaterialIndex];
+
+    usize const stored_textures_len = count_assimp_material_textures_with_types(
         ai_material, STORED_ASSIMP_TEXTURE_TYPES, ARRAY_LEN(STORED_ASSIMP_TEXTURE_TYPES));
-    assert(textures_capacity <= texture_store->capacity);
+    assert(stored_textures_len <= texture_store->capacity);
+
+    usize const textures_capacity = stored_textures_len + 1 + (normal_texture.id != 0 ? 1 : 0);
 
     Mesh mesh = {
         .vertices = calloc(ai_mesh->mNumVertices, sizeof(Vertex)),
@@ -255,25 +485,33 @@ static Mesh alloc_mesh_from_assimp_mesh(
                     texture_store, ai_material, ai_texture_type, index, err);
         }
     }
+    mesh.textures[mesh.textures_len++] = packed_texture;
+    if (normal_texture.id != 0) { mesh.textures[mesh.textures_len++] = normal_texture; }
     assert(mesh.textures_len == textures_capacity);
 
     //
     // Mesh vertices.
     //
 
+    mesh.bounds = empty_aabb();
+
     bool const has_texcoord = ai_mesh->mTextureCoords[0] != NULL;
+    bool const has_tangent = ai_mesh->mTangents != NULL; // @Note: requires texcoords
     for (uint i = 0; i < ai_mesh->mNumVertices; ++i) {
         struct aiVector3D position = ai_mesh->mVertices[i];
         struct aiVector3D normal = ai_mesh->mNormals[i];
         struct aiVector3D texcoord =
             has_texcoord ? ai_mesh->mTextureCoords[0][i] : (struct aiVector3D) { 0 };
-        /* struct aiVector3D tangent = ai_mesh->mTangents[i]; */
+        struct aiVector3D tangent =
+            has_tangent ? ai_mesh->mTangents[i] : (struct aiVector3D) { 0 };
         /* struct aiVector3D bitangent = ai_mesh->mBitangents[i]; */
         mesh.vertices[mesh.vertices_len++] = (Vertex) {
             { position.x, position.y, position.z },
             { normal.x, normal.y, normal.z },
             { texcoord.x, texcoord.y },
+            { tangent.x, tangent.y, tangent.z },
         };
+        mesh.bounds = aabb_with_point(mesh.bounds, (vec3) { position.x, position.y, position.z });
     }
 
     //
@@ -288,12 +526,7 @@ static Mesh alloc_mesh_from_assimp_mesh(
         mesh.indices[mesh.indices_len++] = ai_mesh->mFaces[i].mIndices[2];
     }
 
-    //
-    // Mesh VAO.
-    //
-
-    mesh.vao = create_mesh_vao(mesh.vertices, mesh.vertices_len, mesh.indices, mesh.indices_len);
-
+    // @Note: the mesh's VAO is the model's, which is created once every mesh was loaded.
     return mesh;
 }
 
@@ -0,0 +1,608 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#endif
+
+#include "occlusion.h"
+
+#include "console.h"
+#include "jobs.h"
+#include "maths.h"
+#include "simd.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// @Note: the number of occluder triangles that are set up by each job.
+#define OCCLUSION_TRIANGLES_PER_JOB 1024
+
+// @Note: the most texels that is_aabb_occluded reads from a level before giving up on it (and
+// on every finer one), so testing a box that covers most of the screen stays cheap.
+#define OCCLUSION_TEST_TEXELS_MAX 64
+
+STATIC_ASSERT(OCCLUSION_HEIGHT % OCCLUSION_BAND_HEIGHT == 0);
+STATIC_ASSERT(OCCLUSION_BAND_HEIGHT % (1 << (OCCLUSION_LEVELS - 1)) == 0);
+STATIC_ASSERT(OCCLUSION_WIDTH % (4 << (OCCLUSION_LEVELS - 1)) == 0);
+
+// @Note: a triangle in pixel coordinates (with y pointing up), set up to be rasterized.
+typedef struct ScreenTriangle {
+    f32 edges[3][3]; // @Note: (a, b, c) of each edge function a * x + b * y + c, >= 0 inside
+    f32 depth[3]; // @Note: the plane of 1 / w, i.e. depth[0] * x + depth[1] * y + depth[2]
+    int x0, x1; // @Note: inclusive pixel bounds, clamped to the buffer
+    int y0, y1;
+} ScreenTriangle;
+
+struct OcclusionScratch {
+    mat4 *local_to_clips;
+    usize local_to_clips_capacity;
+
+    usize *first_triangles; // @Note: of each occluder, plus the total number of them
+    usize first_triangles_capacity;
+
+    // @Note: each job writes (up to two per triangle, after clipping) into its own range.
+    ScreenTriangle *screen_triangles;
+    usize screen_triangles_capacity;
+    usize *jobs_triangles_len;
+    usize jobs_triangles_len_capacity;
+
+    // @Note: inputs of the jobs running in rasterize_occluders.
+    OccluderMesh const *occluders;
+    usize triangles_len;
+    usize jobs_len;
+    f32 *levels[OCCLUSION_LEVELS];
+};
+
+// @Note: returns the (possibly moved) data, which is left untouched if it can't grow.
+static void *reserve(void *data, usize *capacity, usize len, usize elem_size, Err *err) {
+    if (len <= *capacity) { return data; }
+
+    usize const new_capacity = MAX(2 * *capacity, len);
+    void *new_data = realloc(data, new_capacity * elem_size);
+    if (!new_data) {
+        *err = Err_Realloc;
+        return data;
+    }
+
+    *capacity = new_capacity;
+    return new_data;
+}
+
+static f64 get_time_ms(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return 1000.0 * (f64) counter.QuadPart / (f64) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return 1000.0 * (f64) now.tv_sec + 1e-6 * (f64) now.tv_nsec;
+#endif
+}
+
+static usize get_levels_len(void) {
+    usize len = 0;
+    for (int level = 0; level < OCCLUSION_LEVELS; ++level) {
+        len += (OCCLUSION_WIDTH >> level) * (OCCLUSION_HEIGHT >> level);
+    }
+    return len;
+}
+
+OcclusionBuffer alloc_occlusion_buffer(Err *err) {
+    if (*err) { return (OcclusionBuffer) { 0 }; }
+
+    f32 *texels = calloc(get_levels_len(), sizeof(f32));
+    OcclusionScratch *scratch = calloc(1, sizeof(OcclusionScratch));
+    if (!texels || !scratch) {
+        free(scratch);
+        free(texels);
+        *err = Err_Calloc;
+        return (OcclusionBuffer) { 0 };
+    }
+
+    OcclusionBuffer buffer = { .scratch = scratch };
+    for (int level = 0; level < OCCLUSION_LEVELS; ++level) {
+        buffer.levels[level] = texels;
+        texels += (OCCLUSION_WIDTH >> level) * (OCCLUSION_HEIGHT >> level);
+    }
+    return buffer;
+}
+
+void dealloc_occlusion_buffer(OcclusionBuffer *buffer) {
+    OcclusionScratch *scratch = buffer->scratch;
+    if (scratch) {
+        free(scratch->jobs_triangles_len);
+        free(scratch->screen_triangles);
+        free(scratch->first_triangles);
+        free(scratch->local_to_clips);
+        free(scratch);
+    }
+
+    free(buffer->levels[0]);
+    *buffer = (OcclusionBuffer) { 0 };
+}
+
+//
+// Triangle setup.
+//
+
+// @Note: clips a triangle against the near plane (z >= -w), returning how many vertices the
+// resulting convex polygon has (either none, three or four of them).
+static int clip_against_near_plane(vec4 const triangle[3], vec4 polygon[4]) {
+    int len = 0;
+    for (int i = 0; i < 3; ++i) {
+        vec4 const a = triangle[i];
+        vec4 const b = triangle[(i + 1) % 3];
+        f32 const distance_a = a.z + a.w;
+        f32 const distance_b = b.z + b.w;
+
+        if (distance_a >= 0) { polygon[len++] = a; }
+        if ((distance_a >= 0) != (distance_b >= 0)) {
+            polygon[len++] = vec4_lerp(a, b, distance_a / (distance_a - distance_b));
+        }
+    }
+    return len;
+}
+
+// @Note: expects vertices as (x, y, 1 / w) in pixel coordinates, and returns false if the
+// triangle doesn't need to be rasterized (i.e. it is degenerate or outside of the buffer).
+static bool setup_screen_triangle(vec3 v0, vec3 v1, vec3 v2, ScreenTriangle *triangle) {
+    f32 area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (area < 0) {
+        // @Note: flip back facing triangles, so that the edge functions are positive inside.
+        vec3 const v = v1;
+        v1 = v2;
+        v2 = v;
+        area = -area;
+    }
+    if (!(area > 1e-6f)) { return false; }
+
+    f32 const min_x = MIN(v0.x, MIN(v1.x, v2.x));
+    f32 const max_x = MAX(v0.x, MAX(v1.x, v2.x));
+    f32 const min_y = MIN(v0.y, MIN(v1.y, v2.y));
+    f32 const max_y = MAX(v0.y, MAX(v1.y, v2.y));
+    if (max_x < 0 || min_x >= OCCLUSION_WIDTH || max_y < 0 || min_y >= OCCLUSION_HEIGHT) {
+        return false;
+    }
+
+    triangle->x0 = (int) MAX(floorf(min_x), 0);
+    triangle->x1 = (int) MIN(floorf(max_x), OCCLUSION_WIDTH - 1);
+    triangle->y0 = (int) MAX(floorf(min_y), 0);
+    triangle->y1 = (int) MIN(floorf(max_y), OCCLUSION_HEIGHT - 1);
+
+    // @Note: the edge opposite to each vertex, whose function divided by the triangle's area
+    // is the vertex's barycentric coordinate (which is what 1 / w is interpolated with).
+    vec3 const v[3] = { v0, v1, v2 };
+    f32 const rcp_area = 1 / area;
+    triangle->depth[0] = triangle->depth[1] = triangle->depth[2] = 0;
+    for (int k = 0; k < 3; ++k) {
+        vec3 const a = v[(k + 1) % 3];
+        vec3 const b = v[(k + 2) % 3];
+        triangle->edges[k][0] = a.y - b.y;
+        triangle->edges[k][1] = b.x - a.x;
+        triangle->edges[k][2] = a.x * b.y - b.x * a.y;
+        for (int i = 0; i < 3; ++i) {
+            triangle->depth[i] += v[k].z * triangle->edges[k][i] * rcp_area;
+        }
+    }
+
+    return true;
+}
+
+// @Note: returns how many screen triangles the clip space one ended up as (up to two of them).
+static usize setup_triangle(vec4 const clip[3], ScreenTriangle screen_triangles[2]) {
+    // Trivially reject triangles that are entirely outside of the left, right, bottom, top or
+    // far planes (as they're clipped against the near one).
+    u32 outside = ~0u;
+    for (int k = 0; k < 3; ++k) {
+        vec4 const p = clip[k];
+        outside &= (u32) (p.x < -p.w) | (u32) (p.x > p.w) << 1 | (u32) (p.y < -p.w) << 2
+                   | (u32) (p.y > p.w) << 3 | (u32) (p.z > p.w) << 4;
+    }
+    if (outside) { return 0; }
+
+    vec4 polygon[4];
+    int const polygon_len = clip_against_near_plane(clip, polygon);
+
+    vec3 screen[4];
+    for (int i = 0; i < polygon_len; ++i) {
+        vec4 const p = polygon[i];
+        if (!(p.w > 0)) { return 0; } // @Note: only happens for degenerate projections
+
+        f32 const rcp_w = 1 / p.w;
+        screen[i] = (vec3) {
+            (0.5f * p.x * rcp_w + 0.5f) * OCCLUSION_WIDTH,
+            (0.5f * p.y * rcp_w + 0.5f) * OCCLUSION_HEIGHT,
+            rcp_w,
+        };
+    }
+
+    usize len = 0;
+    for (int i = 2; i < polygon_len; ++i) {
+        len += setup_screen_triangle(screen[0], screen[i - 1], screen[i], &screen_triangles[len]);
+    }
+    return len;
+}
+
+static void setup_triangles_job(void *data, usize index) {
+    OcclusionScratch *scratch = data;
+
+    usize const begin = index * OCCLUSION_TRIANGLES_PER_JOB;
+    usize const end = MIN(begin + OCCLUSION_TRIANGLES_PER_JOB, scratch->triangles_len);
+
+    ScreenTriangle *screen_triangles = &scratch->screen_triangles[2 * begin];
+    usize screen_triangles_len = 0;
+
+    usize occluder = 0;
+    for (usize t = begin; t < end; ++t) {
+        while (scratch->first_triangles[occluder + 1] <= t) { ++occluder; }
+
+        OccluderMesh const *mesh = &scratch->occluders[occluder];
+        uint const *indices = &mesh->indices[3 * (t - scratch->first_triangles[occluder])];
+
+        vec4 clip[3];
+        for (int k = 0; k < 3; ++k) {
+            u8 const *position = (u8 const *) mesh->positions + indices[k] * mesh->stride;
+            clip[k] = mat4_mul_vec4(
+                scratch->local_to_clips[occluder], vec4_from_vec3(*(vec3 const *) position, 1));
+        }
+        screen_triangles_len += setup_triangle(clip, &screen_triangles[screen_triangles_len]);
+    }
+
+    scratch->jobs_triangles_len[index] = screen_triangles_len;
+}
+
+//
+// Rasterization.
+//
+
+// @Note: keeps the nearest depth (i.e. the largest 1 / w) of each pixel whose center is inside
+// of the triangle, four pixels of a row at a time.
+static void rasterize_triangle(f32 *depth, ScreenTriangle const *triangle, int y0, int y1) {
+    f32x4 const zero = f32x4_set1(0);
+    f32x4 const pixel_centers = f32x4_set(0.5f, 1.5f, 2.5f, 3.5f);
+
+    f32x4 const edge_a[3] = {
+        f32x4_set1(triangle->edges[0][0]),
+        f32x4_set1(triangle->edges[1][0]),
+        f32x4_set1(triangle->edges[2][0]),
+    };
+    f32x4 const depth_a = f32x4_set1(triangle->depth[0]);
+
+    int const x0 = triangle->x0 & ~3; // @Note: rows are 16-byte aligned (in groups of four)
+    for (int y = y0; y <= y1; ++y) {
+        f32 const py = (f32) y + 0.5f;
+        f32x4 const edge_bc[3] = {
+            f32x4_set1(triangle->edges[0][1] * py + triangle->edges[0][2]),
+            f32x4_set1(triangle->edges[1][1] * py + triangle->edges[1][2]),
+            f32x4_set1(triangle->edges[2][1] * py + triangle->edges[2][2]),
+        };
+        f32x4 const depth_bc = f32x4_set1(triangle->depth[1] * py + triangle->depth[2]);
+
+        f32 *row = &depth[y * OCCLUSION_WIDTH];
+        for (int x = x0; x <= triangle->x1; x += 4) {
+            f32x4 const px = f32x4_add(f32x4_set1((f32) x), pixel_centers);
+            f32x4 const outside = f32x4_or(
+                f32x4_or(
+                    f32x4_lt(f32x4_madd(edge_a[0], px, edge_bc[0]), zero),
+                    f32x4_lt(f32x4_madd(edge_a[1], px, edge_bc[1]), zero)),
+                f32x4_lt(f32x4_madd(edge_a[2], px, edge_bc[2]), zero));
+            if (f32x4_movemask(outside) == 0xf) { continue; }
+
+            f32x4 const z = f32x4_madd(depth_a, px, depth_bc);
+            f32x4 const old_z = f32x4_load(&row[x]);
+            f32x4_store(&row[x], f32x4_select(outside, old_z, f32x4_max(old_z, z)));
+        }
+    }
+}
+
+// @Note: each job owns a band of rows (of every level), so they never write to the same texels.
+static void rasterize_band_job(void *data, usize band) {
+    OcclusionScratch *scratch = data;
+
+    int const y_begin = (int) band * OCCLUSION_BAND_HEIGHT;
+    int const y_end = y_begin + OCCLUSION_BAND_HEIGHT;
+
+    f32 *depth = scratch->levels[0];
+    usize const band_len = OCCLUSION_BAND_HEIGHT * OCCLUSION_WIDTH;
+    memset(&depth[y_begin * OCCLUSION_WIDTH], 0, band_len * sizeof(f32));
+
+    for (usize j = 0; j < scratch->jobs_len; ++j) {
+        ScreenTriangle const *triangles =
+            &scratch->screen_triangles[2 * j * OCCLUSION_TRIANGLES_PER_JOB];
+        for (usize i = 0; i < scratch->jobs_triangles_len[j]; ++i) {
+            int const y0 = MAX(triangles[i].y0, y_begin);
+            int const y1 = MIN(triangles[i].y1, y_end - 1);
+            if (y0 <= y1) { rasterize_triangle(depth, &triangles[i], y0, y1); }
+        }
+    }
+
+    // Downsample the band into every coarser level, keeping the farthest depth.
+    for (int level = 1; level < OCCLUSION_LEVELS; ++level) {
+        int const fine_width = OCCLUSION_WIDTH >> (level - 1);
+        int const width = OCCLUSION_WIDTH >> level;
+        f32 const *fine = scratch->levels[level - 1];
+        f32 *coarse = scratch->levels[level];
+
+        for (int y = y_begin >> level; y < y_end >> level; ++y) {
+            f32 const *row0 = &fine[2 * y * fine_width];
+            f32 const *row1 = row0 + fine_width;
+            for (int x = 0; x < width; ++x) {
+                f32 const z0 = MIN(row0[2 * x], row0[2 * x + 1]);
+                f32 const z1 = MIN(row1[2 * x], row1[2 * x + 1]);
+                coarse[y * width + x] = MIN(z0, z1);
+            }
+        }
+    }
+}
+
+void rasterize_occluders(
+    OcclusionBuffer *buffer,
+    mat4 const world_to_clip,
+    OccluderMesh const occluders[],
+    usize count,
+    Err *err) {
+    if (*err) { return; }
+
+    f64 const start_ms = get_time_ms();
+
+    OcclusionScratch *scratch = buffer->scratch;
+    buffer->world_to_clip = world_to_clip;
+    buffer->stats = (OcclusionStats) { 0 };
+
+    scratch->local_to_clips = reserve(
+        scratch->local_to_clips, &scratch->local_to_clips_capacity, count, sizeof(mat4), err);
+    scratch->first_triangles = reserve(
+        scratch->first_triangles,
+        &scratch->first_triangles_capacity,
+        count + 1,
+        sizeof(usize),
+        err);
+
+    usize triangles_len = 0;
+    if (!*err) {
+        for (usize i = 0; i < count; ++i) {
+            scratch->local_to_clips[i] = mat4_mul(world_to_clip, occluders[i].local_to_world);
+            scratch->first_triangles[i] = triangles_len;
+            triangles_len += occluders[i].indices_len / 3;
+        }
+        scratch->first_triangles[count] = triangles_len;
+    }
+
+    usize const jobs_len =
+        (triangles_len + OCCLUSION_TRIANGLES_PER_JOB - 1) / OCCLUSION_TRIANGLES_PER_JOB;
+    scratch->screen_triangles = reserve(
+        scratch->screen_triangles,
+        &scratch->screen_triangles_capacity,
+        2 * triangles_len,
+        sizeof(ScreenTriangle),
+        err);
+    scratch->jobs_triangles_len = reserve(
+        scratch->jobs_triangles_len,
+        &scratch->jobs_triangles_len_capacity,
+        jobs_len,
+        sizeof(usize),
+        err);
+
+    if (*err) {
+        memset(buffer->levels[0], 0, get_levels_len() * sizeof(f32));
+        return;
+    }
+
+    scratch->occluders = occluders;
+    scratch->triangles_len = triangles_len;
+    scratch->jobs_len = jobs_len;
+    memcpy(scratch->levels, buffer->levels, sizeof(scratch->levels));
+
+    run_jobs(setup_triangles_job, scratch, jobs_len);
+    run_jobs(rasterize_band_job, scratch, OCCLUSION_HEIGHT / OCCLUSION_BAND_HEIGHT);
+
+    usize screen_triangles_len = 0;
+    for (usize j = 0; j < jobs_len; ++j) {
+        screen_triangles_len += scratch->jobs_triangles_len[j];
+    }
+
+    buffer->stats = (OcclusionStats) {
+        .occluders = count,
+        .triangles = screen_triangles_len,
+        .rasterize_ms = get_time_ms() - start_ms,
+    };
+}
+
+//
+// Occlusion queries.
+//
+
+bool is_aabb_occluded(OcclusionBuffer const *buffer, Aabb const aabb) {
+    if (aabb.max.x < aabb.min.x) { return false; }
+
+    vec2 min = { +FLT_MAX, +FLT_MAX };
+    vec2 max = { -FLT_MAX, -FLT_MAX };
+    f32 nearest = 0; // @Note: as 1 / w, like the buffer's texels
+
+    for (int corner = 0; corner < 8; ++corner) {
+        vec3 const p = {
+            (corner & 1) ? aabb.max.x : aabb.min.x,
+            (corner & 2) ? aabb.max.y : aabb.min.y,
+            (corner & 4) ? aabb.max.z : aabb.min.z,
+        };
+        vec4 const clip = mat4_mul_vec4(buffer->world_to_clip, vec4_from_vec3(p, 1));
+        if (clip.z < -clip.w || !(clip.w > 0)) { return false; } // @Note: crosses the near plane
+
+        f32 const rcp_w = 1 / clip.w;
+        f32 const x = (0.5f * clip.x * rcp_w + 0.5f) * OCCLUSION_WIDTH;
+        f32 const y = (0.5f * clip.y * rcp_w + 0.5f) * OCCLUSION_HEIGHT;
+        min = (vec2) { MIN(min.x, x), MIN(min.y, y) };
+        max = (vec2) { MAX(max.x, x), MAX(max.y, y) };
+        nearest = MAX(nearest, rcp_w);
+    }
+
+    // @Note: boxes outside of the screen are left for frustum culling to reject.
+    if (max.x < 0 || min.x >= OCCLUSION_WIDTH || max.y < 0 || min.y >= OCCLUSION_HEIGHT) {
+        return false;
+    }
+
+    int const x0 = (int) MAX(floorf(min.x), 0);
+    int const x1 = (int) MIN(floorf(max.x), OCCLUSION_WIDTH - 1);
+    int const y0 = (int) MAX(floorf(min.y), 0);
+    int const y1 = (int) MIN(floorf(max.y), OCCLUSION_HEIGHT - 1);
+
+    // @Note: a coarse texel also covers pixels around the box, so when a level can't tell that
+    // it is occluded the next (finer) one may still do so, as long as it isn't too many texels.
+    for (int level = OCCLUSION_LEVELS - 1; level >= 0; --level) {
+        int const lx0 = x0 >> level, lx1 = x1 >> level;
+        int const ly0 = y0 >> level, ly1 = y1 >> level;
+        if ((lx1 - lx0 + 1) * (ly1 - ly0 + 1) > OCCLUSION_TEST_TEXELS_MAX) { break; }
+
+        int const width = OCCLUSION_WIDTH >> level;
+        f32 const *texels = buffer->levels[level];
+
+        f32 farthest = FLT_MAX;
+        for (int y = ly0; y <= ly1; ++y) {
+            for (int x = lx0; x <= lx1; ++x) { farthest = MIN(farthest, texels[y * width + x]); }
+        }
+        if (farthest > nearest) { return true; }
+    }
+
+    return false;
+}
+
+//
+// Headless benchmark.
+//
+
+/* clang-format off */
+static vec3 const cube_positions[8] = {
+    { -1, -1, -1 }, { +1, -1, -1 }, { -1, +1, -1 }, { +1, +1, -1 },
+    { -1, -1, +1 }, { +1, -1, +1 }, { -1, +1, +1 }, { +1, +1, +1 },
+};
+static uint const cube_indices[36] = {
+    0, 2, 1, 1, 2, 3, // -z
+    4, 5, 6, 5, 7, 6, // +z
+    0, 4, 2, 2, 4, 6, // -x
+    1, 3, 5, 3, 7, 5, // +x
+    0, 1, 4, 1, 5, 4, // -y
+    2, 6, 3, 3, 6, 7, // +y
+};
+/* clang-format on */
+
+// @Note: a single wall five units in front of the camera, and a few boxes whose answer is
+// known, so that a broken rasterizer (or hierarchy) is caught before it's timed.
+static void check_occlusion(OcclusionBuffer *buffer, mat4 const world_to_clip, Err *err) {
+    if (*err) { return; }
+
+    OccluderMesh const wall = {
+        .positions = cube_positions,
+        .stride = sizeof(vec3),
+        .indices = cube_indices,
+        .indices_len = ARRAY_LEN(cube_indices),
+        .local_to_world = mat4_mul(
+            mat4_translate((vec3) { 0, 0, -5 }), mat4_scale((vec3) { 4, 4, 0.25f })),
+    };
+    rasterize_occluders(buffer, world_to_clip, &wall, 1, err);
+    if (*err) { return; }
+
+    struct {
+        char const *name;
+        vec3 center;
+        bool is_occluded;
+    } const cases[] = {
+        { "behind the wall", { 0, 0, -20 }, true },
+        { "beside the wall", { 18, 0, -20 }, false },
+        { "in front of the wall", { 0, 0, -2 }, false },
+        { "around the camera", { 0, 0, 0 }, false },
+    };
+
+    for (usize i = 0; i < ARRAY_LEN(cases); ++i) {
+        vec3 const extent = { 0.5f, 0.5f, 0.5f };
+        Aabb const box = { vec3_sub(cases[i].center, extent), vec3_add(cases[i].center, extent) };
+        bool const is_occluded = is_aabb_occluded(buffer, box);
+        if (is_occluded != cases[i].is_occluded) {
+            GLOW_ERROR(
+                "occlusion self-check: the box %s was%s reported as occluded",
+                cases[i].name,
+                is_occluded ? "" : "n't");
+            *err = Err_Occlusion_Check;
+        }
+    }
+}
+
+void bench_occlusion(int frames, Err *err) {
+    if (*err) { return; }
+
+    // @Note: four walls (with gaps in between them) ten units in front of the camera, and a
+    // grid of small boxes that starts in front of them and goes on far behind.
+    OccluderMesh walls[4];
+    for (usize i = 0; i < ARRAY_LEN(walls); ++i) {
+        vec3 const position = { -6.0f + 4.0f * (f32) i, 0, -10 };
+        walls[i] = (OccluderMesh) {
+            .positions = cube_positions,
+            .stride = sizeof(vec3),
+            .indices = cube_indices,
+            .indices_len = ARRAY_LEN(cube_indices),
+            .local_to_world =
+                mat4_mul(mat4_translate(position), mat4_scale((vec3) { 1.5f, 4, 0.25f })),
+        };
+    }
+
+    usize const boxes_x = 32;
+    usize const boxes_z = 32;
+    Aabb *boxes = calloc(boxes_x * boxes_z, sizeof(Aabb));
+    if (!boxes) {
+        *err = Err_Calloc;
+        return;
+    }
+    for (usize z = 0; z < boxes_z; ++z) {
+        for (usize x = 0; x < boxes_x; ++x) {
+            vec3 const center = { (f32) x - 0.5f * (f32) boxes_x, 0, -4.0f - (f32) z };
+            boxes[z * boxes_x + x] = (Aabb) {
+                vec3_sub(center, (vec3) { 0.25f, 0.25f, 0.25f }),
+                vec3_add(center, (vec3) { 0.25f, 0.25f, 0.25f }),
+            };
+        }
+    }
+
+    OcclusionBuffer buffer = alloc_occlusion_buffer(err);
+
+    f32 const aspect = (f32) OCCLUSION_WIDTH / (f32) OCCLUSION_HEIGHT;
+    mat4 const world_to_clip = mat4_mul(
+        mat4_perspective((f32) RADIANS_FROM_DEGREES(60), aspect, 0.1f, 100.0f),
+        mat4_lookat((vec3) { 0, 0, 0 }, (vec3) { 0, 0, -1 }, (vec3) { 0, 1, 0 }));
+    check_occlusion(&buffer, world_to_clip, err);
+
+    f64 rasterize_ms = 0;
+    f64 test_ms = 0;
+    usize occluded = 0;
+    for (int frame = 0; frame < frames && !*err; ++frame) {
+        rasterize_occluders(&buffer, world_to_clip, walls, ARRAY_LEN(walls), err);
+        rasterize_ms += buffer.stats.rasterize_ms;
+
+        f64 const start_ms = get_time_ms();
+        occluded = 0;
+        for (usize i = 0; i < boxes_x * boxes_z; ++i) {
+            occluded += is_aabb_occluded(&buffer, boxes[i]) ? 1 : 0;
+        }
+        test_ms += get_time_ms() - start_ms;
+    }
+
+    if (!*err && frames > 0) {
+        GLOW_LOG(
+            "Occlusion benchmark: `%d` frames, `%.3f` ms rasterizing `%zu` triangles and `%.3f`"
+            " ms testing `%zu` boxes (`%zu` occluded) per frame, with `%d` job threads",
+            frames,
+            rasterize_ms / frames,
+            buffer.stats.triangles,
+            test_ms / frames,
+            boxes_x * boxes_z,
+            occluded,
+            get_jobs_thread_count());
+    }
+
+    dealloc_occlusion_buffer(&buffer);
+    free(boxes);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "prelude.h"
+
+#include "culling.h"
+#include "maths_types.h"
+
+// @Note: a small depth buffer, that a few large occluders are rasterized into on the CPU (on
+// the job system, four pixels at a time), and whose hierarchy the bounds of everything else are
+// then tested against, so that what is hidden behind them isn't even submitted to the GPU. It
+// doesn't touch OpenGL at all, so it can be run (and timed) headless, see bench_occlusion.
+//
+// Like on the GPU, occluders cover the pixels whose centers are inside of their triangles, so
+// a box that only shows through a gap narrower than a pixel of this buffer may still be culled.
+
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_LEVELS 5 // @Note: each one half the size of the previous, i.e. down to 16x8
+
+// @Note: rows rasterized by each job, which also downsamples them into every coarser level.
+#define OCCLUSION_BAND_HEIGHT 16
+
+typedef struct OccluderMesh {
+    void const *positions; // @Note: vec3s in local space, each `stride` bytes after the last
+    usize stride;
+    uint const *indices; // @Note: triangles, which are drawn regardless of their winding
+    usize indices_len;
+    mat4 local_to_world;
+} OccluderMesh;
+
+typedef struct OcclusionStats {
+    usize occluders;
+    usize triangles; // @Note: that were set up, i.e. after clipping and trivial rejection
+    f64 rasterize_ms; // @Note: wall clock time, which includes waiting on the jobs
+} OcclusionStats;
+
+typedef struct OcclusionScratch OcclusionScratch; // @Note: scratch memory, opaque
+
+typedef struct OcclusionBuffer {
+    // @Note: each level stores 1 / w of the nearest occluder per texel (zero where there is
+    // none), and every coarser level keeps the farthest of the texels it covers in the previous
+    // one, so a texel of any of them is never nearer than what actually occludes its area.
+    f32 *levels[OCCLUSION_LEVELS]; // @Ownership (as a single allocation, starting at levels[0])
+    mat4 world_to_clip; // @Note: of the last rasterize_occluders call
+
+    OcclusionStats stats; // @Note: of the last rasterize_occluders call
+    OcclusionScratch *scratch; // @Ownership
+} OcclusionBuffer;
+
+OcclusionBuffer alloc_occlusion_buffer(Err *err);
+void dealloc_occlusion_buffer(OcclusionBuffer *buffer);
+
+// @Note: expects the matrix to map to GL clip space (with -w <= z <= w). Triangles are clipped
+// against the near plane, so the occluders may surround the camera. If it fails (i.e. runs out
+// of memory) the buffer is left empty, so that nothing is reported as occluded.
+void rasterize_occluders(
+    OcclusionBuffer *buffer,
+    mat4 const world_to_clip,
+    OccluderMesh const occluders[],
+    usize count,
+    Err *err);
+
+// @Note: tests the box's screen rectangle, from the coarsest level that covers it with a few
+// texels down to finer ones, and returns true only if all of it is behind the occluders (boxes
+// that cross the near plane never are).
+bool is_aabb_occluded(OcclusionBuffer const *buffer, Aabb const aabb);
+
+// @Note: rasterizes a synthetic scene (a few walls in front of a grid of boxes) for a number of
+// frames and logs how long it took, without needing a window nor a GL context. It first checks
+// a few boxes whose answer is known, and fails with Err_Occlusion_Check if any is wrong.
+void bench_occlusion(int frames, Err *err);
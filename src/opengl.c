@@ -1,8 +1,11 @@
 #include "opengl.h"
 
 #include "console.h"
+#include "jobs.h"
 #include "maths.h"
 
+#include <limits.h>
+
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 
@@ -63,6 +66,26 @@ static void error_callback(int error, char const *description) {
     GLOW_WARNING("glfw error %d: `%s`", error, description);
 }
 
+#define SHARED_CONTEXTS_MAX 8
+
+static GLFWwindow *main_window = NULL;
+static GLFWwindow *shared_windows[SHARED_CONTEXTS_MAX] = { 0 };
+static int shared_windows_len = 0;
+
+static void create_shared_contexts(GLFWwindow *window, int count) {
+    // @Note: the other window hints are kept, so that the contexts match the main one.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    DEFER (glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE)) {
+        for (int i = 0; i < MIN(count, SHARED_CONTEXTS_MAX); ++i) {
+            GLFWwindow *shared_window = glfwCreateWindow(1, 1, "glow (shared)", NULL, window);
+            if (!shared_window) { break; }
+            shared_windows[shared_windows_len++] = shared_window;
+        }
+    }
+
+    GLOW_LOG("Created %d shared contexts for shader compilation", shared_windows_len);
+}
+
 GLFWwindow *init_opengl(WindowSettings const settings, Err *err) {
     if (*err) { return NULL; }
 
@@ -126,14 +149,258 @@ GLFWwindow *init_opengl(WindowSettings const settings, Err *err) {
     GLOW_LOG("GL_VERSION = %s", (char *) glGetString(GL_VERSION));
     GLOW_LOG("GL_RENDERER = %s", (char *) glGetString(GL_RENDERER));
 
+    main_window = window;
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xffffffffu); // @Note: let the driver choose the count
+    } else if (get_jobs_thread_count() > 1) {
+        create_shared_contexts(window, get_jobs_thread_count());
+    }
+
+    invalidate_gl_state();
+
     return window;
 }
 
 void deinit_opengl(GLFWwindow *window) {
+    for (int i = 0; i < shared_windows_len; ++i) { glfwDestroyWindow(shared_windows[i]); }
+    shared_windows_len = 0;
+    main_window = NULL;
+
     glfwDestroyWindow(window);
     glfwTerminate();
 }
 
+int get_shared_contexts_len(void) {
+    return shared_windows_len;
+}
+
+void make_shared_context_current(int index) {
+    assert(index < shared_windows_len);
+    glfwMakeContextCurrent(index < 0 ? NULL : shared_windows[index]);
+}
+
+void make_main_context_current(void) {
+    glfwMakeContextCurrent(main_window);
+}
+
+//
+// State tracking.
+//
+
+#define GL_STATE_UNKNOWN UINT_MAX // @Note: never a valid object name, so it always mismatches
+
+// @Volatile: keep in sync with get_texture_target_index.
+#define GL_STATE_TEXTURE_TARGETS 6
+
+// @Volatile: keep in sync with get_capability_index.
+#define GL_STATE_CAPABILITIES 8
+
+static struct {
+    uint program;
+    uint vertex_array;
+    uint read_framebuffer;
+    uint draw_framebuffer;
+    uint active_texture; // @Note: as a unit index (i.e. without GL_TEXTURE0)
+    uint textures[GL_STATE_TEXTURE_UNITS][GL_STATE_TEXTURE_TARGETS];
+    uint capabilities[GL_STATE_CAPABILITIES]; // @Note: 0, 1, or GL_STATE_UNKNOWN
+    GlStateStats stats;
+} gl_state;
+
+static int get_texture_target_index(uint target) {
+    switch (target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_CUBE_MAP: return 1;
+        case GL_TEXTURE_2D_ARRAY: return 2;
+        case GL_TEXTURE_3D: return 3;
+        case GL_TEXTURE_BUFFER: return 4;
+        case GL_TEXTURE_2D_MULTISAMPLE: return 5;
+        default: return -1;
+    }
+}
+
+static int get_capability_index(uint capability) {
+    switch (capability) {
+        case GL_DEPTH_TEST: return 0;
+        case GL_STENCIL_TEST: return 1;
+        case GL_CULL_FACE: return 2;
+        case GL_BLEND: return 3;
+        case GL_SCISSOR_TEST: return 4;
+        case GL_FRAMEBUFFER_SRGB: return 5;
+        case GL_POLYGON_OFFSET_FILL: return 6;
+        case GL_MULTISAMPLE: return 7;
+        default: return -1;
+    }
+}
+
+// @Note: returns true if the call is redundant (i.e. if it should be filtered out).
+static bool update_gl_state(uint *shadow, uint value, GlStateCounter *counter) {
+    counter->calls += 1;
+    if (*shadow == value) {
+        counter->filtered += 1;
+        return true;
+    }
+    *shadow = value;
+    return false;
+}
+
+void invalidate_gl_state(void) {
+    gl_state.program = GL_STATE_UNKNOWN;
+    gl_state.vertex_array = GL_STATE_UNKNOWN;
+    gl_state.read_framebuffer = GL_STATE_UNKNOWN;
+    gl_state.draw_framebuffer = GL_STATE_UNKNOWN;
+    gl_state.active_texture = GL_STATE_UNKNOWN;
+    for (usize i = 0; i < GL_STATE_TEXTURE_UNITS; ++i) {
+        for (usize j = 0; j < GL_STATE_TEXTURE_TARGETS; ++j) {
+            gl_state.textures[i][j] = GL_STATE_UNKNOWN;
+        }
+    }
+    for (usize i = 0; i < GL_STATE_CAPABILITIES; ++i) {
+        gl_state.capabilities[i] = GL_STATE_UNKNOWN;
+    }
+}
+
+GlStateStats get_gl_state_stats(void) {
+    return gl_state.stats;
+}
+
+void reset_gl_state_stats(void) {
+    gl_state.stats = (GlStateStats) { 0 };
+}
+
+void bind_gl_program(uint program) {
+    if (update_gl_state(&gl_state.program, program, &gl_state.stats.programs)) { return; }
+    glUseProgram(program);
+}
+
+void bind_gl_vertex_array(uint vao) {
+    if (update_gl_state(&gl_state.vertex_array, vao, &gl_state.stats.vertex_arrays)) { return; }
+    glBindVertexArray(vao);
+}
+
+void bind_gl_framebuffer(uint target, uint framebuffer) {
+    GlStateCounter *counter = &gl_state.stats.framebuffers;
+
+    if (target == GL_FRAMEBUFFER) {
+        bool const is_redundant = gl_state.read_framebuffer == framebuffer
+                                  && gl_state.draw_framebuffer == framebuffer;
+        counter->calls += 1;
+        counter->filtered += is_redundant ? 1 : 0;
+        if (is_redundant) { return; }
+        gl_state.read_framebuffer = framebuffer;
+        gl_state.draw_framebuffer = framebuffer;
+    } else {
+        assert(target == GL_READ_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER);
+        uint *shadow = target == GL_READ_FRAMEBUFFER ? &gl_state.read_framebuffer
+                                                     : &gl_state.draw_framebuffer;
+        if (update_gl_state(shadow, framebuffer, counter)) { return; }
+    }
+
+    glBindFramebuffer(target, framebuffer);
+}
+
+void bind_gl_texture(uint texture_unit, uint target, uint texture) {
+    assert(texture_unit >= GL_TEXTURE0);
+    uint const unit = texture_unit - GL_TEXTURE0;
+    int const target_index = get_texture_target_index(target);
+
+    if (unit < GL_STATE_TEXTURE_UNITS && target_index != -1) {
+        uint *shadow = &gl_state.textures[unit][target_index];
+        if (update_gl_state(shadow, texture, &gl_state.stats.textures)) { return; }
+    } else {
+        gl_state.stats.textures.calls += 1; // @Note: untracked, so it can't be filtered
+    }
+
+    if (gl_state.active_texture != unit) {
+        gl_state.active_texture = unit;
+        glActiveTexture(texture_unit);
+    }
+    glBindTexture(target, texture);
+}
+
+void set_gl_capability(uint capability, bool is_enabled) {
+    int const index = get_capability_index(capability);
+    if (index != -1) {
+        uint *shadow = &gl_state.capabilities[index];
+        if (update_gl_state(shadow, is_enabled, &gl_state.stats.capabilities)) { return; }
+    } else {
+        gl_state.stats.capabilities.calls += 1;
+    }
+
+    if (is_enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+}
+
+// @Note: deleting a bound object reverts the binding to 0 (except for programs in use, which
+// are only flagged for deletion), either way we simply stop assuming anything about it.
+void forget_gl_program(uint program) {
+    if (gl_state.program == program) { gl_state.program = GL_STATE_UNKNOWN; }
+}
+
+void forget_gl_vertex_array(uint vao) {
+    if (gl_state.vertex_array == vao) { gl_state.vertex_array = GL_STATE_UNKNOWN; }
+}
+
+void forget_gl_framebuffer(uint framebuffer) {
+    uint *const shadows[2] = { &gl_state.read_framebuffer, &gl_state.draw_framebuffer };
+    for (usize i = 0; i < 2; ++i) {
+        if (*shadows[i] == framebuffer) { *shadows[i] = GL_STATE_UNKNOWN; }
+    }
+}
+
+void forget_gl_texture(uint texture) {
+    for (usize i = 0; i < GL_STATE_TEXTURE_UNITS; ++i) {
+        for (usize j = 0; j < GL_STATE_TEXTURE_TARGETS; ++j) {
+            uint *shadow = &gl_state.textures[i][j];
+            if (*shadow == texture) { *shadow = GL_STATE_UNKNOWN; }
+        }
+    }
+}
+
+//
+// GPU timers.
+//
+
+GlTimer create_gl_timer(void) {
+    GlTimer timer = { 0 };
+    glGenQueries(GL_TIMER_QUERIES_LEN, timer.queries);
+    return timer;
+}
+
+void destroy_gl_timer(GlTimer *timer) {
+    glDeleteQueries(GL_TIMER_QUERIES_LEN, timer->queries);
+    *timer = (GlTimer) { 0 };
+}
+
+void begin_gl_timer(GlTimer *timer) {
+    usize const index = timer->begun_len % GL_TIMER_QUERIES_LEN;
+
+    // @Note: read the result of the query that we're about to reuse, if it's already available.
+    if (timer->begun_len >= GL_TIMER_QUERIES_LEN) {
+        int is_available = 0;
+        glGetQueryObjectiv(timer->queries[index], GL_QUERY_RESULT_AVAILABLE, &is_available);
+        if (is_available) {
+            u64 elapsed_ns = 0;
+            glGetQueryObjectui64v(timer->queries[index], GL_QUERY_RESULT, &elapsed_ns);
+            timer->elapsed_ms = (f64) elapsed_ns / 1e6;
+        }
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, timer->queries[index]);
+    timer->begun_len += 1;
+}
+
+void end_gl_timer(GlTimer *timer) {
+    UNUSED(timer);
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+//
+// Miscellaneous.
+//
+
 bool check_bound_framebuffer_is_complete(void) {
     int const status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (status == GL_FRAMEBUFFER_COMPLETE) { return true; }
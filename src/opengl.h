@@ -19,6 +19,80 @@ typedef struct WindowSettings {
 GLFWwindow *init_opengl(WindowSettings const settings, Err *err);
 void deinit_opengl(GLFWwindow *window);
 
+// @Note: when the driver can't compile shaders in the background on its own (i.e. without
+// KHR_parallel_shader_compile), we create hidden windows whose contexts share objects with
+// the main one, so that worker threads can compile them instead (one context per thread).
+int get_shared_contexts_len(void);
+void make_shared_context_current(int index); // @Note: a negative index releases it
+void make_main_context_current(void);
+
+//
+// State tracking.
+//
+
+// @Note: shadows the bound program, vertex array, framebuffers, textures (per unit and target)
+// and enabled capabilities of the main context, so that binding what is already bound never
+// reaches the driver. Code that changes them directly (e.g. glBindTexture) must be followed by
+// invalidate_gl_state(), and deleted objects have to be forgotten, as their names are reused.
+
+#define GL_STATE_TEXTURE_UNITS 32
+
+typedef struct GlStateCounter {
+    usize calls;
+    usize filtered; // @Note: redundant calls that were skipped
+} GlStateCounter;
+
+typedef struct GlStateStats {
+    GlStateCounter programs;
+    GlStateCounter vertex_arrays;
+    GlStateCounter framebuffers;
+    GlStateCounter textures;
+    GlStateCounter capabilities;
+} GlStateStats;
+
+void invalidate_gl_state(void);
+
+// @Note: the counters accumulate until they're reset (e.g. once per frame).
+GlStateStats get_gl_state_stats(void);
+void reset_gl_state_stats(void);
+
+void bind_gl_program(uint program);
+void bind_gl_vertex_array(uint vao);
+void bind_gl_framebuffer(uint target, uint framebuffer); // @Note: GL_FRAMEBUFFER binds both
+void bind_gl_texture(uint texture_unit, uint target, uint texture); // GL_TEXTURE0 + unit
+void set_gl_capability(uint capability, bool is_enabled);
+
+void forget_gl_program(uint program);
+void forget_gl_vertex_array(uint vao);
+void forget_gl_framebuffer(uint framebuffer);
+void forget_gl_texture(uint texture);
+
+//
+// GPU timers.
+//
+
+// @Note: measures the GPU time between begin and end with GL_TIME_ELAPSED queries, which are only
+// read back GL_TIMER_QUERIES_LEN frames later (so that we never stall waiting on them). As there
+// can only be one of these queries active at a time, timers can't be nested or interleaved.
+
+#define GL_TIMER_QUERIES_LEN 4
+
+typedef struct GlTimer {
+    uint queries[GL_TIMER_QUERIES_LEN];
+    usize begun_len; // @Note: how many times it was begun (so which query is next)
+    f64 elapsed_ms; // @Note: of the latest query whose result is available
+} GlTimer;
+
+GlTimer create_gl_timer(void);
+void destroy_gl_timer(GlTimer *timer);
+
+void begin_gl_timer(GlTimer *timer);
+void end_gl_timer(GlTimer *timer);
+
+//
+// Miscellaneous.
+//
+
 bool check_bound_framebuffer_is_complete(void);
 
 bool is_shader_compile_success(uint shader, char info_log[INFO_LOG_LENGTH], Err *err);
@@ -94,6 +94,9 @@ Options parse_args(int argc, char *argv[]) {
         assert(strlen(arg_m) <= 2);
         options.msaa = atoi(arg_m);
     }
+    if (arg_j) { options.jobs = atoi(arg_j); }
+    if (arg_l) { options.lights = atoi(arg_l); }
+    if (arg_b) { options.bench_occlusion = atoi(arg_b); }
 
     return options;
 }
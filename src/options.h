@@ -7,6 +7,9 @@ typedef struct Options {
     bool vsync;
     bool no_ui;
     int msaa;
+    int jobs;
+    int lights;
+    int bench_occlusion; // @Note: number of frames, if positive
 } Options;
 
 Options parse_args(int argc, char *argv[]);
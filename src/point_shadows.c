@@ -0,0 +1,527 @@
+#include "point_shadows.h"
+
+#include "console.h"
+#include "maths.h"
+#include "opengl.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <glad/glad.h>
+
+STATIC_ASSERT(
+    (POINT_SHADOW_ATLAS_SIZE >> (POINT_SHADOW_ATLAS_LEVELS - 1)) == POINT_SHADOW_TILE_MIN);
+STATIC_ASSERT(POINT_SHADOW_ATLAS_NODES <= UINT16_MAX);
+STATIC_ASSERT(POINT_SHADOW_FACES <= 8); // @Note: a bit per face (see PointShadow)
+
+#define ALL_FACES ((u8) ((1 << POINT_SHADOW_FACES) - 1))
+
+// @Note: lights that are already shadowed need to cover this much more of the screen than
+// another one to be replaced by it, so that lights of similar sizes don't trade places.
+#define ASSIGNED_COVERAGE_BIAS 1.25f
+
+// @Note: how far (in powers of two) a light's coverage has to drift from its tile size before
+// it's resized, so that lights close to halfway between two sizes don't keep being resized.
+#define TILE_SIZE_HYSTERESIS 0.75f
+
+enum { TILE_FREE = 0, TILE_SPLIT, TILE_USED };
+
+// @Note: the same faces (and orientations) as a GL cube map's.
+// @Volatile: keep in sync with point_shadows.glsl.
+static vec3 const face_forwards[POINT_SHADOW_FACES] = {
+    { +1, 0, 0 }, { -1, 0, 0 }, { 0, +1, 0 }, { 0, -1, 0 }, { 0, 0, +1 }, { 0, 0, -1 },
+};
+static vec3 const face_ups[POINT_SHADOW_FACES] = {
+    { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, +1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 },
+};
+
+PointShadows create_point_shadows(void) {
+    PointShadows shadows = { 0 };
+
+    // @Note: filtered linearly, so that each compared fetch is a 2x2 PCF in hardware.
+    glGenTextures(1, &shadows.texture);
+    bind_gl_texture(GL_TEXTURE0, GL_TEXTURE_2D, shadows.texture);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_DEPTH_COMPONENT32F,
+        POINT_SHADOW_ATLAS_SIZE,
+        POINT_SHADOW_ATLAS_SIZE,
+        0,
+        GL_DEPTH_COMPONENT,
+        GL_FLOAT,
+        NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    glGenFramebuffers(1, &shadows.framebuffer);
+    bind_gl_framebuffer(GL_FRAMEBUFFER, shadows.framebuffer);
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadows.texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    check_bound_framebuffer_is_complete();
+    bind_gl_framebuffer(GL_FRAMEBUFFER, 0);
+
+    return shadows;
+}
+
+void destroy_point_shadows(PointShadows *shadows) {
+    forget_gl_framebuffer(shadows->framebuffer);
+    glDeleteFramebuffers(1, &shadows->framebuffer);
+
+    forget_gl_texture(shadows->texture);
+    glDeleteTextures(1, &shadows->texture);
+
+    *shadows = (PointShadows) { 0 };
+}
+
+//
+// Atlas (a quadtree, whose children of node n are the nodes 4n + 1 to 4n + 4).
+//
+
+static int get_tile_level(int tile_size) {
+    int level = 0;
+    while ((POINT_SHADOW_ATLAS_SIZE >> level) > tile_size) { ++level; }
+    return level;
+}
+
+// @Note: the children are in Morton order, so each one's index is a bit of x and a bit of y.
+static void get_tile_rect(usize node, int *x, int *y, int *size) {
+    int level = 0;
+    *x = 0;
+    *y = 0;
+    while (node > 0) {
+        usize const child = (node - 1) & 3;
+        *x |= (int) (child & 1) << level;
+        *y |= (int) (child >> 1) << level;
+        node = (node - 1) >> 2;
+        ++level;
+    }
+
+    *size = POINT_SHADOW_ATLAS_SIZE >> level;
+    *x *= *size;
+    *y *= *size;
+}
+
+// @Note: returns the node of a free tile at the level (or zero if there's none), preferring
+// nodes that are already split, so that larger free tiles are kept whole for as long as possible.
+static usize allocate_tile(u8 atlas[], usize node, int level, int tile_level) {
+    if (level == tile_level) {
+        if (atlas[node] != TILE_FREE) { return 0; }
+        atlas[node] = TILE_USED;
+        return node;
+    }
+
+    if (atlas[node] == TILE_USED) { return 0; }
+    if (atlas[node] == TILE_FREE) {
+        atlas[node] = TILE_SPLIT; // @Note: so every child is free
+        return allocate_tile(atlas, 4 * node + 1, level + 1, tile_level);
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (usize i = 0; i < 4; ++i) {
+            usize const child = 4 * node + 1 + i;
+            if ((atlas[child] == TILE_FREE) != (pass == 1)) { continue; }
+
+            usize const tile = allocate_tile(atlas, child, level + 1, tile_level);
+            if (tile != 0) { return tile; }
+        }
+    }
+    return 0;
+}
+
+// @Note: merges the tile back into its parents for as long as all of their children are free.
+static void free_tile(u8 atlas[], usize node) {
+    atlas[node] = TILE_FREE;
+    while (node > 0) {
+        usize const parent = (node - 1) >> 2;
+        for (usize i = 0; i < 4; ++i) {
+            if (atlas[4 * parent + 1 + i] != TILE_FREE) { return; }
+        }
+        atlas[parent] = TILE_FREE;
+        node = parent;
+    }
+}
+
+static void free_shadow_tiles(PointShadows *shadows, PointShadow *shadow) {
+    if (shadow->tile_size == 0) { return; }
+    for (usize f = 0; f < POINT_SHADOW_FACES; ++f) {
+        free_tile(shadows->atlas, shadow->tiles[f]);
+    }
+    shadow->tile_size = 0;
+}
+
+// @Note: falls back to smaller tiles when the atlas has no room left for the desired size, and
+// returns whether it found room at all (in which case the shadow has no tiles).
+static bool allocate_shadow_tiles(PointShadows *shadows, PointShadow *shadow) {
+    free_shadow_tiles(shadows, shadow);
+
+    for (int size = shadow->desired_tile_size; size >= POINT_SHADOW_TILE_MIN; size /= 2) {
+        int const tile_level = get_tile_level(size);
+
+        usize f = 0;
+        for (; f < POINT_SHADOW_FACES; ++f) {
+            usize const tile = allocate_tile(shadows->atlas, 0, 0, tile_level);
+            if (tile == 0) { break; }
+            shadow->tiles[f] = (u16) tile;
+        }
+
+        if (f == POINT_SHADOW_FACES) {
+            shadow->tile_size = size;
+            return true;
+        }
+        while (f > 0) { free_tile(shadows->atlas, shadow->tiles[--f]); }
+    }
+    return false;
+}
+
+//
+// Scheduling.
+//
+
+static usize count_faces(u8 faces) {
+    usize count = 0;
+    for (; faces != 0; faces &= (u8) (faces - 1)) { ++count; }
+    return count;
+}
+
+// @Note: the radius of the light's sphere on screen, in pixels (or the viewport's height if the
+// view is inside of it).
+static f32 compute_coverage(PointShadowView const *view, vec3 const position, f32 radius) {
+    f32 const distance = vec3_length(vec3_sub(position, view->position));
+    if (distance <= radius) { return view->height; }
+
+    f32 const tan_radius = radius / sqrtf(distance * distance - radius * radius);
+    return MIN(0.5f * view->height * tan_radius / tanf(0.5f * view->fovy), view->height);
+}
+
+// @Note: a tile is about as large as the light's sphere is on screen (as each face sees about
+// its diameter), rounded to a power of two, and only resized once it drifted far enough.
+static int choose_tile_size(f32 coverage, int tile_size) {
+    f32 const ideal = CLAMP(2.0f * coverage, POINT_SHADOW_TILE_MIN, POINT_SHADOW_TILE_MAX);
+    if (tile_size != 0 && fabsf(log2f(ideal / (f32) tile_size)) <= TILE_SIZE_HYSTERESIS) {
+        return tile_size;
+    }
+    return 1 << (int) roundf(log2f(ideal));
+}
+
+static bool aabb_overlaps_sphere(Aabb const aabb, vec3 const center, f32 radius) {
+    vec3 const closest = {
+        CLAMP(center.x, aabb.min.x, aabb.max.x),
+        CLAMP(center.y, aabb.min.y, aabb.max.y),
+        CLAMP(center.z, aabb.min.z, aabb.max.z),
+    };
+    vec3 const offset = vec3_sub(closest, center);
+    return vec3_dot(offset, offset) <= radius * radius;
+}
+
+// @Note: the faces of the (rendered) shadow that the bounds are inside of.
+static u8 find_faces_overlapping(PointShadow const *shadow, Aabb const aabb) {
+    if (!aabb_overlaps_sphere(aabb, shadow->position, shadow->radius)) { return 0; }
+
+    u8 faces = 0;
+    for (usize f = 0; f < POINT_SHADOW_FACES; ++f) {
+        Frustum const frustum = compute_frustum(shadow->world_to_faces[f]);
+        bool visible;
+        if (cull_aabbs(&frustum, &aabb, &visible, 1) > 0) { faces |= (u8) (1 << f); }
+    }
+    return faces;
+}
+
+// @Note: the field of view is widened so that the border around the face's 90 degrees is
+// rendered too (see get_point_shadow_uniforms).
+static void fit_shadow_faces(PointShadow *shadow, vec3 const position, f32 radius) {
+    f32 const tan_half_fov = (f32) shadow->tile_size
+                             / (f32) (shadow->tile_size - 2 * POINT_SHADOW_BORDER);
+    mat4 const face_to_clip =
+        mat4_perspective(2.0f * atanf(tan_half_fov), 1.0f, POINT_SHADOW_NEAR, radius);
+
+    for (usize f = 0; f < POINT_SHADOW_FACES; ++f) {
+        mat4 const world_to_face =
+            mat4_lookat(position, vec3_add(position, face_forwards[f]), face_ups[f]);
+        shadow->world_to_faces[f] = mat4_mul(face_to_clip, world_to_face);
+    }
+    shadow->position = position;
+    shadow->radius = radius;
+}
+
+// @Note: whether a should be rendered before b, i.e. lights that aren't shadowed yet, then those
+// that have waited the longest, then those that cover the most of the screen.
+static bool is_more_urgent(PointShadow const *a, PointShadow const *b) {
+    if (a->is_rendered != b->is_rendered) { return !a->is_rendered; }
+    if (a->dirty_frames != b->dirty_frames) { return a->dirty_frames > b->dirty_frames; }
+    return a->coverage > b->coverage;
+}
+
+// @Note: the `count` lights inside of the view that cover the most of it, in no particular order.
+static usize select_shadowed_lights(
+    PointShadows const *shadows,
+    PointShadowView const *view,
+    vec3 const light_positions[],
+    f32 const light_radii[],
+    usize lights_len,
+    usize count,
+    usize selected[POINT_SHADOWS_MAX],
+    f32 coverages[POINT_SHADOWS_MAX]) {
+    Frustum const frustum = compute_frustum(view->world_to_clip);
+    f32 scores[POINT_SHADOWS_MAX];
+    usize selected_len = 0;
+
+    // @Note: the lights' spheres are culled by their bounds, a batch at a time.
+    enum { BATCH_LEN = 64 };
+    for (usize begin = 0; begin < lights_len && count > 0; begin += BATCH_LEN) {
+        usize const end = MIN(begin + BATCH_LEN, lights_len);
+
+        Aabb bounds[BATCH_LEN];
+        bool visible[BATCH_LEN];
+        for (usize i = begin; i < end; ++i) {
+            vec3 const extent = vec3_of(light_radii[i]);
+            bounds[i - begin] = (Aabb) {
+                vec3_sub(light_positions[i], extent),
+                vec3_add(light_positions[i], extent),
+            };
+        }
+        cull_aabbs(&frustum, bounds, visible, end - begin);
+
+        for (usize i = begin; i < end; ++i) {
+            if (!visible[i - begin]) { continue; }
+
+            f32 const coverage = compute_coverage(view, light_positions[i], light_radii[i]);
+            f32 score = coverage;
+            for (usize s = 0; s < POINT_SHADOWS_MAX; ++s) {
+                PointShadow const *shadow = &shadows->shadows[s];
+                if (shadow->is_assigned && shadow->light == i) {
+                    score *= ASSIGNED_COVERAGE_BIAS;
+                    break;
+                }
+            }
+
+            // @Note: an insertion into the selection, which is sorted by decreasing score.
+            if (selected_len == count && score <= scores[count - 1]) { continue; }
+            usize j = MIN(selected_len, count - 1);
+            for (; j > 0 && scores[j - 1] < score; --j) {
+                selected[j] = selected[j - 1];
+                coverages[j] = coverages[j - 1];
+                scores[j] = scores[j - 1];
+            }
+            selected[j] = i;
+            coverages[j] = coverage;
+            scores[j] = score;
+            selected_len = MIN(selected_len + 1, count);
+        }
+    }
+
+    return selected_len;
+}
+
+void update_point_shadows(
+    PointShadows *shadows,
+    PointShadowView const view,
+    vec3 const light_positions[],
+    f32 const light_radii[],
+    usize lights_len,
+    Aabb const casters[],
+    usize casters_len,
+    usize count,
+    usize budget) {
+    assert(casters_len <= POINT_SHADOW_CASTERS_MAX);
+    count = MIN(count, POINT_SHADOWS_MAX);
+    shadows->lights_changed = false;
+
+    usize selected[POINT_SHADOWS_MAX];
+    f32 coverages[POINT_SHADOWS_MAX];
+    usize const selected_len = select_shadowed_lights(
+        shadows, &view, light_positions, light_radii, lights_len, count, selected, coverages);
+
+    // @Note: lights that are no longer selected free their slots (and tiles) first, so that the
+    // newly selected ones can take them.
+    for (usize s = 0; s < POINT_SHADOWS_MAX; ++s) {
+        PointShadow *shadow = &shadows->shadows[s];
+        if (!shadow->is_assigned) { continue; }
+
+        bool is_selected = false;
+        for (usize i = 0; i < selected_len && !is_selected; ++i) {
+            is_selected = selected[i] == shadow->light;
+        }
+        if (is_selected) { continue; }
+
+        free_shadow_tiles(shadows, shadow);
+        shadows->lights_changed |= shadow->is_rendered;
+        *shadow = (PointShadow) { 0 };
+    }
+
+    for (usize i = 0; i < selected_len; ++i) {
+        PointShadow *shadow = NULL;
+        for (usize s = 0; s < POINT_SHADOWS_MAX && !shadow; ++s) {
+            PointShadow *slot = &shadows->shadows[s];
+            if (slot->is_assigned && slot->light == selected[i]) { shadow = slot; }
+        }
+        for (usize s = 0; s < POINT_SHADOWS_MAX && !shadow; ++s) {
+            PointShadow *slot = &shadows->shadows[s];
+            if (!slot->is_assigned) {
+                shadow = slot;
+                *shadow = (PointShadow) { .light = selected[i], .is_assigned = true };
+                shadow->dirty_faces = ALL_FACES;
+            }
+        }
+        assert(shadow);
+
+        // @Note: a light that moves (or whose radius changes) is rendered again entirely.
+        vec3 const position = light_positions[shadow->light];
+        f32 const radius = light_radii[shadow->light];
+        if (shadow->position.x != position.x || shadow->position.y != position.y
+            || shadow->position.z != position.z || shadow->radius != radius) {
+            shadow->dirty_faces = ALL_FACES;
+        }
+
+        // @Note: and so is a light whose tiles have to be resized.
+        int const tile_size = choose_tile_size(coverages[i], shadow->desired_tile_size);
+        if (tile_size != shadow->desired_tile_size) {
+            shadow->desired_tile_size = tile_size;
+            if (shadow->tile_size != tile_size) { shadow->dirty_faces = ALL_FACES; }
+        }
+        shadow->coverage = coverages[i];
+    }
+
+    // @Note: casters that moved dirty the faces that they were inside of, and those that they
+    // are now inside of (unless their count changed, in which case every face is dirty).
+    for (usize s = 0; s < POINT_SHADOWS_MAX; ++s) {
+        PointShadow *shadow = &shadows->shadows[s];
+        if (!shadow->is_assigned || !shadow->is_rendered) { continue; }
+        if (casters_len != shadows->casters_len) {
+            shadow->dirty_faces = ALL_FACES;
+            continue;
+        }
+
+        for (usize i = 0; i < casters_len && shadow->dirty_faces != ALL_FACES; ++i) {
+            if (memcmp(&casters[i], &shadows->casters[i], sizeof(Aabb)) == 0) { continue; }
+            shadow->dirty_faces |= find_faces_overlapping(shadow, shadows->casters[i]);
+            shadow->dirty_faces |= find_faces_overlapping(shadow, casters[i]);
+        }
+    }
+    if (casters_len > 0) { memcpy(shadows->casters, casters, casters_len * sizeof(Aabb)); }
+    shadows->casters_len = casters_len;
+
+    // @Note: the dirty shadows, from the most urgent to the least (by insertion).
+    PointShadow *dirty[POINT_SHADOWS_MAX];
+    usize dirty_len = 0;
+    for (usize s = 0; s < POINT_SHADOWS_MAX; ++s) {
+        PointShadow *shadow = &shadows->shadows[s];
+        shadow->update_faces = 0;
+        if (!shadow->is_assigned || shadow->dirty_faces == 0) { continue; }
+
+        ++shadow->dirty_frames;
+        usize j = dirty_len++;
+        for (; j > 0 && is_more_urgent(shadow, dirty[j - 1]); --j) { dirty[j] = dirty[j - 1]; }
+        dirty[j] = shadow;
+    }
+
+    // @Note: shadows are scheduled whole (i.e. all of their dirty faces at once) while they fit
+    // into the budget, skipping those that don't fit for smaller ones.
+    usize faces_scheduled = 0;
+    for (usize i = 0; i < dirty_len; ++i) {
+        PointShadow *shadow = dirty[i];
+        usize const faces = count_faces(shadow->dirty_faces);
+        if (faces_scheduled > 0 && faces_scheduled + faces > budget) { continue; }
+
+        vec3 const position = light_positions[shadow->light];
+        f32 const radius = light_radii[shadow->light];
+
+        // @Note: the tiles are only (re)allocated as the shadow is rendered, so that it keeps
+        // its previous ones (and shadows) while it waits.
+        bool const needs_tiles = shadow->tile_size == 0
+                                 || (shadow->dirty_faces == ALL_FACES
+                                     && shadow->tile_size != shadow->desired_tile_size);
+        if (needs_tiles && !allocate_shadow_tiles(shadows, shadow)) {
+            // @Note: it tries again every frame, so it only warns when it starts failing.
+            if (!shadow->is_out_of_tiles) {
+                GLOW_WARNING("failed to allocate the shadow tiles of light `%zu`", shadow->light);
+            }
+            shadow->is_out_of_tiles = true;
+            shadows->lights_changed |= shadow->is_rendered;
+            shadow->is_rendered = false;
+            continue;
+        }
+        shadow->is_out_of_tiles = false;
+
+        fit_shadow_faces(shadow, position, radius);
+        shadows->lights_changed |= !shadow->is_rendered;
+        shadow->is_rendered = true;
+        shadow->update_faces = shadow->dirty_faces;
+        shadow->dirty_faces = 0;
+        shadow->dirty_frames = 0;
+        faces_scheduled += faces;
+    }
+
+    PointShadowStats stats = { 0 };
+    for (usize s = 0; s < POINT_SHADOWS_MAX; ++s) {
+        PointShadow const *shadow = &shadows->shadows[s];
+        stats.lights_shadowed += shadow->is_assigned && shadow->is_rendered;
+        stats.faces_rendered += count_faces(shadow->update_faces);
+        stats.faces_pending += count_faces(shadow->dirty_faces);
+        stats.lights_out_of_tiles += shadow->is_assigned && shadow->is_out_of_tiles;
+        stats.texels_used += (usize) shadow->tile_size * (usize) shadow->tile_size
+                             * POINT_SHADOW_FACES;
+    }
+    shadows->stats = stats;
+}
+
+int get_point_shadow_slot(PointShadows const *shadows, usize light) {
+    for (usize s = 0; s < POINT_SHADOWS_MAX; ++s) {
+        PointShadow const *shadow = &shadows->shadows[s];
+        if (shadow->is_assigned && shadow->is_rendered && shadow->light == light) {
+            return (int) s;
+        }
+    }
+    return -1;
+}
+
+void get_point_shadow_uniforms(
+    PointShadows const *shadows,
+    vec4 spheres[POINT_SHADOWS_MAX],
+    vec4 tiles[POINT_SHADOWS_MAX * POINT_SHADOW_FACES]) {
+    f32 const texel = 1.0f / POINT_SHADOW_ATLAS_SIZE;
+
+    for (usize s = 0; s < POINT_SHADOWS_MAX; ++s) {
+        PointShadow const *shadow = &shadows->shadows[s];
+        bool const is_shadowed = shadow->is_assigned && shadow->is_rendered;
+        spheres[s] =
+            is_shadowed ? vec4_from_vec3(shadow->position, shadow->radius) : (vec4) { 0 };
+
+        for (usize f = 0; f < POINT_SHADOW_FACES; ++f) {
+            vec4 *tile = &tiles[s * POINT_SHADOW_FACES + f];
+            if (!is_shadowed) {
+                *tile = (vec4) { 0 };
+                continue;
+            }
+
+            int x, y, size;
+            get_tile_rect(shadow->tiles[f], &x, &y, &size);
+            *tile = (vec4) {
+                (f32) (x + POINT_SHADOW_BORDER) * texel,
+                (f32) (y + POINT_SHADOW_BORDER) * texel,
+                (f32) (size - 2 * POINT_SHADOW_BORDER) * texel,
+                (f32) size,
+            };
+        }
+    }
+}
+
+void begin_point_shadow_face(PointShadows const *shadows, usize slot, usize face) {
+    assert(slot < POINT_SHADOWS_MAX && face < POINT_SHADOW_FACES);
+    PointShadow const *shadow = &shadows->shadows[slot];
+    assert(shadow->tile_size != 0);
+
+    int x, y, size;
+    get_tile_rect(shadow->tiles[face], &x, &y, &size);
+
+    bind_gl_framebuffer(GL_FRAMEBUFFER, shadows->framebuffer);
+    glViewport(x, y, size, size);
+    glScissor(x, y, size, size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
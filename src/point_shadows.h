@@ -0,0 +1,121 @@
+#pragma once
+
+#include "prelude.h"
+
+#include "culling.h"
+#include "maths_types.h"
+
+// @Note: the omnidirectional shadows of up to POINT_SHADOWS_MAX point lights, those that cover
+// the most of the screen, are rendered into a shared depth atlas. Each light gets six square
+// tiles (one per face of its cube, of a perspective projection with a 90 degree field of view
+// plus a border, so that filtering never reaches into a neighbouring tile), whose size follows
+// how large the light is on screen. Tiles are allocated from a quadtree of the atlas, so they're
+// all powers of two between POINT_SHADOW_TILE_MIN and POINT_SHADOW_TILE_MAX.
+//
+// Shadows are kept across frames, and a face is only rendered again once a caster moves inside
+// of it (or the light itself moves, or its tiles are resized). Those updates are then spread
+// over frames: each frame renders at most a budget of faces, starting with the lights that
+// aren't shadowed yet, then those that have waited the longest. A light that waits keeps the
+// shadows that it was last rendered with (see PointShadow), and a light is only shadowed once
+// all of its faces were rendered.
+
+#define POINT_SHADOWS_MAX 16 // @Volatile: injected into the lighting passes
+#define POINT_SHADOW_FACES 6
+#define POINT_SHADOW_ATLAS_SIZE 4096
+#define POINT_SHADOW_TILE_MIN 64
+#define POINT_SHADOW_TILE_MAX 512
+#define POINT_SHADOW_BORDER 2 // @Note: in texels, on each side of a tile
+#define POINT_SHADOW_NEAR 0.05f // @Volatile: keep in sync with point_shadows.glsl
+#define POINT_SHADOW_CASTERS_MAX 64
+
+// @Note: a quadtree of the atlas' tiles, from the whole atlas down to POINT_SHADOW_TILE_MIN.
+#define POINT_SHADOW_ATLAS_LEVELS 7
+#define POINT_SHADOW_ATLAS_NODES ((((usize) 1 << (2 * POINT_SHADOW_ATLAS_LEVELS)) - 1) / 3)
+
+typedef struct PointShadowView {
+    mat4 world_to_clip;
+    vec3 position;
+    f32 fovy; // @Note: in radians (of a symmetric perspective projection)
+    f32 height; // @Note: of the viewport, in pixels
+} PointShadowView;
+
+typedef struct PointShadow {
+    usize light; // @Note: the index of the light that it's assigned to
+    bool is_assigned;
+
+    // @Note: what its tiles were last rendered with, which is what the lighting passes read
+    // (as the light may have moved since, while it waits to be rendered again).
+    bool is_rendered; // @Note: whether its tiles hold its shadows (it's unshadowed until then)
+    vec3 position;
+    f32 radius; // @Note: the far plane of its faces
+    mat4 world_to_faces[POINT_SHADOW_FACES]; // @Note: to GL clip space
+    u16 tiles[POINT_SHADOW_FACES]; // @Note: nodes of the atlas' quadtree
+    int tile_size; // @Note: in texels (including the border)
+    bool is_out_of_tiles; // @Note: whether the atlas had no room for its tiles, last it tried
+
+    f32 coverage; // @Note: the radius of its sphere on screen, in pixels
+    int desired_tile_size; // @Note: from its coverage (tile_size is smaller if the atlas is full)
+    u8 dirty_faces; // @Note: a bit per face, of those that have to be rendered again
+    u8 update_faces; // @Note: a bit per face, of those that are rendered this frame
+    usize dirty_frames; // @Note: how many frames its dirty faces have waited for
+} PointShadow;
+
+typedef struct PointShadowStats {
+    usize lights_shadowed;
+    usize faces_rendered;
+    usize faces_pending; // @Note: that are dirty, but didn't fit into this frame's budget
+    usize lights_out_of_tiles; // @Note: that are waiting for room in the atlas
+    usize texels_used; // @Note: of the atlas
+} PointShadowStats;
+
+typedef struct PointShadows {
+    uint texture; // GL_DEPTH_COMPONENT32F, compared with GL_LEQUAL (sampler2DShadow)
+    uint framebuffer;
+    PointShadow shadows[POINT_SHADOWS_MAX];
+    u8 atlas[POINT_SHADOW_ATLAS_NODES]; // @Note: the state of each node of its quadtree
+
+    // @Note: the bounds of the casters on the last update, to tell which ones moved since.
+    Aabb casters[POINT_SHADOW_CASTERS_MAX];
+    usize casters_len;
+
+    // @Note: set when a light starts or stops being shadowed, i.e. when the slots that the
+    // lights point at (see get_point_shadow_slot) have to be written again.
+    bool lights_changed;
+
+    PointShadowStats stats; // @Note: of the last call to update_point_shadows
+} PointShadows;
+
+PointShadows create_point_shadows(void);
+void destroy_point_shadows(PointShadows *shadows);
+
+// @Note: picks the `count` lights (up to POINT_SHADOWS_MAX) with the largest coverage of the
+// view to be shadowed, finds which of their faces are dirty, and schedules up to `budget` of
+// those to be rendered this frame (though at least one light's, so that updates never stall).
+// The casters are compared by their bounds, so any caster whose bounds change dirties the faces
+// that it was or is now inside of.
+void update_point_shadows(
+    PointShadows *shadows,
+    PointShadowView const view,
+    vec3 const light_positions[],
+    f32 const light_radii[],
+    usize lights_len,
+    Aabb const casters[],
+    usize casters_len,
+    usize count,
+    usize budget);
+
+// @Note: the slot of the light's shadows that the lighting passes sample (see
+// get_point_shadow_uniforms), or -1 if it isn't shadowed.
+int get_point_shadow_slot(PointShadows const *shadows, usize light);
+
+// @Note: per slot, the position and far plane that it was rendered with (zero if it isn't
+// shadowed), and per face of each slot, the rectangle of its tile inside of the border (offset
+// and size, in texture coordinates) along with the tile's size in texels.
+void get_point_shadow_uniforms(
+    PointShadows const *shadows,
+    vec4 spheres[POINT_SHADOWS_MAX],
+    vec4 tiles[POINT_SHADOWS_MAX * POINT_SHADOW_FACES]);
+
+// @Note: binds the atlas' framebuffer, sets the viewport and the scissor to the face's tile, and
+// clears its depth (which needs GL_SCISSOR_TEST to be enabled by the caller).
+void begin_point_shadow_face(PointShadows const *shadows, usize slot, usize face);
@@ -95,6 +95,7 @@ typedef enum Err {
 
     Err_Shader_Compile,
     Err_Shader_Link,
+    Err_Shader_Include,
 
     Err_Stbi_Load,
 
@@ -103,6 +104,8 @@ typedef enum Err {
 
     Err_Model_Load_Stored_Texture,
 
+    Err_Occlusion_Check,
+
     Err_Fopen,
     Err_Malloc,
     Err_Calloc,
@@ -0,0 +1,492 @@
+#include "render_graph.h"
+
+#include "console.h"
+#include "maths.h"
+#include "opengl.h"
+
+#include <string.h>
+
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+typedef struct RenderFormat {
+    uint internal_format;
+    uint format;
+    uint type;
+    usize bytes_per_pixel;
+} RenderFormat;
+
+/* clang-format off */
+static RenderFormat const render_formats[] = {
+    { GL_R8,                 GL_RED,             GL_UNSIGNED_BYTE,     1 },
+    { GL_RG8,                GL_RG,              GL_UNSIGNED_BYTE,     2 },
+    { GL_RGBA8,              GL_RGBA,            GL_UNSIGNED_BYTE,     4 },
+    { GL_RG16,               GL_RG,              GL_UNSIGNED_SHORT,    4 },
+    { GL_R16F,               GL_RED,             GL_FLOAT,             2 },
+    { GL_RG16F,              GL_RG,              GL_FLOAT,             4 },
+    { GL_RGBA16F,            GL_RGBA,            GL_FLOAT,             8 },
+    { GL_R32F,               GL_RED,             GL_FLOAT,             4 },
+    { GL_R32UI,              GL_RED_INTEGER,     GL_UNSIGNED_INT,      4 },
+    { GL_DEPTH_COMPONENT24,  GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,      4 },
+    { GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT,             4 },
+    { GL_DEPTH24_STENCIL8,   GL_DEPTH_STENCIL,   GL_UNSIGNED_INT_24_8, 4 },
+};
+/* clang-format on */
+
+typedef struct GraphTexture {
+    RenderTextureDesc desc;
+    RenderFormat const *format;
+    int width;
+    int height;
+
+    int first_pass; // @Note: that uses it (and isn't culled), or -1 if none does
+    int last_pass;
+    uint texture; // @Note: the pooled one that it was given, if it's used
+} GraphTexture;
+
+typedef struct GraphPass {
+    RenderPassDesc desc;
+    uint framebuffer;
+    bool has_outputs; // @Note: otherwise, whatever framebuffer is bound is left as it is
+    int width; // @Note: of its outputs
+    int height;
+} GraphPass;
+
+typedef struct PooledTexture {
+    uint texture;
+    RenderFormat const *format;
+    int width;
+    int height;
+    bool is_filtered;
+
+    int busy_until; // @Note: the last pass of the texture that it was last given to
+    bool is_used; // @Note: by this frame
+} PooledTexture;
+
+typedef struct PooledFramebuffer {
+    uint framebuffer;
+    uint attachments[RENDER_PASS_WRITES_MAX]; // @Note: pooled textures, in the pass' order
+    bool is_used; // @Note: by this frame
+} PooledFramebuffer;
+
+typedef struct PassTimer {
+    char const *name;
+    GlTimer timer;
+} PassTimer;
+
+struct RenderGraphState {
+    // @Note: declared this frame.
+    GraphTexture textures[RENDER_GRAPH_TEXTURES_MAX];
+    usize textures_len;
+    GraphPass passes[RENDER_GRAPH_PASSES_MAX];
+    usize passes_len;
+
+    // @Note: persist across frames.
+    PooledTexture pooled_textures[RENDER_GRAPH_TEXTURES_MAX];
+    usize pooled_textures_len;
+    PooledFramebuffer pooled_framebuffers[RENDER_GRAPH_PASSES_MAX];
+    usize pooled_framebuffers_len;
+    PassTimer timers[RENDER_GRAPH_PASSES_MAX];
+    usize timers_len;
+};
+
+static f64 get_time_ms(void) {
+    return 1000.0 * glfwGetTime();
+}
+
+static RenderFormat const *find_render_format(uint internal_format) {
+    for (usize i = 0; i < ARRAY_LEN(render_formats); ++i) {
+        if (render_formats[i].internal_format == internal_format) { return &render_formats[i]; }
+    }
+    return NULL;
+}
+
+RenderGraph create_render_graph(Err *err) {
+    RenderGraph graph = { 0 };
+    if (*err) { return graph; }
+
+    graph.state = calloc(1, sizeof(RenderGraphState));
+    if (!graph.state) { *err = Err_Calloc; }
+
+    return graph;
+}
+
+static void delete_pooled_framebuffer(RenderGraphState *state, usize index) {
+    PooledFramebuffer *pooled = &state->pooled_framebuffers[index];
+    forget_gl_framebuffer(pooled->framebuffer);
+    glDeleteFramebuffers(1, &pooled->framebuffer);
+
+    *pooled = state->pooled_framebuffers[--state->pooled_framebuffers_len];
+}
+
+static void delete_pooled_texture(RenderGraphState *state, usize index) {
+    PooledTexture *pooled = &state->pooled_textures[index];
+    forget_gl_texture(pooled->texture);
+    glDeleteTextures(1, &pooled->texture);
+
+    *pooled = state->pooled_textures[--state->pooled_textures_len];
+}
+
+void destroy_render_graph(RenderGraph *graph) {
+    RenderGraphState *state = graph->state;
+    if (state) {
+        while (state->pooled_framebuffers_len > 0) { delete_pooled_framebuffer(state, 0); }
+        while (state->pooled_textures_len > 0) { delete_pooled_texture(state, 0); }
+        for (usize i = 0; i < state->timers_len; ++i) {
+            destroy_gl_timer(&state->timers[i].timer);
+        }
+        free(state);
+    }
+    *graph = (RenderGraph) { 0 };
+}
+
+void begin_render_graph(RenderGraph *graph, int width, int height) {
+    graph->width = width;
+    graph->height = height;
+    graph->state->textures_len = 0;
+    graph->state->passes_len = 0;
+}
+
+RenderResource declare_render_texture(RenderGraph *graph, RenderTextureDesc const desc) {
+    RenderGraphState *state = graph->state;
+    assert(state->textures_len < RENDER_GRAPH_TEXTURES_MAX);
+
+    RenderFormat const *format = find_render_format(desc.internal_format);
+    assert(format && "unsupported render texture format");
+
+    f32 const scale = desc.scale > 0.0f ? desc.scale : 1.0f;
+    state->textures[state->textures_len] = (GraphTexture) {
+        .desc = desc,
+        .format = format,
+        .width = MAX(1, (int) (scale * graph->width)),
+        .height = MAX(1, (int) (scale * graph->height)),
+    };
+    return (RenderResource) ++state->textures_len;
+}
+
+void add_render_pass(RenderGraph *graph, RenderPassDesc const desc) {
+    RenderGraphState *state = graph->state;
+    assert(state->passes_len < RENDER_GRAPH_PASSES_MAX);
+
+    state->passes[state->passes_len++] = (GraphPass) { .desc = desc };
+}
+
+uint get_render_texture(RenderGraph const *graph, RenderResource resource) {
+    RenderGraphState const *state = graph->state;
+    if (resource == 0 || resource > state->textures_len) { return 0; }
+    return state->textures[resource - 1].texture;
+}
+
+RenderPassStats const *get_render_pass_stats(RenderGraph const *graph, char const *name) {
+    for (usize i = 0; i < graph->stats.passes; ++i) {
+        if (strcmp(graph->pass_stats[i].name, name) == 0) { return &graph->pass_stats[i]; }
+    }
+    return NULL;
+}
+
+//
+// Execution.
+//
+
+// @Note: walks the passes backwards, keeping those that write the backbuffer (or have side
+// effects) or something that a kept pass reads later on. A kept pass that writes a texture
+// without reading it overwrites it, so the passes before it don't need to write it anymore.
+static void cull_render_passes(RenderGraph *graph) {
+    RenderGraphState *state = graph->state;
+    bool is_needed[RENDER_GRAPH_TEXTURES_MAX + 1] = { 0 };
+
+    for (usize i = state->passes_len; i-- > 0;) {
+        RenderPassDesc const *desc = &state->passes[i].desc;
+
+        bool is_kept = desc->has_side_effects;
+        for (RenderResource const *w = desc->writes; *w != 0; ++w) {
+            assert(*w == RENDER_GRAPH_BACKBUFFER || *w <= state->textures_len);
+            is_kept |= *w == RENDER_GRAPH_BACKBUFFER || is_needed[*w];
+        }
+
+        graph->pass_stats[i] = (RenderPassStats) { .name = desc->name, .is_culled = !is_kept };
+        if (!is_kept) { continue; }
+
+        for (RenderResource const *w = desc->writes; *w != 0; ++w) {
+            if (*w != RENDER_GRAPH_BACKBUFFER) { is_needed[*w] = false; }
+        }
+        for (RenderResource const *r = desc->reads; *r != 0; ++r) {
+            assert(*r != RENDER_GRAPH_BACKBUFFER && *r <= state->textures_len);
+            is_needed[*r] = true;
+        }
+    }
+}
+
+static void extend_lifetime(GraphTexture *texture, int pass) {
+    if (texture->first_pass < 0) { texture->first_pass = pass; }
+    texture->last_pass = pass;
+}
+
+// @Note: returns whether the pool changed (i.e. a texture had to be created).
+static bool allocate_render_textures(RenderGraph *graph) {
+    RenderGraphState *state = graph->state;
+
+    for (usize i = 0; i < state->textures_len; ++i) {
+        state->textures[i].first_pass = -1;
+        state->textures[i].last_pass = -1;
+        state->textures[i].texture = 0;
+    }
+    for (usize i = 0; i < state->passes_len; ++i) {
+        if (graph->pass_stats[i].is_culled) { continue; }
+
+        RenderPassDesc const *desc = &state->passes[i].desc;
+        for (RenderResource const *r = desc->reads; *r != 0; ++r) {
+            extend_lifetime(&state->textures[*r - 1], (int) i);
+        }
+        for (RenderResource const *w = desc->writes; *w != 0; ++w) {
+            if (*w == RENDER_GRAPH_BACKBUFFER) { continue; }
+            extend_lifetime(&state->textures[*w - 1], (int) i);
+        }
+    }
+
+    for (usize i = 0; i < state->pooled_textures_len; ++i) {
+        state->pooled_textures[i].busy_until = -1;
+        state->pooled_textures[i].is_used = false;
+    }
+
+    // @Note: textures are given pooled ones in the order that they're first used in, so that
+    // the ones whose lifetimes already ended can be reused (and the result is the same for the
+    // same passes, which keeps the cached framebuffers valid from one frame to the next).
+    bool has_pool_changed = false;
+    for (usize pass = 0; pass < state->passes_len; ++pass) {
+        for (usize i = 0; i < state->textures_len; ++i) {
+            GraphTexture *texture = &state->textures[i];
+            if (texture->first_pass != (int) pass) { continue; }
+
+            PooledTexture *pooled = NULL;
+            for (usize j = 0; j < state->pooled_textures_len && !pooled; ++j) {
+                PooledTexture *candidate = &state->pooled_textures[j];
+                if (candidate->format == texture->format && candidate->width == texture->width
+                    && candidate->height == texture->height
+                    && candidate->is_filtered == texture->desc.is_filtered
+                    && candidate->busy_until < texture->first_pass) {
+                    pooled = candidate;
+                }
+            }
+
+            if (!pooled) {
+                assert(state->pooled_textures_len < RENDER_GRAPH_TEXTURES_MAX);
+                pooled = &state->pooled_textures[state->pooled_textures_len++];
+                *pooled = (PooledTexture) {
+                    .format = texture->format,
+                    .width = texture->width,
+                    .height = texture->height,
+                    .is_filtered = texture->desc.is_filtered,
+                };
+
+                RenderFormat const *format = texture->format;
+                int const filter = texture->desc.is_filtered ? GL_LINEAR : GL_NEAREST;
+
+                glGenTextures(1, &pooled->texture);
+                bind_gl_texture(GL_TEXTURE0, GL_TEXTURE_2D, pooled->texture);
+                glTexImage2D(
+                    GL_TEXTURE_2D,
+                    0,
+                    (int) format->internal_format,
+                    texture->width,
+                    texture->height,
+                    0,
+                    format->format,
+                    format->type,
+                    NULL);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+                has_pool_changed = true;
+            }
+
+            pooled->busy_until = texture->last_pass;
+            pooled->is_used = true;
+            texture->texture = pooled->texture;
+        }
+    }
+
+    return has_pool_changed;
+}
+
+static uint create_pass_framebuffer(RenderGraphState const *state, RenderPassDesc const *desc) {
+    uint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    bind_gl_framebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    uint draw_buffers[RENDER_PASS_WRITES_MAX];
+    int draw_buffers_len = 0;
+    for (RenderResource const *w = desc->writes; *w != 0; ++w) {
+        GraphTexture const *texture = &state->textures[*w - 1];
+
+        uint attachment = GL_COLOR_ATTACHMENT0 + (uint) draw_buffers_len;
+        if (texture->format->format == GL_DEPTH_STENCIL) {
+            attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+        } else if (texture->format->format == GL_DEPTH_COMPONENT) {
+            attachment = GL_DEPTH_ATTACHMENT;
+        } else {
+            draw_buffers[draw_buffers_len++] = attachment;
+        }
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture->texture, 0);
+    }
+
+    if (draw_buffers_len > 0) {
+        glDrawBuffers(draw_buffers_len, draw_buffers);
+    } else {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+
+    check_bound_framebuffer_is_complete();
+    return framebuffer;
+}
+
+// @Note: framebuffers are cached by the pooled textures that they have attached (in order).
+static void prepare_pass_framebuffers(RenderGraph *graph) {
+    RenderGraphState *state = graph->state;
+
+    for (usize i = 0; i < state->pooled_framebuffers_len; ++i) {
+        state->pooled_framebuffers[i].is_used = false;
+    }
+
+    for (usize i = 0; i < state->passes_len; ++i) {
+        GraphPass *pass = &state->passes[i];
+        RenderPassDesc const *desc = &pass->desc;
+        if (graph->pass_stats[i].is_culled || desc->writes[0] == 0) { continue; }
+
+        pass->has_outputs = true;
+        if (desc->writes[0] == RENDER_GRAPH_BACKBUFFER) {
+            assert(desc->writes[1] == 0 && "the backbuffer can't be written along with textures");
+            pass->framebuffer = 0;
+            pass->width = graph->width;
+            pass->height = graph->height;
+            continue;
+        }
+
+        uint attachments[RENDER_PASS_WRITES_MAX] = { 0 };
+        for (usize w = 0; desc->writes[w] != 0; ++w) {
+            assert(desc->writes[w] != RENDER_GRAPH_BACKBUFFER);
+            GraphTexture const *texture = &state->textures[desc->writes[w] - 1];
+            attachments[w] = texture->texture;
+            pass->width = texture->width; // @Note: outputs are expected to be the same size
+            pass->height = texture->height;
+        }
+
+        PooledFramebuffer *pooled = NULL;
+        for (usize j = 0; j < state->pooled_framebuffers_len && !pooled; ++j) {
+            PooledFramebuffer *candidate = &state->pooled_framebuffers[j];
+            if (memcmp(candidate->attachments, attachments, sizeof(attachments)) == 0) {
+                pooled = candidate;
+            }
+        }
+
+        if (!pooled) {
+            assert(state->pooled_framebuffers_len < RENDER_GRAPH_PASSES_MAX);
+            pooled = &state->pooled_framebuffers[state->pooled_framebuffers_len++];
+            pooled->framebuffer = create_pass_framebuffer(state, desc);
+            memcpy(pooled->attachments, attachments, sizeof(attachments));
+        }
+
+        pooled->is_used = true;
+        pass->framebuffer = pooled->framebuffer;
+    }
+
+    bind_gl_framebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static GlTimer *get_pass_timer(RenderGraphState *state, char const *name) {
+    for (usize i = 0; i < state->timers_len; ++i) {
+        if (strcmp(state->timers[i].name, name) == 0) { return &state->timers[i].timer; }
+    }
+
+    // @Note: passes past the limit (which would take more distinct names) just aren't timed.
+    if (state->timers_len == RENDER_GRAPH_PASSES_MAX) { return NULL; }
+
+    PassTimer *timer = &state->timers[state->timers_len++];
+    *timer = (PassTimer) { name, create_gl_timer() };
+    return &timer->timer;
+}
+
+void execute_render_graph(RenderGraph *graph) {
+    RenderGraphState *state = graph->state;
+    f64 const start_ms = get_time_ms();
+
+    cull_render_passes(graph);
+    bool const has_pool_changed = allocate_render_textures(graph);
+    prepare_pass_framebuffers(graph);
+
+    f64 passes_ms = 0.0;
+    for (usize i = 0; i < state->passes_len; ++i) {
+        GraphPass const *pass = &state->passes[i];
+        RenderPassStats *stats = &graph->pass_stats[i];
+        if (stats->is_culled) { continue; }
+
+        f64 const pass_start_ms = get_time_ms();
+        if (pass->has_outputs) {
+            bind_gl_framebuffer(GL_FRAMEBUFFER, pass->framebuffer);
+            glViewport(0, 0, pass->width, pass->height);
+        }
+
+        GlTimer *timer = get_pass_timer(state, pass->desc.name);
+        f64 const execute_start_ms = get_time_ms();
+        if (timer) { begin_gl_timer(timer); }
+        pass->desc.execute(graph, pass->desc.data);
+        if (timer) { end_gl_timer(timer); }
+        f64 const execute_end_ms = get_time_ms();
+
+        stats->cpu_ms = execute_end_ms - pass_start_ms;
+        stats->gpu_ms = timer ? timer->elapsed_ms : 0.0;
+        passes_ms += execute_end_ms - execute_start_ms;
+    }
+
+    bind_gl_framebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, graph->width, graph->height);
+
+    // @Note: whatever this frame didn't use is released (e.g. the textures of the previous
+    // size, after a resize), framebuffers first as they may have those textures attached.
+    bool has_pool_shrunk = false;
+    for (usize i = state->pooled_framebuffers_len; i-- > 0;) {
+        if (!state->pooled_framebuffers[i].is_used) { delete_pooled_framebuffer(state, i); }
+    }
+    for (usize i = state->pooled_textures_len; i-- > 0;) {
+        if (!state->pooled_textures[i].is_used) {
+            delete_pooled_texture(state, i);
+            has_pool_shrunk = true;
+        }
+    }
+
+    RenderGraphStats stats = {
+        .passes = state->passes_len,
+        .textures_allocated = state->pooled_textures_len,
+    };
+    for (usize i = 0; i < state->passes_len; ++i) {
+        stats.passes_culled += graph->pass_stats[i].is_culled;
+    }
+    for (usize i = 0; i < state->textures_len; ++i) {
+        GraphTexture const *texture = &state->textures[i];
+        if (texture->first_pass < 0) { continue; }
+
+        stats.textures += 1;
+        stats.bytes_unaliased +=
+            (usize) texture->width * (usize) texture->height * texture->format->bytes_per_pixel;
+    }
+    for (usize i = 0; i < state->pooled_textures_len; ++i) {
+        PooledTexture const *pooled = &state->pooled_textures[i];
+        stats.bytes +=
+            (usize) pooled->width * (usize) pooled->height * pooled->format->bytes_per_pixel;
+    }
+    stats.overhead_ms = (get_time_ms() - start_ms) - passes_ms;
+    graph->stats = stats;
+
+    if (has_pool_changed || has_pool_shrunk) {
+        GLOW_LOG(
+            "Render graph: `%zu` textures for `%zu` declared ones, `%.2f` MiB (`%.2f` MiB "
+            "without aliasing)",
+            stats.textures_allocated,
+            stats.textures,
+            (f64) stats.bytes / (1024.0 * 1024.0),
+            (f64) stats.bytes_unaliased / (1024.0 * 1024.0));
+    }
+}
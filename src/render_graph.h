@@ -0,0 +1,91 @@
+#pragma once
+
+#include "prelude.h"
+
+// @Note: the passes of a frame are declared every frame, along with the transient textures that
+// they read and write (by handle), and the graph then decides what actually runs: passes whose
+// outputs nothing reads (down to the backbuffer, or a pass that has side effects) are culled,
+// every texture is given a physical one from a pool that persists across frames, where textures
+// of the same format and size whose lifetimes don't overlap share the same one, and each pass
+// gets a framebuffer with its outputs attached. Resizing only means declaring a different size,
+// as pooled textures that weren't used by a frame are deleted at its end.
+//
+// Passes are executed in the order they were declared, and a pass that keeps what is already in
+// one of its outputs (e.g. depth tests against it, rather than clearing it) must read it too.
+
+#define RENDER_GRAPH_PASSES_MAX 32
+#define RENDER_GRAPH_TEXTURES_MAX 32
+#define RENDER_PASS_READS_MAX 8
+#define RENDER_PASS_WRITES_MAX 5 // @Note: up to four color attachments and a depth one
+
+typedef uint RenderResource; // @Note: zero is no resource (which terminates reads and writes)
+
+// @Note: the default framebuffer, which can only be written, and not along with any texture.
+#define RENDER_GRAPH_BACKBUFFER ((RenderResource) ~0u)
+
+typedef struct RenderTextureDesc {
+    char const *name;
+    uint internal_format; // @Note: depth formats are attached as depth (and stencil) outputs
+    f32 scale; // @Note: of the graph's size (zero is the same as one)
+    bool is_filtered; // @Note: sampled with GL_LINEAR (and GL_NEAREST otherwise)
+} RenderTextureDesc;
+
+typedef struct RenderGraph RenderGraph;
+typedef void (*RenderPassFn)(RenderGraph const *graph, void *data);
+
+typedef struct RenderPassDesc {
+    char const *name; // @Note: also what its timer is looked up by, so it must be unique
+    RenderPassFn execute;
+    void *data;
+    RenderResource reads[RENDER_PASS_READS_MAX + 1];
+    RenderResource writes[RENDER_PASS_WRITES_MAX + 1]; // @Note: color outputs in order
+    bool has_side_effects; // @Note: so that it's never culled
+} RenderPassDesc;
+
+typedef struct RenderPassStats {
+    char const *name;
+    bool is_culled;
+    f64 cpu_ms; // @Note: including binding its framebuffer
+    f64 gpu_ms; // @Note: of a few frames ago (see GlTimer)
+} RenderPassStats;
+
+typedef struct RenderGraphStats {
+    usize passes;
+    usize passes_culled;
+    usize textures; // @Note: declared (and used by a pass that wasn't culled)
+    usize textures_allocated; // @Note: after aliasing
+    usize bytes; // @Note: of the allocated textures, i.e. the peak render target memory
+    usize bytes_unaliased; // @Note: if every used texture had its own
+    f64 overhead_ms; // @Note: CPU time spent by the graph itself, outside of the passes
+} RenderGraphStats;
+
+typedef struct RenderGraphState RenderGraphState; // @Note: opaque
+
+struct RenderGraph {
+    int width;
+    int height;
+
+    RenderGraphStats stats; // @Note: of the last call to execute_render_graph
+    RenderPassStats pass_stats[RENDER_GRAPH_PASSES_MAX]; // @Note: stats.passes of them
+
+    RenderGraphState *state; // @Ownership (along with the pooled textures and framebuffers)
+};
+
+RenderGraph create_render_graph(Err *err);
+void destroy_render_graph(RenderGraph *graph);
+
+// @Note: forgets the passes and textures declared for the previous frame.
+void begin_render_graph(RenderGraph *graph, int width, int height);
+
+RenderResource declare_render_texture(RenderGraph *graph, RenderTextureDesc const desc);
+void add_render_pass(RenderGraph *graph, RenderPassDesc const desc);
+
+// @Note: culls, allocates and runs the passes, leaving the backbuffer bound.
+void execute_render_graph(RenderGraph *graph);
+
+// @Note: the GL texture of a declared texture, while the graph is executed (or zero if it
+// isn't used by any pass that runs), so that passes can bind what they read.
+uint get_render_texture(RenderGraph const *graph, RenderResource resource);
+
+// @Note: the stats of a pass of the last execution, or NULL if it wasn't declared.
+RenderPassStats const *get_render_pass_stats(RenderGraph const *graph, char const *name);
@@ -0,0 +1,201 @@
+#include "render_queue.h"
+
+#include "hash.h"
+#include "maths.h"
+#include "mesh.h"
+#include "shader.h"
+#include "texture.h"
+
+#include <string.h>
+
+STATIC_ASSERT(
+    DRAW_KEY_PASS_BITS + DRAW_KEY_SHADER_BITS + DRAW_KEY_MATERIAL_BITS + DRAW_KEY_MESH_BITS
+        + DRAW_KEY_DEPTH_BITS
+    == 64);
+
+#define DRAW_KEY_DEPTH_SHIFT 0
+#define DRAW_KEY_MESH_SHIFT (DRAW_KEY_DEPTH_SHIFT + DRAW_KEY_DEPTH_BITS)
+#define DRAW_KEY_MATERIAL_SHIFT (DRAW_KEY_MESH_SHIFT + DRAW_KEY_MESH_BITS)
+#define DRAW_KEY_SHADER_SHIFT (DRAW_KEY_MATERIAL_SHIFT + DRAW_KEY_MATERIAL_BITS)
+#define DRAW_KEY_PASS_SHIFT (DRAW_KEY_SHADER_SHIFT + DRAW_KEY_SHADER_BITS)
+
+#define DRAW_KEY_FIELD(value, name) \
+    (((u64) (value) & ((1ull << DRAW_KEY_##name##_BITS) - 1)) << DRAW_KEY_##name##_SHIFT)
+
+struct RenderQueueItem {
+    u64 key;
+    usize index;
+};
+
+u64 make_draw_key(uint pass, uint shader_id, uint material_id, uint mesh_id, f32 view_depth) {
+    // @Note: the bits of positive floats sort like their values, so the top ones are kept
+    // (and negative depths, i.e. behind the camera, are clamped to zero).
+    union { f32 f; u32 u; } depth = { MAX(view_depth, 0.0f) };
+    u32 const quantized_depth = depth.u >> (32 - DRAW_KEY_DEPTH_BITS);
+
+    return DRAW_KEY_FIELD(pass, PASS) | DRAW_KEY_FIELD(shader_id, SHADER)
+           | DRAW_KEY_FIELD(material_id, MATERIAL) | DRAW_KEY_FIELD(mesh_id, MESH)
+           | DRAW_KEY_FIELD(quantized_depth, DEPTH);
+}
+
+void dealloc_render_queue(RenderQueue *queue) {
+    free(queue->instances);
+    free(queue->items);
+    free(queue->packets);
+    *queue = (RenderQueue) { 0 };
+}
+
+void clear_render_queue(RenderQueue *queue) {
+    queue->len = 0;
+    queue->stats = (RenderQueueStats) { 0 };
+}
+
+// @Note: the scratch memory grows along with the packets, so that submitting can't fail.
+static bool reserve_render_queue(RenderQueue *queue, usize len) {
+    if (len <= queue->capacity) { return true; }
+
+    usize const capacity = MAX(2 * queue->capacity, MAX(len, 64));
+
+    DrawPacket *packets = realloc(queue->packets, capacity * sizeof(DrawPacket));
+    if (!packets) { return false; }
+    queue->packets = packets;
+
+    RenderQueueItem *items = realloc(queue->items, 2 * capacity * sizeof(RenderQueueItem));
+    if (!items) { return false; }
+    queue->items = items;
+
+    mat4 *instances = realloc(queue->instances, capacity * sizeof(mat4));
+    if (!instances) { return false; }
+    queue->instances = instances;
+
+    queue->capacity = capacity;
+    return true;
+}
+
+void push_draw_packet(RenderQueue *queue, u64 key, DrawPacket const packet, Err *err) {
+    if (*err) { return; }
+
+    if (!reserve_render_queue(queue, queue->len + 1)) {
+        *err = Err_Realloc;
+        return;
+    }
+
+    queue->items[queue->len] = (RenderQueueItem) { key, queue->len };
+    queue->packets[queue->len] = packet;
+    queue->len += 1;
+}
+
+static uint get_mesh_material_id(Mesh const *mesh) {
+    u64 hash = 0;
+    for (usize i = 0; i < mesh->textures_len; ++i) {
+        uint const id = mesh->textures[i].id;
+        hash = hash_combine(hash, hash_bytes(&id, sizeof(id), 0));
+    }
+    return (uint) hash;
+}
+
+void push_mesh_draw(
+    RenderQueue *queue,
+    uint pass,
+    Mesh const *mesh,
+    Shader const *shader,
+    mat4 const local_to_world,
+    mat4 const world_to_view,
+    Err *err) {
+    if (*err) { return; }
+
+    vec3 const center = vec3_scl(vec3_add(mesh->bounds.min, mesh->bounds.max), 0.5f);
+    vec4 const center_world = mat4_mul_vec4(local_to_world, vec4_from_vec3(center, 1));
+    f32 const view_depth = -mat4_mul_vec4(world_to_view, center_world).z;
+
+    // @Note: meshes are told apart by their address, which is fine as it only groups them.
+    usize const mesh_address = (usize) mesh;
+    uint const mesh_id = (uint) hash_bytes(&mesh_address, sizeof(mesh_address), 0);
+
+    u64 const key = make_draw_key(
+        pass, shader->program_id, get_mesh_material_id(mesh), mesh_id, view_depth);
+    push_draw_packet(queue, key, (DrawPacket) { mesh, shader, local_to_world }, err);
+}
+
+//
+// Sorting and submission.
+//
+
+// @Note: a least significant digit radix sort (with 8-bit digits), which skips the digits that
+// every key has in common (e.g. the pass, when there's only one), and returns the sorted items
+// (either the given ones, or the temporary ones, as they're swapped after every digit).
+static RenderQueueItem *
+radix_sort_items(RenderQueueItem *items, RenderQueueItem *temp, usize len) {
+    usize counts[8][256] = { { 0 } };
+    for (usize i = 0; i < len; ++i) {
+        for (int digit = 0; digit < 8; ++digit) {
+            counts[digit][(items[i].key >> (8 * digit)) & 0xff] += 1;
+        }
+    }
+
+    RenderQueueItem *src = items;
+    RenderQueueItem *dst = temp;
+    for (int digit = 0; digit < 8; ++digit) {
+        usize *count = counts[digit];
+        int const shift = 8 * digit;
+        if (len == 0 || count[(src[0].key >> shift) & 0xff] == len) { continue; }
+
+        for (usize d = 0, offset = 0; d < 256; ++d) {
+            usize const digit_len = count[d];
+            count[d] = offset;
+            offset += digit_len;
+        }
+        for (usize i = 0; i < len; ++i) { dst[count[(src[i].key >> shift) & 0xff]++] = src[i]; }
+
+        RenderQueueItem *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    return src;
+}
+
+void submit_render_queue(RenderQueue *queue) {
+    RenderQueueItem const *items =
+        radix_sort_items(queue->items, queue->items + queue->capacity, queue->len);
+
+    RenderQueueStats stats = { .packets = queue->len };
+    uint program_id = 0;
+    u64 material_key = ~0ull;
+
+    for (usize i = 0; i < queue->len;) {
+        DrawPacket const *first = &queue->packets[items[i].index];
+
+        // Gather the run of packets that can be drawn as instances of the first one.
+        usize instances_len = 0;
+        for (; i + instances_len < queue->len; ++instances_len) {
+            DrawPacket const *packet = &queue->packets[items[i + instances_len].index];
+            if (packet->mesh != first->mesh
+                || packet->shader->program_id != first->shader->program_id) {
+                break;
+            }
+            queue->instances[instances_len] = packet->local_to_world;
+        }
+
+        if (first->shader->program_id != program_id) {
+            program_id = first->shader->program_id;
+            use_shader(*first->shader);
+            stats.shader_changes += 1;
+        }
+
+        u64 const key_material = items[i].key >> DRAW_KEY_MATERIAL_SHIFT;
+        if (key_material != material_key) {
+            material_key = key_material;
+            stats.material_changes += 1;
+        }
+
+        // @Note: GL 3.3 has no base instance, so each run is uploaded right before its draw.
+        upload_mesh_instances(queue->instances, instances_len);
+        draw_mesh_instanced(first->mesh, first->shader, instances_len);
+        stats.draws += 1;
+
+        i += instances_len;
+    }
+
+    queue->stats = stats;
+}
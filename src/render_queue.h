@@ -0,0 +1,73 @@
+#pragma once
+
+#include "prelude.h"
+
+#include "maths_types.h"
+
+// Forward declarations.
+typedef struct Mesh Mesh;
+typedef struct Shader Shader;
+
+// @Note: draws are pushed as packets with a 64-bit sort key, and are radix sorted before being
+// submitted, so that they're grouped by pass, then shader, then material (i.e. set of textures),
+// then mesh, and finally ordered front to back (for early depth rejection). Sorting by mesh
+// before depth keeps each mesh's packets next to each other, so they're merged into a single
+// instanced draw (whose instances are still drawn in order, i.e. front to back).
+
+/* clang-format off */
+#define DRAW_KEY_PASS_BITS      4
+#define DRAW_KEY_SHADER_BITS   12
+#define DRAW_KEY_MATERIAL_BITS 16
+#define DRAW_KEY_MESH_BITS      8
+#define DRAW_KEY_DEPTH_BITS    24 // @Note: the top bits of a (positive) f32, which sort like it
+/* clang-format on */
+
+// @Note: ids that don't fit are truncated, which can only make sorting less effective, as the
+// packets themselves are compared when merging them.
+u64 make_draw_key(uint pass, uint shader_id, uint material_id, uint mesh_id, f32 view_depth);
+
+typedef struct DrawPacket {
+    Mesh const *mesh;
+    Shader const *shader;
+    mat4 local_to_world;
+} DrawPacket;
+
+typedef struct RenderQueueStats {
+    usize packets;
+    usize draws; // @Note: after merging packets of the same mesh and shader
+    usize shader_changes;
+    usize material_changes;
+} RenderQueueStats;
+
+typedef struct RenderQueueItem RenderQueueItem; // @Note: a key and the index of its packet
+
+typedef struct RenderQueue {
+    DrawPacket *packets; // @Ownership
+    usize len;
+    usize capacity;
+
+    RenderQueueStats stats; // @Note: of the last call to submit_render_queue
+
+    // @Note: scratch memory, for sorting and for gathering the instances of merged packets.
+    RenderQueueItem *items; // @Ownership (twice the capacity, as the sort ping-pongs)
+    mat4 *instances; // @Ownership
+} RenderQueue;
+
+void dealloc_render_queue(RenderQueue *queue);
+void clear_render_queue(RenderQueue *queue); // @Note: along with the stats
+
+void push_draw_packet(RenderQueue *queue, u64 key, DrawPacket const packet, Err *err);
+
+// @Note: computes the key from the mesh's textures and the depth of its bounds' center.
+void push_mesh_draw(
+    RenderQueue *queue,
+    uint pass,
+    Mesh const *mesh,
+    Shader const *shader,
+    mat4 const local_to_world,
+    mat4 const world_to_view,
+    Err *err);
+
+// @Note: sorts the packets by key (which is stable, so ties keep the order they were pushed in)
+// and submits them, merging runs of packets of the same mesh and shader into instanced draws.
+void submit_render_queue(RenderQueue *queue);
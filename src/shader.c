@@ -1,90 +1,879 @@
 #include "shader.h"
 
 #include "console.h"
+#include "dynarray.h"
 #include "file.h"
+#include "file_watcher.h"
+#include "hash.h"
+#include "jobs.h"
+#include "maths.h"
 #include "opengl.h"
+#include "texture.h"
 
+#include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <glad/glad.h>
 
-static uint
-create_shader(uint type, char const *source, char info_log[INFO_LOG_LENGTH], Err *err) {
-    if (*err) { return 0; }
+//
+// Uniform location table.
+//
 
-    uint const id = glCreateShader(type);
-    glShaderSource(id, 1, &source, NULL);
-    glCompileShader(id);
-    if (!is_shader_compile_success(id, info_log, err)) {
-        char const *type_string =
-            (type == GL_VERTEX_SHADER     ? "vertex"
-             : type == GL_FRAGMENT_SHADER ? "fragment"
-             : type == GL_GEOMETRY_SHADER ? "geometry"
-                                          : "");
-        GLOW_WARNING("%s shader compilation failed with: `\n%s`", type_string, info_log);
+#define UNIFORM_TABLE_MIN_CAPACITY 16
+
+// @Note: the uniforms are stored densely (so that ShaderUniform handles are simply indices
+// into them), and slots is an open addressing (linear probing) hash table of index + 1 values.
+struct ShaderUniformTable {
+    char **names; // @Ownership
+    u64 *hashes;
+    int *locations;
+    ShaderUniformReflection *reflections;
+    usize len;
+    usize capacity;
+
+    u32 *slots;
+    usize slots_len; // @Note: power of two, kept at least twice as large as capacity
+};
+
+static void dealloc_uniform_table(ShaderUniformTable *table) {
+    if (!table) { return; }
+    for (usize i = 0; i < table->len; ++i) { free(table->names[i]); }
+    free(table->names);
+    free(table->hashes);
+    free(table->locations);
+    free(table->reflections);
+    free(table->slots);
+    free(table);
+}
+
+static bool grow_uniform_table(ShaderUniformTable *table) {
+    usize const capacity = MAX(2 * table->capacity, UNIFORM_TABLE_MIN_CAPACITY);
+    usize const slots_len = 2 * capacity;
+
+    char **names = realloc(table->names, capacity * sizeof(char *));
+    if (names) { table->names = names; }
+    u64 *hashes = realloc(table->hashes, capacity * sizeof(u64));
+    if (hashes) { table->hashes = hashes; }
+    int *locations = realloc(table->locations, capacity * sizeof(int));
+    if (locations) { table->locations = locations; }
+    ShaderUniformReflection *reflections =
+        realloc(table->reflections, capacity * sizeof(ShaderUniformReflection));
+    if (reflections) { table->reflections = reflections; }
+    u32 *slots = calloc(slots_len, sizeof(u32));
+
+    if (!names || !hashes || !locations || !reflections || !slots) {
+        free(slots);
+        return false;
+    }
+
+    for (usize i = 0; i < table->len; ++i) {
+        usize slot = table->hashes[i] & (slots_len - 1);
+        while (slots[slot]) { slot = (slot + 1) & (slots_len - 1); }
+        slots[slot] = (u32) i + 1;
     }
 
-    return id;
+    free(table->slots);
+    table->slots = slots;
+    table->slots_len = slots_len;
+    table->capacity = capacity;
+    return true;
 }
 
-Shader new_shader_from_source(ShaderSources const source, Err *err) {
-    if (*err) { return (Shader) { 0 }; }
+// @Note: returns the index of name's uniform in the table, or -1 if it isn't stored in it.
+static i64 find_uniform_index(ShaderUniformTable const *table, char const *name, u64 hash) {
+    if (table->slots_len == 0) { return -1; }
+
+    usize slot = hash & (table->slots_len - 1);
+    while (table->slots[slot]) {
+        usize const index = table->slots[slot] - 1;
+        if (table->hashes[index] == hash && !strcmp(table->names[index], name)) {
+            return (i64) index;
+        }
+        slot = (slot + 1) & (table->slots_len - 1);
+    }
+
+    return -1;
+}
 
-    char info_log[INFO_LOG_LENGTH] = { 0 };
+static i64 insert_uniform(ShaderUniformTable *table, char const *name, u64 hash, int location) {
+    if (table->len == table->capacity && !grow_uniform_table(table)) { return -1; }
 
-    bool const has_geometry = source.geometry != NULL;
+    usize const len = strlen(name);
+    char *name_copy = malloc(len + 1);
+    if (!name_copy) { return -1; }
+    memcpy(name_copy, name, len + 1);
 
-    uint const vertex_id = create_shader(GL_VERTEX_SHADER, source.vertex, info_log, err);
-    uint const fragment_id = create_shader(GL_FRAGMENT_SHADER, source.fragment, info_log, err);
-    uint const geometry_id =
-        has_geometry ? create_shader(GL_GEOMETRY_SHADER, source.geometry, info_log, err) : 0;
+    usize const index = table->len++;
+    table->names[index] = name_copy;
+    table->hashes[index] = hash;
+    table->locations[index] = location;
+    table->reflections[index] = (ShaderUniformReflection) { 0 }; // @Note: until it's reflected
 
-    uint const program_id = glCreateProgram();
-    glAttachShader(program_id, vertex_id);
-    glAttachShader(program_id, fragment_id);
-    if (has_geometry) { glAttachShader(program_id, geometry_id); }
+    usize slot = hash & (table->slots_len - 1);
+    while (table->slots[slot]) { slot = (slot + 1) & (table->slots_len - 1); }
+    table->slots[slot] = (u32) index + 1;
 
-    glLinkProgram(program_id);
-    if (!is_program_link_success(program_id, info_log, err)) {
-        GLOW_WARNING("shader program linking failed with: `\n%s`", info_log);
+    return (i64) index;
+}
+
+static bool is_sampler_type(uint type) {
+    switch (type) {
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_1D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_1D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_BUFFER:
+        case GL_SAMPLER_2D_RECT:
+        case GL_SAMPLER_2D_RECT_SHADOW:
+        case GL_INT_SAMPLER_2D:
+        case GL_INT_SAMPLER_3D:
+        case GL_INT_SAMPLER_CUBE:
+        case GL_INT_SAMPLER_2D_ARRAY:
+        case GL_INT_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_CUBE:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_BUFFER: return true;
+        default: return false;
     }
+}
 
-    glDeleteShader(geometry_id);
-    glDeleteShader(fragment_id);
-    glDeleteShader(vertex_id);
+// @Note: returns the fixed unit of material samplers (see get_material_sampler_name), e.g.
+// `texture_diffuse` or `texture_normal1`, and -1 for samplers with any other name.
+static int find_material_sampler_unit(char const *name) {
+    for (int i = TextureMaterialType_Diffuse; i <= TextureMaterialType_Packed; ++i) {
+        TextureMaterialType const type = (TextureMaterialType) i;
+        char const *sampler_name = get_material_sampler_name(type);
+        usize const len = strlen(sampler_name);
+        if (strncmp(name, sampler_name, len)) { continue; }
 
-    return (Shader) { program_id };
+        // @Note: the first one has no index (e.g. `texture_diffuse`, then `texture_diffuse1`).
+        char const *suffix = &name[len];
+        uint index = 0;
+        for (; '0' <= *suffix && *suffix <= '9'; ++suffix) {
+            index = 10 * index + (uint) (*suffix - '0');
+        }
+        if (*suffix == '\0') { return get_material_texture_unit(type, index); }
+    }
+
+    return -1;
 }
 
-Shader new_shader_from_filepath(ShaderFilepaths const path, Err *err) {
-    if (*err) { return (Shader) { 0 }; }
+static void reflect_uniform(
+    ShaderUniformTable *table,
+    char const *name,
+    int location,
+    ShaderUniformReflection const reflection) {
+    u64 const hash = hash_str(name, 0);
+    i64 index = find_uniform_index(table, name, hash);
+    if (index == -1) { index = insert_uniform(table, name, hash, location); }
+    if (index != -1) { table->reflections[index] = reflection; }
+}
+
+// @Note: also assigns a texture unit to every sampler, which is either the fixed unit of its
+// material semantic, or the next one after them (in the order they're listed by the driver).
+static void insert_active_uniforms(ShaderUniformTable *table, uint program_id) {
+    int active_uniforms = 0;
+    int max_name_len = 0;
+    glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &active_uniforms);
+    glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_len);
+    if (active_uniforms <= 0 || max_name_len <= 0) { return; }
+
+    char *name = malloc((usize) max_name_len + 1);
+    if (!name) { return; }
+
+    int max_texture_units = 0;
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_texture_units);
+
+    // @Note: sampler uniforms can only be set on the current program in GL 3.3 (which is
+    // left bound, as whoever draws with a program has to bind it first anyway).
+    bind_gl_program(program_id);
+
+    int next_unit = MATERIAL_TEXTURE_UNITS_LEN;
+    for (int i = 0; i < active_uniforms; ++i) {
+        int name_len = 0, size = 0;
+        uint type = 0;
+        glGetActiveUniform(program_id, (uint) i, max_name_len + 1, &name_len, &size, &type, name);
+
+        int const location = glGetUniformLocation(program_id, name);
+        if (location == -1) { continue; } // e.g. uniform block members
+
+        ShaderUniformReflection reflection = { type, size, 0 };
+        if (is_sampler_type(type)) {
+            int unit = size == 1 ? find_material_sampler_unit(name) : -1;
+            if (unit == -1) {
+                unit = next_unit;
+                next_unit += size;
+            }
+
+            if (unit + size > max_texture_units) {
+                GLOW_WARNING("ran out of texture units for sampler: `%s`", name);
+            } else {
+                int units[32];
+                int const units_len = MIN(size, (int) ARRAY_LEN(units));
+                for (int j = 0; j < units_len; ++j) { units[j] = unit + j; }
+                glUniform1iv(location, units_len, units);
+                reflection.texture_unit = GL_TEXTURE0 + (uint) unit;
+            }
+        }
+
+        reflect_uniform(table, name, location, reflection);
+
+        // @Note: arrays of basic types are only listed as `name[0]`, but they can also be
+        // referred to by `name` (while the other elements are lazily added on lookups).
+        if (name_len > 3 && !strcmp(&name[name_len - 3], "[0]")) {
+            name[name_len - 3] = '\0';
+            reflect_uniform(table, name, location, reflection);
+        }
+    }
+
+    free(name);
+}
+
+static ShaderUniformTable *alloc_uniform_table(uint program_id, Err *err) {
+    if (*err) { return NULL; }
+
+    ShaderUniformTable *table = calloc(1, sizeof(ShaderUniformTable));
+    if (!table) {
+        *err = Err_Calloc;
+        return NULL;
+    }
+
+    insert_active_uniforms(table, program_id);
+    return table;
+}
+
+// @Note: keeps every (already looked up) uniform at the same index, so that handles to them
+// remain valid, but with locations from the new program (which are -1 if no longer active).
+static void update_uniform_table(ShaderUniformTable *table, uint program_id) {
+    for (usize i = 0; i < table->len; ++i) {
+        table->locations[i] = glGetUniformLocation(program_id, table->names[i]);
+        table->reflections[i] = (ShaderUniformReflection) { 0 };
+    }
+    insert_active_uniforms(table, program_id);
+}
+
+static int find_uniform_location(Shader const shader, char const *name) {
+    if (!shader.uniforms) { return glGetUniformLocation(shader.program_id, name); }
+
+    u64 const hash = hash_str(name, 0);
+    i64 const index = find_uniform_index(shader.uniforms, name, hash);
+    if (index != -1) { return shader.uniforms->locations[index]; }
+
+    // @Note: locations of inactive uniforms (i.e. -1) are also stored, so they're only
+    // queried once, while if we fail to insert it we simply look it up again next time.
+    int const location = glGetUniformLocation(shader.program_id, name);
+    insert_uniform(shader.uniforms, name, hash, location);
+    return location;
+}
+
+//
+// Program binary cache.
+//
+
+#define PROGRAM_CACHE_MAGIC 0x47525047u // "GPRG"
+#define PROGRAM_CACHE_VERSION 1u
+
+typedef struct ProgramCacheHeader {
+    u32 magic;
+    u32 version;
+    u64 key;
+    u32 binary_format;
+    u32 binary_size;
+} ProgramCacheHeader;
+
+static ShaderCacheStats program_cache_stats = { 0 };
+
+static bool is_program_cache_enabled(void) {
+    static int is_enabled = -1; // @Note: lazily initialized, since it needs a GL context
+    if (is_enabled == -1) {
+        int formats_len = 0;
+        if (GLAD_GL_ARB_get_program_binary) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_len);
+        }
+        is_enabled = GLOW_CACHE_[0] != '\0' && formats_len > 0;
+    }
+    return is_enabled;
+}
+
+// @Note: binaries are only valid for the driver that produced them, so its
+// vendor, renderer and version strings are all part of the program's key.
+static u64 compute_program_cache_key(ShaderSources const source) {
+    static u64 driver_key = 0;
+    if (driver_key == 0) {
+        driver_key = hash_str((char const *) glGetString(GL_VENDOR), PROGRAM_CACHE_VERSION);
+        driver_key = hash_str((char const *) glGetString(GL_RENDERER), driver_key);
+        driver_key = hash_str((char const *) glGetString(GL_VERSION), driver_key);
+    }
+
+    u64 key = driver_key;
+    key = hash_combine(key, hash_str(source.vertex, 1));
+    key = hash_combine(key, hash_str(source.fragment, 2));
+    key = hash_combine(key, source.geometry ? hash_str(source.geometry, 3) : 0);
+    return key;
+}
+
+static void get_program_cache_path(char *path, usize max_len, u64 key) {
+    snprintf(path, max_len, GLOW_CACHE_ "programs" SLASH "%016" PRIx64 ".bin", key);
+}
+
+// @Note: returns 0 on a cache miss, which includes binaries rejected by the driver
+// (e.g. after it's updated, even if its version string stays the same).
+static uint try_load_program_from_cache(u64 key) {
+    char path[512];
+    get_program_cache_path(path, sizeof(path), key);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) { return 0; }
+
+    ProgramCacheHeader header = { 0 };
+    void *binary = NULL;
+    bool const is_valid = fread(&header, sizeof(header), 1, fp) == 1
+                          && header.magic == PROGRAM_CACHE_MAGIC
+                          && header.version == PROGRAM_CACHE_VERSION && header.key == key
+                          && (binary = malloc(header.binary_size)) != NULL
+                          && fread(binary, 1, header.binary_size, fp) == header.binary_size;
+    fclose(fp);
+
+    uint program_id = 0;
+    if (is_valid) {
+        program_id = glCreateProgram();
+        glProgramBinary(program_id, header.binary_format, binary, (int) header.binary_size);
+
+        int success = 0;
+        glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+        if (!success) {
+            GLOW_DEBUG("program binary was rejected by the driver: `%s`", path);
+            glDeleteProgram(program_id);
+            program_id = 0;
+        }
+    }
+
+    free(binary);
+    return program_id;
+}
+
+static void write_program_to_cache(uint program_id, u64 key) {
+    static bool has_made_directory = false;
+    if (!has_made_directory) {
+        has_made_directory =
+            make_directory(GLOW_CACHE_) && make_directory(GLOW_CACHE_ "programs");
+    }
+
+    int binary_size = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    if (binary_size <= 0) { return; }
+
+    usize const size = sizeof(ProgramCacheHeader) + (usize) binary_size;
+    u8 *data = malloc(size);
+    if (!data) { return; }
+
+    uint binary_format = 0;
+    glGetProgramBinary(
+        program_id, binary_size, NULL, &binary_format, data + sizeof(ProgramCacheHeader));
+
+    ProgramCacheHeader const header = {
+        PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, key, binary_format, (u32) binary_size,
+    };
+    memcpy(data, &header, sizeof(header));
+
+    char path[512];
+    get_program_cache_path(path, sizeof(path), key);
+    if (!write_data_to_filepath(path, data, size)) {
+        GLOW_WARNING("failed to write program cache file: `%s`", path);
+    }
+
+    free(data);
+}
+
+ShaderCacheStats get_shader_cache_stats(void) {
+    return program_cache_stats;
+}
+
+//
+// Source loading (with #include resolution and #define injection).
+//
+
+#define SHADER_INCLUDE_DEPTH_MAX 16
+
+typedef struct SourceBuilder {
+    char *data; // @Ownership
+    usize len;
+    usize capacity;
+} SourceBuilder;
+
+static void append_to_source(SourceBuilder *builder, char const *str, usize len, Err *err) {
+    if (*err) { return; }
+
+    if (builder->len + len + 1 > builder->capacity) {
+        usize const capacity = MAX(2 * builder->capacity, builder->len + len + 1);
+        char *data = realloc(builder->data, capacity);
+        if (!data) {
+            *err = Err_Realloc;
+            return;
+        }
+        builder->data = data;
+        builder->capacity = capacity;
+    }
+
+    memcpy(&builder->data[builder->len], str, len);
+    builder->len += len;
+    builder->data[builder->len] = '\0';
+}
 
-    bool const has_geometry = path.geometry != NULL;
+// @Note: returns the index of path in dependencies, adding it if it's not already there.
+static usize find_or_add_dependency(char ***dependencies, char const *path, bool *was_added) {
+    for (usize i = 0; i < arrlen(*dependencies); ++i) {
+        if (!strcmp((*dependencies)[i], path)) {
+            *was_added = false;
+            return i;
+        }
+    }
+
+    Err err = Err_None;
+    char *path_copy = alloc_str_copy(path, &err);
+    *was_added = err == Err_None;
+    if (*was_added) { arrpush(*dependencies, path_copy); }
+    return arrlen(*dependencies) - 1;
+}
+
+static bool is_directive(char const *line, char const *directive) {
+    while (*line == ' ' || *line == '\t') { line += 1; }
+    return !strncmp(line, directive, strlen(directive));
+}
+
+// @Note: `#include "path"` lines are replaced by the contents of the file at path (relative
+// to the including file), at most once per program (as if they all had `#pragma once`), and
+// `#line` directives are added so that errors point at the right source string (i.e. the
+// index of the file in dependencies) and line. The prologue (if any) is added right after
+// the `#version` directive of the top-level file, as nothing but comments may precede it.
+static void append_source_with_includes(
+    SourceBuilder *builder,
+    char const *path,
+    char const *prologue,
+    char ***dependencies,
+    int depth,
+    Err *err) {
+    if (*err) { return; }
+
+    if (depth > SHADER_INCLUDE_DEPTH_MAX) {
+        GLOW_WARNING("exceeded the maximum #include depth with: `%s`", path);
+        *err = Err_Shader_Include;
+        return;
+    }
+
+    bool was_added = false;
+    usize const source_index = find_or_add_dependency(dependencies, path, &was_added);
+    if (!was_added) { return; } // @Note: it was already included
+
+    char *data = alloc_data_from_filepath(path, err);
+    if (*err) {
+        GLOW_WARNING("failed to read shader source: `%s`", path);
+        return;
+    }
+
+    char directory[512];
+    snprintf(directory, sizeof(directory), "%s", path);
+    terminate_at_last_path_component_inplace(directory);
+
+    if (prologue && !strstr(data, "#version")) {
+        append_to_source(builder, prologue, strlen(prologue), err);
+        append_to_source(builder, "#line 1 0\n", strlen("#line 1 0\n"), err);
+    }
+
+    usize line_number = 1;
+    for (char const *line = data; *line && !*err; ++line_number) {
+        char const *line_end = strchr(line, '\n');
+        usize const line_len = line_end ? (usize) (line_end - line) + 1 : strlen(line);
+
+        char const *directive = line;
+        while (*directive == ' ' || *directive == '\t') { directive += 1; }
+
+        char include_name[256];
+        if (prologue && is_directive(line, "#version")) {
+            char line_directive[64];
+            snprintf(line_directive, sizeof(line_directive), "#line %zu 0\n", line_number + 1);
+
+            append_to_source(builder, line, line_len, err);
+            if (!line_end) { append_to_source(builder, "\n", 1, err); }
+            append_to_source(builder, prologue, strlen(prologue), err);
+            append_to_source(builder, line_directive, strlen(line_directive), err);
+        } else if (sscanf(directive, "#include \"%255[^\"]\"", include_name) == 1) {
+            char include_path[768];
+            snprintf(include_path, sizeof(include_path), "%s%s", directory, include_name);
+
+            char line_directive[64];
+            usize const include_index = arrlen(*dependencies);
+            snprintf(line_directive, sizeof(line_directive), "#line 1 %zu\n", include_index);
+            append_to_source(builder, line_directive, strlen(line_directive), err);
+            append_source_with_includes(
+                builder, include_path, NULL, dependencies, depth + 1, err);
+
+            snprintf(
+                line_directive,
+                sizeof(line_directive),
+                "\n#line %zu %zu\n",
+                line_number + 1,
+                source_index);
+            append_to_source(builder, line_directive, strlen(line_directive), err);
+        } else {
+            append_to_source(builder, line, line_len, err);
+        }
+
+        line += line_len;
+    }
+
+    free(data);
+}
+
+static char *alloc_source_with_includes(
+    char const *path, char const *prologue, char ***dependencies, Err *err) {
+    if (*err) { return NULL; }
+
+    SourceBuilder builder = { 0 };
+    append_source_with_includes(&builder, path, prologue, dependencies, 0, err);
+    if (*err) {
+        free(builder.data);
+        return NULL;
+    }
+
+    return builder.data;
+}
+
+static void dealloc_dependencies(char ***dependencies) {
+    for (usize i = 0; i < arrlen(*dependencies); ++i) { free((*dependencies)[i]); }
+    arrfree(*dependencies);
+}
+
+static void dealloc_sources(ShaderSources *sources) {
+    free((char *) sources->geometry);
+    free((char *) sources->fragment);
+    free((char *) sources->vertex);
+    *sources = (ShaderSources) { 0 };
+}
+
+// @Note: if dependencies isn't null, the paths of every file that was read are added to it.
+static ShaderSources alloc_sources_from_filepaths(
+    ShaderFilepaths const path, char const *prologue, char ***dependencies, Err *err) {
+    if (*err) { return (ShaderSources) { 0 }; }
+
+    char const *const stage_paths[3] = { path.vertex, path.fragment, path.geometry };
+    char *stage_sources[3] = { 0 };
 
-    char *vertex_source = alloc_data_from_filepath(path.vertex, err);
-    char *fragment_source = alloc_data_from_filepath(path.fragment, err);
-    char *geometry_source = has_geometry ? alloc_data_from_filepath(path.geometry, err) : NULL;
+    for (usize i = 0; i < 3; ++i) {
+        if (!stage_paths[i]) { continue; }
 
-    Shader const shader = new_shader_from_source(
-        (ShaderSources) { vertex_source, fragment_source, geometry_source }, err);
+        // @Note: each stage is expanded on its own, as they're separate compilation units.
+        char **stage_dependencies = NULL;
+        stage_sources[i] =
+            alloc_source_with_includes(stage_paths[i], prologue, &stage_dependencies, err);
 
-    free(geometry_source);
-    free(fragment_source);
-    free(vertex_source);
+        if (dependencies) {
+            for (usize j = 0; j < arrlen(stage_dependencies); ++j) {
+                bool was_added = false;
+                find_or_add_dependency(dependencies, stage_dependencies[j], &was_added);
+            }
+        }
+        dealloc_dependencies(&stage_dependencies);
+    }
+
+    ShaderSources sources = { stage_sources[0], stage_sources[1], stage_sources[2] };
+    if (*err) { dealloc_sources(&sources); }
+    return sources;
+}
+
+// @Note: the #define lines that are injected into every stage of a permutation.
+static char *alloc_defines_prologue(ShaderDefine const defines[], usize count, Err *err) {
+    if (*err) { return NULL; }
+
+    SourceBuilder builder = { 0 };
+    append_to_source(&builder, "", 0, err); // @Note: so that it's never null (if count is 0)
+    for (usize i = 0; i < count; ++i) {
+        char line[256];
+        snprintf(line, sizeof(line), "#define %s %d\n", defines[i].name, defines[i].value);
+        append_to_source(&builder, line, strlen(line), err);
+    }
+
+    if (*err) {
+        free(builder.data);
+        return NULL;
+    }
 
+    return builder.data;
+}
+
+// @Note: depends on the order of the defines, so callers should always list them the same way.
+static u64 hash_defines(ShaderDefine const defines[], usize count) {
+    u64 hash = hash_str("ShaderDefines", count);
+    for (usize i = 0; i < count; ++i) {
+        hash = hash_combine(hash, hash_str(defines[i].name, 0));
+        hash = hash_combine(hash, (u64) (i64) defines[i].value);
+    }
+    return hash;
+}
+
+//
+// Shader programs.
+//
+
+// @Note: a program that has been submitted to the driver, but whose shaders may still be
+// compiling (and whose linking may still be in progress) in the background.
+typedef struct PendingProgram {
+    ShaderSources source;
+    uint program_id;
+    uint shader_ids[3]; // vertex, fragment, and geometry (which may be 0)
+    bool use_cache;
+    bool is_cached; // @Note: if true, the program was loaded already linked from the cache
+    bool is_finished;
+    u64 cache_key;
+} PendingProgram;
+
+static uint const SHADER_TYPES[3] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+static char const *const SHADER_TYPE_STRINGS[3] = { "vertex", "fragment", "geometry" };
+
+// @Note: doesn't wait on (nor query) any results, so drivers that compile in the
+// background can work on every program submitted in a batch at the same time.
+static void submit_program(PendingProgram *pending) {
+    char const *const stage_sources[3] = {
+        pending->source.vertex, pending->source.fragment, pending->source.geometry,
+    };
+
+    pending->program_id = glCreateProgram();
+    for (usize i = 0; i < 3; ++i) {
+        if (!stage_sources[i]) { continue; }
+        uint const id = glCreateShader(SHADER_TYPES[i]);
+        glShaderSource(id, 1, &stage_sources[i], NULL);
+        glCompileShader(id);
+        glAttachShader(pending->program_id, id);
+        pending->shader_ids[i] = id;
+    }
+
+    if (pending->use_cache) {
+        glProgramParameteri(pending->program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+    }
+
+    glLinkProgram(pending->program_id);
+}
+
+static bool is_program_completed(PendingProgram const *pending) {
+    if (pending->is_cached || !GLAD_GL_KHR_parallel_shader_compile) { return true; }
+
+    int is_completed = 0;
+    glGetProgramiv(pending->program_id, GL_COMPLETION_STATUS_KHR, &is_completed);
+    return is_completed;
+}
+
+// @Note: blocks until the program is linked (if it's still being compiled in the background).
+static Shader finish_program(PendingProgram *pending, Err *err) {
+    assert(!pending->is_finished);
+    pending->is_finished = true;
+
+    uint const program_id = pending->program_id;
+
+    if (!pending->is_cached) {
+        char info_log[INFO_LOG_LENGTH] = { 0 };
+        Err program_err = Err_None;
+
+        for (usize i = 0; i < 3; ++i) {
+            if (!pending->shader_ids[i]) { continue; }
+            if (!is_shader_compile_success(pending->shader_ids[i], info_log, &program_err)) {
+                char const *type_string = SHADER_TYPE_STRINGS[i];
+                GLOW_WARNING("%s shader compilation failed with: `\n%s`", type_string, info_log);
+            }
+        }
+
+        if (!is_program_link_success(program_id, info_log, &program_err)) {
+            if (program_err == Err_Shader_Link) {
+                GLOW_WARNING("shader program linking failed with: `\n%s`", info_log);
+            }
+        } else if (pending->use_cache) {
+            write_program_to_cache(program_id, pending->cache_key);
+        }
+
+        for (usize i = 0; i < 3; ++i) { glDeleteShader(pending->shader_ids[i]); }
+
+        if (program_err && !*err) { *err = program_err; }
+    }
+
+    ShaderUniformTable *uniforms = alloc_uniform_table(program_id, err);
+
+    return (Shader) { program_id, uniforms };
+}
+
+// @Note: loads the program from the cache if possible, otherwise it still has to be submitted.
+static void begin_program(PendingProgram *pending, ShaderSources const source) {
+    *pending = (PendingProgram) { .source = source, .use_cache = is_program_cache_enabled() };
+    if (!pending->use_cache) { return; }
+
+    pending->cache_key = compute_program_cache_key(source);
+    pending->program_id = try_load_program_from_cache(pending->cache_key);
+    pending->is_cached = pending->program_id != 0;
+    program_cache_stats.hits += pending->is_cached ? 1 : 0;
+    program_cache_stats.misses += pending->is_cached ? 0 : 1;
+}
+
+static void finish_reload_job(void);
+
+typedef struct SubmitProgramJobs {
+    PendingProgram *pending;
+    usize const *uncached; // @Note: the indices of the programs that weren't cached
+    usize uncached_len;
+    usize jobs_len;
+} SubmitProgramJobs;
+
+// @Note: each job owns one of the shared contexts, and submits every jobs_len-th uncached
+// program (so that every one of them is submitted, however few there are).
+static void submit_programs_job(void *data, usize index) {
+    SubmitProgramJobs const *jobs = data;
+
+    make_shared_context_current((int) index);
+    for (usize i = index; i < jobs->uncached_len; i += jobs->jobs_len) {
+        submit_program(&jobs->pending[jobs->uncached[i]]);
+    }
+
+    // Make sure that the results are visible to the main context before we release this one.
+    glFinish();
+    make_shared_context_current(-1);
+}
+
+void new_shaders_from_sources(
+    ShaderSources const sources[], Shader shaders[], usize count, Err *err) {
+    if (*err) { return; }
+
+    PendingProgram *pending = calloc(count, sizeof(PendingProgram));
+    if (!pending) {
+        *err = Err_Calloc;
+        return;
+    }
+
+    // Load every program that we already have a binary of.
+    usize uncached_len = 0;
+    for (usize i = 0; i < count; ++i) {
+        begin_program(&pending[i], sources[i]);
+        uncached_len += pending[i].is_cached ? 0 : 1;
+    }
+
+    // Submit all of the other programs, before checking the status of any of them.
+    // @Note: if the indices can't be allocated, the programs are simply submitted one by one.
+    usize const contexts_len = (usize) get_shared_contexts_len();
+    usize *uncached = NULL;
+    if (contexts_len > 0 && uncached_len > 1) { uncached = calloc(uncached_len, sizeof(usize)); }
+    if (uncached) {
+        finish_reload_job(); // @Note: as it may be using one of the shared contexts
+
+
+        usize uncached_i = 0;
+        for (usize i = 0; i < count; ++i) {
+            if (!pending[i].is_cached) { uncached[uncached_i++] = i; }
+        }
+
+        usize const jobs_len = MIN(contexts_len, uncached_len);
+        SubmitProgramJobs jobs = { pending, uncached, uncached_len, jobs_len };
+        run_jobs(submit_programs_job, &jobs, jobs_len);
+        make_main_context_current();
+        free(uncached);
+    } else {
+        for (usize i = 0; i < count; ++i) {
+            if (!pending[i].is_cached) { submit_program(&pending[i]); }
+        }
+    }
+
+    // Finish programs in the order that they complete, only blocking if none has.
+    usize finished_len = 0;
+    while (finished_len < count) {
+        usize const previous_finished_len = finished_len;
+        for (usize i = 0; i < count; ++i) {
+            if (pending[i].is_finished || !is_program_completed(&pending[i])) { continue; }
+            shaders[i] = finish_program(&pending[i], err);
+            finished_len += 1;
+        }
+
+        if (finished_len == previous_finished_len) {
+            for (usize i = 0; i < count; ++i) {
+                if (pending[i].is_finished) { continue; }
+                shaders[i] = finish_program(&pending[i], err);
+                finished_len += 1;
+                break;
+            }
+        }
+    }
+
+    free(pending);
+}
+
+void new_shaders_from_filepaths(
+    ShaderFilepaths const paths[], Shader shaders[], usize count, Err *err) {
+    if (*err) { return; }
+
+    ShaderSources *sources = calloc(count, sizeof(ShaderSources));
+    if (!sources) {
+        *err = Err_Calloc;
+        return;
+    }
+
+    for (usize i = 0; i < count; ++i) {
+        sources[i] = alloc_sources_from_filepaths(paths[i], NULL, NULL, err);
+    }
+
+    new_shaders_from_sources(sources, shaders, count, err);
+
+    for (usize i = 0; i < count; ++i) { dealloc_sources(&sources[i]); }
+    free(sources);
+}
+
+Shader new_shader_from_source(ShaderSources const source, Err *err) {
+    Shader shader = { 0 };
+    new_shaders_from_sources(&source, &shader, 1, err);
+    return shader;
+}
+
+Shader new_shader_from_filepath(ShaderFilepaths const path, Err *err) {
+    Shader shader = { 0 };
+    new_shaders_from_filepaths(&path, &shader, 1, err);
     return shader;
 }
 
+// @Note: takes over new_shader's program (destroying whatever is left of new_shader after it).
+static void replace_shader_program(Shader *shader, Shader *new_shader) {
+    forget_gl_program(shader->program_id);
+    glDeleteProgram(shader->program_id);
+    shader->program_id = new_shader->program_id;
+    new_shader->program_id = 0;
+
+    // @Note: rebuild the existing table (instead of using the new one), so that
+    // the ShaderUniform handles into it, which are indices, remain valid.
+    if (shader->uniforms) {
+        update_uniform_table(shader->uniforms, shader->program_id);
+    } else {
+        SWAP(ShaderUniformTable *, shader->uniforms, new_shader->uniforms);
+    }
+
+    destroy_shader(new_shader);
+}
+
 static Err try_reload_shader(
     Shader *shader,
     Shader (*new_shader_fn)(ShaderStrings const, Err *),
     ShaderStrings const new_shader_arg) {
     Err err = Err_None;
 
-    Shader const new_shader = new_shader_fn(new_shader_arg, &err);
+    Shader new_shader = new_shader_fn(new_shader_arg, &err);
     if (err == Err_None) {
-        glDeleteProgram(shader->program_id);
-        shader->program_id = new_shader.program_id;
+        replace_shader_program(shader, &new_shader);
+    } else {
+        destroy_shader(&new_shader);
     }
 
     return err;
@@ -96,24 +885,497 @@ bool try_reload_shader_from_filepath(Shader *shader, ShaderFilepaths const path)
     return Err_None == try_reload_shader(shader, new_shader_from_filepath, path);
 }
 
+//
+// Hot reloading.
+//
+
+typedef struct RegisteredShader {
+    Shader *shader;
+    ShaderSetupFn setup; // @Note: called after every reload (may be null)
+    char *prologue; // @Ownership (may be null, see alloc_defines_prologue)
+    char *paths[3]; // @Ownership (vertex, fragment, and geometry, which may be null)
+    char **dependencies; // @Ownership (dynarray of every file its sources were read from)
+    bool is_dirty;
+    bool is_pending;
+    bool is_in_reload_job; // @Note: its program is still being submitted (see reload_job)
+    PendingProgram pending;
+} RegisteredShader;
+
+static struct {
+    RegisteredShader *entries; // dynarray
+    FileWatcher *watcher;
+
+    // @Note: without KHR_parallel_shader_compile, reloaded programs are submitted on the last
+    // shared context by a background job, so that compiling them doesn't stall the frame.
+    BackgroundJob *reload_job; // @Note: null if there isn't one in flight
+    Shader **reload_shaders; // dynarray, identifying the entries (whose array may move)
+    PendingProgram *reload_pending; // dynarray, @Ownership of their sources
+} registry;
+
+static bool should_reload_in_background(void) {
+    return !GLAD_GL_KHR_parallel_shader_compile && get_shared_contexts_len() > 0;
+}
+
+static RegisteredShader *find_registered_shader(Shader const *shader) {
+    for (usize i = 0; i < arrlen(registry.entries); ++i) {
+        if (registry.entries[i].shader == shader) { return &registry.entries[i]; }
+    }
+    return NULL;
+}
+
+static void submit_reload_job(void *data, usize index) {
+    UNUSED(data);
+    UNUSED(index);
+
+    make_shared_context_current(get_shared_contexts_len() - 1);
+    for (usize i = 0; i < arrlen(registry.reload_pending); ++i) {
+        submit_program(&registry.reload_pending[i]);
+    }
+
+    // Make sure that the results are visible to the main context before we release this one.
+    glFinish();
+    make_shared_context_current(-1);
+}
+
+// @Note: waits for the reload job (if there's one), handing its programs back to their entries.
+static void finish_reload_job(void) {
+    wait_for_background_job(registry.reload_job);
+    registry.reload_job = NULL;
+
+    for (usize i = 0; i < arrlen(registry.reload_pending); ++i) {
+        PendingProgram *pending = &registry.reload_pending[i];
+        dealloc_sources(&pending->source);
+
+        RegisteredShader *entry = find_registered_shader(registry.reload_shaders[i]);
+        assert(entry && entry->is_in_reload_job);
+        entry->pending = *pending;
+        entry->is_in_reload_job = false;
+    }
+
+    arrclear(registry.reload_shaders);
+    arrclear(registry.reload_pending);
+}
+
+static ShaderFilepaths get_registered_shader_filepaths(RegisteredShader const *entry) {
+    return (ShaderFilepaths) { entry->paths[0], entry->paths[1], entry->paths[2] };
+}
+
+static void watch_dependencies(char **dependencies) {
+    if (!registry.watcher) { return; }
+    for (usize i = 0; i < arrlen(dependencies); ++i) {
+        watch_file(registry.watcher, dependencies[i]);
+    }
+}
+
+static void dealloc_registered_shader(RegisteredShader *entry) {
+    if (entry->is_pending) {
+        // @Note: it's fine to delete a program (and its shaders) that is still being compiled.
+        glDeleteProgram(entry->pending.program_id);
+        for (usize i = 0; i < 3; ++i) { glDeleteShader(entry->pending.shader_ids[i]); }
+    }
+    for (usize i = 0; i < 3; ++i) { free(entry->paths[i]); }
+    free(entry->prologue);
+    dealloc_dependencies(&entry->dependencies);
+}
+
+// @Note: takes over the dependencies (i.e. the files that its sources were read from).
+static void register_shader_with_dependencies(
+    Shader *shader,
+    ShaderFilepaths const path,
+    char const *prologue,
+    ShaderSetupFn setup,
+    char **dependencies) {
+    Err err = Err_None;
+
+    if (!registry.watcher) {
+        registry.watcher = alloc_file_watcher(&err);
+        if (err) {
+            GLOW_WARNING("failed to create file watcher, so shaders will only reload manually");
+            err = Err_None;
+        }
+    }
+
+    RegisteredShader entry = { .shader = shader, .setup = setup, .dependencies = dependencies };
+    char const *const stage_paths[3] = { path.vertex, path.fragment, path.geometry };
+    for (usize i = 0; i < 3; ++i) {
+        if (stage_paths[i]) { entry.paths[i] = alloc_str_copy(stage_paths[i], &err); }
+    }
+    if (prologue) { entry.prologue = alloc_str_copy(prologue, &err); }
+
+    if (err) {
+        GLOW_WARNING("failed to register shader with: `%s`", path.vertex);
+        dealloc_registered_shader(&entry);
+        return;
+    }
+
+    watch_dependencies(entry.dependencies);
+    arrpush(registry.entries, entry);
+}
+
+void register_shader(Shader *shader, ShaderFilepaths const path) {
+    Err err = Err_None;
+
+    // @Note: the sources are only read to find their dependencies (i.e. the files to watch),
+    // new_registered_shaders_from_filepaths() avoids this by keeping the ones it compiled.
+    char **dependencies = NULL;
+    ShaderSources sources = alloc_sources_from_filepaths(path, NULL, &dependencies, &err);
+    dealloc_sources(&sources);
+
+    if (err) {
+        GLOW_WARNING("failed to register shader with: `%s`", path.vertex);
+        dealloc_dependencies(&dependencies);
+        return;
+    }
+
+    register_shader_with_dependencies(shader, path, NULL, NULL, dependencies);
+}
+
+void new_registered_shaders_from_filepaths(
+    ShaderFilepaths const paths[], Shader *const shaders[], usize count, Err *err) {
+    if (*err) { return; }
+
+    ShaderSources *sources = calloc(count, sizeof(ShaderSources));
+    char ***dependencies = calloc(count, sizeof(char **));
+    Shader *new_shaders = calloc(count, sizeof(Shader));
+    if (!sources || !dependencies || !new_shaders) {
+        *err = Err_Calloc;
+    } else {
+        for (usize i = 0; i < count; ++i) {
+            sources[i] = alloc_sources_from_filepaths(paths[i], NULL, &dependencies[i], err);
+        }
+
+        new_shaders_from_sources(sources, new_shaders, count, err);
+        for (usize i = 0; i < count; ++i) { *shaders[i] = new_shaders[i]; }
+
+        for (usize i = 0; *err == Err_None && i < count; ++i) {
+            register_shader_with_dependencies(shaders[i], paths[i], NULL, NULL, dependencies[i]);
+            dependencies[i] = NULL;
+        }
+
+        for (usize i = 0; i < count; ++i) {
+            dealloc_dependencies(&dependencies[i]);
+            dealloc_sources(&sources[i]);
+        }
+    }
+
+    free(new_shaders);
+    free(dependencies);
+    free(sources);
+}
+
+void unregister_shader(Shader const *shader) {
+    finish_reload_job(); // @Note: so that none of its programs belongs to the entry
+
+    for (usize i = 0; i < arrlen(registry.entries); ++i) {
+        if (registry.entries[i].shader != shader) { continue; }
+        dealloc_registered_shader(&registry.entries[i]);
+        arrdelswap(registry.entries, i);
+        break;
+    }
+
+    if (arrlen(registry.entries) == 0) {
+        arrfree(registry.reload_pending);
+        arrfree(registry.reload_shaders);
+        arrfree(registry.entries);
+        dealloc_file_watcher(registry.watcher);
+        registry.watcher = NULL;
+    }
+}
+
+void mark_all_shaders_dirty(void) {
+    for (usize i = 0; i < arrlen(registry.entries); ++i) { registry.entries[i].is_dirty = true; }
+}
+
+static void mark_dependents_dirty(char const *path, void *data) {
+    UNUSED(data);
+    for (usize i = 0; i < arrlen(registry.entries); ++i) {
+        RegisteredShader *entry = &registry.entries[i];
+        for (usize j = 0; j < arrlen(entry->dependencies); ++j) {
+            if (!strcmp(entry->dependencies[j], path)) {
+                entry->is_dirty = true;
+                break;
+            }
+        }
+    }
+}
+
+// @Note: re-reads the sources (picking up added or removed #includes) and submits the program,
+// without waiting for it, as update_shader_registry() only finishes it once it has completed.
+static void submit_registered_shader(RegisteredShader *entry) {
+    Err err = Err_None;
+
+    char **dependencies = NULL;
+    ShaderFilepaths const path = get_registered_shader_filepaths(entry);
+    ShaderSources sources =
+        alloc_sources_from_filepaths(path, entry->prologue, &dependencies, &err);
+    if (err) {
+        // @Note: keep the previous program, and try again on the next change.
+        GLOW_WARNING("failed to read the sources of shader with: `%s`", path.vertex);
+        dealloc_dependencies(&dependencies);
+        return;
+    }
+
+    begin_program(&entry->pending, sources);
+    if (!entry->pending.is_cached && should_reload_in_background()) {
+        // @Note: the reload job takes over the sources, and is started once every dirty
+        // entry has joined it (see update_shader_registry).
+        arrpush(registry.reload_shaders, entry->shader);
+        arrpush(registry.reload_pending, entry->pending);
+        entry->is_in_reload_job = true;
+    } else {
+        if (!entry->pending.is_cached) { submit_program(&entry->pending); }
+        dealloc_sources(&sources);
+    }
+    entry->pending.source = (ShaderSources) { 0 };
+    entry->is_pending = true;
+
+    dealloc_dependencies(&entry->dependencies);
+    entry->dependencies = dependencies;
+    watch_dependencies(entry->dependencies);
+}
+
+usize update_shader_registry(void) {
+    if (registry.watcher) { poll_file_watcher(registry.watcher, mark_dependents_dirty, NULL); }
+
+    if (is_background_job_done(registry.reload_job)) { finish_reload_job(); }
+
+    usize reloaded_len = 0;
+    for (usize i = 0; i < arrlen(registry.entries); ++i) {
+        RegisteredShader *entry = &registry.entries[i];
+
+        // @Note: a change while the previous one is still compiling waits for it to finish, as
+        // do all changes while a reload job is in flight (as it's reading its programs).
+        if (entry->is_dirty && !entry->is_pending && !registry.reload_job) {
+            entry->is_dirty = false;
+            submit_registered_shader(entry);
+        }
+
+        if (!entry->is_pending || entry->is_in_reload_job) { continue; }
+        if (!is_program_completed(&entry->pending)) { continue; }
+
+        Err err = Err_None;
+        Shader new_shader = finish_program(&entry->pending, &err);
+        entry->is_pending = false;
+
+        if (err == Err_None) {
+            replace_shader_program(entry->shader, &new_shader);
+            if (entry->setup) { entry->setup(*entry->shader); }
+            reloaded_len += 1;
+        } else {
+            GLOW_WARNING("keeping the previous program of shader with: `%s`", entry->paths[0]);
+            destroy_shader(&new_shader);
+        }
+    }
+
+    if (arrlen(registry.reload_pending) > 0 && !registry.reload_job) {
+        registry.reload_job = start_background_job(submit_reload_job, NULL);
+    }
+
+    return reloaded_len;
+}
+
+//
+// Permutations.
+//
+
+typedef struct ShaderPermutation {
+    u64 key; // @Note: see hash_defines
+    Shader *shader; // @Ownership (heap allocated, so that it can be registered)
+} ShaderPermutation;
+
+struct ShaderPermutations {
+    char *paths[3]; // @Ownership (vertex, fragment, and geometry, which may be null)
+    ShaderSetupFn setup;
+    ShaderPermutation *variants; // dynarray
+};
+
+ShaderPermutations *
+alloc_shader_permutations(ShaderFilepaths const path, ShaderSetupFn setup, Err *err) {
+    if (*err) { return NULL; }
+
+    ShaderPermutations *permutations = calloc(1, sizeof(ShaderPermutations));
+    if (!permutations) {
+        *err = Err_Calloc;
+        return NULL;
+    }
+
+    permutations->setup = setup;
+    char const *const stage_paths[3] = { path.vertex, path.fragment, path.geometry };
+    for (usize i = 0; i < 3; ++i) {
+        if (stage_paths[i]) { permutations->paths[i] = alloc_str_copy(stage_paths[i], err); }
+    }
+
+    if (*err) {
+        dealloc_shader_permutations(permutations);
+        return NULL;
+    }
+
+    return permutations;
+}
+
+void dealloc_shader_permutations(ShaderPermutations *permutations) {
+    if (!permutations) { return; }
+
+    for (usize i = 0; i < arrlen(permutations->variants); ++i) {
+        Shader *shader = permutations->variants[i].shader;
+        unregister_shader(shader);
+        destroy_shader(shader);
+        free(shader);
+    }
+    arrfree(permutations->variants);
+
+    for (usize i = 0; i < 3; ++i) { free(permutations->paths[i]); }
+    free(permutations);
+}
+
+Shader const *get_shader_permutation(
+    ShaderPermutations *permutations, ShaderDefine const defines[], usize count, Err *err) {
+    if (*err) { return NULL; }
+
+    u64 const key = hash_defines(defines, count);
+    for (usize i = 0; i < arrlen(permutations->variants); ++i) {
+        if (permutations->variants[i].key == key) { return permutations->variants[i].shader; }
+    }
+
+    Shader *shader = calloc(1, sizeof(Shader));
+    char *prologue = alloc_defines_prologue(defines, count, err);
+    if (!shader || *err) {
+        if (!*err) { *err = Err_Calloc; }
+        free(prologue);
+        free(shader);
+        return NULL;
+    }
+
+    ShaderFilepaths const path = {
+        permutations->paths[0], permutations->paths[1], permutations->paths[2],
+    };
+    char **dependencies = NULL;
+    ShaderSources sources = alloc_sources_from_filepaths(path, prologue, &dependencies, err);
+    *shader = new_shader_from_source(sources, err);
+    dealloc_sources(&sources);
+
+    // @Note: failed variants are still stored (and registered), with a null program, so that
+    // they aren't compiled again on every lookup, and so that fixing their sources reloads them.
+    if (*err) {
+        GLOW_WARNING("failed to create shader permutation of: `%s`", path.vertex);
+        destroy_shader(shader);
+    } else if (permutations->setup) {
+        permutations->setup(*shader);
+    }
+
+    register_shader_with_dependencies(
+        shader, path, prologue, permutations->setup, dependencies);
+    free(prologue);
+
+    ShaderPermutation const variant = { key, shader };
+    arrpush(permutations->variants, variant);
+    return shader;
+}
+
+void destroy_shader(Shader *shader) {
+    forget_gl_program(shader->program_id);
+    glDeleteProgram(shader->program_id);
+    shader->program_id = 0;
+
+    dealloc_uniform_table(shader->uniforms);
+    shader->uniforms = NULL;
+}
+
 void use_shader(Shader const shader) {
-    glUseProgram(shader.program_id);
+    bind_gl_program(shader.program_id);
+}
+
+void bind_shader_uniform_block(Shader const shader, char const *name, uint binding) {
+    uint const index = glGetUniformBlockIndex(shader.program_id, name);
+    if (index == GL_INVALID_INDEX) {
+        GLOW_WARNING("failed to find uniform block: `%s`", name);
+        return;
+    }
+    glUniformBlockBinding(shader.program_id, index, binding);
 }
 
 /* clang-format off */
-void set_shader_int(Shader const shader, char const *name, int value) { glUniform1i(get_uniform_location(shader.program_id, name), value); }
-void set_shader_bool(Shader const shader, char const *name, bool value) { glUniform1i(get_uniform_location(shader.program_id, name), (int) value); }
-void set_shader_float(Shader const shader, char const *name, f32 value) { glUniform1f(get_uniform_location(shader.program_id, name), value); }
+void set_shader_int(Shader const shader, char const *name, int value) { glUniform1i(find_uniform_location(shader, name), value); }
+void set_shader_bool(Shader const shader, char const *name, bool value) { glUniform1i(find_uniform_location(shader, name), (int) value); }
+void set_shader_float(Shader const shader, char const *name, f32 value) { glUniform1f(find_uniform_location(shader, name), value); }
+void set_shader_float_array(Shader const shader, char const *name, f32 const values[], usize len) { glUniform1fv(find_uniform_location(shader, name), (int) len, values); }
 
 void set_shader_sampler2D(Shader const shader, char const *name, uint texture_unit) {
+    // @Note: through its handle, so that get_shader_sampler_unit() returns the new unit.
+    if (shader.uniforms) {
+        set_shader_uniform_sampler2D(shader, get_shader_uniform(shader, name), texture_unit);
+        return;
+    }
+
     assert(texture_unit >= GL_TEXTURE0);
-    glUniform1i(get_uniform_location(shader.program_id, name), (int) (texture_unit - GL_TEXTURE0));
+    glUniform1i(find_uniform_location(shader, name), (int) (texture_unit - GL_TEXTURE0));
+}
+
+void set_shader_vec2(Shader const shader, char const *name, vec2 const vec) { glUniform2fv(find_uniform_location(shader, name), 1, (f32 *) &vec); }
+void set_shader_vec3(Shader const shader, char const *name, vec3 const vec) { glUniform3fv(find_uniform_location(shader, name), 1, (f32 *) &vec); }
+void set_shader_vec3_array(Shader const shader, char const *name, vec3 const vecs[], usize len) { glUniform3fv(find_uniform_location(shader, name), (int) len, (f32 const *) vecs); }
+void set_shader_vec4(Shader const shader, char const *name, vec4 const vec) { glUniform4fv(find_uniform_location(shader, name), 1, (f32 *) &vec); }
+void set_shader_vec4_array(Shader const shader, char const *name, vec4 const vecs[], usize len) { glUniform4fv(find_uniform_location(shader, name), (int) len, (f32 const *) vecs); }
+
+void set_shader_mat3(Shader const shader, char const *name, mat3 const mat) { glUniformMatrix3fv(find_uniform_location(shader, name), 1, GL_FALSE, &mat.m[0][0]); }
+void set_shader_mat4(Shader const shader, char const *name, mat4 const mat) { glUniformMatrix4fv(find_uniform_location(shader, name), 1, GL_FALSE, &mat.m[0][0]); }
+void set_shader_mat4_array(Shader const shader, char const *name, mat4 const mats[], usize len) { glUniformMatrix4fv(find_uniform_location(shader, name), (int) len, GL_FALSE, &mats[0].m[0][0]); }
+/* clang-format on */
+
+//
+// Uniform handles.
+//
+
+ShaderUniform get_shader_uniform(Shader const shader, char const *name) {
+    if (!shader.uniforms) { return (ShaderUniform) { UINT_MAX }; }
+
+    u64 const hash = hash_str(name, 0);
+    i64 index = find_uniform_index(shader.uniforms, name, hash);
+    if (index == -1) {
+        int const location = get_uniform_location(shader.program_id, name);
+        index = insert_uniform(shader.uniforms, name, hash, location);
+    }
+
+    if (index == -1) { GLOW_WARNING("failed to store uniform: `%s`", name); }
+    return (ShaderUniform) { index == -1 ? UINT_MAX : (uint) index };
+}
+
+int get_shader_uniform_location(Shader const shader, ShaderUniform const uniform) {
+    if (!shader.uniforms || uniform.index >= shader.uniforms->len) { return -1; }
+    return shader.uniforms->locations[uniform.index];
+}
+
+ShaderUniformReflection
+get_shader_uniform_reflection(Shader const shader, ShaderUniform const uniform) {
+    if (!shader.uniforms || uniform.index >= shader.uniforms->len) {
+        return (ShaderUniformReflection) { 0 };
+    }
+    return shader.uniforms->reflections[uniform.index];
+}
+
+uint get_shader_sampler_unit(Shader const shader, char const *name) {
+    return get_shader_uniform_reflection(shader, get_shader_uniform(shader, name)).texture_unit;
+}
+
+/* clang-format off */
+void set_shader_uniform_int(Shader const shader, ShaderUniform const uniform, int value) { glUniform1i(get_shader_uniform_location(shader, uniform), value); }
+void set_shader_uniform_bool(Shader const shader, ShaderUniform const uniform, bool value) { glUniform1i(get_shader_uniform_location(shader, uniform), (int) value); }
+void set_shader_uniform_float(Shader const shader, ShaderUniform const uniform, f32 value) { glUniform1f(get_shader_uniform_location(shader, uniform), value); }
+
+void set_shader_uniform_sampler2D(Shader const shader, ShaderUniform const uniform, uint texture_unit) {
+    assert(texture_unit >= GL_TEXTURE0);
+    glUniform1i(get_shader_uniform_location(shader, uniform), (int) (texture_unit - GL_TEXTURE0));
+
+    // @Note: only active samplers have a reflected unit (inactive uniforms are zeroed).
+    if (!shader.uniforms || uniform.index >= shader.uniforms->len) { return; }
+    ShaderUniformReflection *reflection = &shader.uniforms->reflections[uniform.index];
+    if (is_sampler_type(reflection->type)) { reflection->texture_unit = texture_unit; }
 }
 
-void set_shader_vec2(Shader const shader, char const *name, vec2 const vec) { glUniform2fv(get_uniform_location(shader.program_id, name), 1, (f32 *) &vec); }
-void set_shader_vec3(Shader const shader, char const *name, vec3 const vec) { glUniform3fv(get_uniform_location(shader.program_id, name), 1, (f32 *) &vec); }
-void set_shader_vec4(Shader const shader, char const *name, vec4 const vec) { glUniform4fv(get_uniform_location(shader.program_id, name), 1, (f32 *) &vec); }
+void set_shader_uniform_vec2(Shader const shader, ShaderUniform const uniform, vec2 const vec) { glUniform2fv(get_shader_uniform_location(shader, uniform), 1, (f32 *) &vec); }
+void set_shader_uniform_vec3(Shader const shader, ShaderUniform const uniform, vec3 const vec) { glUniform3fv(get_shader_uniform_location(shader, uniform), 1, (f32 *) &vec); }
+void set_shader_uniform_vec4(Shader const shader, ShaderUniform const uniform, vec4 const vec) { glUniform4fv(get_shader_uniform_location(shader, uniform), 1, (f32 *) &vec); }
 
-void set_shader_mat3(Shader const shader, char const *name, mat3 const mat) { glUniformMatrix3fv(get_uniform_location(shader.program_id, name), 1, GL_FALSE, &mat.m[0][0]); }
-void set_shader_mat4(Shader const shader, char const *name, mat4 const mat) { glUniformMatrix4fv(get_uniform_location(shader.program_id, name), 1, GL_FALSE, &mat.m[0][0]); }
+void set_shader_uniform_mat3(Shader const shader, ShaderUniform const uniform, mat3 const mat) { glUniformMatrix3fv(get_shader_uniform_location(shader, uniform), 1, GL_FALSE, &mat.m[0][0]); }
+void set_shader_uniform_mat4(Shader const shader, ShaderUniform const uniform, mat4 const mat) { glUniformMatrix4fv(get_shader_uniform_location(shader, uniform), 1, GL_FALSE, &mat.m[0][0]); }
 /* clang-format on */
@@ -4,10 +4,29 @@
 
 #include "maths_types.h"
 
+// @Note: resolved uniform locations (by name), which are queried from GL_ACTIVE_UNIFORMS after
+// linking and lazily added to on lookups of other names (e.g. non-first elements of arrays).
+typedef struct ShaderUniformTable ShaderUniformTable;
+
 typedef struct Shader {
     uint program_id;
+    ShaderUniformTable *uniforms; // @Ownership (shared by copies of the Shader)
 } Shader;
 
+// @Note: typed handle into a shader's uniform table, which skips the name lookup entirely and
+// stays valid when the shader is reloaded (as its uniforms' locations are resolved again).
+typedef struct ShaderUniform {
+    uint index;
+} ShaderUniform;
+
+// @Note: what glGetActiveUniform() reports for an active uniform (which is zeroed for inactive
+// ones), along with the texture unit that was assigned to it, if it's a sampler (see below).
+typedef struct ShaderUniformReflection {
+    uint type; // e.g. GL_FLOAT_VEC3 or GL_SAMPLER_2D
+    int size; // @Note: number of elements, for arrays
+    uint texture_unit; // @Note: GL_TEXTURE0 + unit (or 0 if it isn't a sampler)
+} ShaderUniformReflection;
+
 // @Note: geometry may be null, but vertex and fragment are assumed not to be.
 typedef struct ShaderStrings {
     char const *vertex;
@@ -18,20 +37,112 @@ typedef struct ShaderStrings {
 typedef ShaderStrings ShaderSources;
 typedef ShaderStrings ShaderFilepaths;
 
+// @Note: injected as `#define name value` lines, right after the `#version` directive of every
+// stage (so shaders should guard their defaults with #ifndef). Values are integers, since that's
+// all that #if can test, and what compile-time constants like array sizes need anyway.
+typedef struct ShaderDefine {
+    char const *name;
+    int value;
+} ShaderDefine;
+
+// @Note: per-program state (e.g. bound uniform blocks and samplers) that has to be set up
+// again whenever a new program is created for the shader (i.e. on creation and reloads).
+typedef void (*ShaderSetupFn)(Shader const shader);
+
+// @Note: specialized variants of the same sources, compiled on demand for each set of defines
+// (and cached by their hash), so that feature toggles and debug modes can be separate programs
+// with dead code removed, instead of uniform branches evaluated on every invocation.
+typedef struct ShaderPermutations ShaderPermutations;
+
+// @Note: linked programs are stored (as driver specific binaries) under GLOW_CACHE_, keyed
+// by their sources, so that later runs can skip compiling and linking them altogether.
+typedef struct ShaderCacheStats {
+    usize hits;
+    usize misses;
+} ShaderCacheStats;
+
 Shader new_shader_from_source(ShaderSources const source, Err *err);
 Shader new_shader_from_filepath(ShaderFilepaths const path, Err *err);
 
+// @Note: submits every program before checking on any of them, so that they're compiled in
+// parallel (by the driver, with KHR_parallel_shader_compile, or on the job system otherwise).
+void new_shaders_from_sources(
+    ShaderSources const sources[], Shader shaders[], usize count, Err *err);
+void new_shaders_from_filepaths(
+    ShaderFilepaths const paths[], Shader shaders[], usize count, Err *err);
+
 bool try_reload_shader_from_source(Shader *shader, ShaderSources const source);
 bool try_reload_shader_from_filepath(Shader *shader, ShaderFilepaths const path);
 
+void destroy_shader(Shader *shader);
+
+// @Note: registered shaders are reloaded in place when any of the files that their sources
+// were read from changes on disk (i.e. their stages, and whatever those #include). Reloads are
+// submitted without blocking (compiled in the background by the driver, with
+// KHR_parallel_shader_compile, or on a shared context otherwise), and only swapped in by
+// update_shader_registry() once they have finished compiling (if they failed to, the previous
+// program is kept).
+void register_shader(Shader *shader, ShaderFilepaths const path);
+void unregister_shader(Shader const *shader);
+void mark_all_shaders_dirty(void);
+
+// @Note: new_shaders_from_filepaths() followed by register_shader() for each of them, but
+// reading (and preprocessing) their sources only once.
+void new_registered_shaders_from_filepaths(
+    ShaderFilepaths const paths[], Shader *const shaders[], usize count, Err *err);
+
+// @Note: should be called once per frame, and returns how many shaders were reloaded
+// (whose per-program state, e.g. bound uniform blocks and samplers, has to be set again).
+usize update_shader_registry(void);
+
+// @Note: variants are registered for hot reloading (calling setup again after each reload), and
+// the returned pointers remain valid until the permutations are deallocated. A variant that
+// fails to compile sets err, but it's still cached with a null program (until it's fixed).
+ShaderPermutations *
+alloc_shader_permutations(ShaderFilepaths const path, ShaderSetupFn setup, Err *err);
+void dealloc_shader_permutations(ShaderPermutations *permutations);
+Shader const *get_shader_permutation(
+    ShaderPermutations *permutations, ShaderDefine const defines[], usize count, Err *err);
+
+ShaderCacheStats get_shader_cache_stats(void);
+
 void use_shader(Shader const shader);
 
+// @Note: has to be called again after the shader is reloaded, as it's per-program state.
+void bind_shader_uniform_block(Shader const shader, char const *name, uint binding);
+
+// @Note: every sampler is assigned a texture unit when the program is linked (or reloaded),
+// material samplers get fixed units by name (see get_material_texture_unit), while any others
+// get the units after those. Calling set_shader_(uniform_)sampler2D() overrides it (until a
+// reload), which is then also the unit that's returned.
+uint get_shader_sampler_unit(Shader const shader, char const *name);
+
 void set_shader_int(Shader const shader, char const *name, int value);
 void set_shader_bool(Shader const shader, char const *name, bool value);
 void set_shader_float(Shader const shader, char const *name, f32 value);
+void set_shader_float_array(Shader const shader, char const *name, f32 const values[], usize len);
 void set_shader_sampler2D(Shader const shader, char const *name, uint texture_unit);
 void set_shader_vec2(Shader const shader, char const *name, vec2 const vec);
 void set_shader_vec3(Shader const shader, char const *name, vec3 const vec);
+void set_shader_vec3_array(Shader const shader, char const *name, vec3 const vecs[], usize len);
 void set_shader_vec4(Shader const shader, char const *name, vec4 const vec);
+void set_shader_vec4_array(Shader const shader, char const *name, vec4 const vecs[], usize len);
 void set_shader_mat3(Shader const shader, char const *name, mat3 const mat);
 void set_shader_mat4(Shader const shader, char const *name, mat4 const mat);
+void set_shader_mat4_array(Shader const shader, char const *name, mat4 const mats[], usize len);
+
+ShaderUniform get_shader_uniform(Shader const shader, char const *name);
+int get_shader_uniform_location(Shader const shader, ShaderUniform const uniform);
+ShaderUniformReflection
+get_shader_uniform_reflection(Shader const shader, ShaderUniform const uniform);
+
+void set_shader_uniform_int(Shader const shader, ShaderUniform const uniform, int value);
+void set_shader_uniform_bool(Shader const shader, ShaderUniform const uniform, bool value);
+void set_shader_uniform_float(Shader const shader, ShaderUniform const uniform, f32 value);
+void set_shader_uniform_sampler2D(
+    Shader const shader, ShaderUniform const uniform, uint texture_unit);
+void set_shader_uniform_vec2(Shader const shader, ShaderUniform const uniform, vec2 const vec);
+void set_shader_uniform_vec3(Shader const shader, ShaderUniform const uniform, vec3 const vec);
+void set_shader_uniform_vec4(Shader const shader, ShaderUniform const uniform, vec4 const vec);
+void set_shader_uniform_mat3(Shader const shader, ShaderUniform const uniform, mat3 const mat);
+void set_shader_uniform_mat4(Shader const shader, ShaderUniform const uniform, mat4 const mat);
@@ -0,0 +1,196 @@
+#include "shadow_cascades.h"
+
+#include "maths.h"
+#include "opengl.h"
+
+#include <math.h>
+
+#include <glad/glad.h>
+
+STATIC_ASSERT(SHADOW_CASCADES_CACHED <= SHADOW_CASCADES);
+
+ShadowCascades create_shadow_cascades(void) {
+    ShadowCascades shadows = { 0 };
+
+    // @Note: filtered linearly, so that each compared fetch is a 2x2 PCF in hardware.
+    glGenTextures(1, &shadows.texture);
+    bind_gl_texture(GL_TEXTURE0, GL_TEXTURE_2D_ARRAY, shadows.texture);
+    glTexImage3D(
+        GL_TEXTURE_2D_ARRAY,
+        0,
+        GL_DEPTH_COMPONENT32F,
+        SHADOW_CASCADE_RESOLUTION,
+        SHADOW_CASCADE_RESOLUTION,
+        SHADOW_CASCADES,
+        0,
+        GL_DEPTH_COMPONENT,
+        GL_FLOAT,
+        NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    glGenFramebuffers(SHADOW_CASCADES, shadows.framebuffers);
+    for (usize i = 0; i < SHADOW_CASCADES; ++i) {
+        bind_gl_framebuffer(GL_FRAMEBUFFER, shadows.framebuffers[i]);
+        glFramebufferTextureLayer(
+            GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadows.texture, 0, (int) i);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        check_bound_framebuffer_is_complete();
+    }
+    bind_gl_framebuffer(GL_FRAMEBUFFER, 0);
+
+    return shadows;
+}
+
+void destroy_shadow_cascades(ShadowCascades *shadows) {
+    for (usize i = 0; i < SHADOW_CASCADES; ++i) {
+        forget_gl_framebuffer(shadows->framebuffers[i]);
+    }
+    glDeleteFramebuffers(SHADOW_CASCADES, shadows->framebuffers);
+
+    forget_gl_texture(shadows->texture);
+    glDeleteTextures(1, &shadows->texture);
+
+    *shadows = (ShadowCascades) { 0 };
+}
+
+void invalidate_shadow_cascades(ShadowCascades *shadows) {
+    shadows->is_cache_valid = false;
+}
+
+// @Note: the view depth at which the i-th slice begins (or where the previous one ends).
+static f32 get_split_depth(ShadowCascadeView const *view, usize i) {
+    f32 const t = (f32) i / SHADOW_CASCADES;
+    f32 const uniform = view->near + (view->far - view->near) * t;
+    f32 const logarithmic = view->near * powf(view->far / view->near, t);
+    return uniform + (logarithmic - uniform) * view->split_lambda;
+}
+
+// @Note: the smallest sphere around the slice of the view frustum between two view depths, whose
+// center is on the view axis, where it's equally far from the near and far corners (unless
+// that's past the far plane, in which case the far corners alone bound it).
+static void bound_frustum_slice(
+    ShadowCascadeView const *view,
+    mat4 const view_to_world,
+    f32 near,
+    f32 far,
+    vec3 *center,
+    f32 *radius) {
+    f32 const tan_y = tanf(0.5f * view->fovy);
+    f32 const tan_x = tan_y * view->aspect;
+    f32 const k2 = tan_x * tan_x + tan_y * tan_y; // @Note: corners are at (z * tan_x, z * tan_y)
+
+    f32 const depth = MIN(0.5f * (near + far) * (1.0f + k2), far);
+    *radius = sqrtf((far - depth) * (far - depth) + far * far * k2);
+    *center = vec3_from_vec4(mat4_mul_vec4(view_to_world, (vec4) { 0, 0, -depth, 1 }));
+}
+
+// @Note: a rotation that looks along the light's direction, so that moving a cascade is only a
+// translation in its space (which is then snapped to whole texels).
+static mat4 compute_light_view(vec3 const light_direction) {
+    vec3 const up = fabsf(light_direction.y) > 0.99f ? (vec3) { 0, 0, 1 } : (vec3) { 0, 1, 0 };
+    return mat4_lookat((vec3) { 0 }, light_direction, up);
+}
+
+static void fit_shadow_cascade(
+    ShadowCascade *cascade,
+    mat4 const light_view,
+    vec3 const center,
+    f32 radius,
+    Aabb const scene_bounds) {
+    // @Note: the extent is padded by a texel on each side, as snapping can move it by up to one.
+    f32 const texel_size = 2.0f * radius / (SHADOW_CASCADE_RESOLUTION - 2);
+    f32 const extent = radius + texel_size;
+
+    vec4 center_light = mat4_mul_vec4(light_view, vec4_from_vec3(center, 1));
+    center_light.x = floorf(center_light.x / texel_size) * texel_size;
+    center_light.y = floorf(center_light.y / texel_size) * texel_size;
+
+    // @Note: looking down -Z, so depths are negated, and only the near plane is pulled back.
+    f32 near = -center_light.z - radius;
+    f32 const far = -center_light.z + radius;
+    for (int i = 0; i < 8 && scene_bounds.min.x <= scene_bounds.max.x; ++i) {
+        vec3 const corner = {
+            (i & 1) ? scene_bounds.max.x : scene_bounds.min.x,
+            (i & 2) ? scene_bounds.max.y : scene_bounds.min.y,
+            (i & 4) ? scene_bounds.max.z : scene_bounds.min.z,
+        };
+        near = MIN(near, -mat4_mul_vec4(light_view, vec4_from_vec3(corner, 1)).z);
+    }
+
+    mat4 const light_to_clip = mat4_ortho(
+        center_light.x - extent,
+        center_light.x + extent,
+        center_light.y - extent,
+        center_light.y + extent,
+        near,
+        far);
+
+    cascade->world_to_light = mat4_mul(light_to_clip, light_view);
+    cascade->frustum = compute_frustum(cascade->world_to_light);
+    cascade->texel_size = texel_size;
+    cascade->center = center;
+    cascade->radius = radius;
+}
+
+void update_shadow_cascades(
+    ShadowCascades *shadows,
+    ShadowCascadeView const view,
+    vec3 const light_direction,
+    Aabb const scene_bounds,
+    u64 static_version) {
+    mat4 const light_view = compute_light_view(light_direction);
+    mat4 const view_to_world = mat4_inverse(view.world_to_view);
+
+    bool const is_cache_valid = shadows->is_cache_valid
+                                && shadows->static_version == static_version
+                                && shadows->light_direction.x == light_direction.x
+                                && shadows->light_direction.y == light_direction.y
+                                && shadows->light_direction.z == light_direction.z;
+
+    ShadowCascadeStats stats = { 0 };
+    f32 near = view.near;
+    for (usize i = 0; i < SHADOW_CASCADES; ++i) {
+        ShadowCascade *cascade = &shadows->cascades[i];
+        f32 const far = get_split_depth(&view, i + 1);
+
+        vec3 center;
+        f32 radius;
+        bound_frustum_slice(&view, view_to_world, near, far, &center, &radius);
+        cascade->split_depth = far;
+
+        if (i >= SHADOW_CASCADES - SHADOW_CASCADES_CACHED) {
+            // @Note: the cached sphere still covers the slice if the slice's is inside of it.
+            f32 const offset = vec3_length(vec3_sub(center, cascade->center));
+            cascade->needs_update = !is_cache_valid || offset + radius > cascade->radius;
+            if (cascade->needs_update) {
+                fit_shadow_cascade(
+                    cascade, light_view, center, SHADOW_CACHE_MARGIN * radius, scene_bounds);
+            }
+        } else {
+            cascade->needs_update = true;
+            fit_shadow_cascade(cascade, light_view, center, radius, scene_bounds);
+        }
+
+        stats.cascades_rendered += cascade->needs_update;
+        stats.cascades_cached += !cascade->needs_update;
+        near = far;
+    }
+
+    shadows->light_direction = light_direction;
+    shadows->static_version = static_version;
+    shadows->is_cache_valid = true;
+    shadows->stats = stats;
+}
+
+void begin_shadow_cascade(ShadowCascades const *shadows, usize cascade) {
+    assert(cascade < SHADOW_CASCADES);
+    bind_gl_framebuffer(GL_FRAMEBUFFER, shadows->framebuffers[cascade]);
+    glViewport(0, 0, SHADOW_CASCADE_RESOLUTION, SHADOW_CASCADE_RESOLUTION);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "prelude.h"
+
+#include "culling.h"
+#include "maths_types.h"
+
+// @Note: the shadows of a directional light are rendered into a depth texture array, one layer
+// per cascade, where each cascade covers a slice of the view frustum (whose splits are spaced
+// between uniformly and logarithmically), so that texels get larger farther from the camera.
+// Cascades are fitted to the bounding sphere of their slice, which keeps its size as the camera
+// turns, and their centers are snapped to whole texels in light space, so that the shadows'
+// edges don't shimmer as it moves.
+//
+// The last SHADOW_CASCADES_CACHED cascades are cached: they're fitted to a sphere that is
+// SHADOW_CACHE_MARGIN times larger than their slice's, and are only refitted (and rendered
+// again) once their slice leaves it, or when the light or the static geometry changes. Thus,
+// they're expected to only hold static casters.
+
+#define SHADOW_CASCADES 4 // @Volatile: injected into the lighting pass (see get_lighting_pass)
+#define SHADOW_CASCADES_CACHED 2
+#define SHADOW_CASCADE_RESOLUTION 1024
+#define SHADOW_CACHE_MARGIN 1.5f
+
+typedef struct ShadowCascadeView {
+    mat4 world_to_view;
+    f32 fovy; // @Note: in radians (of a symmetric perspective projection)
+    f32 aspect;
+    f32 near;
+    f32 far; // @Note: how far shadows are drawn, i.e. where the last slice ends
+    f32 split_lambda; // @Note: from uniform (zero) to logarithmic (one) splits
+} ShadowCascadeView;
+
+typedef struct ShadowCascade {
+    mat4 world_to_light; // @Note: an orthographic projection, to GL clip space
+    Frustum frustum; // @Note: of world_to_light, to cull the casters with
+    f32 split_depth; // @Note: the view depth at which its slice ends
+    f32 texel_size; // @Note: in world units
+
+    vec3 center; // @Note: of the sphere that it was last fitted to (in world space)
+    f32 radius;
+    bool needs_update; // @Note: whether it has to be rendered this frame
+} ShadowCascade;
+
+typedef struct ShadowCascadeStats {
+    usize cascades_rendered;
+    usize cascades_cached; // @Note: i.e. that were kept from a previous frame
+} ShadowCascadeStats;
+
+typedef struct ShadowCascades {
+    uint texture; // GL_DEPTH_COMPONENT32F array, compared with GL_LEQUAL (sampler2DArrayShadow)
+    uint framebuffers[SHADOW_CASCADES]; // @Note: each one with a layer of the texture attached
+    ShadowCascade cascades[SHADOW_CASCADES];
+
+    // @Note: what the cached cascades were last rendered with.
+    vec3 light_direction;
+    u64 static_version;
+    bool is_cache_valid;
+
+    ShadowCascadeStats stats; // @Note: of the last call to update_shadow_cascades
+} ShadowCascades;
+
+ShadowCascades create_shadow_cascades(void);
+void destroy_shadow_cascades(ShadowCascades *shadows);
+
+// @Note: fits the cascades to the view, and decides which ones need to be rendered this frame.
+// Cascades are extended towards the light up to the scene's bounds, so that casters outside of
+// the view still cast shadows into it, and `static_version` must change whenever any static
+// caster does (e.g. moves), as should the bounds.
+void update_shadow_cascades(
+    ShadowCascades *shadows,
+    ShadowCascadeView const view,
+    vec3 const light_direction,
+    Aabb const scene_bounds,
+    u64 static_version);
+
+// @Note: binds the cascade's framebuffer and viewport, and clears its depth.
+void begin_shadow_cascade(ShadowCascades const *shadows, usize cascade);
+
+// @Note: forces every cascade to be rendered again on the next update.
+void invalidate_shadow_cascades(ShadowCascades *shadows);
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "prelude.h"
+
+// @Note: 4-wide f32 vectors, which map to SSE registers when available and
+// fall back to plain scalar code otherwise (so everything still builds anywhere).
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLOW_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define GLOW_SIMD_SSE2 0
+#endif
+
+/* clang-format off */
+
+#if GLOW_SIMD_SSE2
+
+typedef __m128 f32x4;
+typedef __m128i i32x4;
+
+static inline f32x4 f32x4_set1(f32 a) { return _mm_set1_ps(a); }
+static inline f32x4 f32x4_set(f32 x, f32 y, f32 z, f32 w) { return _mm_setr_ps(x, y, z, w); }
+static inline f32x4 f32x4_load(f32 const *p) { return _mm_loadu_ps(p); }
+static inline void f32x4_store(f32 *p, f32x4 a) { _mm_storeu_ps(p, a); }
+
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return _mm_add_ps(a, b); }
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { return _mm_sub_ps(a, b); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return _mm_mul_ps(a, b); }
+static inline f32x4 f32x4_min(f32x4 a, f32x4 b) { return _mm_min_ps(a, b); }
+static inline f32x4 f32x4_max(f32x4 a, f32x4 b) { return _mm_max_ps(a, b); }
+static inline f32x4 f32x4_madd(f32x4 a, f32x4 b, f32x4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+// @Note: comparisons return lane masks, which should only be combined with f32x4_and(),
+// f32x4_or() and f32x4_movemask() (i.e. to get a 4-bit mask of the lanes' results), or used
+// to pick between the lanes of two vectors with f32x4_select().
+static inline f32x4 f32x4_lt(f32x4 a, f32x4 b) { return _mm_cmplt_ps(a, b); }
+static inline f32x4 f32x4_gt(f32x4 a, f32x4 b) { return _mm_cmpgt_ps(a, b); }
+static inline f32x4 f32x4_and(f32x4 a, f32x4 b) { return _mm_and_ps(a, b); }
+static inline f32x4 f32x4_or(f32x4 a, f32x4 b) { return _mm_or_ps(a, b); }
+static inline int f32x4_movemask(f32x4 a) { return _mm_movemask_ps(a); }
+static inline f32x4 f32x4_select(f32x4 mask, f32x4 a, f32x4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+static inline i32x4 f32x4_to_i32x4(f32x4 a) { return _mm_cvtps_epi32(a); } // round to nearest
+static inline void i32x4_store(i32 *p, i32x4 a) { _mm_storeu_si128((__m128i *) p, a); }
+
+/* clang-format on */
+
+// @Note: converts to IEEE half floats (rounding to nearest even, and keeping infinities
+// and NaNs) without relying on F16C, since SSE2 is all we can assume for x64 targets.
+// Reference: https://gist.github.com/rygorous/2156668 (float_to_half_SSE2)
+static inline void f32x4_store_f16(u16 *p, f32x4 a) {
+    __m128i const sign_mask = _mm_set1_epi32((i32) 0x80000000u);
+    __m128i const f16_max = _mm_set1_epi32((127 + 16) << 23); // rounds to infinity (or above)
+    __m128i const f16_min_normal = _mm_set1_epi32((127 - 14) << 23);
+    __m128i const subnormal_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    __m128i const normal_bias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+    __m128i const nan_bit = _mm_set1_epi32(0x200);
+    __m128i const infinity = _mm_set1_epi32(0x7c00);
+
+    __m128 const sign = _mm_and_ps(a, _mm_castsi128_ps(sign_mask));
+    __m128 const abs = _mm_xor_ps(a, sign);
+    __m128i const abs_bits = _mm_castps_si128(abs);
+
+    __m128i const is_nan = _mm_castps_si128(_mm_cmpunord_ps(abs, abs));
+    __m128i const is_regular = _mm_cmpgt_epi32(f16_max, abs_bits);
+    __m128i const is_subnormal = _mm_cmpgt_epi32(f16_min_normal, abs_bits);
+    __m128i const inf_or_nan = _mm_or_si128(_mm_and_si128(is_nan, nan_bit), infinity);
+
+    // Let the FPU do the rounding of subnormals, by adding a value that aligns the mantissa.
+    __m128 const subnormal_sum = _mm_add_ps(abs, _mm_castsi128_ps(subnormal_magic));
+    __m128i const subnormal = _mm_sub_epi32(_mm_castps_si128(subnormal_sum), subnormal_magic);
+
+    // Rebias the exponent, and round the mantissa to nearest even.
+    __m128i const mantissa_odd = _mm_srai_epi32(_mm_slli_epi32(abs_bits, 31 - 13), 31);
+    __m128i const rounded = _mm_sub_epi32(_mm_add_epi32(abs_bits, normal_bias), mantissa_odd);
+    __m128i const normal = _mm_srli_epi32(rounded, 13);
+
+    __m128i const finite = _mm_or_si128(
+        _mm_and_si128(is_subnormal, subnormal), _mm_andnot_si128(is_subnormal, normal));
+    __m128i const joined = _mm_or_si128(
+        _mm_and_si128(is_regular, finite), _mm_andnot_si128(is_regular, inf_or_nan));
+    __m128i const half = _mm_or_si128(joined, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+
+    // @Note: sign extend from 16 bits, so that the saturating pack keeps the bits as they are.
+    __m128i const packed = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(half, 16), 16), half);
+    _mm_storel_epi64((__m128i *) p, packed);
+}
+
+/* clang-format off */
+
+#else
+
+typedef struct { f32 v[4]; } f32x4;
+typedef struct { i32 v[4]; } i32x4;
+
+#define F32X4_LANEWISE(expr) \
+    f32x4 r; for (int i = 0; i < 4; ++i) { r.v[i] = (expr); } return r
+#define F32X4_MASK(cond) (((cond) ? -1.0f : 0.0f)) // @Note: only its sign bit is used
+
+static inline f32x4 f32x4_set1(f32 a) { return (f32x4) { { a, a, a, a } }; }
+static inline f32x4 f32x4_set(f32 x, f32 y, f32 z, f32 w) { return (f32x4) { { x, y, z, w } }; }
+static inline f32x4 f32x4_load(f32 const *p) { return (f32x4) { { p[0], p[1], p[2], p[3] } }; }
+static inline void f32x4_store(f32 *p, f32x4 a) { for (int i = 0; i < 4; ++i) { p[i] = a.v[i]; } }
+
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { F32X4_LANEWISE(a.v[i] + b.v[i]); }
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { F32X4_LANEWISE(a.v[i] - b.v[i]); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { F32X4_LANEWISE(a.v[i] * b.v[i]); }
+static inline f32x4 f32x4_min(f32x4 a, f32x4 b) { F32X4_LANEWISE(a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+static inline f32x4 f32x4_max(f32x4 a, f32x4 b) { F32X4_LANEWISE(a.v[i] < b.v[i] ? b.v[i] : a.v[i]); }
+static inline f32x4 f32x4_madd(f32x4 a, f32x4 b, f32x4 c) { F32X4_LANEWISE(a.v[i] * b.v[i] + c.v[i]); }
+
+static inline f32x4 f32x4_lt(f32x4 a, f32x4 b) { F32X4_LANEWISE(F32X4_MASK(a.v[i] < b.v[i])); }
+static inline f32x4 f32x4_gt(f32x4 a, f32x4 b) { F32X4_LANEWISE(F32X4_MASK(a.v[i] > b.v[i])); }
+static inline f32x4 f32x4_and(f32x4 a, f32x4 b) { F32X4_LANEWISE(F32X4_MASK(a.v[i] < 0 && b.v[i] < 0)); }
+static inline f32x4 f32x4_or(f32x4 a, f32x4 b) { F32X4_LANEWISE(F32X4_MASK(a.v[i] < 0 || b.v[i] < 0)); }
+static inline int f32x4_movemask(f32x4 a) {
+    return (a.v[0] < 0) | ((a.v[1] < 0) << 1) | ((a.v[2] < 0) << 2) | ((a.v[3] < 0) << 3);
+}
+static inline f32x4 f32x4_select(f32x4 mask, f32x4 a, f32x4 b) { F32X4_LANEWISE(mask.v[i] < 0 ? a.v[i] : b.v[i]); }
+
+static inline i32x4 f32x4_to_i32x4(f32x4 a) {
+    i32x4 r;
+    for (int i = 0; i < 4; ++i) { r.v[i] = (i32) (a.v[i] < 0 ? a.v[i] - 0.5f : a.v[i] + 0.5f); }
+    return r;
+}
+static inline void i32x4_store(i32 *p, i32x4 a) { for (int i = 0; i < 4; ++i) { p[i] = a.v[i]; } }
+
+#undef F32X4_MASK
+#undef F32X4_LANEWISE
+
+#endif
+
+/* clang-format on */
+
+// @Note: scalar equivalent of the SSE2 f32x4_store_f16() (used for leftovers and fallbacks).
+// Reference: https://gist.github.com/rygorous/2156668 (float_to_half_fast3_rtne)
+static inline u16 f32_to_f16(f32 value) {
+    union { f32 f; u32 u; } bits = { value };
+    union { u32 u; f32 f; } const subnormal_magic = { ((127u - 15u) + (23u - 10u) + 1u) << 23 };
+
+    u32 const sign = bits.u & 0x80000000u;
+    bits.u ^= sign;
+
+    u16 half;
+    if (bits.u >= (127u + 16u) << 23) { // infinity or NaN (or too big to be represented)
+        half = bits.u > (255u << 23) ? 0x7e00 : 0x7c00;
+    } else if (bits.u < (127u - 14u) << 23) { // subnormal (or zero)
+        bits.f += subnormal_magic.f;
+        half = (u16) (bits.u - subnormal_magic.u);
+    } else {
+        u32 const mantissa_odd = (bits.u >> 13) & 1;
+        bits.u += ((u32) (15 - 127) << 23) + 0xfff + mantissa_odd;
+        half = (u16) (bits.u >> 13);
+    }
+
+    return half | (u16) (sign >> 16);
+}
+
+#if !GLOW_SIMD_SSE2
+static inline void f32x4_store_f16(u16 *p, f32x4 a) {
+    for (int i = 0; i < 4; ++i) { p[i] = f32_to_f16(a.v[i]); }
+}
+#endif
@@ -1,6 +1,11 @@
 #include "texture.h"
 
 #include "console.h"
+#include "jobs.h"
+#include "maths.h"
+#include "mipmap.h"
+#include "opengl.h"
+#include "simd.h"
 
 #include <stb_image.h>
 
@@ -75,11 +80,12 @@ static int gl_internal_format(int format, bool is_srgb, bool is_highp, bool is_f
     }
 
     // @Note: index = is_highp ? (is_float ? 3 : 2) : (is_float ? 1 : 0)
+    // We use normalized 16-bit formats (instead of GL_*16UI) so that they can be filtered.
     // Reference: https://www.khronos.org/opengl/wiki/Image_Format#Required_formats
-    static int const INTERNAL_FORMAT_R[4] = { GL_R8, GL_R16F, GL_R16UI, GL_R32F };
-    static int const INTERNAL_FORMAT_RG[4] = { GL_RG8, GL_RG16F, GL_RG16UI, GL_RG32F };
-    static int const INTERNAL_FORMAT_RGB[4] = { GL_RGB8, GL_RGB16F, GL_RGB16UI, GL_RGB32F };
-    static int const INTERNAL_FORMAT_RGBA[4] = { GL_RGBA8, GL_RGBA16F, GL_RGBA16UI, GL_RGBA32F };
+    static int const INTERNAL_FORMAT_R[4] = { GL_R8, GL_R16F, GL_R16, GL_R32F };
+    static int const INTERNAL_FORMAT_RG[4] = { GL_RG8, GL_RG16F, GL_RG16, GL_RG32F };
+    static int const INTERNAL_FORMAT_RGB[4] = { GL_RGB8, GL_RGB16F, GL_RGB16, GL_RGB32F };
+    static int const INTERNAL_FORMAT_RGBA[4] = { GL_RGBA8, GL_RGBA16F, GL_RGBA16, GL_RGBA32F };
 
     int const index = ((!!is_highp) << 1) | (!!is_float);
 
@@ -99,14 +105,7 @@ typedef struct TextureParameters {
     int gl_wrap;
 } TextureParameters;
 
-static TextureParameters gl_parameters(TextureImage const image, TextureSettings settings) {
-    // @Temporary: we can directly use settings after we handle HDR images and
-    // both half float and 16-bits-per-channel images (that are sometimes used
-    // for storing color / albedo data).
-    assert(!settings.highp_bitdepth && !settings.floating_point);
-    settings.highp_bitdepth = false;
-    settings.floating_point = false;
-
+static TextureParameters gl_parameters(TextureImage const image, TextureSettings const settings) {
 #define DEFAULT(value) ((value) == 0)
 #define VALUE_OR(value, default) (DEFAULT(value) ? (default) : (value))
 
@@ -118,9 +117,11 @@ static TextureParameters gl_parameters(TextureImage const image, TextureSettings
     assert(DEFAULT(settings.format) || FORMAT[settings.format] == expected_format);
     assert(internal_format != format); // we want the internal format to be sized
 
-    int const type = settings.floating_point   ? GL_FLOAT
-                     : settings.highp_bitdepth ? GL_UNSIGNED_SHORT
-                                               : GL_UNSIGNED_BYTE;
+    // @Note: floating point images are converted to half floats on load (unless highp_bitdepth
+    // is set), so that we don't need to rely on the driver to convert them to GL_RGB16F.
+    int const type = settings.floating_point
+                         ? (settings.highp_bitdepth ? GL_FLOAT : GL_HALF_FLOAT)
+                         : (settings.highp_bitdepth ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE);
 
     int const mag_filter = FILTER[VALUE_OR(settings.mag_filter, TextureFilter_Linear)];
     int const min_filter =
@@ -137,22 +138,84 @@ static TextureParameters gl_parameters(TextureImage const image, TextureSettings
     return (TextureParameters) { format, internal_format, type, mag_filter, min_filter, wrap };
 }
 
+//
+// Half float conversion.
+//
+
+#define HALF_FLOAT_VALUES_PER_JOB (64 * 1024)
+
+typedef struct HalfFloatJobs {
+    f32 const *src;
+    u16 *dst;
+    usize len;
+} HalfFloatJobs;
+
+static void convert_to_half_float_job(void *data, usize index) {
+    HalfFloatJobs const *jobs = data;
+
+    usize const begin = index * HALF_FLOAT_VALUES_PER_JOB;
+    usize const end = MIN(begin + HALF_FLOAT_VALUES_PER_JOB, jobs->len);
+
+    usize i = begin;
+    for (; i + 4 <= end; i += 4) { f32x4_store_f16(&jobs->dst[i], f32x4_load(&jobs->src[i])); }
+    for (; i < end; ++i) { jobs->dst[i] = f32_to_f16(jobs->src[i]); }
+}
+
+// @Note: halves the memory used by (e.g. equirectangular) HDR maps, both in RAM and in VRAM,
+// where each chunk of HALF_FLOAT_VALUES_PER_JOB values is converted in parallel.
+static u16 *alloc_half_floats_from_floats(f32 const *src, usize len, Err *err) {
+    if (*err) { return NULL; }
+
+    u16 *dst = malloc(len * sizeof(u16));
+    if (!dst) {
+        *err = Err_Malloc;
+        return NULL;
+    }
+
+    HalfFloatJobs jobs = { src, dst, len };
+    run_jobs(
+        convert_to_half_float_job,
+        &jobs,
+        (len + HALF_FLOAT_VALUES_PER_JOB - 1) / HALF_FLOAT_VALUES_PER_JOB);
+
+    return dst;
+}
+
+//
+// Image loading.
+//
+
+// @Note: the image's data type depends on the settings: f32 (or f16, if highp_bitdepth isn't
+// set) for floating_point, u16 for highp_bitdepth, and u8 otherwise. As this doesn't touch the
+// (global) stbi vertical flip flag, it's safe to call it from multiple threads at once.
 static TextureImage
-alloc_texture_image(char const *path, TextureSettings const settings, Err *err) {
+load_texture_image_from_filepath(char const *path, TextureSettings const settings, Err *err) {
     if (*err) { return (TextureImage) { 0 }; }
 
-    assert(!stbi_is_hdr(path)); // @Fixme: handle HDR images.
-    assert(!settings.highp_bitdepth && !settings.floating_point);
-
     TextureImage image = { 0 };
 
-    // @Note: as there's no getter for the current value of the stbi__vertically_flip flag
-    // we can't restore it afterwards, so we set it to false as this is its default value.
-    stbi_set_flip_vertically_on_load(settings.flip_vertically);
-    image.data = stbi_load(path, &image.width, &image.height, &image.channels, 0);
-    stbi_set_flip_vertically_on_load(false);
+    if (settings.floating_point) {
+        f32 *data = stbi_loadf(path, &image.width, &image.height, &image.channels, 0);
+        if (data && !settings.highp_bitdepth) {
+            usize const len = (usize) image.width * image.height * image.channels;
+            image.data = (u8 *) alloc_half_floats_from_floats(data, len, err);
+            stbi_image_free(data);
+            if (*err) { return (TextureImage) { 0 }; }
+        } else {
+            image.data = (u8 *) data;
+        }
+    } else if (settings.highp_bitdepth) {
+        image.data = (u8 *) stbi_load_16(path, &image.width, &image.height, &image.channels, 0);
+    } else {
+        if (stbi_is_hdr(path)) {
+            GLOW_WARNING("HDR image will be tonemapped to 8 bits per channel: `%s`", path);
+        }
+        image.data = stbi_load(path, &image.width, &image.height, &image.channels, 0);
+    }
 
     if (!image.data) {
+        // @Note: stbi_failure_reason() isn't thread local (unless STBI_THREAD_LOCAL is used),
+        // so when loading multiple images at once this may come from a different failure.
         GLOW_WARNING("failed to load image from path: `%s`", path);
         GLOW_WARNING("stbi_failure_reason() returned: `%s`", stbi_failure_reason());
         *err = Err_Stbi_Load;
@@ -163,30 +226,147 @@ alloc_texture_image(char const *path, TextureSettings const settings, Err *err)
     return image;
 }
 
-static void dealloc_texture_image(TextureImage *image) {
+bool is_floating_point_image_filepath(char const *path) { return stbi_is_hdr(path); }
+
+TextureImage
+alloc_texture_image_from_filepath(char const *path, TextureSettings const settings, Err *err) {
+    if (*err) { return (TextureImage) { 0 }; }
+
+    // @Note: as there's no getter for the current value of the stbi__vertically_flip flag
+    // we can't restore it afterwards, so we set it to false as this is its default value.
+    stbi_set_flip_vertically_on_load(settings.flip_vertically);
+    TextureImage const image = load_texture_image_from_filepath(path, settings, err);
+    stbi_set_flip_vertically_on_load(false);
+
+    return image;
+}
+
+typedef struct LoadImageJobs {
+    char const **paths;
+    TextureSettings settings;
+    TextureImage *images;
+    Err *errs;
+} LoadImageJobs;
+
+static void load_texture_image_job(void *data, usize index) {
+    LoadImageJobs const *jobs = data;
+    jobs->images[index] =
+        load_texture_image_from_filepath(jobs->paths[index], jobs->settings, &jobs->errs[index]);
+}
+
+// @Note: decodes each image on its own job (and, since the half float conversion is then run
+// from inside a job, it happens serially for each of them, which is fine as they're parallel).
+static void alloc_texture_images_from_filepaths(
+    char const *paths[],
+    TextureSettings const settings,
+    TextureImage images[],
+    usize count,
+    Err *err) {
+    if (*err) { return; }
+
+    Err *errs = calloc(count, sizeof(Err));
+    if (!errs) {
+        *err = Err_Calloc;
+        return;
+    }
+
+    stbi_set_flip_vertically_on_load(settings.flip_vertically);
+    run_jobs(load_texture_image_job, &(LoadImageJobs) { paths, settings, images, errs }, count);
+    stbi_set_flip_vertically_on_load(false);
+
+    for (usize i = 0; i < count; ++i) {
+        if (errs[i] && !*err) { *err = errs[i]; }
+    }
+
+    free(errs);
+}
+
+void dealloc_texture_image(TextureImage *image) {
+    // @Note: stbi_image_free() simply calls STBI_FREE, which defaults to free(),
+    // so this also works for images that we've allocated ourselves with malloc().
     stbi_image_free(image->data);
     image->data = NULL;
 }
 
-Texture new_texture_from_image(TextureImage const image, TextureSettings const settings) {
+TextureImage alloc_texture_image_from_channels(
+    TextureChannelSource const sources[], int channels, Err *err) {
+    if (*err) { return (TextureImage) { 0 }; }
+
+    assert(1 <= channels && channels <= 4);
+
+    TextureImage packed = { .width = 1, .height = 1, .channels = channels };
+    for (int c = 0; c < channels; ++c) {
+        TextureImage const *image = sources[c].image;
+        if (image && image->data) {
+            if (image->width > packed.width) { packed.width = image->width; }
+            if (image->height > packed.height) { packed.height = image->height; }
+        }
+    }
+
+    packed.data = malloc((usize) packed.width * packed.height * channels);
+    if (!packed.data) {
+        *err = Err_Malloc;
+        return (TextureImage) { 0 };
+    }
+
+    for (int c = 0; c < channels; ++c) {
+        TextureChannelSource const source = sources[c];
+        TextureImage const *image = source.image;
+
+        if (!image || !image->data || source.channel >= image->channels) {
+            for (usize i = 0; i < (usize) packed.width * packed.height; ++i) {
+                packed.data[i * channels + c] = source.fallback;
+            }
+            continue;
+        }
+
+        for (int y = 0; y < packed.height; ++y) {
+            usize const src_y = (usize) y * image->height / packed.height;
+            u8 const *src_row = &image->data[src_y * image->width * image->channels];
+            u8 *dst_row = &packed.data[(usize) y * packed.width * channels];
+            for (int x = 0; x < packed.width; ++x) {
+                usize const src_x = (usize) x * image->width / packed.width;
+                dst_row[x * channels + c] = src_row[src_x * image->channels + source.channel];
+            }
+        }
+    }
+
+    return packed;
+}
+
+// @Note: if chain is null, level 0 is uploaded from image (and, if needed, the rest of the
+// levels are generated with glGenerateMipmap), otherwise every level comes from the chain.
+static Texture new_texture_from_image_and_mipmap_chain(
+    TextureImage const image, TextureSettings const settings, MipmapChain const *chain) {
     TextureParameters const parameters = gl_parameters(image, settings);
 
     uint texture_id;
     glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    DEFER (glBindTexture(GL_TEXTURE_2D, 0)) {
-        glTexImage2D(
-            /*target*/ GL_TEXTURE_2D,
-            /*level*/ 0,
-            /*internalFormat*/ parameters.gl_internal_format,
-            /*width*/ image.width,
-            /*height*/ image.height,
-            /*border*/ 0,
-            /*format*/ parameters.gl_format,
-            /*type*/ parameters.gl_type,
-            /*data*/ image.data);
-
-        if (settings.generate_mipmap) { glGenerateMipmap(GL_TEXTURE_2D); }
+    bind_gl_texture(GL_TEXTURE0, GL_TEXTURE_2D, texture_id);
+    DEFER (bind_gl_texture(GL_TEXTURE0, GL_TEXTURE_2D, 0)) {
+        // @Note: rows of 1, 2 and 3 channel images (and of small levels) aren't 4-byte aligned.
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        DEFER (glPixelStorei(GL_UNPACK_ALIGNMENT, 4)) {
+            int const levels_len = chain ? chain->levels_len : 1;
+            for (int level = 0; level < levels_len; ++level) {
+                glTexImage2D(
+                    /*target*/ GL_TEXTURE_2D,
+                    /*level*/ level,
+                    /*internalFormat*/ parameters.gl_internal_format,
+                    /*width*/ chain ? chain->widths[level] : image.width,
+                    /*height*/ chain ? chain->heights[level] : image.height,
+                    /*border*/ 0,
+                    /*format*/ parameters.gl_format,
+                    /*type*/ parameters.gl_type,
+                    /*data*/ chain ? &chain->data[chain->offsets[level]] : image.data);
+            }
+        }
+
+        if (chain) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, chain->levels_len - 1);
+        } else if (settings.generate_mipmap) {
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, parameters.gl_mag_filter);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, parameters.gl_min_filter);
@@ -195,7 +375,9 @@ Texture new_texture_from_image(TextureImage const image, TextureSettings const s
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, parameters.gl_wrap);
 
         // Reference: https://www.khronos.org/opengl/wiki/Image_Format#Legacy_Image_Formats
-        if (parameters.gl_format == GL_RED) { // replicate legacy GL_LUMINANCE
+        if (settings.keep_channels) {
+            // Do nothing, as the channels are (e.g. packed) data and not luminance.
+        } else if (parameters.gl_format == GL_RED) { // replicate legacy GL_LUMINANCE
             static int const SWIZZLE_R001_TO_RRR1[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
             glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, SWIZZLE_R001_TO_RRR1);
         } else if (parameters.gl_format == GL_RG) { // replicate legacy GL_LUMINANCE_ALPHA
@@ -207,11 +389,75 @@ Texture new_texture_from_image(TextureImage const image, TextureSettings const s
     return (Texture) { texture_id, TextureTarget_2D, TextureMaterialType_None };
 }
 
+static bool
+should_generate_mipmap_on_cpu(TextureImage const image, TextureSettings const settings) {
+    return settings.generate_mipmap && image.data && (image.width > 1 || image.height > 1)
+           && gl_parameters(image, settings).gl_type == GL_UNSIGNED_BYTE;
+}
+
+Texture new_texture_from_image(TextureImage const image, TextureSettings const settings) {
+    Texture texture = { 0 };
+    new_textures_from_images(&image, &settings, &texture, 1);
+    return texture;
+}
+
+void new_textures_from_images(
+    TextureImage const images[],
+    TextureSettings const settings[],
+    Texture textures[],
+    usize count) {
+    if (count == 0) { return; }
+
+    Err err = Err_None;
+
+    // Collect the images whose mipmaps we generate on the CPU (instead of glGenerateMipmap).
+    usize cpu_len = 0;
+    usize *cpu_indices = calloc(count, sizeof(usize));
+    TextureImage *cpu_images = calloc(count, sizeof(TextureImage));
+    MipmapSettings *cpu_settings = calloc(count, sizeof(MipmapSettings));
+    MipmapChain *chains = calloc(count, sizeof(MipmapChain));
+    if (!cpu_indices || !cpu_images || !cpu_settings || !chains) { err = Err_Calloc; }
+
+    for (usize i = 0; err == Err_None && i < count; ++i) {
+        if (!should_generate_mipmap_on_cpu(images[i], settings[i])) { continue; }
+        cpu_indices[cpu_len] = i;
+        cpu_images[cpu_len] = images[i];
+        cpu_settings[cpu_len] = (MipmapSettings) {
+            .kernel = settings[i].mipmap_kernel,
+            .is_srgb = settings[i].apply_srgb_eotf,
+            .use_cache = true,
+        };
+        cpu_len += 1;
+    }
+
+    // @Note: calloc(0) may return NULL, so images without any CPU mipmaps (e.g. the 1x1
+    // placeholders) skip it entirely, rather than warning about a failed allocation.
+    if (cpu_len > 0) { alloc_mipmap_chains(cpu_images, cpu_settings, chains, cpu_len, &err); }
+    if (err) {
+        GLOW_WARNING("failed to generate mipmaps on the CPU, falling back to glGenerateMipmap");
+        cpu_len = 0;
+    }
+
+    // @Note: uploads have to happen on this (i.e. the GL context's) thread.
+    usize cpu_index = 0;
+    for (usize i = 0; i < count; ++i) {
+        bool const has_chain = cpu_index < cpu_len && cpu_indices[cpu_index] == i;
+        MipmapChain const *chain = has_chain ? &chains[cpu_index++] : NULL;
+        textures[i] = new_texture_from_image_and_mipmap_chain(images[i], settings[i], chain);
+    }
+
+    for (usize i = 0; i < cpu_len; ++i) { dealloc_mipmap_chain(&chains[i]); }
+    free(chains);
+    free(cpu_settings);
+    free(cpu_images);
+    free(cpu_indices);
+}
+
 Texture new_texture_from_filepath(char const *path, TextureSettings const settings, Err *err) {
     Texture texture = { 0 };
 
     if (*err == Err_None) {
-        TextureImage image = alloc_texture_image(path, settings, err);
+        TextureImage image = alloc_texture_image_from_filepath(path, settings, err);
         if (*err == Err_None) { texture = new_texture_from_image(image, settings); }
         dealloc_texture_image(&image);
     }
@@ -227,19 +473,23 @@ new_cubemap_texture_from_images(TextureImage const images[6], TextureSettings co
 
     uint texture_id;
     glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
-    DEFER (glBindTexture(GL_TEXTURE_CUBE_MAP, 0)) {
-        for (usize i = 0; i < 6; ++i) {
-            glTexImage2D(
-                /*target*/ TARGET_CUBE_FACE[i],
-                /*level*/ 0,
-                /*internalFormat*/ parameters.gl_internal_format,
-                /*width*/ images[i].width,
-                /*height*/ images[i].height,
-                /*border*/ 0,
-                /*format*/ parameters.gl_format,
-                /*type*/ parameters.gl_type,
-                /*data*/ images[i].data);
+    bind_gl_texture(GL_TEXTURE0, GL_TEXTURE_CUBE_MAP, texture_id);
+    DEFER (bind_gl_texture(GL_TEXTURE0, GL_TEXTURE_CUBE_MAP, 0)) {
+        // @Note: rows of e.g. GL_RGB16F faces (i.e. 6 bytes per pixel) aren't 4-byte aligned.
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        DEFER (glPixelStorei(GL_UNPACK_ALIGNMENT, 4)) {
+            for (usize i = 0; i < 6; ++i) {
+                glTexImage2D(
+                    /*target*/ TARGET_CUBE_FACE[i],
+                    /*level*/ 0,
+                    /*internalFormat*/ parameters.gl_internal_format,
+                    /*width*/ images[i].width,
+                    /*height*/ images[i].height,
+                    /*border*/ 0,
+                    /*format*/ parameters.gl_format,
+                    /*type*/ parameters.gl_type,
+                    /*data*/ images[i].data);
+            }
         }
 
         if (settings.generate_mipmap) { glGenerateMipmap(GL_TEXTURE_CUBE_MAP); }
@@ -261,9 +511,7 @@ Texture new_cubemap_texture_from_filepaths(
 
     if (*err == Err_None) {
         TextureImage images[6] = { 0 };
-        for (usize i = 0; i < 6; ++i) {
-            images[i] = alloc_texture_image(paths[i], settings, err);
-        }
+        alloc_texture_images_from_filepaths(paths, settings, images, 6, err);
         if (*err == Err_None) { texture = new_cubemap_texture_from_images(images, settings); }
         for (usize i = 0; i < 6; ++i) { dealloc_texture_image(&images[i]); }
     }
@@ -272,7 +520,29 @@ Texture new_cubemap_texture_from_filepaths(
 }
 
 void bind_texture_to_unit(Texture const texture, uint texture_unit) {
-    assert(texture_unit >= GL_TEXTURE0);
-    glActiveTexture(texture_unit);
-    glBindTexture(TARGET[texture.target], texture.id);
+    bind_gl_texture(texture_unit, TARGET[texture.target], texture.id);
+}
+
+// @Volatile: keep in sync with TextureMaterialType.
+static char const *const MATERIAL_SAMPLER_NAMES[] = {
+    [TextureMaterialType_None] = "texture",
+    [TextureMaterialType_Diffuse] = "texture_diffuse",
+    [TextureMaterialType_Specular] = "texture_specular",
+    [TextureMaterialType_Ambient] = "texture_ambient",
+    [TextureMaterialType_Normal] = "texture_normal",
+    [TextureMaterialType_Height] = "texture_height",
+    [TextureMaterialType_Packed] = "texture_packed",
+};
+
+STATIC_ASSERT(ARRAY_LEN(MATERIAL_SAMPLER_NAMES) == TextureMaterialType_Packed + 1);
+
+char const *get_material_sampler_name(TextureMaterialType const material_type) {
+    assert(0 <= material_type && material_type < ARRAY_LEN(MATERIAL_SAMPLER_NAMES));
+    return MATERIAL_SAMPLER_NAMES[material_type];
+}
+
+int get_material_texture_unit(TextureMaterialType const material_type, uint index) {
+    assert(material_type != TextureMaterialType_None);
+    if (index >= MATERIAL_TEXTURES_PER_TYPE) { return -1; }
+    return (int) ((material_type - 1) * MATERIAL_TEXTURES_PER_TYPE + index);
 }
@@ -23,13 +23,22 @@ typedef enum TextureFormat {
     TextureFormat_Rgba,
 } TextureFormat;
 
+// @Note: kernels used by the CPU mipmap generator (see mipmap.h), which always filters
+// sRGB textures in linear space (unlike many glGenerateMipmap implementations).
+typedef enum TextureMipmapKernel {
+    TextureMipmapKernel_Box = 0, // 2x2 average
+    TextureMipmapKernel_Kaiser, // 8x8 separable Kaiser-windowed sinc (sharper)
+} TextureMipmapKernel;
+
 typedef struct TextureSettings {
     TextureFormat format;
     bool flip_vertically; // @Note: only applied into new_texture_from_filepath()
     bool apply_srgb_eotf; // @Note: assumes 8-bit-per-channel sRGB or sRGBA types
-    bool highp_bitdepth; // GL_UNSIGNED_BYTE 8 -> 16 bits, GL_FLOAT 16 -> 32 bits
-    bool floating_point; // GL_UNSIGNED_BYTE if false else GL_FLOAT
+    bool highp_bitdepth; // GL_UNSIGNED_BYTE 8 -> 16 bits, GL_HALF_FLOAT 16 -> GL_FLOAT 32 bits
+    bool floating_point; // @Note: loaded with stbi_loadf() (e.g. for .hdr images)
     bool generate_mipmap;
+    TextureMipmapKernel mipmap_kernel;
+    bool keep_channels; // @Note: don't replicate legacy GL_LUMINANCE(_ALPHA) swizzles
     TextureFilter mag_filter;
     TextureFilter min_filter;
     TextureFilter mipmap_filter;
@@ -37,12 +46,20 @@ typedef struct TextureSettings {
 } TextureSettings;
 
 typedef struct TextureImage {
-    u8 *data;
+    u8 *data; // @Note: u8, u16, f16 or f32 per channel (as per the loading TextureSettings)
     int width;
     int height;
     int channels;
 } TextureImage;
 
+// @Note: describes where a channel of a packed image comes from, if image is null
+// (or it doesn't have the given channel) then the fallback value is used instead.
+typedef struct TextureChannelSource {
+    TextureImage const *image;
+    int channel;
+    u8 fallback;
+} TextureChannelSource;
+
 // @Volatile: sync with mesh.c and models.c.
 // @Refactor: move this to mesh.h instead, simply as MaterialType.
 typedef enum TextureMaterialType {
@@ -52,12 +69,19 @@ typedef enum TextureMaterialType {
     TextureMaterialType_Ambient,
     TextureMaterialType_Normal,
     TextureMaterialType_Height,
+    TextureMaterialType_Packed, // R = specular, G = ambient, B = height, A = has normal map
     /* TextureMaterialType_Emissive,
     TextureMaterialType_Shininess,
     TextureMaterialType_Light,
     TextureMaterialType_Displacement, */
 } TextureMaterialType;
 
+// @Note: material samplers are named `texture_<type>`, followed by an index for all but the
+// first of each type (e.g. texture_diffuse, texture_diffuse1), and each one has a fixed unit,
+// so that shaders assign them once when linked and meshes only have to bind their textures.
+#define MATERIAL_TEXTURES_PER_TYPE 2
+#define MATERIAL_TEXTURE_UNITS_LEN (TextureMaterialType_Packed * MATERIAL_TEXTURES_PER_TYPE)
+
 typedef enum TextureTarget {
     TextureTarget_2D = 0,
     TextureTarget_Cube,
@@ -69,7 +93,27 @@ typedef struct Texture {
     TextureMaterialType material_type;
 } Texture;
 
+TextureImage
+alloc_texture_image_from_filepath(char const *path, TextureSettings const settings, Err *err);
+void dealloc_texture_image(TextureImage *image);
+
+// @Note: peeks at the file's header, i.e. whether it should be loaded with floating_point
+// (e.g. .hdr images) rather than being tonemapped to 8 bits per channel.
+bool is_floating_point_image_filepath(char const *path);
+
+// @Note: the packed image size is the largest of its sources (which are nearest sampled).
+TextureImage alloc_texture_image_from_channels(
+    TextureChannelSource const sources[], int channels, Err *err);
+
 Texture new_texture_from_image(TextureImage const image, TextureSettings const settings);
+
+// @Note: creates count textures at once, so that the mipmaps of all of them are generated
+// in parallel (on the job system), and then uploaded level by level in one go each.
+void new_textures_from_images(
+    TextureImage const images[],
+    TextureSettings const settings[],
+    Texture textures[],
+    usize count);
 Texture new_texture_from_filepath(char const *path, TextureSettings const settings, Err *err);
 
 // @Note: the expected order for the 6 faces is: Right, Left, Top, Bottom, Front, Back.
@@ -80,3 +124,9 @@ Texture new_cubemap_texture_from_filepaths(
     char const *paths[6], TextureSettings const settings, Err *err);
 
 void bind_texture_to_unit(Texture const texture, uint texture_unit);
+
+char const *get_material_sampler_name(TextureMaterialType const material_type);
+
+// @Note: returns the unit (i.e. an offset from GL_TEXTURE0) of the index-th texture of the
+// material type, or -1 if there are already MATERIAL_TEXTURES_PER_TYPE textures of the type.
+int get_material_texture_unit(TextureMaterialType const material_type, uint index);
@@ -0,0 +1,47 @@
+#include "texture_buffer.h"
+
+#include "opengl.h"
+
+#include <glad/glad.h>
+
+TextureBuffer create_texture_buffer(uint internal_format) {
+    uint tbo;
+    glGenBuffers(1, &tbo);
+
+    uint texture;
+    glGenTextures(1, &texture);
+
+    // @Note: the texture has to be attached to a buffer with some storage, so we start with
+    // a single (zeroed) texel's worth of it, which also keeps empty buffers from being unbound.
+    u8 const empty[16] = { 0 };
+    glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+    DEFER (glBindBuffer(GL_TEXTURE_BUFFER, 0)) {
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(empty), empty, GL_DYNAMIC_DRAW);
+    }
+
+    bind_gl_texture(GL_TEXTURE0, GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, internal_format, tbo);
+
+    return (TextureBuffer) { tbo, texture, internal_format, sizeof(empty) };
+}
+
+void destroy_texture_buffer(TextureBuffer *buffer) {
+    forget_gl_texture(buffer->texture);
+    glDeleteTextures(1, &buffer->texture);
+    glDeleteBuffers(1, &buffer->tbo);
+    buffer->texture = 0;
+    buffer->tbo = 0;
+}
+
+void update_texture_buffer(TextureBuffer *buffer, void const *data, usize size) {
+    if (size == 0) { return; } // @Note: shaders shouldn't read from it, so keep what's there
+
+    // @Note: grow geometrically, so that the storage doesn't get respecified every frame.
+    while (buffer->capacity < size) { buffer->capacity *= 2; }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer->tbo);
+    DEFER (glBindBuffer(GL_TEXTURE_BUFFER, 0)) {
+        glBufferData(GL_TEXTURE_BUFFER, buffer->capacity, NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "prelude.h"
+
+// @Note: a buffer object that shaders read from through a buffer texture (i.e. with
+// texelFetch() on a samplerBuffer), which isn't limited in size like a uniform block is.
+typedef struct TextureBuffer {
+    uint tbo;
+    uint texture;
+    uint internal_format; // e.g. GL_RGBA32F, which is the size and type of each texel
+    usize capacity; // in bytes
+} TextureBuffer;
+
+TextureBuffer create_texture_buffer(uint internal_format);
+void destroy_texture_buffer(TextureBuffer *buffer);
+
+// @Note: rewrites the whole buffer (growing it if needed), orphaning its previous storage so
+// that we don't stall on draws from earlier frames that may still be reading from it.
+void update_texture_buffer(TextureBuffer *buffer, void const *data, usize size);
@@ -0,0 +1,32 @@
+#include "uniform_buffer.h"
+
+#include <glad/glad.h>
+
+UniformBuffer create_uniform_buffer(uint binding, usize size) {
+    uint ubo;
+    glGenBuffers(1, &ubo);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    DEFER (glBindBuffer(GL_UNIFORM_BUFFER, 0)) {
+        glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo);
+
+    return (UniformBuffer) { ubo, binding, size };
+}
+
+void destroy_uniform_buffer(UniformBuffer *buffer) {
+    glDeleteBuffers(1, &buffer->ubo);
+    buffer->ubo = 0;
+}
+
+void update_uniform_buffer(UniformBuffer const *buffer, void const *data, usize size) {
+    assert(size == buffer->size);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer->ubo);
+    DEFER (glBindBuffer(GL_UNIFORM_BUFFER, 0)) {
+        glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    }
+}
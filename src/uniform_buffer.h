@@ -0,0 +1,18 @@
+#pragma once
+
+#include "prelude.h"
+
+// @Note: a uniform buffer object bound to a fixed binding point, whose contents are expected
+// to follow the std140 layout of the uniform blocks that use it (see bind_shader_uniform_block).
+typedef struct UniformBuffer {
+    uint ubo;
+    uint binding;
+    usize size; // in bytes
+} UniformBuffer;
+
+UniformBuffer create_uniform_buffer(uint binding, usize size);
+void destroy_uniform_buffer(UniformBuffer *buffer);
+
+// @Note: rewrites the whole buffer, orphaning its previous storage so that we don't
+// stall on draws from earlier frames that may still be reading from it.
+void update_uniform_buffer(UniformBuffer const *buffer, void const *data, usize size);
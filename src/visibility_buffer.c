@@ -0,0 +1,105 @@
+#include "visibility_buffer.h"
+
+#include "console.h"
+#include "mesh.h"
+#include "maths.h"
+#include "model.h"
+
+#include <glad/glad.h>
+
+STATIC_ASSERT(sizeof(VisibilityVertex) == 3 * 4 * sizeof(f32));
+
+VisibilityGeometry create_visibility_geometry(Model const *model, Err *err) {
+    if (*err) { return (VisibilityGeometry) { 0 }; }
+
+    usize meshes_len = model->meshes_len;
+    if (meshes_len > VISIBILITY_MESHES_MAX) {
+        GLOW_WARNING(
+            "only the first `%d` of `%zu` meshes have visibility ids",
+            VISIBILITY_MESHES_MAX,
+            meshes_len);
+        meshes_len = VISIBILITY_MESHES_MAX;
+    }
+
+    usize vertices_len = 0;
+    usize indices_len = 0;
+    for (usize i = 0; i < meshes_len; ++i) {
+        Mesh const *mesh = &model->meshes[i];
+        if (mesh->indices_len / 3 > VISIBILITY_TRIANGLES_MAX) {
+            GLOW_WARNING("mesh `%zu` has too many triangles for visibility ids", i);
+        }
+        vertices_len += mesh->vertices_len;
+        indices_len += mesh->indices_len;
+    }
+
+    usize *first_indices = calloc(meshes_len + 1, sizeof(usize));
+    VisibilityVertex *vertices = calloc(MAX(vertices_len, 1), sizeof(VisibilityVertex));
+    u32 *indices = calloc(MAX(indices_len, 1), sizeof(u32));
+    if (!first_indices || !vertices || !indices) {
+        *err = Err_Calloc;
+        free(indices);
+        free(vertices);
+        free(first_indices);
+        return (VisibilityGeometry) { 0 };
+    }
+
+    usize vertex_offset = 0;
+    usize index_offset = 0;
+    for (usize i = 0; i < meshes_len; ++i) {
+        Mesh const *mesh = &model->meshes[i];
+        for (usize j = 0; j < mesh->vertices_len; ++j) {
+            Vertex const *vertex = &mesh->vertices[j];
+            vertices[vertex_offset + j] = (VisibilityVertex) {
+                .position = vertex->position,
+                .u = vertex->texcoord.x,
+                .normal = vertex->normal,
+                .v = vertex->texcoord.y,
+                .tangent = vertex->tangent,
+            };
+        }
+        for (usize j = 0; j < mesh->indices_len; ++j) {
+            indices[index_offset + j] = (u32) (vertex_offset + mesh->indices[j]);
+        }
+
+        first_indices[i] = index_offset;
+        vertex_offset += mesh->vertices_len;
+        index_offset += mesh->indices_len;
+    }
+    first_indices[meshes_len] = index_offset;
+
+    int max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    if ((usize) max_texels < MAX(3 * vertices_len, indices_len)) {
+        GLOW_WARNING("model `%s` is too large for texture buffers", model->path);
+    }
+
+    VisibilityGeometry geometry = {
+        .vertices = create_texture_buffer(GL_RGBA32F),
+        .indices = create_texture_buffer(GL_R32UI),
+        .instances = create_texture_buffer(GL_RGBA32F),
+        .first_indices = first_indices,
+        .meshes_len = meshes_len,
+    };
+    update_texture_buffer(&geometry.vertices, vertices, vertices_len * sizeof(VisibilityVertex));
+    update_texture_buffer(&geometry.indices, indices, indices_len * sizeof(u32));
+
+    free(indices);
+    free(vertices);
+
+    return geometry;
+}
+
+void destroy_visibility_geometry(VisibilityGeometry *geometry) {
+    free(geometry->first_indices);
+    geometry->first_indices = NULL;
+    geometry->meshes_len = 0;
+
+    destroy_texture_buffer(&geometry->instances);
+    destroy_texture_buffer(&geometry->indices);
+    destroy_texture_buffer(&geometry->vertices);
+}
+
+void update_visibility_instances(
+    VisibilityGeometry *geometry, mat4 const local_to_worlds[], usize count) {
+    update_texture_buffer(&geometry->instances, local_to_worlds, count * sizeof(mat4));
+}
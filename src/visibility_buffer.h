@@ -0,0 +1,53 @@
+#pragma once
+
+#include "prelude.h"
+
+#include "maths_types.h"
+#include "texture_buffer.h"
+
+// Forward declarations.
+typedef struct Model Model;
+
+// @Note: with a visibility buffer, the geometry pass only writes which triangle of which
+// instance covers each pixel (along with depth, and the mesh's index in the stencil buffer),
+// and a later fullscreen pass fetches that triangle's vertices and material to shade it. So
+// material attributes are only computed (and written) once per pixel, regardless of overdraw.
+
+// @Volatile: keep in sync with VISIBILITY_INSTANCE_BITS in visibility.glsl (where a pixel's id
+// is its triangle's index within the mesh, shifted left by this, or'd with its instance index).
+#define VISIBILITY_INSTANCE_BITS 8
+#define VISIBILITY_INSTANCES_MAX (1 << VISIBILITY_INSTANCE_BITS)
+#define VISIBILITY_TRIANGLES_MAX (1u << (32 - VISIBILITY_INSTANCE_BITS))
+
+// @Note: meshes (or rather, each draw of at most VISIBILITY_INSTANCES_MAX of their instances) are
+// told apart by their stencil value, where 0 is left for empty pixels.
+#define VISIBILITY_MESHES_MAX 255
+
+// @Volatile: keep in sync with fetch_visibility_vertex() in visibility.glsl, which reads each
+// vertex from the `vertices` buffer as three RGBA32F texels.
+typedef struct VisibilityVertex {
+    vec3 position;
+    f32 u;
+    vec3 normal;
+    f32 v;
+    vec3 tangent;
+    f32 _padding;
+} VisibilityVertex;
+
+// @Note: every mesh of a model, flattened into buffers that shaders can fetch triangles from.
+typedef struct VisibilityGeometry {
+    TextureBuffer vertices; // RGBA32F, three texels per vertex
+    TextureBuffer indices; // R32UI, already offset by the first vertex of their mesh
+    TextureBuffer instances; // RGBA32F, four texels per instance (the rows of local_to_world)
+
+    usize *first_indices; // @Ownership (of each mesh, into indices)
+    usize meshes_len; // @Note: at most VISIBILITY_MESHES_MAX (any others aren't drawn)
+} VisibilityGeometry;
+
+VisibilityGeometry create_visibility_geometry(Model const *model, Err *err);
+void destroy_visibility_geometry(VisibilityGeometry *geometry);
+
+// @Note: should hold the local_to_worlds of every instanced draw, where each one's instances
+// start at some offset of them (and there are at most VISIBILITY_INSTANCES_MAX per draw).
+void update_visibility_instances(
+    VisibilityGeometry *geometry, mat4 const local_to_worlds[], usize count);